@@ -37,9 +37,14 @@
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
+#include <mutex>
+#include <set>
+#include <tuple>
 #include <utility>
 
 using namespace clang::ast_matchers;
@@ -409,46 +414,255 @@ ClangTidyOptions::OptionMap getCheckOptions(const ClangTidyOptions &Options) {
   return Factory.getCheckOptions();
 }
 
+namespace {
+
+/// \brief Lets several \c ClangTidyContexts share one options provider,
+/// serializing the accesses to it.
+class SynchronizedOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  SynchronizedOptionsProvider(ClangTidyOptionsProvider &Provider,
+                              std::mutex &Mutex)
+      : Provider(Provider), Mutex(Mutex) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Provider.getGlobalOptions();
+  }
+
+  std::vector<OptionsSource> getRawOptions(StringRef FileName) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Provider.getRawOptions(FileName);
+  }
+
+private:
+  ClangTidyOptionsProvider &Provider;
+  std::mutex &Mutex;
+};
+
+class ClangTidyActionFactory : public FrontendActionFactory {
+public:
+  /// \param BuildDirectory if not empty, overrides the build directory that
+  /// is otherwise derived from the working directory of the file system.
+  ClangTidyActionFactory(ClangTidyContext &Context,
+                         StringRef BuildDirectory = StringRef())
+      : Context(Context), ConsumerFactory(Context),
+        BuildDirectory(BuildDirectory) {}
+  FrontendAction *create() override { return new Action(this); }
+
+private:
+  class Action : public ASTFrontendAction {
+  public:
+    Action(ClangTidyActionFactory *Factory) : Factory(Factory) {}
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
+                                                   StringRef File) override {
+      auto Consumer =
+          Factory->ConsumerFactory.CreateASTConsumer(Compiler, File);
+      if (!Factory->BuildDirectory.empty())
+        Factory->Context.setCurrentBuildDirectory(Factory->BuildDirectory);
+      return Consumer;
+    }
+
+  private:
+    ClangTidyActionFactory *Factory;
+  };
+
+  ClangTidyContext &Context;
+  ClangTidyASTConsumerFactory ConsumerFactory;
+  std::string BuildDirectory;
+};
+
+} // end anonymous namespace
+
+// Add extra arguments passed by the clang-tidy command-line.
+static ArgumentsAdjuster
+getPerFileExtraArgumentsInserter(ClangTidyContext &Context) {
+  return [&Context](const CommandLineArguments &Args, StringRef Filename) {
+    ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
+    CommandLineArguments AdjustedArgs;
+    if (Opts.ExtraArgsBefore)
+      AdjustedArgs = *Opts.ExtraArgsBefore;
+    AdjustedArgs.insert(AdjustedArgs.begin(), Args.begin(), Args.end());
+    if (Opts.ExtraArgs)
+      AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
+                          Opts.ExtraArgs->end());
+    return AdjustedArgs;
+  };
+}
+
+// Remove plugins arguments.
+static CommandLineArguments
+removePluginArguments(const CommandLineArguments &Args, StringRef Filename) {
+  CommandLineArguments AdjustedArgs;
+  for (size_t I = 0, E = Args.size(); I < E; ++I) {
+    if (I + 4 < Args.size() && Args[I] == "-Xclang" &&
+        (Args[I + 1] == "-load" || Args[I + 1] == "-add-plugin" ||
+         StringRef(Args[I + 1]).startswith("-plugin-arg-")) &&
+        Args[I + 2] == "-Xclang") {
+      I += 3;
+    } else
+      AdjustedArgs.push_back(Args[I]);
+  }
+  return AdjustedArgs;
+}
+
+/// \brief Drops the errors that another translation unit already reported.
+///
+/// A diagnostic in a header shows up once for every translation unit that
+/// includes the header. Errors are identified by the file they point to,
+/// resolved against their build directory, their offset, check and message.
+static void removeDuplicateErrors(std::vector<ClangTidyError> &Errors,
+                                  ClangTidyStats &Stats) {
+  std::set<std::tuple<std::string, unsigned, std::string, std::string>> Seen;
+  auto IsDuplicate = [&](const ClangTidyError &Error) {
+    SmallString<256> Path(Error.Message.FilePath);
+    if (!Path.empty() && !llvm::sys::path::is_absolute(Path)) {
+      SmallString<256> Absolute(Error.BuildDirectory);
+      llvm::sys::path::append(Absolute, Path);
+      Path = Absolute;
+    }
+    llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+    return !Seen.insert(std::make_tuple(Path.str().str(),
+                                        Error.Message.FileOffset,
+                                        Error.CheckName,
+                                        Error.Message.Message))
+                .second;
+  };
+  auto End = std::remove_if(Errors.begin(), Errors.end(), IsDuplicate);
+  unsigned NumDuplicates = Errors.end() - End;
+  Stats.ErrorsDisplayed -= std::min(NumDuplicates, Stats.ErrorsDisplayed);
+  Stats.ErrorsIgnoredDuplicate += NumDuplicates;
+  Errors.erase(End, Errors.end());
+}
+
+static void mergeStats(ClangTidyStats &Stats, const ClangTidyStats &Other) {
+  Stats.ErrorsDisplayed += Other.ErrorsDisplayed;
+  Stats.ErrorsIgnoredCheckFilter += Other.ErrorsIgnoredCheckFilter;
+  Stats.ErrorsIgnoredNOLINT += Other.ErrorsIgnoredNOLINT;
+  Stats.ErrorsIgnoredNonUserCode += Other.ErrorsIgnoredNonUserCode;
+  Stats.ErrorsIgnoredLineFilter += Other.ErrorsIgnoredLineFilter;
+  Stats.ErrorsIgnoredDuplicate += Other.ErrorsIgnoredDuplicate;
+}
+
+/// \brief Runs clang-tidy over each compile command of \p InputFiles on a
+/// pool of \p NumThreads threads, or one per hardware thread if it is 0.
+///
+/// Every translation unit gets its own \c ClangTidyContext, diagnostic
+/// consumer and file manager. \c ClangTool is not used, since it changes the
+/// working directory of the process for each command; relative paths are
+/// resolved against the command's directory with -working-directory
+/// instead. The results are merged in the order of \p InputFiles, so the
+/// output does not depend on scheduling.
+static ClangTidyStats
+runClangTidyInParallel(ClangTidyOptionsProvider &OptionsProvider,
+                       const tooling::CompilationDatabase &Compilations,
+                       ArrayRef<std::string> InputFiles,
+                       std::vector<ClangTidyError> *Errors,
+                       ProfileData *Profile, unsigned NumThreads) {
+  std::vector<tooling::CompileCommand> Commands;
+  for (const std::string &InputFile : InputFiles) {
+    std::string File = tooling::getAbsolutePath(InputFile);
+    std::vector<tooling::CompileCommand> CommandsForFile =
+        Compilations.getCompileCommands(File);
+    if (CommandsForFile.empty()) {
+      llvm::errs() << "Skipping " << File << ". Compile command not found.\n";
+      continue;
+    }
+    Commands.insert(Commands.end(), CommandsForFile.begin(),
+                    CommandsForFile.end());
+  }
+
+  // Use the builtin headers of this binary rather than those of whatever
+  // compiler the compilation database refers to, as ClangTool does.
+  static int StaticSymbol;
+  std::string ResourceDir = CompilerInvocation::GetResourcesPath(
+      "clang_tool", static_cast<void *>(&StaticSymbol));
+
+  struct UnitResult {
+    std::vector<ClangTidyError> Errors;
+    ClangTidyStats Stats;
+    ProfileData Profile;
+  };
+  std::vector<UnitResult> Results(Commands.size());
+  auto PCHContainerOps = std::make_shared<PCHContainerOperations>();
+  std::mutex OptionsMutex;
+  std::mutex OutputMutex;
+
+  auto RunCommand = [&](unsigned Index) {
+    const tooling::CompileCommand &Command = Commands[Index];
+    UnitResult &Result = Results[Index];
+    ClangTidyContext Context(llvm::make_unique<SynchronizedOptionsProvider>(
+        OptionsProvider, OptionsMutex));
+    if (Profile)
+      Context.setCheckProfileData(&Result.Profile);
+
+    CommandLineArguments CommandLine = removePluginArguments(
+        getPerFileExtraArgumentsInserter(Context)(Command.CommandLine,
+                                                  Command.Filename),
+        Command.Filename);
+    assert(!CommandLine.empty());
+    CommandLine.insert(CommandLine.begin() + 1,
+                       {"-working-directory", Command.Directory});
+    if (std::none_of(CommandLine.begin(), CommandLine.end(),
+                     [](StringRef Arg) {
+                       return Arg.startswith("-resource-dir");
+                     }))
+      CommandLine.push_back("-resource-dir=" + ResourceDir);
+
+    FileSystemOptions FileSystemOpts;
+    FileSystemOpts.WorkingDir = Command.Directory;
+    IntrusiveRefCntPtr<FileManager> Files(new FileManager(FileSystemOpts));
+    ClangTidyDiagnosticConsumer DiagConsumer(Context);
+    ClangTidyActionFactory Factory(Context, Command.Directory);
+    tooling::ToolInvocation Invocation(std::move(CommandLine), &Factory,
+                                       Files.get(), PCHContainerOps);
+    Invocation.setDiagnosticConsumer(&DiagConsumer);
+    if (!Invocation.run()) {
+      std::lock_guard<std::mutex> Lock(OutputMutex);
+      llvm::errs() << "Error while processing " << Command.Filename << ".\n";
+    }
+
+    Result.Errors = Context.getErrors();
+    Result.Stats = Context.getStats();
+  };
+
+  {
+    std::unique_ptr<llvm::ThreadPool> Pool(
+        NumThreads ? new llvm::ThreadPool(NumThreads) : new llvm::ThreadPool());
+    for (unsigned I = 0, E = Commands.size(); I != E; ++I)
+      Pool->async(RunCommand, I);
+    Pool->wait();
+  }
+
+  ClangTidyStats Stats;
+  for (UnitResult &Result : Results) {
+    Errors->insert(Errors->end(), Result.Errors.begin(), Result.Errors.end());
+    mergeStats(Stats, Result.Stats);
+    if (Profile)
+      for (const auto &Record : Result.Profile.Records)
+        Profile->Records[Record.getKey()] += Record.getValue();
+  }
+  return Stats;
+}
+
 ClangTidyStats
 runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
-             std::vector<ClangTidyError> *Errors, ProfileData *Profile) {
+             std::vector<ClangTidyError> *Errors, ProfileData *Profile,
+             unsigned NumThreads) {
+  if (NumThreads != 1) {
+    ClangTidyStats Stats =
+        runClangTidyInParallel(*OptionsProvider, Compilations, InputFiles,
+                               Errors, Profile, NumThreads);
+    removeDuplicateErrors(*Errors, Stats);
+    return Stats;
+  }
+
   ClangTool Tool(Compilations, InputFiles);
   clang::tidy::ClangTidyContext Context(std::move(OptionsProvider));
 
-  // Add extra arguments passed by the clang-tidy command-line.
-  ArgumentsAdjuster PerFileExtraArgumentsInserter =
-      [&Context](const CommandLineArguments &Args, StringRef Filename) {
-        ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
-        CommandLineArguments AdjustedArgs;
-        if (Opts.ExtraArgsBefore)
-          AdjustedArgs = *Opts.ExtraArgsBefore;
-        AdjustedArgs.insert(AdjustedArgs.begin(), Args.begin(), Args.end());
-        if (Opts.ExtraArgs)
-          AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
-                              Opts.ExtraArgs->end());
-        return AdjustedArgs;
-      };
-
-  // Remove plugins arguments.
-  ArgumentsAdjuster PluginArgumentsRemover =
-      [&Context](const CommandLineArguments &Args, StringRef Filename) {
-        CommandLineArguments AdjustedArgs;
-        for (size_t I = 0, E = Args.size(); I < E; ++I) {
-          if (I + 4 < Args.size() && Args[I] == "-Xclang" &&
-              (Args[I + 1] == "-load" || Args[I + 1] == "-add-plugin" ||
-               StringRef(Args[I + 1]).startswith("-plugin-arg-")) &&
-              Args[I + 2] == "-Xclang") {
-            I += 3;
-          } else
-            AdjustedArgs.push_back(Args[I]);
-        }
-        return AdjustedArgs;
-      };
-
-  Tool.appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
-  Tool.appendArgumentsAdjuster(PluginArgumentsRemover);
+  Tool.appendArgumentsAdjuster(getPerFileExtraArgumentsInserter(Context));
+  Tool.appendArgumentsAdjuster(removePluginArguments);
   if (Profile)
     Context.setCheckProfileData(Profile);
 
@@ -456,31 +670,12 @@ runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
 
   Tool.setDiagnosticConsumer(&DiagConsumer);
 
-  class ActionFactory : public FrontendActionFactory {
-  public:
-    ActionFactory(ClangTidyContext &Context) : ConsumerFactory(Context) {}
-    FrontendAction *create() override { return new Action(&ConsumerFactory); }
-
-  private:
-    class Action : public ASTFrontendAction {
-    public:
-      Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
-      std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
-                                                     StringRef File) override {
-        return Factory->CreateASTConsumer(Compiler, File);
-      }
-
-    private:
-      ClangTidyASTConsumerFactory *Factory;
-    };
-
-    ClangTidyASTConsumerFactory ConsumerFactory;
-  };
-
-  ActionFactory Factory(Context);
+  ClangTidyActionFactory Factory(Context);
   Tool.run(&Factory);
   *Errors = Context.getErrors();
-  return Context.getStats();
+  ClangTidyStats Stats = Context.getStats();
+  removeDuplicateErrors(*Errors, Stats);
+  return Stats;
 }
 
 void handleErrors(const std::vector<ClangTidyError> &Errors, bool Fix,
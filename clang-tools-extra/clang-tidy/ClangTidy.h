@@ -208,14 +208,19 @@ ClangTidyOptions::OptionMap getCheckOptions(const ClangTidyOptions &Options);
 
 /// \brief Run a set of clang-tidy checks on a set of files.
 ///
+/// Errors that several translation units report at the same location, such
+/// as warnings in a shared header, are returned once.
+///
 /// \param Profile if provided, it enables check profile collection in
 /// MatchFinder, and will contain the result of the profile.
+/// \param NumThreads the number of translation units to process in
+/// parallel, or 0 to use one thread per hardware thread.
 ClangTidyStats
 runClangTidy(std::unique_ptr<ClangTidyOptionsProvider> OptionsProvider,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              std::vector<ClangTidyError> *Errors,
-             ProfileData *Profile = nullptr);
+             ProfileData *Profile = nullptr, unsigned NumThreads = 1);
 
 // FIXME: This interface will need to be significantly extended to be useful.
 // FIXME: Implement confidence levels for displaying/fixing errors.
@@ -182,6 +182,13 @@ code with clang-apply-replacements.
                                         cl::value_desc("filename"),
                                         cl::cat(ClangTidyCategory));
 
+static cl::opt<unsigned> NumThreads("j", cl::desc(R"(
+Number of translation units to process in
+parallel. 0 uses one thread per hardware thread.
+)"),
+                                    cl::init(1), cl::value_desc("threads"),
+                                    cl::cat(ClangTidyCategory));
+
 namespace clang {
 namespace tidy {
 
@@ -202,9 +209,14 @@ static void printStats(const ClangTidyStats &Stats) {
       llvm::errs() << Separator << Stats.ErrorsIgnoredNOLINT << " NOLINT";
       Separator = ", ";
     }
-    if (Stats.ErrorsIgnoredCheckFilter)
+    if (Stats.ErrorsIgnoredCheckFilter) {
       llvm::errs() << Separator << Stats.ErrorsIgnoredCheckFilter
                    << " with check filters";
+      Separator = ", ";
+    }
+    if (Stats.ErrorsIgnoredDuplicate)
+      llvm::errs() << Separator << Stats.ErrorsIgnoredDuplicate
+                   << " reported by another translation unit";
     llvm::errs() << ").\n";
     if (Stats.ErrorsIgnoredNonUserCode)
       llvm::errs() << "Use -header-filter=.* to display errors from all "
@@ -377,7 +389,7 @@ static int clangTidyMain(int argc, const char **argv) {
   ClangTidyStats Stats =
       runClangTidy(std::move(OptionsProvider), OptionsParser.getCompilations(),
                    PathList, &Errors,
-                   EnableCheckProfile ? &Profile : nullptr);
+                   EnableCheckProfile ? &Profile : nullptr, NumThreads);
   bool FoundErrors =
       std::find_if(Errors.begin(), Errors.end(), [](const ClangTidyError &E) {
         return E.DiagLevel == ClangTidyError::Error;
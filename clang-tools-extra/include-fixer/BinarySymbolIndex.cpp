@@ -0,0 +1,229 @@
+//===-- BinarySymbolIndex.cpp ---------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolIndex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/Path.h"
+#include <algorithm>
+#include <string>
+
+using clang::find_all_symbols::SymbolInfo;
+using namespace llvm::support;
+
+// The layout of the file, in which all integers are 32 bit little endian:
+//
+//   Header:   Magic, Version, NumNames, NumSymbols, NumContexts, StringsSize
+//   Names:    NumNames x {NameOffset, NameLength, FirstSymbol, NumSymbols},
+//             sorted by name
+//   Symbols:  NumSymbols x {PathOffset, PathLength, LineNumber, Kind,
+//             NumOccurrences, FirstContext, NumContexts}
+//   Contexts: NumContexts x {ContextType, NameOffset, NameLength}
+//   Strings:  StringsSize bytes
+static const char Magic[8] = {'I', 'F', 'X', 'S', 'Y', 'M', 'D', 'B'};
+static const uint32_t Version = 1;
+static const size_t HeaderSize = sizeof(Magic) + 5 * 4;
+static const size_t NameSize = 4 * 4;
+static const size_t SymbolSize = 7 * 4;
+static const size_t ContextSize = 3 * 4;
+
+static uint32_t readField(const char *Entry, unsigned Field) {
+  return endian::read32le(Entry + Field * 4);
+}
+
+namespace clang {
+namespace include_fixer {
+
+llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+BinarySymbolIndex::createFromFile(llvm::StringRef FilePath) {
+  auto Buffer = llvm::MemoryBuffer::getFile(FilePath, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return Buffer.getError();
+  return createFromBuffer(std::move(*Buffer));
+}
+
+llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+BinarySymbolIndex::createFromDirectory(llvm::StringRef Directory,
+                                       llvm::StringRef Name) {
+  // Walk upwards from Directory, looking for files.
+  for (llvm::SmallString<128> PathStorage = Directory; !Directory.empty();
+       Directory = llvm::sys::path::parent_path(Directory)) {
+    assert(Directory.size() <= PathStorage.size());
+    PathStorage.resize(Directory.size()); // Shrink to parent.
+    llvm::sys::path::append(PathStorage, Name);
+    if (auto DB = createFromFile(PathStorage))
+      return DB;
+  }
+  return llvm::make_error_code(llvm::errc::no_such_file_or_directory);
+}
+
+llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+BinarySymbolIndex::createFromBuffer(
+    std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  llvm::StringRef Data = Buffer->getBuffer();
+  if (Data.size() < HeaderSize ||
+      !Data.startswith(llvm::StringRef(Magic, sizeof(Magic))) ||
+      readField(Data.data() + sizeof(Magic), 0) != Version)
+    return llvm::make_error_code(llvm::errc::invalid_argument);
+
+  std::unique_ptr<BinarySymbolIndex> DB(
+      new BinarySymbolIndex(std::move(Buffer)));
+  const char *Header = Data.data() + sizeof(Magic);
+  DB->NumNames = readField(Header, 1);
+  DB->NumSymbols = readField(Header, 2);
+  DB->NumContexts = readField(Header, 3);
+  uint32_t StringsSize = readField(Header, 4);
+
+  uint64_t Size = HeaderSize + uint64_t(DB->NumNames) * NameSize +
+                  uint64_t(DB->NumSymbols) * SymbolSize +
+                  uint64_t(DB->NumContexts) * ContextSize + StringsSize;
+  if (Size != Data.size())
+    return llvm::make_error_code(llvm::errc::invalid_argument);
+
+  DB->Names = Data.data() + HeaderSize;
+  DB->Symbols = DB->Names + DB->NumNames * NameSize;
+  DB->Contexts = DB->Symbols + DB->NumSymbols * SymbolSize;
+  DB->Strings = Data.substr(Data.size() - StringsSize);
+  return std::move(DB);
+}
+
+void BinarySymbolIndex::write(llvm::raw_ostream &OS,
+                              const std::vector<SymbolInfo> &Symbols) {
+  std::string Strings;
+  llvm::StringMap<uint32_t> StringOffsets;
+  auto AddString = [&](llvm::StringRef S) {
+    auto Inserted = StringOffsets.insert(std::make_pair(S, Strings.size()));
+    if (Inserted.second)
+      Strings += S;
+    return Inserted.first->second;
+  };
+
+  // Group the symbols by name, keeping the order of the symbols of a name.
+  std::vector<const SymbolInfo *> Sorted;
+  for (const SymbolInfo &Symbol : Symbols)
+    Sorted.push_back(&Symbol);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const SymbolInfo *LHS, const SymbolInfo *RHS) {
+                     return LHS->getName() < RHS->getName();
+                   });
+
+  std::string Names, SymbolTable, ContextTable;
+  llvm::raw_string_ostream NamesOS(Names), SymbolsOS(SymbolTable),
+      ContextsOS(ContextTable);
+  endian::Writer<little> NameWriter(NamesOS), SymbolWriter(SymbolsOS),
+      ContextWriter(ContextsOS);
+  uint32_t NumNames = 0, NumContexts = 0;
+  for (size_t I = 0, E = Sorted.size(); I != E;) {
+    llvm::StringRef Name = Sorted[I]->getName();
+    size_t First = I;
+    for (; I != E && Sorted[I]->getName() == Name; ++I) {
+      const SymbolInfo &Symbol = *Sorted[I];
+      SymbolWriter.write<uint32_t>(AddString(Symbol.getFilePath()));
+      SymbolWriter.write<uint32_t>(Symbol.getFilePath().size());
+      SymbolWriter.write<uint32_t>(Symbol.getLineNumber());
+      SymbolWriter.write<uint32_t>(
+          static_cast<uint32_t>(Symbol.getSymbolKind()));
+      SymbolWriter.write<uint32_t>(Symbol.getNumOccurrences());
+      SymbolWriter.write<uint32_t>(NumContexts);
+      SymbolWriter.write<uint32_t>(Symbol.getContexts().size());
+      for (const SymbolInfo::Context &Context : Symbol.getContexts()) {
+        ContextWriter.write<uint32_t>(static_cast<uint32_t>(Context.first));
+        ContextWriter.write<uint32_t>(AddString(Context.second));
+        ContextWriter.write<uint32_t>(Context.second.size());
+        ++NumContexts;
+      }
+    }
+    NameWriter.write<uint32_t>(AddString(Name));
+    NameWriter.write<uint32_t>(Name.size());
+    NameWriter.write<uint32_t>(First);
+    NameWriter.write<uint32_t>(I - First);
+    ++NumNames;
+  }
+
+  endian::Writer<little> Writer(OS);
+  OS.write(Magic, sizeof(Magic));
+  Writer.write<uint32_t>(Version);
+  Writer.write<uint32_t>(NumNames);
+  Writer.write<uint32_t>(Sorted.size());
+  Writer.write<uint32_t>(NumContexts);
+  Writer.write<uint32_t>(Strings.size());
+  OS << NamesOS.str() << SymbolsOS.str() << ContextsOS.str() << Strings;
+}
+
+llvm::StringRef BinarySymbolIndex::getString(uint32_t Offset,
+                                             uint32_t Length) const {
+  if (uint64_t(Offset) + Length > Strings.size())
+    return llvm::StringRef();
+  return Strings.substr(Offset, Length);
+}
+
+llvm::StringRef BinarySymbolIndex::getName(uint32_t Index) const {
+  const char *Entry = Names + Index * NameSize;
+  return getString(readField(Entry, 0), readField(Entry, 1));
+}
+
+SymbolInfo BinarySymbolIndex::getSymbol(llvm::StringRef Name,
+                                        uint32_t Index) const {
+  const char *Entry = Symbols + Index * SymbolSize;
+  uint32_t Kind = readField(Entry, 3);
+  if (Kind > static_cast<uint32_t>(SymbolInfo::SymbolKind::Unknown))
+    Kind = static_cast<uint32_t>(SymbolInfo::SymbolKind::Unknown);
+
+  std::vector<SymbolInfo::Context> SymbolContexts;
+  uint32_t FirstContext = readField(Entry, 5);
+  uint32_t NumSymbolContexts = readField(Entry, 6);
+  if (uint64_t(FirstContext) + NumSymbolContexts <= NumContexts) {
+    for (uint32_t I = FirstContext, E = FirstContext + NumSymbolContexts;
+         I != E; ++I) {
+      const char *Context = Contexts + I * ContextSize;
+      uint32_t Type = readField(Context, 0);
+      if (Type > static_cast<uint32_t>(SymbolInfo::ContextType::EnumDecl))
+        Type = static_cast<uint32_t>(SymbolInfo::ContextType::Namespace);
+      SymbolContexts.emplace_back(
+          static_cast<SymbolInfo::ContextType>(Type),
+          getString(readField(Context, 1), readField(Context, 2)));
+    }
+  }
+
+  return SymbolInfo(Name, static_cast<SymbolInfo::SymbolKind>(Kind),
+                    getString(readField(Entry, 0), readField(Entry, 1)),
+                    static_cast<int>(readField(Entry, 2)), SymbolContexts,
+                    readField(Entry, 4));
+}
+
+std::vector<SymbolInfo> BinarySymbolIndex::search(llvm::StringRef Identifier) {
+  // Binary search the name table.
+  uint32_t Low = 0, High = NumNames;
+  while (Low < High) {
+    uint32_t Middle = Low + (High - Low) / 2;
+    if (getName(Middle) < Identifier)
+      Low = Middle + 1;
+    else
+      High = Middle;
+  }
+
+  std::vector<SymbolInfo> Results;
+  if (Low == NumNames || getName(Low) != Identifier)
+    return Results;
+
+  const char *Entry = Names + Low * NameSize;
+  uint32_t FirstSymbol = readField(Entry, 2);
+  uint32_t NumNameSymbols = readField(Entry, 3);
+  if (uint64_t(FirstSymbol) + NumNameSymbols > NumSymbols)
+    return Results;
+  for (uint32_t I = FirstSymbol, E = FirstSymbol + NumNameSymbols; I != E; ++I)
+    Results.push_back(getSymbol(Identifier, I));
+  return Results;
+}
+
+} // namespace include_fixer
+} // namespace clang
@@ -0,0 +1,83 @@
+//===-- BinarySymbolIndex.h -------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
+#define LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
+
+#include "SymbolIndex.h"
+#include "find-all-symbols/SymbolInfo.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <vector>
+
+namespace clang {
+namespace include_fixer {
+
+/// Binary format database.
+///
+/// The file is mapped into memory and searched in place: a table of the
+/// distinct symbol names, sorted so that it can be binary searched, points to
+/// the symbols of each name, which in turn point to their contexts and into a
+/// table of deduplicated strings. Opening the database does not depend on its
+/// size, and a search only touches the pages of the names it compares and of
+/// the symbols it returns.
+///
+/// Databases are created from the YAML output of find-all-symbols with
+/// clang-include-fixer-convert-db.
+class BinarySymbolIndex : public SymbolIndex {
+public:
+  /// Open a binary db file.
+  static llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+  createFromFile(llvm::StringRef FilePath);
+  /// Look for a file called \c Name in \c Directory and all parent directories.
+  static llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+  createFromDirectory(llvm::StringRef Directory, llvm::StringRef Name);
+  /// Open a binary db held in \c Buffer.
+  static llvm::ErrorOr<std::unique_ptr<BinarySymbolIndex>>
+  createFromBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  /// Write \c Symbols as a binary db.
+  static void write(llvm::raw_ostream &OS,
+                    const std::vector<find_all_symbols::SymbolInfo> &Symbols);
+
+  std::vector<clang::find_all_symbols::SymbolInfo>
+  search(llvm::StringRef Identifier) override;
+
+  /// The number of distinct symbol names in the db.
+  unsigned getNumNames() const { return NumNames; }
+
+private:
+  explicit BinarySymbolIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  /// Returns the string at \p Offset in the string table, or an empty string
+  /// if it is out of bounds.
+  llvm::StringRef getString(uint32_t Offset, uint32_t Length) const;
+
+  llvm::StringRef getName(uint32_t Index) const;
+
+  find_all_symbols::SymbolInfo getSymbol(llvm::StringRef Name,
+                                         uint32_t Index) const;
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  uint32_t NumNames = 0;
+  uint32_t NumSymbols = 0;
+  uint32_t NumContexts = 0;
+  const char *Names = nullptr;
+  const char *Symbols = nullptr;
+  const char *Contexts = nullptr;
+  llvm::StringRef Strings;
+};
+
+} // namespace include_fixer
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_INCLUDE_FIXER_BINARYSYMBOLINDEX_H
@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "BinarySymbolIndex.h"
 #include "InMemorySymbolIndex.h"
 #include "IncludeFixer.h"
 #include "IncludeFixerContext.h"
@@ -84,12 +85,15 @@ cl::OptionCategory IncludeFixerCategory("Tool options");
 enum DatabaseFormatTy {
   fixed, ///< Hard-coded mapping.
   yaml,  ///< Yaml database created by find-all-symbols.
+  binary ///< Binary database created by clang-include-fixer-convert-db.
 };
 
 cl::opt<DatabaseFormatTy> DatabaseFormat(
     "db", cl::desc("Specify input format"),
     cl::values(clEnumVal(fixed, "Hard-coded mapping"),
                clEnumVal(yaml, "Yaml database created by find-all-symbols"),
+               clEnumVal(binary, "Binary database created by "
+                                 "clang-include-fixer-convert-db"),
                clEnumValEnd),
     cl::init(yaml), cl::cat(IncludeFixerCategory));
 
@@ -197,6 +201,29 @@ createSymbolIndexManager(StringRef FilePath) {
     SymbolIndexMgr->addSymbolIndex(std::move(*DB));
     break;
   }
+  case binary: {
+    llvm::ErrorOr<std::unique_ptr<include_fixer::BinarySymbolIndex>> DB(
+        nullptr);
+    if (!Input.empty()) {
+      DB = include_fixer::BinarySymbolIndex::createFromFile(Input);
+    } else {
+      // If we don't have any input file, look in the directory of the first
+      // file and its parents.
+      SmallString<128> AbsolutePath(tooling::getAbsolutePath(FilePath));
+      StringRef Directory = llvm::sys::path::parent_path(AbsolutePath);
+      DB = include_fixer::BinarySymbolIndex::createFromDirectory(
+          Directory, "find_all_symbols_db.bin");
+    }
+
+    if (!DB) {
+      llvm::errs() << "Couldn't find binary db: " << DB.getError().message()
+                   << '\n';
+      return nullptr;
+    }
+
+    SymbolIndexMgr->addSymbolIndex(std::move(*DB));
+    break;
+  }
   }
   return SymbolIndexMgr;
 }
@@ -0,0 +1,55 @@
+//===-- ConvertSymbolDatabase.cpp - Convert a YAML db to binary -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Converts the YAML symbol database written by find-all-symbols into the
+// binary database read by clang-include-fixer -db=binary, which can be
+// searched without loading it as a whole.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolIndex.h"
+#include "find-all-symbols/SymbolInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional,
+                                      cl::desc("<find-all-symbols YAML db>"),
+                                      cl::Required);
+
+static cl::opt<std::string> OutputFile("o", cl::desc("Output binary db"),
+                                       cl::value_desc("filename"),
+                                       cl::init("find_all_symbols_db.bin"));
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(
+      argc, argv, "Convert a find-all-symbols YAML db to a binary db\n");
+
+  auto Buffer = MemoryBuffer::getFileOrSTDIN(InputFile);
+  if (!Buffer) {
+    errs() << "Can't open '" << InputFile
+           << "': " << Buffer.getError().message() << '\n';
+    return 1;
+  }
+  std::vector<find_all_symbols::SymbolInfo> Symbols =
+      find_all_symbols::ReadSymbolInfosFromYAML(Buffer.get()->getBuffer());
+
+  std::error_code EC;
+  raw_fd_ostream OS(OutputFile, EC, sys::fs::F_None);
+  if (EC) {
+    errs() << "Can't open '" << OutputFile << "': " << EC.message() << '\n';
+    return 1;
+  }
+  include_fixer::BinarySymbolIndex::write(OS, Symbols);
+  return 0;
+}
@@ -0,0 +1,28 @@
+// REQUIRES: shell
+// RUN: rm -rf %T/parallel-test
+// RUN: mkdir -p %T/parallel-test/include %T/parallel-test/src
+// RUN: echo 'int *HP = 0;' > %T/parallel-test/include/header.h
+// RUN: echo '#include "header.h"' > %T/parallel-test/src/a.cpp
+// RUN: echo 'int *AA = 0;' >> %T/parallel-test/src/a.cpp
+// RUN: echo '#include "header.h"' > %T/parallel-test/src/b.cpp
+// RUN: echo 'int *BB = 0;' >> %T/parallel-test/src/b.cpp
+// RUN: echo '[{"directory":"%T/parallel-test/src","command":"clang++ -I../include -c a.cpp","file":"%T/parallel-test/src/a.cpp"},{"directory":"%T/parallel-test/src","command":"clang++ -I../include -c b.cpp","file":"%T/parallel-test/src/b.cpp"}]' > %T/parallel-test/compile_commands.json
+// RUN: clang-tidy --checks=-*,modernize-use-nullptr -p %T/parallel-test %T/parallel-test/src/a.cpp %T/parallel-test/src/b.cpp -header-filter=.* -j 2 > %t.out 2>&1
+// RUN: FileCheck -input-file=%t.out %s
+// RUN: grep -c 'header.h:1:10: warning' %t.out | FileCheck -check-prefix=CHECK-COUNT %s
+// RUN: clang-tidy --checks=-*,modernize-use-nullptr -p %T/parallel-test %T/parallel-test/src/a.cpp %T/parallel-test/src/b.cpp -header-filter=.* -j 2 -fix
+// RUN: FileCheck -input-file=%T/parallel-test/include/header.h %s -check-prefix=CHECK-FIX1
+// RUN: FileCheck -input-file=%T/parallel-test/src/a.cpp %s -check-prefix=CHECK-FIX2
+// RUN: FileCheck -input-file=%T/parallel-test/src/b.cpp %s -check-prefix=CHECK-FIX3
+
+// The warning in the shared header is reported by both translation units,
+// but only shown once.
+// CHECK-DAG: header.h:1:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-DAG: a.cpp:2:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-DAG: b.cpp:2:10: warning: use nullptr [modernize-use-nullptr]
+// CHECK-DAG: Suppressed 1 warnings (1 reported by another translation unit).
+// CHECK-COUNT: {{^1$}}
+
+// CHECK-FIX1: int *HP = nullptr;
+// CHECK-FIX2: int *AA = nullptr;
+// CHECK-FIX3: int *BB = nullptr;
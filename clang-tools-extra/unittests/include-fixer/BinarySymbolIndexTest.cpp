@@ -0,0 +1,101 @@
+//===-- BinarySymbolIndexTest.cpp - Binary symbol index unit tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BinarySymbolIndex.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace include_fixer {
+namespace {
+
+using find_all_symbols::SymbolInfo;
+
+static std::unique_ptr<BinarySymbolIndex>
+createIndex(const std::vector<SymbolInfo> &Symbols) {
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  BinarySymbolIndex::write(OS, Symbols);
+  auto DB = BinarySymbolIndex::createFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(OS.str()));
+  EXPECT_TRUE(static_cast<bool>(DB));
+  return DB ? std::move(*DB) : nullptr;
+}
+
+TEST(BinarySymbolIndexTest, RoundTrip) {
+  std::vector<SymbolInfo> Symbols = {
+      SymbolInfo("foo", SymbolInfo::SymbolKind::Class, "foo.h", 1,
+                 {{SymbolInfo::ContextType::Namespace, "b"},
+                  {SymbolInfo::ContextType::Namespace, "a"}},
+                 /*NumOccurrences=*/3),
+      SymbolInfo("bar", SymbolInfo::SymbolKind::Function, "bar.h", 7, {}, 1),
+      SymbolInfo("foo", SymbolInfo::SymbolKind::Variable, "foo.h", 12,
+                 {{SymbolInfo::ContextType::Record, "S"}}, 2),
+      SymbolInfo("E", SymbolInfo::SymbolKind::EnumConstantDecl, "e.h", 2,
+                 {{SymbolInfo::ContextType::EnumDecl, "Color"}}, 1),
+  };
+  auto DB = createIndex(Symbols);
+  ASSERT_TRUE(DB != nullptr);
+  EXPECT_EQ(3u, DB->getNumNames());
+
+  std::vector<SymbolInfo> Foo = DB->search("foo");
+  ASSERT_EQ(2u, Foo.size());
+  EXPECT_EQ(Symbols[0], Foo[0]);
+  EXPECT_EQ(3u, Foo[0].getNumOccurrences());
+  EXPECT_EQ("a::b::foo", Foo[0].getQualifiedName());
+  EXPECT_EQ(Symbols[2], Foo[1]);
+  EXPECT_EQ(2u, Foo[1].getNumOccurrences());
+
+  std::vector<SymbolInfo> Bar = DB->search("bar");
+  ASSERT_EQ(1u, Bar.size());
+  EXPECT_EQ(Symbols[1], Bar[0]);
+  std::vector<SymbolInfo> E = DB->search("E");
+  ASSERT_EQ(1u, E.size());
+  EXPECT_EQ(Symbols[3], E[0]);
+
+  EXPECT_TRUE(DB->search("fo").empty());
+  EXPECT_TRUE(DB->search("").empty());
+  EXPECT_TRUE(DB->search("zzz").empty());
+}
+
+TEST(BinarySymbolIndexTest, ManyNames) {
+  std::vector<SymbolInfo> Symbols;
+  for (unsigned I = 0; I != 1000; ++I)
+    Symbols.push_back(SymbolInfo("name" + std::to_string(I * 7 % 1000),
+                                 SymbolInfo::SymbolKind::Class,
+                                 "header" + std::to_string(I % 10) + ".h", I,
+                                 {}, 1));
+  auto DB = createIndex(Symbols);
+  ASSERT_TRUE(DB != nullptr);
+  EXPECT_EQ(1000u, DB->getNumNames());
+  for (const SymbolInfo &Symbol : Symbols) {
+    std::vector<SymbolInfo> Results = DB->search(Symbol.getName());
+    ASSERT_EQ(1u, Results.size());
+    EXPECT_EQ(Symbol, Results[0]);
+  }
+  EXPECT_TRUE(DB->search("name1000").empty());
+}
+
+TEST(BinarySymbolIndexTest, RejectsInvalidData) {
+  EXPECT_FALSE(BinarySymbolIndex::createFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy("---\nName: foo\n...\n")));
+
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  BinarySymbolIndex::write(
+      OS, {SymbolInfo("foo", SymbolInfo::SymbolKind::Class, "foo.h", 1, {})});
+  OS.flush();
+  EXPECT_TRUE(static_cast<bool>(BinarySymbolIndex::createFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(Data))));
+  EXPECT_FALSE(BinarySymbolIndex::createFromBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(Data.substr(0, Data.size() - 1))));
+}
+
+} // namespace
+} // namespace include_fixer
+} // namespace clang
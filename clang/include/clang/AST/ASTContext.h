@@ -34,10 +34,12 @@
 #include "clang/Basic/SanitizerBlacklist.h"
 #include "clang/Basic/VersionTuple.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Support/Allocator.h"
 #include <memory>
@@ -60,6 +62,7 @@ namespace clang {
   class MaterializeTemporaryExpr;
   class SelectorTable;
   class TargetInfo;
+  class TemplateArgumentList;
   class CXXABI;
   class MangleNumberingContext;
   // Decls
@@ -187,6 +190,11 @@ class ASTContext : public RefCountedBase<ASTContext> {
   llvm::DenseMap<const MaterializeTemporaryExpr *, APValue *>
     MaterializedTemporaryValues;
 
+  /// \brief Mapping from constexpr function calls whose result only depends
+  /// on the values of their arguments to that result. Each key encodes the
+  /// callee and the argument values; see ExprConstant.cpp.
+  llvm::StringMap<APValue *> ConstexprCallResults;
+
   /// \brief Representation of a "canonical" template template parameter that
   /// is used in canonical template names.
   class CanonicalTemplateTemplateParm : public llvm::FoldingSetNode {
@@ -444,6 +452,27 @@ private:
   /// AST objects will be released when the ASTContext itself is destroyed.
   mutable llvm::BumpPtrAllocator BumpAlloc;
 
+  /// \brief DenseMapInfo for the template argument lists that are shared,
+  /// which can also be looked up by their arguments.
+  struct TemplateArgumentListIdentityInfo {
+    static TemplateArgumentList *getEmptyKey();
+    static TemplateArgumentList *getTombstoneKey();
+    static unsigned getHashValue(ArrayRef<TemplateArgument> Args);
+    static unsigned getHashValue(const TemplateArgumentList *List);
+    static bool isEqual(ArrayRef<TemplateArgument> LHS,
+                        const TemplateArgumentList *RHS);
+    static bool isEqual(const TemplateArgumentList *LHS,
+                        const TemplateArgumentList *RHS);
+  };
+
+  /// \brief The template argument lists created by
+  /// TemplateArgumentList::CreateCopy that can be shared, because their
+  /// arguments are compared by identity.
+  mutable llvm::DenseSet<TemplateArgumentList *,
+                         TemplateArgumentListIdentityInfo>
+      SharedTemplateArgumentLists;
+  friend class TemplateArgumentList;
+
   /// \brief Allocator for partial diagnostics.
   PartialDiagnostic::StorageAllocator DiagAllocator;
 
@@ -578,6 +607,8 @@ public:
   }
 
   void *Allocate(size_t Size, unsigned Align = 8) const {
+    if (CollectAllocationStats)
+      AllocatedBytes[CurAllocationSource] += Size;
     return BumpAlloc.Allocate(Size, Align);
   }
   template <typename T> T *Allocate(size_t Num = 1) const {
@@ -592,7 +623,39 @@ public:
   }
   /// Return the total memory used for various side tables.
   size_t getSideTableAllocatedMemory() const;
-  
+
+  /// \brief What the AST nodes being allocated are created for.
+  enum AllocationSource {
+    /// \brief Parsing and analyzing the source code.
+    AS_Parse,
+    /// \brief Instantiating templates and deducing template arguments.
+    AS_TemplateInstantiation,
+    NumAllocationSources
+  };
+
+  /// \brief Start attributing the memory allocated for AST nodes to the
+  /// allocation sources, to be printed by PrintStats().
+  void enableAllocationStats() { CollectAllocationStats = true; }
+  bool allocationStatsEnabled() const { return CollectAllocationStats; }
+
+  AllocationSource getAllocationSource() const { return CurAllocationSource; }
+  void setAllocationSource(AllocationSource Source) {
+    CurAllocationSource = Source;
+  }
+
+  /// \brief Return the number of bytes allocated for AST nodes on behalf of
+  /// \p Source since the allocation statistics were enabled.
+  uint64_t getAllocatedBytes(AllocationSource Source) const {
+    return AllocatedBytes[Source];
+  }
+
+private:
+  /// \brief Whether allocations are attributed to allocation sources.
+  bool CollectAllocationStats = false;
+  AllocationSource CurAllocationSource = AS_Parse;
+  mutable uint64_t AllocatedBytes[NumAllocationSources] = {};
+
+public:
   PartialDiagnostic::StorageAllocator &getDiagAllocator() {
     return DiagAllocator;
   }
@@ -2461,6 +2524,18 @@ public:
   APValue *getMaterializedTemporaryValue(const MaterializeTemporaryExpr *E,
                                          bool MayCreate);
 
+  /// \brief Get the storage for the memoized result of the constexpr function
+  /// call encoded by \p Key.
+  ///
+  /// \returns the stored result, a new empty value if there is none and
+  /// \p MayCreate is true, or null otherwise.
+  APValue *getConstexprCallResult(StringRef Key, bool MayCreate);
+
+  /// \brief The number of constexpr function call results memoized so far.
+  unsigned getNumConstexprCallResults() const {
+    return ConstexprCallResults.size();
+  }
+
   //===--------------------------------------------------------------------===//
   //                    Statistics
   //===--------------------------------------------------------------------===//
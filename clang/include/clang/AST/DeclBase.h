@@ -339,7 +339,7 @@ protected:
       IdentifierNamespace(getIdentifierNamespaceForKind(DK)),
       CacheValidAndLinkage(0)
   {
-    if (StatisticsEnabled) add(DK);
+    if (StatisticsEnabled) add(DK, DC);
   }
 
   Decl(Kind DK, EmptyShell Empty)
@@ -879,7 +879,9 @@ public:
   SourceLocation getBodyRBrace() const;
 
   // global temp stats (until we have a per-module visitor)
-  static void add(Kind k);
+  /// \brief Count a declaration of kind \p k, which is created in \p DC,
+  /// if known, and attributed to its ASTContext's allocation source.
+  static void add(Kind k, const DeclContext *DC = nullptr);
   static void EnableStatistics();
   static void PrintStats();
 
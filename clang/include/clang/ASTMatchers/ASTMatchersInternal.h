@@ -257,6 +257,15 @@ public:
   virtual bool dynMatches(const ast_type_traits::DynTypedNode &DynNode,
                           ASTMatchFinder *Finder,
                           BoundNodesTreeBuilder *Builder) const = 0;
+
+  /// \brief Returns true if this matcher can only match \c NamedDecl nodes
+  /// whose identifier is one of \p Names, which are then added to \p Names.
+  ///
+  /// Used by the \c MatchFinder to only try the matcher on declarations of
+  /// those names. Returning false is always correct.
+  virtual bool getRequiredNames(SmallVectorImpl<StringRef> &Names) const {
+    return false;
+  }
 };
 
 /// \brief Generic interface for matchers on an AST node of type T.
@@ -370,6 +379,14 @@ public:
                           ASTMatchFinder *Finder,
                           BoundNodesTreeBuilder *Builder) const;
 
+  /// \brief Returns true if the matcher can only match \c NamedDecl nodes
+  /// whose identifier is one of \p Names.
+  ///
+  /// See \c DynMatcherInterface::getRequiredNames().
+  bool getRequiredNames(SmallVectorImpl<StringRef> &Names) const {
+    return Implementation->getRequiredNames(Names);
+  }
+
   /// \brief Bind the specified \p ID to the matcher.
   /// \return A new matcher with the \p ID bound to it if this matcher supports
   ///   binding. Otherwise, returns an empty \c Optional<>.
@@ -679,6 +696,8 @@ class HasNameMatcher : public SingleNodeMatcherInterface<NamedDecl> {
 
   bool matchesNode(const NamedDecl &Node) const override;
 
+  bool getRequiredNames(SmallVectorImpl<StringRef> &Names) const override;
+
  private:
   /// \brief Unqualified match routine.
   ///
@@ -18,6 +18,7 @@
 #include "clang/Basic/LangOptions.h"
 #include "clang/Tooling/Core/Replacement.h"
 #include "llvm/ADT/ArrayRef.h"
+#include <memory>
 #include <system_error>
 
 namespace clang {
@@ -810,6 +811,49 @@ tooling::Replacements reformat(const FormatStyle &Style, StringRef Code,
                                StringRef FileName = "<stdin>",
                                bool *IncompleteFormat = nullptr);
 
+/// \brief Reformats successive versions of a file, such as the buffer of an
+/// editor that formats as the user types.
+///
+/// \c reformat() lexes, parses and annotates the whole file on every call,
+/// even if only one line is to be formatted. An \c IncrementalFormatter
+/// remembers how the previous version of the file splits into regions that
+/// can be formatted independently (top-level declarations separated by empty
+/// lines) and the properties from which style options such as
+/// ``DerivePointerAlignment`` are derived. The next call only processes the
+/// regions around the changes and the ranges to format.
+///
+/// The replacements are the same as those returned by \c reformat(). Code for
+/// which this cannot be guaranteed, such as code with ``#else`` branches,
+/// languages other than C++ and styles with ``MaxEmptyLinesToKeep`` set to 0,
+/// is processed as a whole.
+class IncrementalFormatter {
+public:
+  IncrementalFormatter(const FormatStyle &Style,
+                       StringRef FileName = "<stdin>");
+  ~IncrementalFormatter();
+
+  /// \brief Returns the replacements necessary to make all \p Ranges of \p
+  /// Code comply with the style, like \c reformat().
+  ///
+  /// \p Code is compared to the code passed to the previous call to find the
+  /// regions that changed.
+  tooling::Replacements reformat(StringRef Code,
+                                 ArrayRef<tooling::Range> Ranges,
+                                 bool *IncompleteFormat = nullptr);
+
+  /// \brief Returns the number of bytes of code that the last call to
+  /// \c reformat() had to process.
+  unsigned getLastProcessedLength() const { return LastProcessedLength; }
+
+private:
+  struct State;
+
+  FormatStyle Style;
+  std::string FileName;
+  std::unique_ptr<State> S;
+  unsigned LastProcessedLength = 0;
+};
+
 /// \brief Clean up any erroneous/redundant code in the given \p Ranges in the
 /// file \p ID.
 ///
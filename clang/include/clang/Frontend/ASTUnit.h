@@ -26,11 +26,15 @@
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Serialization/ASTBitCodes.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/MD5.h"
 #include <cassert>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sys/types.h>
 #include <utility>
@@ -54,6 +58,7 @@ class HeaderSearch;
 class Preprocessor;
 class PCHContainerOperations;
 class PCHContainerReader;
+class PrecompiledPreambleCache;
 class TargetInfo;
 class FrontendAction;
 class ASTDeserializationListener;
@@ -287,6 +292,28 @@ private:
   /// \brief A list of the serialization ID numbers for each of the top-level
   /// declarations parsed within the precompiled preamble.
   std::vector<serialization::DeclID> TopLevelDeclsInPreamble;
+
+public:
+  /// \brief A precompiled preamble that can be shared between ASTUnits.
+  struct SharedPreamble;
+
+private:
+  /// \brief The cache through which this unit shares precompiled preambles
+  /// with other ASTUnits, if any.
+  std::shared_ptr<PrecompiledPreambleCache> PreambleCache;
+
+  /// \brief The shared precompiled preamble this unit is using, if it came
+  /// from (or was published to) \c PreambleCache. The preamble file is then
+  /// owned by the shared preamble rather than by this unit.
+  std::shared_ptr<const SharedPreamble> CurrentSharedPreamble;
+
+  /// \brief Retrieve the file containing the precompiled preamble in use, or
+  /// an empty string if there is none.
+  const std::string &getPrecompiledPreambleFile();
+
+  /// \brief Make this unit use a precompiled preamble built by another one.
+  void adoptSharedPreamble(std::shared_ptr<const SharedPreamble> Shared,
+                           const FileEntry *MainFile);
   
   /// \brief Whether we should be caching code-completion results.
   bool ShouldCacheCodeCompletionResults : 1;
@@ -831,6 +858,9 @@ public:
   /// (e.g. because the PCH could not be loaded), this accepts the ASTUnit
   /// mainly to allow the caller to see the diagnostics.
   ///
+  /// \param PreambleCache - If non-null, the cache through which precompiled
+  /// preambles are shared with other ASTUnits.
+  ///
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
   static ASTUnit *LoadFromCommandLine(
@@ -847,7 +877,8 @@ public:
       bool AllowPCHWithCompilerErrors = false, bool SkipFunctionBodies = false,
       bool UserFilesAreVolatile = false, bool ForSerialization = false,
       llvm::Optional<StringRef> ModuleFormat = llvm::None,
-      std::unique_ptr<ASTUnit> *ErrAST = nullptr);
+      std::unique_ptr<ASTUnit> *ErrAST = nullptr,
+      std::shared_ptr<PrecompiledPreambleCache> PreambleCache = nullptr);
 
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
@@ -914,6 +945,69 @@ public:
     { return 0; }
 };
 
+
+
+/// \brief A cache of precompiled preambles shared between ASTUnits.
+///
+/// ASTUnits that parse the same main file, whose preambles are identical and
+/// that were configured with the same preprocessing-relevant options, can use
+/// the same precompiled preamble rather than each building their own. This is
+/// common for an IDE or indexer that opens several translation units for a
+/// file. The cache is thread-safe: while one unit is building a preamble,
+/// others asking for the same preamble wait for it instead of building it
+/// again.
+///
+/// The cache does not keep preambles alive by itself: a preamble, and its
+/// PCH file, go away with the last unit that uses it.
+class PrecompiledPreambleCache {
+public:
+  typedef std::shared_ptr<const ASTUnit::SharedPreamble> SharedPreamblePtr;
+
+private:
+  std::mutex Mutex;
+  std::condition_variable BuildFinished;
+
+  /// \brief The cached preambles, keyed by a hash of their contents and of the
+  /// options they were built with.
+  llvm::StringMap<std::weak_ptr<const ASTUnit::SharedPreamble>> Preambles;
+
+  /// \brief The keys of the preambles currently being built.
+  llvm::StringSet<> InProgress;
+
+  unsigned NumHits = 0;
+  unsigned NumMisses = 0;
+
+public:
+  PrecompiledPreambleCache() = default;
+  PrecompiledPreambleCache(const PrecompiledPreambleCache &) = delete;
+  PrecompiledPreambleCache &
+  operator=(const PrecompiledPreambleCache &) = delete;
+
+  /// \brief Retrieve the preamble cached under \p Key if \p IsUsable accepts
+  /// it, waiting for it first if another unit is building it.
+  ///
+  /// If there is no usable preamble, returns null and the caller becomes
+  /// responsible for building it: it must call \c finishBuild() with \p Key
+  /// once it is done, whether or not it succeeded.
+  SharedPreamblePtr getOrClaim(
+      StringRef Key,
+      llvm::function_ref<bool(const ASTUnit::SharedPreamble &)> IsUsable);
+
+  /// \brief Finish building the preamble claimed with \c getOrClaim(), caching
+  /// \p Built unless it's null.
+  void finishBuild(StringRef Key, SharedPreamblePtr Built);
+
+  /// \brief Stop sharing the preambles cached so far. The units using them
+  /// keep them until they are done with them.
+  void clear();
+
+  /// \brief The number of requests satisfied by a cached preamble.
+  unsigned getNumHits();
+
+  /// \brief The number of requests that had to build a preamble.
+  unsigned getNumMisses();
+};
+
 } // namespace clang
 
 #endif
@@ -168,6 +168,10 @@ public:
   /// importing.
   std::string ThinLTOIndexFile;
 
+  /// The object files to write the additional partitions to when generating
+  /// code in parallel. The first partition is written to the main output.
+  std::vector<std::string> ParallelCodeGenOutputs;
+
   /// A list of file names passed with -fcuda-include-gpubinary options to
   /// forward to CUDA runtime back-end for incorporating them into host-side
   /// object file.
@@ -45,6 +45,7 @@ class FileEntry;
 class FileManager;
 class FrontendAction;
 class Module;
+class ModuleBuildService;
 class Preprocessor;
 class Sema;
 class SourceManager;
@@ -117,6 +118,10 @@ class CompilerInstance : public ModuleLoader {
   /// \brief The module dependency collector for crashdumps
   std::shared_ptr<ModuleDependencyCollector> ModuleDepCollector;
 
+  /// \brief The service coordinating implicit module builds with other
+  /// compiler instances in this process, if any.
+  std::shared_ptr<ModuleBuildService> ModuleBuilds;
+
   /// \brief The module provider.
   std::shared_ptr<PCHContainerOperations> ThePCHContainerOperations;
 
@@ -504,6 +509,15 @@ public:
   void setModuleDepCollector(
       std::shared_ptr<ModuleDependencyCollector> Collector);
 
+  /// \brief Share implicit module builds with the other compiler instances
+  /// using \p Service. Instances created to build modules inherit it.
+  std::shared_ptr<ModuleBuildService> getModuleBuildService() const {
+    return ModuleBuilds;
+  }
+  void setModuleBuildService(std::shared_ptr<ModuleBuildService> Service) {
+    ModuleBuilds = std::move(Service);
+  }
+
   std::shared_ptr<PCHContainerOperations> getPCHContainerOperations() const {
     return ThePCHContainerOperations;
   }
@@ -130,6 +130,8 @@ public:
                                            /// metrics and statistics.
   unsigned ShowTimers : 1;                 ///< Show timers for individual
                                            /// actions.
+  unsigned TimeTrace : 1;                  ///< Write a Chrome trace of the
+                                           /// time spent in the frontend.
   unsigned ShowVersion : 1;                ///< Show the -version text.
   unsigned FixWhatYouCan : 1;              ///< Apply fixes even if there are
                                            /// unfixable errors.
@@ -271,17 +273,26 @@ public:
   // included by this file.
   std::string FindPchSource;
 
+  /// \brief The minimum duration, in microseconds, of a section written to
+  /// the -ftime-trace output.
+  unsigned TimeTraceGranularity;
+
+  /// \brief The number of most expensive sections of each kind to print
+  /// after compiling with -ftime-trace, or 0 to print none.
+  unsigned TimeTraceSummary;
+
 public:
   FrontendOptions() :
     DisableFree(false), RelocatablePCH(false), ShowHelp(false),
-    ShowStats(false), ShowTimers(false), ShowVersion(false),
+    ShowStats(false), ShowTimers(false), TimeTrace(false), ShowVersion(false),
     FixWhatYouCan(false), FixOnlyWarnings(false), FixAndRecompile(false),
     FixToTemporaries(false), ARCMTMigrateEmitARCErrors(false),
     SkipFunctionBodies(false), UseGlobalModuleIndex(true),
     GenerateGlobalModuleIndex(true), ASTDumpDecls(false), ASTDumpLookups(false),
     BuildingImplicitModule(false), ModulesEmbedAllFiles(false),
     IncludeTimestamps(true), ARCMTAction(ARCMT_None),
-    ObjCMTAction(ObjCMT_None), ProgramAction(frontend::ParseSyntaxOnly)
+    ObjCMTAction(ObjCMT_None), ProgramAction(frontend::ParseSyntaxOnly),
+    TimeTraceGranularity(500), TimeTraceSummary(0)
   {}
 
   /// getInputKindForExtension - Return the appropriate input kind for a file
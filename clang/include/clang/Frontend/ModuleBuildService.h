@@ -0,0 +1,98 @@
+//===--- ModuleBuildService.h - Shared implicit module builds ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ModuleBuildService class, which coordinates implicit
+// module builds between compiler instances that live in the same process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_FRONTEND_MODULEBUILDSERVICE_H
+#define LLVM_CLANG_FRONTEND_MODULEBUILDSERVICE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace clang {
+
+/// \brief De-duplicates implicit module builds between compiler instances
+/// that share it.
+///
+/// Compiler instances running concurrently in one process (for example, the
+/// worker threads of a tool that drives many translation units) normally
+/// coordinate implicit module builds only through the lock files created by
+/// llvm::LockFileManager, which the waiting side polls with an exponential
+/// backoff. When the instances share a ModuleBuildService, the first instance
+/// to request a given module file builds it and every other requester blocks
+/// until that build is finished, then reads the result. Builds of distinct
+/// module files are never serialized by the service, so independent modules
+/// are built in parallel.
+///
+/// Lock files are still used underneath, so the service composes with other
+/// processes that build into the same module cache.
+class ModuleBuildService {
+public:
+  /// \brief The outcome of a call to \c beginBuild().
+  enum BuildStatus {
+    /// The caller is now responsible for building the module file and must
+    /// call \c endBuild() once it is done.
+    BS_Owned,
+    /// Another instance built the module file while the caller waited.
+    BS_BuiltByOther,
+    /// Another instance tried to build the module file while the caller
+    /// waited, but failed.
+    BS_FailedByOther
+  };
+
+private:
+  struct BuildState {
+    bool Finished = false;
+    bool Succeeded = false;
+  };
+
+  std::mutex Mutex;
+  std::condition_variable BuildFinished;
+
+  /// The module files currently being built, keyed by file name.
+  llvm::StringMap<std::shared_ptr<BuildState>> InProgress;
+
+  /// The number of requests that were satisfied by waiting for a build that
+  /// was already in progress.
+  unsigned NumDeduplicatedRequests = 0;
+
+public:
+  ModuleBuildService() = default;
+  ModuleBuildService(const ModuleBuildService &) = delete;
+  ModuleBuildService &operator=(const ModuleBuildService &) = delete;
+
+  /// \brief Request to build \p ModuleFileName.
+  ///
+  /// If no other instance is building this module file, returns \c BS_Owned
+  /// immediately. Otherwise blocks until the owning instance calls
+  /// \c endBuild() and reports how its build went.
+  BuildStatus beginBuild(StringRef ModuleFileName);
+
+  /// \brief Finish a build previously claimed with \c beginBuild(), waking up
+  /// every instance waiting for it.
+  void endBuild(StringRef ModuleFileName, bool Succeeded);
+
+  /// \brief Whether some instance is currently building \p ModuleFileName.
+  bool isBuilding(StringRef ModuleFileName);
+
+  /// \brief The number of build requests that were satisfied by another
+  /// instance's build rather than by building the module again.
+  unsigned getNumDeduplicatedRequests();
+};
+
+} // end namespace clang
+
+#endif
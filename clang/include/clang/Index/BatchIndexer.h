@@ -0,0 +1,138 @@
+//===--- BatchIndexer.h - Parallel indexing of many TUs ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_INDEX_BATCHINDEXER_H
+#define LLVM_CLANG_INDEX_BATCHINDEXER_H
+
+#include "clang/Index/IndexStore.h"
+#include "clang/Index/IndexingAction.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+class ModuleBuildService;
+class PCHContainerOperations;
+
+namespace tooling {
+struct CompileCommand;
+}
+
+namespace index {
+
+struct BatchIndexingOptions {
+  /// The number of translation units to index concurrently, or 0 to use one
+  /// thread per hardware thread.
+  unsigned NumThreads = 0;
+
+  /// Whether to skip a header that has already been indexed by another
+  /// translation unit with the same preprocessing and macro context.
+  bool SkipIndexedHeaders = true;
+
+  IndexingOptions IndexOpts;
+};
+
+/// \brief Indexes the translation units of a compilation database in
+/// parallel and collects the results in a single USR-keyed store.
+///
+/// Headers are normally re-indexed by every translation unit that includes
+/// them. The batch indexer instead keys each header by its path and by a
+/// hash of the preprocessing context of the translation unit (language
+/// options, predefined and command-line macros, header search paths), and
+/// records the macro context each time the header is indexed: the values of
+/// the macros defined outside of the header that it tested or expanded. A
+/// later translation unit that enters the header with the same values for
+/// all of these macros skips the declarations of the header. If the header
+/// then uses another macro from outside, it is expanding differently after
+/// all, and is indexed from there on.
+///
+/// A header that several translation units enter at the same time may be
+/// indexed by each of them; the store merges the duplicate occurrences.
+///
+/// The translation units share a ModuleBuildService, so each implicit module
+/// they import is built once.
+class BatchIndexer {
+  BatchIndexingOptions Opts;
+  std::shared_ptr<PCHContainerOperations> PCHContainerOps;
+  std::shared_ptr<ModuleBuildService> ModuleBuilds;
+
+  std::mutex Mutex;
+  IndexStoreBuilder Store;
+
+  /// The values of the macros that a header used, sorted by macro name. An
+  /// empty value stands for an undefined macro.
+  typedef std::vector<std::pair<std::string, std::string>> MacroContext;
+
+  /// The macro contexts under which each (context, header) key was indexed.
+  llvm::StringMap<std::vector<MacroContext>> IndexedHeaders;
+
+  unsigned NumIndexedUnits = 0;
+  unsigned NumFailedUnits = 0;
+  unsigned NumUnitsWithErrors = 0;
+  unsigned NumSkippedHeaders = 0;
+
+  friend class BatchIndexDataConsumer;
+
+  void indexCommand(const tooling::CompileCommand &Command);
+
+  /// \brief Find a macro context under which the header \p File was already
+  /// indexed with \p ContextHash, and in which every macro has the value
+  /// that \p GetMacroValue returns for it now.
+  ///
+  /// \returns true and sets \p Macros to the context if there is one.
+  bool isHeaderIndexed(StringRef ContextHash, StringRef File,
+                       llvm::function_ref<std::string(StringRef)> GetMacroValue,
+                       MacroContext &Macros);
+
+  /// \brief Record that the header \p File was indexed with \p ContextHash
+  /// under the macro context \p Macros.
+  void addIndexedHeader(StringRef ContextHash, StringRef File,
+                        MacroContext Macros);
+
+  void addUnit(const IndexStoreBuilder &UnitStore, unsigned NumSkipped);
+
+public:
+  explicit BatchIndexer(
+      BatchIndexingOptions Opts,
+      std::shared_ptr<PCHContainerOperations> PCHContainerOps = nullptr);
+  ~BatchIndexer();
+
+  /// \brief Index every command in \p Commands, using up to
+  /// \c BatchIndexingOptions::NumThreads threads.
+  ///
+  /// May be called several times; headers indexed by an earlier call are
+  /// skipped by later ones.
+  void indexCommands(ArrayRef<tooling::CompileCommand> Commands);
+
+  /// \brief The symbols collected from every translation unit indexed so far.
+  const IndexStoreBuilder &getStore() const { return Store; }
+
+  unsigned getNumIndexedUnits() const { return NumIndexedUnits; }
+
+  /// \brief The number of commands that could not be turned into a
+  /// translation unit at all.
+  unsigned getNumFailedUnits() const { return NumFailedUnits; }
+
+  /// \brief The number of translation units that were indexed despite
+  /// compilation errors.
+  unsigned getNumUnitsWithErrors() const { return NumUnitsWithErrors; }
+
+  /// \brief The number of times a header was skipped because it had already
+  /// been indexed under the same macro context.
+  unsigned getNumSkippedHeaders() const { return NumSkippedHeaders; }
+};
+
+} // namespace index
+} // namespace clang
+
+#endif
@@ -52,6 +52,10 @@ public:
                                      SymbolRoleSet Roles,
                                      FileID FID, unsigned Offset);
 
+  /// \returns false if the declarations of \p FID should not be indexed at
+  /// all.
+  virtual bool shouldIndexFile(FileID FID);
+
   virtual void finish() {}
 
 private:
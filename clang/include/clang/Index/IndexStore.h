@@ -0,0 +1,160 @@
+//===--- IndexStore.h - Compact USR-keyed symbol store ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a compact on-disk store of indexed symbols and their
+// occurrences, keyed by USR, together with the builder that produces it and
+// a reader that maps it into memory.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_INDEX_INDEXSTORE_H
+#define LLVM_CLANG_INDEX_INDEXSTORE_H
+
+#include "clang/Index/IndexSymbol.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ErrorOr.h"
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+class raw_ostream;
+}
+
+namespace clang {
+namespace index {
+
+/// \brief Accumulates symbols and occurrences and serializes them into the
+/// on-disk index store format.
+///
+/// Symbols are identified by their USR; adding an occurrence of a symbol
+/// that is already known only records the occurrence. Identical occurrences
+/// (for example, a declaration in a header indexed by several translation
+/// units) are stored once.
+///
+/// The builder itself is not thread-safe. Concurrent producers are expected
+/// to fill their own builder and \c merge() it into a shared one.
+class IndexStoreBuilder {
+  struct SymbolData {
+    std::string Name;
+    SymbolKind Kind;
+    SymbolLanguage Lang;
+  };
+
+  struct OccurrenceData {
+    unsigned Symbol;
+    unsigned File;
+    unsigned Line;
+    unsigned Column;
+    SymbolRoleSet Roles;
+  };
+
+  /// Maps each USR to its index in \c Symbols.
+  llvm::StringMap<unsigned> SymbolIDs;
+  std::vector<std::pair<StringRef, SymbolData>> Symbols;
+
+  /// Maps each file path to its index in \c Files.
+  llvm::StringMap<unsigned> FileIDs;
+  std::vector<StringRef> Files;
+
+  std::vector<OccurrenceData> Occurrences;
+
+  unsigned getSymbolID(StringRef USR, StringRef Name, SymbolKind Kind,
+                       SymbolLanguage Lang);
+  unsigned getFileID(StringRef Path);
+
+public:
+  /// \brief Record an occurrence of the symbol \p USR at \p Line and
+  /// \p Column of \p File.
+  void addOccurrence(StringRef USR, StringRef Name, SymbolInfo Info,
+                     StringRef File, unsigned Line, unsigned Column,
+                     SymbolRoleSet Roles);
+
+  /// \brief Add everything recorded by \p Other to this builder.
+  void merge(const IndexStoreBuilder &Other);
+
+  /// \brief The number of distinct symbols seen so far.
+  unsigned getNumSymbols() const { return Symbols.size(); }
+
+  /// \brief Serialize the store to \p OS.
+  ///
+  /// The output does not depend on the order in which symbols, files and
+  /// occurrences were added.
+  void emit(llvm::raw_ostream &OS) const;
+
+  /// \brief Serialize the store to the file at \p Path, replacing it
+  /// atomically.
+  std::error_code writeToFile(StringRef Path) const;
+};
+
+/// \brief Provides read access to an index store written by
+/// \c IndexStoreBuilder.
+///
+/// The store is mapped into memory and all queries read it in place, so
+/// opening even a large store is cheap.
+class IndexStoreReader {
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  const char *FileTable = nullptr;
+  const char *SymbolTable = nullptr;
+  const char *OccurrenceTable = nullptr;
+  const char *Strings = nullptr;
+  unsigned NumFiles = 0;
+  unsigned NumSymbols = 0;
+  unsigned NumOccurrences = 0;
+
+  explicit IndexStoreReader(std::unique_ptr<llvm::MemoryBuffer> Buffer);
+  bool validate();
+
+  StringRef getString(const char *Entry) const;
+
+public:
+  ~IndexStoreReader();
+
+  struct Symbol {
+    StringRef USR;
+    StringRef Name;
+    SymbolKind Kind;
+    SymbolLanguage Lang;
+  };
+
+  struct Occurrence {
+    StringRef File;
+    unsigned Line;
+    unsigned Column;
+    SymbolRoleSet Roles;
+  };
+
+  /// \brief Open the index store at \p Path.
+  static llvm::ErrorOr<std::unique_ptr<IndexStoreReader>>
+  create(StringRef Path);
+
+  unsigned getNumSymbols() const { return NumSymbols; }
+  unsigned getNumOccurrences() const { return NumOccurrences; }
+
+  /// \brief Retrieve the symbol with index \p Idx. Symbols are sorted by USR.
+  Symbol getSymbol(unsigned Idx) const;
+
+  /// \brief Find the index of the symbol with the given USR, if any.
+  llvm::Optional<unsigned> lookupUSR(StringRef USR) const;
+
+  /// \brief Call \p Receiver for each occurrence of the symbol with index
+  /// \p Idx, ordered by file, line and column.
+  void forEachOccurrence(
+      unsigned Idx,
+      llvm::function_ref<void(const Occurrence &)> Receiver) const;
+};
+
+} // namespace index
+} // namespace clang
+
+#endif
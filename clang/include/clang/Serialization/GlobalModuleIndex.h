@@ -34,6 +34,7 @@ namespace clang {
 class DirectoryEntry;
 class FileEntry;
 class FileManager;
+class GlobalModuleIndexBuilder;
 class IdentifierIterator;
 class PCHContainerOperations;
 class PCHContainerReader;
@@ -123,6 +124,10 @@ class GlobalModuleIndex {
   GlobalModuleIndex(const GlobalModuleIndex &) = delete;
   GlobalModuleIndex &operator=(const GlobalModuleIndex &) = delete;
 
+  /// \brief The builder reuses what a previous index knows about module files
+  /// that have not changed since it was written.
+  friend class GlobalModuleIndexBuilder;
+
 public:
   ~GlobalModuleIndex();
 
@@ -193,6 +198,10 @@ public:
 
   /// \brief Write a global index into the given
   ///
+  /// Module files that have not changed since the existing index in \p Path
+  /// was written are not read again; the information the existing index has
+  /// about them is carried over instead.
+  ///
   /// \param FileMgr The file manager to use to load module files.
   /// \param PCHContainerRdr - The PCHContainerOperations to use for loading and
   /// creating modules.
@@ -265,6 +265,12 @@ private:
   /// \sa shouldWidenLoops
   Optional<bool> WidenLoops;
 
+  /// \sa getShardCount
+  Optional<unsigned> ShardCount;
+
+  /// \sa getShardIndex
+  Optional<unsigned> ShardIndex;
+
   /// A helper function that retrieves option for a given full-qualified
   /// checker name.
   /// Options for checkers can be specified via 'analyzer-config' command-line
@@ -533,6 +539,26 @@ public:
   /// This is controlled by the 'widen-loops' config option.
   bool shouldWidenLoops();
 
+  /// Returns the number of shards the path-sensitive analysis of the
+  /// translation unit is split into. Each shard is meant to be run by its own
+  /// analyzer process and analyzes a disjoint set of top-level functions.
+  ///
+  /// This is controlled by the 'shard-count' config option.
+  unsigned getShardCount();
+
+  /// Returns the shard this analyzer invocation is responsible for, in
+  /// [0, shard-count). The AST-only checks only run in shard 0.
+  ///
+  /// This is controlled by the 'shard-index' config option.
+  unsigned getShardIndex();
+
+  /// Returns the directory in which the analyzer runs of different
+  /// translation units share which functions are too expensive to inline, or
+  /// an empty string if they should not share them.
+  ///
+  /// This is controlled by the 'summary-cache-dir' config option.
+  StringRef getSummaryCacheDir();
+
 public:
   AnalyzerOptions() :
     AnalysisStoreOpt(RegionStoreModel),
@@ -16,10 +16,12 @@
 
 #include "clang/AST/Decl.h"
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include <deque>
 
 namespace clang {
@@ -44,18 +46,26 @@ class FunctionSummariesTy {
     /// True if this function may be inlined.
     unsigned MayInline : 1;
 
+    /// True if inlining this function exhausted the block visit budget.
+    unsigned ReachedMaxBlockCount : 1;
+
     /// The number of times the function has been inlined.
     unsigned TimesInlined : 32;
 
     FunctionSummary() :
       TotalBasicBlocks(0),
       InlineChecked(0),
+      ReachedMaxBlockCount(0),
       TimesInlined(0) {}
   };
 
   typedef llvm::DenseMap<const Decl *, FunctionSummary> MapTy;
   MapTy Map;
 
+  /// The functions whose inlining exhausted the block visit budget, in the
+  /// order in which they were found.
+  SmallVector<const Decl *, 8> ReachedMaxBlockCountDecls;
+
 public:
   MapTy::iterator findOrInsertSummary(const Decl *D) {
     MapTy::iterator I = Map.find(D);
@@ -82,6 +92,14 @@ public:
 
   void markReachedMaxBlockCount(const Decl *D) {
     markShouldNotInline(D);
+    FunctionSummary &Summary = Map[D];
+    if (!Summary.ReachedMaxBlockCount)
+      ReachedMaxBlockCountDecls.push_back(D);
+    Summary.ReachedMaxBlockCount = 1;
+  }
+
+  ArrayRef<const Decl *> getReachedMaxBlockCountDecls() const {
+    return ReachedMaxBlockCountDecls;
   }
 
   Optional<bool> mayInline(const Decl *D) {
@@ -0,0 +1,89 @@
+//== FunctionSummaryCache.h - Persistent function summaries -------*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines an on-disk store of function summaries that is shared by
+// the analyzer runs of different translation units.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_FUNCTIONSUMMARYCACHE_H
+#define LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_FUNCTIONSUMMARYCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+#include <system_error>
+
+namespace clang {
+namespace ento {
+
+/// \brief Remembers, across translation units and analyzer runs, which
+/// functions exhausted the block visit budget when they were inlined during
+/// the analysis of a top-level function.
+///
+/// Finding out that a function is too expensive to inline requires
+/// exploring it until the budget runs out, only to throw the result away and
+/// evaluate the call conservatively. Whether the budget runs out depends on
+/// the state at the call, so an entry only applies to the analysis of the
+/// same top-level function: analyzing it again, e.g. from another
+/// translation unit that includes the same header, skips the exploration.
+///
+/// Functions are identified by their USR and by a hash of their body, so an
+/// entry is dropped as soon as either function changes. The store is a text
+/// file in the cache directory, named after a hash of the analyzer
+/// configuration that affects exploration, and is updated under a file lock
+/// so that concurrent analyzer processes can share it. Entries and stores
+/// that have not been used for a while are removed when the store is saved.
+class FunctionSummaryCache {
+  std::string Directory;
+  std::string Path;
+
+  /// Maps the key of each top-level function to the keys of the functions
+  /// that exhausted the budget when inlined during its analysis, and to when
+  /// that was last seen, in seconds since the epoch.
+  typedef llvm::StringMap<llvm::StringMap<uint64_t>> EntriesTy;
+  EntriesTy Exhausted;
+
+  /// The entries found or used during this run.
+  EntriesTy Updated;
+
+  /// Whether the store contains entries that expired.
+  bool HasExpiredEntries;
+
+  void read(StringRef Path, EntriesTy &Entries);
+  void pruneStores();
+
+public:
+  /// \brief Open the store for \p Configuration in \p Directory, which is
+  /// created if needed.
+  FunctionSummaryCache(StringRef Directory, StringRef Configuration);
+
+  /// \brief The key identifying the function \p USR with body hash
+  /// \p BodyHash in the store.
+  static std::string getKey(StringRef USR, StringRef BodyHash);
+
+  /// \brief Retrieve the keys of the functions known to exhaust the block
+  /// visit budget when inlined during the analysis of the top-level function
+  /// \p Root.
+  void getExhausted(StringRef Root, SmallVectorImpl<StringRef> &Callees);
+
+  /// \brief Record that inlining the function \p Callee exhausted the block
+  /// visit budget during the analysis of the top-level function \p Root.
+  void markExhausted(StringRef Root, StringRef Callee);
+
+  /// \brief Merge the entries recorded during this run into the store on
+  /// disk.
+  std::error_code save();
+};
+
+} // end namespace ento
+} // end namespace clang
+
+#endif
@@ -787,6 +787,9 @@ ASTContext::~ASTContext() {
        MaterializedTemporaryValues)
     MTVPair.second->~APValue();
 
+  for (const auto &Result : ConstexprCallResults)
+    Result.second->~APValue();
+
   for (const auto &Value : ModuleInitializers)
     Value.second->~PerModuleInitializers();
 
@@ -870,6 +873,21 @@ void ASTContext::PrintStats() const {
   llvm::errs() << NumImplicitDestructorsDeclared << "/"
                << NumImplicitDestructors
                << " implicit destructors created\n";
+  if (getLangOpts().CPlusPlus11)
+    llvm::errs() << ConstexprCallResults.size()
+                 << " constexpr function call results memoized\n";
+  if (getLangOpts().CPlusPlus)
+    llvm::errs() << SharedTemplateArgumentLists.size()
+                 << " shared template argument lists\n";
+
+  if (CollectAllocationStats) {
+    llvm::errs() << "\n*** AST Allocations By Source:\n";
+    static const char *const SourceNames[] = {"parsing",
+                                              "template instantiation"};
+    for (unsigned I = 0; I != NumAllocationSources; ++I)
+      llvm::errs() << "  " << AllocatedBytes[I] << " bytes allocated for "
+                   << SourceNames[I] << "\n";
+  }
 
   if (ExternalSource) {
     llvm::errs() << "\n";
@@ -8931,6 +8949,17 @@ ASTContext::getMaterializedTemporaryValue(const MaterializeTemporaryExpr *E,
   return MaterializedTemporaryValues.lookup(E);
 }
 
+APValue *ASTContext::getConstexprCallResult(StringRef Key, bool MayCreate) {
+  if (MayCreate) {
+    APValue *&Result = ConstexprCallResults[Key];
+    if (!Result)
+      Result = new (*this) APValue;
+    return Result;
+  }
+
+  return ConstexprCallResults.lookup(Key);
+}
+
 bool ASTContext::AtomicUsesUnsupportedLibcall(const AtomicExpr *E) const {
   const llvm::Triple &T = getTargetInfo().getTriple();
   if (!T.isOSDarwin())
@@ -40,6 +40,12 @@ using namespace clang;
 #define ABSTRACT_DECL(DECL)
 #include "clang/AST/DeclNodes.inc"
 
+// The number of declarations of each kind created while instantiating
+// templates.
+#define DECL(DERIVED, BASE) static int nInstantiated##DERIVED##s = 0;
+#define ABSTRACT_DECL(DECL)
+#include "clang/AST/DeclNodes.inc"
+
 void Decl::updateOutOfDate(IdentifierInfo &II) const {
   getASTContext().getExternalSource()->updateOutOfDateIdentifier(II);
 }
@@ -155,11 +161,37 @@ void Decl::PrintStats() {
 #include "clang/AST/DeclNodes.inc"
 
   llvm::errs() << "Total bytes = " << totalBytes << "\n";
+
+  int totalInstantiated = 0;
+#define DECL(DERIVED, BASE) totalInstantiated += nInstantiated##DERIVED##s;
+#define ABSTRACT_DECL(DECL)
+#include "clang/AST/DeclNodes.inc"
+  if (!totalInstantiated)
+    return;
+
+  llvm::errs() << "  " << totalInstantiated
+               << " decls created by template instantiation.\n";
+#define DECL(DERIVED, BASE)                                             \
+  if (nInstantiated##DERIVED##s > 0)                                    \
+    llvm::errs() << "    " << nInstantiated##DERIVED##s                 \
+                 << " " #DERIVED " decls ("                             \
+                 << nInstantiated##DERIVED##s * sizeof(DERIVED##Decl)   \
+                 << " bytes)\n";
+#define ABSTRACT_DECL(DECL)
+#include "clang/AST/DeclNodes.inc"
 }
 
-void Decl::add(Kind k) {
+void Decl::add(Kind k, const DeclContext *DC) {
+  bool Instantiated =
+      DC && DC->getParentASTContext().getAllocationSource() ==
+                ASTContext::AS_TemplateInstantiation;
   switch (k) {
-#define DECL(DERIVED, BASE) case DERIVED: ++n##DERIVED##s; break;
+#define DECL(DERIVED, BASE)                                             \
+  case DERIVED:                                                         \
+    ++n##DERIVED##s;                                                    \
+    if (Instantiated)                                                   \
+      ++nInstantiated##DERIVED##s;                                      \
+    break;
 #define ABSTRACT_DECL(DECL)
 #include "clang/AST/DeclNodes.inc"
   }
@@ -20,6 +20,7 @@
 #include "clang/AST/TypeLoc.h"
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/IdentifierTable.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include <memory>
 using namespace clang;
@@ -667,11 +668,161 @@ TemplateArgumentList::TemplateArgumentList(ArrayRef<TemplateArgument> Args)
                           getTrailingObjects<TemplateArgument>());
 }
 
+/// \brief Whether \p Arg is compared by identity, which makes the template
+/// argument lists that contain it shareable.
+static bool isIdentityComparable(const TemplateArgument &Arg) {
+  switch (Arg.getKind()) {
+  case TemplateArgument::Expression:
+    return false;
+  case TemplateArgument::Pack:
+    for (const TemplateArgument &Element : Arg.pack_elements())
+      if (!isIdentityComparable(Element))
+        return false;
+    return true;
+  default:
+    return true;
+  }
+}
+
+static bool isIdentical(const TemplateArgument &LHS,
+                        const TemplateArgument &RHS) {
+  if (LHS.getKind() != RHS.getKind())
+    return false;
+
+  switch (LHS.getKind()) {
+  case TemplateArgument::Null:
+    return true;
+  case TemplateArgument::Type:
+    return LHS.getAsType() == RHS.getAsType();
+  case TemplateArgument::Declaration:
+    return LHS.getAsDecl() == RHS.getAsDecl() &&
+           LHS.getParamTypeForDecl() == RHS.getParamTypeForDecl();
+  case TemplateArgument::NullPtr:
+    return LHS.getNullPtrType() == RHS.getNullPtrType();
+  case TemplateArgument::Integral: {
+    if (LHS.getIntegralType() != RHS.getIntegralType())
+      return false;
+    llvm::APSInt LHSValue = LHS.getAsIntegral();
+    llvm::APSInt RHSValue = RHS.getAsIntegral();
+    return LHSValue.getBitWidth() == RHSValue.getBitWidth() &&
+           LHSValue.isSigned() == RHSValue.isSigned() && LHSValue == RHSValue;
+  }
+  case TemplateArgument::Template:
+    return LHS.getAsTemplate().getAsVoidPointer() ==
+           RHS.getAsTemplate().getAsVoidPointer();
+  case TemplateArgument::TemplateExpansion: {
+    if (LHS.getAsTemplateOrTemplatePattern().getAsVoidPointer() !=
+        RHS.getAsTemplateOrTemplatePattern().getAsVoidPointer())
+      return false;
+    Optional<unsigned> LHSExpansions = LHS.getNumTemplateExpansions();
+    Optional<unsigned> RHSExpansions = RHS.getNumTemplateExpansions();
+    return LHSExpansions.hasValue() == RHSExpansions.hasValue() &&
+           (!LHSExpansions || *LHSExpansions == *RHSExpansions);
+  }
+  case TemplateArgument::Pack:
+    if (LHS.pack_size() != RHS.pack_size())
+      return false;
+    for (unsigned I = 0, E = LHS.pack_size(); I != E; ++I)
+      if (!isIdentical(LHS.pack_begin()[I], RHS.pack_begin()[I]))
+        return false;
+    return true;
+  case TemplateArgument::Expression:
+    return false;
+  }
+
+  llvm_unreachable("Invalid TemplateArgument Kind!");
+}
+
+static unsigned getIdentityHash(const TemplateArgument &Arg) {
+  switch (Arg.getKind()) {
+  case TemplateArgument::Null:
+  case TemplateArgument::Expression:
+    return Arg.getKind();
+  case TemplateArgument::Type:
+    return llvm::hash_combine(Arg.getKind(),
+                              Arg.getAsType().getAsOpaquePtr());
+  case TemplateArgument::Declaration:
+    return llvm::hash_combine(Arg.getKind(), Arg.getAsDecl());
+  case TemplateArgument::NullPtr:
+    return llvm::hash_combine(Arg.getKind(),
+                              Arg.getNullPtrType().getAsOpaquePtr());
+  case TemplateArgument::Integral:
+    return llvm::hash_combine(Arg.getKind(),
+                              Arg.getIntegralType().getAsOpaquePtr(),
+                              llvm::hash_value(Arg.getAsIntegral()));
+  case TemplateArgument::Template:
+  case TemplateArgument::TemplateExpansion:
+    return llvm::hash_combine(
+        Arg.getKind(), Arg.getAsTemplateOrTemplatePattern().getAsVoidPointer());
+  case TemplateArgument::Pack: {
+    llvm::hash_code Hash = llvm::hash_value(Arg.getKind());
+    for (const TemplateArgument &Element : Arg.pack_elements())
+      Hash = llvm::hash_combine(Hash, getIdentityHash(Element));
+    return Hash;
+  }
+  }
+
+  llvm_unreachable("Invalid TemplateArgument Kind!");
+}
+
+TemplateArgumentList *
+ASTContext::TemplateArgumentListIdentityInfo::getEmptyKey() {
+  return llvm::DenseMapInfo<TemplateArgumentList *>::getEmptyKey();
+}
+
+TemplateArgumentList *
+ASTContext::TemplateArgumentListIdentityInfo::getTombstoneKey() {
+  return llvm::DenseMapInfo<TemplateArgumentList *>::getTombstoneKey();
+}
+
+unsigned ASTContext::TemplateArgumentListIdentityInfo::getHashValue(
+    ArrayRef<TemplateArgument> Args) {
+  llvm::hash_code Hash = llvm::hash_value(Args.size());
+  for (const TemplateArgument &Arg : Args)
+    Hash = llvm::hash_combine(Hash, getIdentityHash(Arg));
+  return Hash;
+}
+
+unsigned ASTContext::TemplateArgumentListIdentityInfo::getHashValue(
+    const TemplateArgumentList *List) {
+  return getHashValue(List->asArray());
+}
+
+bool ASTContext::TemplateArgumentListIdentityInfo::isEqual(
+    ArrayRef<TemplateArgument> LHS, const TemplateArgumentList *RHS) {
+  if (RHS == getEmptyKey() || RHS == getTombstoneKey() ||
+      LHS.size() != RHS->size())
+    return false;
+  for (unsigned I = 0, E = LHS.size(); I != E; ++I)
+    if (!isIdentical(LHS[I], RHS->get(I)))
+      return false;
+  return true;
+}
+
+bool ASTContext::TemplateArgumentListIdentityInfo::isEqual(
+    const TemplateArgumentList *LHS, const TemplateArgumentList *RHS) {
+  return LHS == RHS;
+}
+
 TemplateArgumentList *
 TemplateArgumentList::CreateCopy(ASTContext &Context,
                                  ArrayRef<TemplateArgument> Args) {
+  // Template argument lists are immutable, so the lists of the different
+  // specializations and deductions that have the same arguments can be
+  // shared. Lists with expressions are not shared, as the expressions carry
+  // source locations.
+  bool Shareable = std::all_of(Args.begin(), Args.end(), isIdentityComparable);
+  if (Shareable) {
+    auto Known = Context.SharedTemplateArgumentLists.find_as(Args);
+    if (Known != Context.SharedTemplateArgumentLists.end())
+      return *Known;
+  }
+
   void *Mem = Context.Allocate(totalSizeToAlloc<TemplateArgument>(Args.size()));
-  return new (Mem) TemplateArgumentList(Args);
+  TemplateArgumentList *List = new (Mem) TemplateArgumentList(Args);
+  if (Shareable)
+    Context.SharedTemplateArgumentLists.insert(List);
+  return List;
 }
 
 FunctionTemplateSpecializationInfo *
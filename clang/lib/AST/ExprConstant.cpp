@@ -44,6 +44,9 @@
 #include "clang/AST/TypeLoc.h"
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/TargetInfo.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstring>
 #include <functional>
@@ -52,6 +55,15 @@ using namespace clang;
 using llvm::APSInt;
 using llvm::APFloat;
 
+#define DEBUG_TYPE "exprconstant"
+
+STATISTIC(NumConstexprCalls, "Number of constexpr function calls evaluated");
+STATISTIC(NumConstexprSteps, "Number of constexpr evaluation steps");
+STATISTIC(NumMemoizedCallHits,
+          "Number of constexpr calls answered by a memoized result");
+STATISTIC(NumMemoizedCalls,
+          "Number of constexpr call results memoized for later calls");
+
 static bool IsGlobalLValue(APValue::LValueBase B);
 
 namespace {
@@ -469,6 +481,11 @@ namespace {
     /// declaration whose initializer is being evaluated, if any.
     APValue *EvaluatingDeclValue;
 
+    /// NumEvaluatingDeclAccesses - The number of times the in-flight value of
+    /// EvaluatingDecl has been accessed. A call whose evaluation accesses it
+    /// depends on more than its arguments and cannot be memoized.
+    unsigned NumEvaluatingDeclAccesses;
+
     /// HasActiveDiagnostic - Was the previous diagnostic stored? If so, further
     /// notes attached to it will also be stored, otherwise they will not be.
     bool HasActiveDiagnostic;
@@ -543,7 +560,8 @@ namespace {
         StepsLeft(getLangOpts().ConstexprStepLimit),
         BottomFrame(*this, SourceLocation(), nullptr, nullptr, nullptr),
         EvaluatingDecl((const ValueDecl *)nullptr),
-        EvaluatingDeclValue(nullptr), HasActiveDiagnostic(false),
+        EvaluatingDeclValue(nullptr), NumEvaluatingDeclAccesses(0),
+        HasActiveDiagnostic(false),
         HasFoldFailureDiagnostic(false), IsSpeculativelyEvaluating(false),
         EvalMode(Mode) {}
 
@@ -587,6 +605,7 @@ namespace {
         return false;
       }
       --StepsLeft;
+      ++NumConstexprSteps;
       return true;
     }
 
@@ -2157,6 +2176,7 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   // If we're currently evaluating the initializer of this declaration, use that
   // in-flight value.
   if (Info.EvaluatingDecl.dyn_cast<const ValueDecl*>() == VD) {
+    ++Info.NumEvaluatingDeclAccesses;
     Result = Info.EvaluatingDeclValue;
     return true;
   }
@@ -2866,6 +2886,7 @@ static CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E,
   // and this doesn't do quite the right thing for const subobjects of the
   // object under construction.
   if (LVal.getLValueBase() == Info.EvaluatingDecl) {
+    ++Info.NumEvaluatingDeclAccesses;
     BaseType = Info.Ctx.getCanonicalType(BaseType);
     BaseType.removeLocalConst();
   }
@@ -3937,6 +3958,103 @@ static bool EvaluateArgs(ArrayRef<const Expr*> Args, ArgVector &ArgValues,
   return Success;
 }
 
+static void appendToMemoKey(SmallVectorImpl<char> &Key, uint64_t V) {
+  Key.append(reinterpret_cast<const char *>(&V),
+             reinterpret_cast<const char *>(&V + 1));
+}
+
+static void appendToMemoKey(SmallVectorImpl<char> &Key, const void *P) {
+  appendToMemoKey(Key, reinterpret_cast<uintptr_t>(P));
+}
+
+static void appendToMemoKey(SmallVectorImpl<char> &Key, const llvm::APInt &I) {
+  appendToMemoKey(Key, I.getBitWidth());
+  for (unsigned W = 0, N = I.getNumWords(); W != N; ++W)
+    appendToMemoKey(Key, I.getRawData()[W]);
+}
+
+static void appendToMemoKey(SmallVectorImpl<char> &Key, const APFloat &F) {
+  appendToMemoKey(Key, &F.getSemantics());
+  appendToMemoKey(Key, F.bitcastToAPInt());
+}
+
+/// Append an encoding of \p V to the memoization key \p Key.
+///
+/// \returns false if \p V refers to an object, as pointers, references and
+/// member pointers do. The result of a call taking such a value may depend on
+/// the current value of that object, so the call cannot be memoized.
+static bool appendToMemoKey(SmallVectorImpl<char> &Key, const APValue &V) {
+  appendToMemoKey(Key, V.getKind());
+  switch (V.getKind()) {
+  case APValue::Uninitialized:
+    return true;
+  case APValue::Int:
+    appendToMemoKey(Key, V.getInt().isUnsigned());
+    appendToMemoKey(Key, V.getInt());
+    return true;
+  case APValue::Float:
+    appendToMemoKey(Key, V.getFloat());
+    return true;
+  case APValue::ComplexInt:
+    appendToMemoKey(Key, V.getComplexIntReal());
+    appendToMemoKey(Key, V.getComplexIntImag());
+    return true;
+  case APValue::ComplexFloat:
+    appendToMemoKey(Key, V.getComplexFloatReal());
+    appendToMemoKey(Key, V.getComplexFloatImag());
+    return true;
+  case APValue::Vector:
+    appendToMemoKey(Key, V.getVectorLength());
+    for (unsigned I = 0, N = V.getVectorLength(); I != N; ++I)
+      if (!appendToMemoKey(Key, V.getVectorElt(I)))
+        return false;
+    return true;
+  case APValue::Array:
+    appendToMemoKey(Key, V.getArraySize());
+    appendToMemoKey(Key, V.getArrayInitializedElts());
+    for (unsigned I = 0, N = V.getArrayInitializedElts(); I != N; ++I)
+      if (!appendToMemoKey(Key, V.getArrayInitializedElt(I)))
+        return false;
+    if (V.hasArrayFiller())
+      return appendToMemoKey(Key, V.getArrayFiller());
+    return true;
+  case APValue::Struct:
+    appendToMemoKey(Key, V.getStructNumBases());
+    appendToMemoKey(Key, V.getStructNumFields());
+    for (unsigned I = 0, N = V.getStructNumBases(); I != N; ++I)
+      if (!appendToMemoKey(Key, V.getStructBase(I)))
+        return false;
+    for (unsigned I = 0, N = V.getStructNumFields(); I != N; ++I)
+      if (!appendToMemoKey(Key, V.getStructField(I)))
+        return false;
+    return true;
+  case APValue::Union:
+    appendToMemoKey(Key, V.getUnionField());
+    return !V.getUnionField() || appendToMemoKey(Key, V.getUnionValue());
+  case APValue::LValue:
+  case APValue::MemberPointer:
+  case APValue::AddrLabelDiff:
+    return false;
+  }
+  llvm_unreachable("unknown APValue kind");
+}
+
+/// Compute the key under which the result of calling \p Callee with
+/// \p ArgValues is memoized.
+///
+/// \returns false if the result of the call may depend on more than the
+/// argument values, so that the call must not be memoized.
+static bool getMemoKey(const FunctionDecl *Callee, const LValue *This,
+                       ArrayRef<APValue> ArgValues, SmallVectorImpl<char> &Key) {
+  if (This || Callee->getReturnType()->isVoidType())
+    return false;
+  appendToMemoKey(Key, Callee);
+  for (const APValue &Arg : ArgValues)
+    if (!appendToMemoKey(Key, Arg))
+      return false;
+  return true;
+}
+
 /// Evaluate a function call.
 static bool HandleFunctionCall(SourceLocation CallLoc,
                                const FunctionDecl *Callee, const LValue *This,
@@ -3950,6 +4068,32 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
   if (!Info.CheckCallLimit(CallLoc))
     return false;
 
+  ++NumConstexprCalls;
+
+  // A call to a constexpr function whose arguments are plain values can only
+  // observe those values and immutable constants, so its result is memoized
+  // for the rest of the translation unit. This turns the exponential
+  // evaluation of naive recursions into a linear one.
+  SmallString<64> MemoKey;
+  bool Memoizable = !Info.checkingPotentialConstantExpression() &&
+                    getMemoKey(Callee, This, ArgValues, MemoKey);
+  if (Memoizable) {
+    if (const APValue *Memo = Info.Ctx.getConstexprCallResult(
+            MemoKey, /*MayCreate=*/false)) {
+      ++NumMemoizedCallHits;
+      Result = *Memo;
+      return true;
+    }
+  }
+
+  // Only a call that evaluated without any diagnostic or side effect is known
+  // to be a constant expression in every evaluation mode, and so can be
+  // memoized. That requires diagnostics to be collected in the first place.
+  Expr::EvalStatus &Status = Info.EvalStatus;
+  Memoizable = Memoizable && Status.Diag && Status.Diag->empty() &&
+               !Status.HasSideEffects && !Status.HasUndefinedBehavior;
+  unsigned OldEvaluatingDeclAccesses = Info.NumEvaluatingDeclAccesses;
+
   CallStackFrame Frame(Info, CallLoc, Callee, This, ArgValues.data());
 
   // For a trivial copy or move assignment, perform an APValue copy. This is
@@ -3984,7 +4128,18 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
       return true;
     Info.FFDiag(Callee->getLocEnd(), diag::note_constexpr_no_return);
   }
-  return ESR == ESR_Returned;
+  if (ESR != ESR_Returned)
+    return false;
+
+  SmallString<64> ResultKey;
+  if (Memoizable && Status.Diag->empty() && !Status.HasSideEffects &&
+      !Status.HasUndefinedBehavior &&
+      Info.NumEvaluatingDeclAccesses == OldEvaluatingDeclAccesses &&
+      appendToMemoKey(ResultKey, Result)) {
+    ++NumMemoizedCalls;
+    *Info.Ctx.getConstexprCallResult(MemoKey, /*MayCreate=*/true) = Result;
+  }
+  return true;
 }
 
 /// Evaluate a constructor call.
@@ -9154,7 +9309,10 @@ bool Expr::EvaluateAsRValue(EvalResult &Result, const ASTContext &Ctx) const {
   bool IsConst;
   if (FastEvaluateAsRValue(this, Result, Ctx, IsConst))
     return IsConst;
-  
+
+  llvm::TimeTraceScope TimeScope("EvaluateAsRValue", [&]() {
+    return getExprLoc().printToString(Ctx.getSourceManager());
+  });
   EvalInfo Info(Ctx, Result, EvalInfo::EM_IgnoreSideEffects);
   return ::EvaluateAsRValue(Info, this, Result.Val);
 }
@@ -9222,6 +9380,9 @@ bool Expr::EvaluateAsInitializer(APValue &Value, const ASTContext &Ctx,
       !Ctx.getLangOpts().CPlusPlus11)
     return false;
 
+  llvm::TimeTraceScope TimeScope("EvaluateAsInitializer", [&]() {
+    return VD->getQualifiedNameAsString();
+  });
   Expr::EvalStatus EStatus;
   EStatus.Diag = &Notes;
 
@@ -9781,6 +9942,10 @@ bool Expr::isCXX11ConstantExpr(const ASTContext &Ctx, APValue *Result,
   // issues.
   assert(Ctx.getLangOpts().CPlusPlus);
 
+  llvm::TimeTraceScope TimeScope("EvaluateAsConstantExpr", [&]() {
+    return getExprLoc().printToString(Ctx.getSourceManager());
+  });
+
   // Build evaluation settings.
   Expr::EvalStatus Status;
   SmallVector<PartialDiagnosticAt, 8> Diags;
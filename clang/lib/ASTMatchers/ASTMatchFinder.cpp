@@ -532,19 +532,31 @@ private:
     }
   }
 
+  /// \brief The indices of the matchers that can match nodes of some kind.
+  struct MatcherFilter {
+    /// \brief All matchers that pass the toplevel restrict check.
+    std::vector<unsigned short> All;
+    /// \brief The matchers of \c All that do not require a specific name.
+    std::vector<unsigned short> Unnamed;
+    /// \brief The matchers of \c All that only match declarations with one
+    /// of a few identifiers, for example through \c hasName(), indexed by
+    /// those identifiers.
+    llvm::StringMap<std::vector<unsigned short>> ByName;
+  };
+
   void matchWithFilter(const ast_type_traits::DynTypedNode &DynNode) {
     auto Kind = DynNode.getNodeKind();
     auto it = MatcherFiltersMap.find(Kind);
     const auto &Filter =
         it != MatcherFiltersMap.end() ? it->second : getFilterForKind(Kind);
 
-    if (Filter.empty())
+    if (Filter.All.empty())
       return;
 
     const bool EnableCheckProfiling = Options.CheckProfiling.hasValue();
     TimeBucketRegion Timer;
     auto &Matchers = this->Matchers->DeclOrStmt;
-    for (unsigned short I : Filter) {
+    auto Match = [&](unsigned short I) {
       auto &MP = Matchers[I];
       if (EnableCheckProfiling)
         Timer.setBucket(&TimeByBucket[MP.second->getID()]);
@@ -553,17 +565,54 @@ private:
         MatchVisitor Visitor(ActiveASTContext, MP.second);
         Builder.visitMatches(&Visitor);
       }
+    };
+
+    const auto *ND = DynNode.get<NamedDecl>();
+    if (Filter.ByName.empty() || !ND || !ND->getIdentifier()) {
+      // Declarations without an identifier (constructors, operators, ...)
+      // can still be matched by name, so they are tried on every matcher.
+      for (unsigned short I : Filter.All)
+        Match(I);
+      return;
+    }
+
+    // Merge the unnamed matchers with the ones for this name, so that the
+    // callbacks run in the order in which the matchers were added.
+    static const std::vector<unsigned short> None;
+    auto Named = Filter.ByName.find(ND->getName());
+    const auto &ForName =
+        Named != Filter.ByName.end() ? Named->getValue() : None;
+    auto U = Filter.Unnamed.begin(), UE = Filter.Unnamed.end();
+    auto N = ForName.begin(), NE = ForName.end();
+    while (U != UE || N != NE) {
+      if (N == NE || (U != UE && *U < *N))
+        Match(*U++);
+      else
+        Match(*N++);
     }
   }
 
-  const std::vector<unsigned short> &
-  getFilterForKind(ast_type_traits::ASTNodeKind Kind) {
+  const MatcherFilter &getFilterForKind(ast_type_traits::ASTNodeKind Kind) {
     auto &Filter = MatcherFiltersMap[Kind];
     auto &Matchers = this->Matchers->DeclOrStmt;
     assert((Matchers.size() < USHRT_MAX) && "Too many matchers.");
+    const bool IsNamedDecl =
+        ast_type_traits::ASTNodeKind::getFromNodeKind<NamedDecl>().isBaseOf(
+            Kind);
     for (unsigned I = 0, E = Matchers.size(); I != E; ++I) {
-      if (Matchers[I].first.canMatchNodesOfKind(Kind)) {
-        Filter.push_back(I);
+      if (!Matchers[I].first.canMatchNodesOfKind(Kind))
+        continue;
+      Filter.All.push_back(I);
+
+      SmallVector<StringRef, 4> Names;
+      if (!IsNamedDecl || !Matchers[I].first.getRequiredNames(Names)) {
+        Filter.Unnamed.push_back(I);
+        continue;
+      }
+      for (StringRef Name : Names) {
+        auto &ForName = Filter.ByName[Name];
+        if (ForName.empty() || ForName.back() != I)
+          ForName.push_back(I);
       }
     }
     return Filter;
@@ -741,7 +790,10 @@ private:
   /// We precalculate a list of matchers that pass the toplevel restrict check.
   /// This also allows us to skip the restrict check at matching time. See
   /// use \c matchesNoKindCheck() above.
-  llvm::DenseMap<ast_type_traits::ASTNodeKind, std::vector<unsigned short>>
+  /// For declarations, the matchers are further indexed by the names they
+  /// require, so that e.g. \c functionDecl(hasName("f")) is only tried on
+  /// declarations named "f".
+  llvm::DenseMap<ast_type_traits::ASTNodeKind, MatcherFilter>
       MatcherFiltersMap;
 
   const MatchFinder::MatchFinderOptions &Options;
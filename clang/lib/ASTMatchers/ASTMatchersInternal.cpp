@@ -13,6 +13,7 @@
 
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchersInternal.h"
+#include "clang/Basic/CharInfo.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -67,6 +68,34 @@ public:
     return Func(DynNode, Finder, Builder, InnerMatchers);
   }
 
+  bool getRequiredNames(SmallVectorImpl<StringRef> &Names) const override {
+    if (Func == AllOfVariadicOperator) {
+      // Every inner matcher must match, so the most selective one decides.
+      bool Found = false;
+      SmallVector<StringRef, 4> Best;
+      for (const DynTypedMatcher &InnerMatcher : InnerMatchers) {
+        SmallVector<StringRef, 4> InnerNames;
+        if (InnerMatcher.getRequiredNames(InnerNames) &&
+            (!Found || InnerNames.size() < Best.size())) {
+          Best = std::move(InnerNames);
+          Found = true;
+        }
+      }
+      Names.append(Best.begin(), Best.end());
+      return Found;
+    }
+    if (Func == AnyOfVariadicOperator || Func == EachOfVariadicOperator) {
+      // Any inner matcher may match, so each of them must be restricted.
+      SmallVector<StringRef, 4> AllNames;
+      for (const DynTypedMatcher &InnerMatcher : InnerMatchers)
+        if (!InnerMatcher.getRequiredNames(AllNames))
+          return false;
+      Names.append(AllNames.begin(), AllNames.end());
+      return true;
+    }
+    return false;
+  }
+
 private:
   std::vector<DynTypedMatcher> InnerMatchers;
 };
@@ -85,6 +114,10 @@ public:
     return Result;
   }
 
+  bool getRequiredNames(SmallVectorImpl<StringRef> &Names) const override {
+    return InnerMatcher->getRequiredNames(Names);
+  }
+
 private:
   const std::string ID;
   const IntrusiveRefCntPtr<DynMatcherInterface> InnerMatcher;
@@ -494,6 +527,22 @@ bool HasNameMatcher::matchesNodeFullSlow(const NamedDecl &Node) const {
   return false;
 }
 
+bool HasNameMatcher::getRequiredNames(SmallVectorImpl<StringRef> &Out) const {
+  // A declaration with an identifier only matches if the last component of
+  // the pattern is that identifier. Patterns ending in anything else (an
+  // operator, a template argument list) are not indexed.
+  SmallVector<StringRef, 4> Identifiers;
+  for (StringRef Name : Names) {
+    size_t Pos = Name.rfind("::");
+    StringRef Last = Pos == StringRef::npos ? Name : Name.substr(Pos + 2);
+    if (!isValidIdentifier(Last))
+      return false;
+    Identifiers.push_back(Last);
+  }
+  Out.append(Identifiers.begin(), Identifiers.end());
+  return true;
+}
+
 bool HasNameMatcher::matchesNode(const NamedDecl &Node) const {
   assert(matchesNodeFullFast(Node) == matchesNodeFullSlow(Node));
   if (UseUnqualifiedMatch) {
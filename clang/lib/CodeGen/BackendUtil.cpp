@@ -24,6 +24,7 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/SchedulerRegistry.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -32,8 +33,12 @@
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/ModuleSummaryIndexObjectFile.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
@@ -45,6 +50,8 @@
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
 #include <memory>
 using namespace clang;
@@ -87,12 +94,21 @@ private:
   /// the requested target.
   void CreateTargetMachine(bool MustCreateTM);
 
+  /// Create a TargetMachine for \p TheTarget configured from the code
+  /// generation options. Safe to call from several threads at once.
+  std::unique_ptr<TargetMachine>
+  buildTargetMachine(const llvm::Target &TheTarget, StringRef Triple) const;
+
   /// Add passes necessary to emit assembly or LLVM IR.
   ///
   /// \return True on success.
   bool AddEmitPasses(legacy::PassManager &CodeGenPasses, BackendAction Action,
                      raw_pwrite_stream &OS);
 
+  /// Split the optimized module into one partition per output stream and
+  /// generate an object file for each of them concurrently.
+  void EmitObjectInParallel(raw_pwrite_stream &OS);
+
 public:
   EmitAssemblyHelper(DiagnosticsEngine &_Diags, const CodeGenOptions &CGOpts,
                      const clang::TargetOptions &TOpts,
@@ -502,6 +518,12 @@ void EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
     return;
   }
 
+  TM = buildTargetMachine(*TheTarget, Triple);
+}
+
+std::unique_ptr<TargetMachine>
+EmitAssemblyHelper::buildTargetMachine(const llvm::Target &TheTarget,
+                                       StringRef Triple) const {
   unsigned CodeModel =
     llvm::StringSwitch<unsigned>(CodeGenOpts.CodeModel)
       .Case("small", llvm::CodeModel::Small)
@@ -607,15 +629,20 @@ void EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
   Options.MCOptions.PreserveAsmComments = CodeGenOpts.PreserveAsmComments;
   Options.MCOptions.ABIName = TargetOpts.ABI;
 
-  TM.reset(TheTarget->createTargetMachine(Triple, TargetOpts.CPU, FeaturesStr,
-                                          Options, RM, CM, OptLevel));
+  return std::unique_ptr<TargetMachine>(TheTarget.createTargetMachine(
+      Triple, TargetOpts.CPU, FeaturesStr, Options, RM, CM, OptLevel));
 }
 
-bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
-                                       BackendAction Action,
-                                       raw_pwrite_stream &OS) {
+/// Add the passes that generate code for \p Action with \p TM to
+/// \p CodeGenPasses.
+///
+/// \return True on success.
+static bool addCodeGenPasses(legacy::PassManager &CodeGenPasses,
+                             TargetMachine &TM, BackendAction Action,
+                             const CodeGenOptions &CodeGenOpts,
+                             raw_pwrite_stream &OS) {
   // Add LibraryInfo.
-  llvm::Triple TargetTriple(TheModule->getTargetTriple());
+  llvm::Triple TargetTriple(TM.getTargetTriple());
   std::unique_ptr<TargetLibraryInfoImpl> TLII(
       createTLII(TargetTriple, CodeGenOpts));
   CodeGenPasses.add(new TargetLibraryInfoWrapperPass(*TLII));
@@ -636,8 +663,14 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   if (CodeGenOpts.OptimizationLevel > 0)
     CodeGenPasses.add(createObjCARCContractPass());
 
-  if (TM->addPassesToEmitFile(CodeGenPasses, OS, CGFT,
-                              /*DisableVerify=*/!CodeGenOpts.VerifyModule)) {
+  return !TM.addPassesToEmitFile(CodeGenPasses, OS, CGFT,
+                                 /*DisableVerify=*/!CodeGenOpts.VerifyModule);
+}
+
+bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
+                                       BackendAction Action,
+                                       raw_pwrite_stream &OS) {
+  if (!addCodeGenPasses(CodeGenPasses, *TM, Action, CodeGenOpts, OS)) {
     Diags.Report(diag::err_fe_unable_to_interface_with_target);
     return false;
   }
@@ -645,6 +678,69 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   return true;
 }
 
+void EmitAssemblyHelper::EmitObjectInParallel(raw_pwrite_stream &OS) {
+  SmallVector<raw_pwrite_stream *, 8> OSs;
+  OSs.push_back(&OS);
+  std::vector<std::unique_ptr<raw_fd_ostream>> PartitionOSs;
+  for (const std::string &Path : CodeGenOpts.ParallelCodeGenOutputs) {
+    std::error_code EC;
+    PartitionOSs.emplace_back(
+        new raw_fd_ostream(Path, EC, llvm::sys::fs::F_None));
+    if (EC) {
+      Diags.Report(diag::err_fe_unable_to_open_output) << Path << EC.message();
+      return;
+    }
+    OSs.push_back(PartitionOSs.back().get());
+  }
+
+  std::string Error;
+  std::string Triple = TheModule->getTargetTriple();
+  const llvm::Target *TheTarget = TargetRegistry::lookupTarget(Triple, Error);
+  assert(TheTarget && "emitting an object without a target");
+
+  // The partitions are linked into a single relocatable object afterwards,
+  // so internal symbols must keep their linkage. SplitModule keeps each of
+  // them in the partition of its users instead of externalizing it.
+  ThreadPool CodeGenPool(OSs.size());
+  unsigned Partition = 0;
+  SplitModule(
+      CloneModule(TheModule), OSs.size(),
+      [&](std::unique_ptr<Module> MPart) {
+        // Each partition is generated in a context of its own. Serialize it
+        // to bitcode while still on this thread, as the partition shares the
+        // context of the original module.
+        SmallString<0> BC;
+        raw_svector_ostream BCOS(BC);
+        WriteBitcodeToFile(MPart.get(), BCOS);
+
+        raw_pwrite_stream *PartitionOS = OSs[Partition++];
+        CodeGenPool.async(
+            [this, TheTarget, &Triple, PartitionOS](const SmallString<0> &BC) {
+              LLVMContext Ctx;
+              ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
+                  MemoryBufferRef(StringRef(BC.data(), BC.size()),
+                                  "<codegen-partition>"),
+                  Ctx);
+              if (!MOrErr)
+                report_fatal_error("Failed to read codegen partition");
+
+              std::unique_ptr<TargetMachine> PartitionTM =
+                  buildTargetMachine(*TheTarget, Triple);
+              legacy::PassManager CodeGenPasses;
+              CodeGenPasses.add(createTargetTransformInfoWrapperPass(
+                  PartitionTM->getTargetIRAnalysis()));
+              if (!addCodeGenPasses(CodeGenPasses, *PartitionTM,
+                                    Backend_EmitObj, CodeGenOpts,
+                                    *PartitionOS))
+                report_fatal_error("Failed to set up codegen");
+              CodeGenPasses.run(**MOrErr);
+            },
+            std::move(BC));
+      },
+      /*PreserveLocals=*/true);
+  CodeGenPool.wait();
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       std::unique_ptr<raw_pwrite_stream> OS) {
   TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : nullptr);
@@ -710,6 +806,14 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
         createPrintModulePass(*OS, "", CodeGenOpts.EmitLLVMUseLists));
     break;
 
+  case Backend_EmitObj:
+    // The code generation passes are set up per partition.
+    if (!CodeGenOpts.ParallelCodeGenOutputs.empty())
+      break;
+    if (!AddEmitPasses(CodeGenPasses, Action, *OS))
+      return;
+    break;
+
   default:
     if (!AddEmitPasses(CodeGenPasses, Action, *OS))
       return;
@@ -738,7 +842,11 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   {
     PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses.run(*TheModule);
+    if (Action == Backend_EmitObj &&
+        !CodeGenOpts.ParallelCodeGenOutputs.empty())
+      EmitObjectInParallel(*OS);
+    else
+      CodeGenPasses.run(*TheModule);
   }
 }
 
@@ -748,6 +856,7 @@ void clang::EmitBackendOutput(DiagnosticsEngine &Diags,
                               const LangOptions &LOpts, const llvm::DataLayout &TDesc,
                               Module *M, BackendAction Action,
                               std::unique_ptr<raw_pwrite_stream> OS) {
+  llvm::TimeTraceScope TimeScope("Backend", "");
   EmitAssemblyHelper AsmHelper(Diags, CGOpts, TOpts, LOpts, M);
 
   AsmHelper.EmitAssembly(Action, std::move(OS));
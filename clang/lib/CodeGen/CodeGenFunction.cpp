@@ -34,6 +34,7 @@
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/TimeProfiler.h"
 using namespace clang;
 using namespace CodeGen;
 
@@ -999,6 +1000,8 @@ void CodeGenFunction::GenerateCode(GlobalDecl GD, llvm::Function *Fn,
   const FunctionDecl *FD = cast<FunctionDecl>(GD.getDecl());
   CurGD = GD;
 
+  llvm::TimeTraceScope TimeScope("CodeGen Function", Fn->getName());
+
   FunctionArgList Args;
   QualType ResTy = BuildFunctionArgList(GD, Args);
 
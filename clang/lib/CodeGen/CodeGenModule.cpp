@@ -43,6 +43,7 @@
 #include "clang/Basic/Version.h"
 #include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Sema/SemaDiagnostic.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/CallingConv.h"
@@ -54,10 +55,17 @@
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MD5.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
 using namespace CodeGen;
 
+#define DEBUG_TYPE "irgen"
+
+STATISTIC(NumDeferredDeclsEmitted, "Number of deferred definitions emitted");
+STATISTIC(NumDeferredDeclsSkipped,
+          "Number of deferred decls skipped because they were already defined");
+
 static const char AnnotationSection[] = "llvm.metadata";
 
 static CGCXXABI *createCXXABI(CodeGenModule &CGM) {
@@ -370,7 +378,10 @@ void InstrProfStats::reportDiagnostics(DiagnosticsEngine &Diags,
 }
 
 void CodeGenModule::Release() {
-  EmitDeferred();
+  {
+    llvm::TimeTraceScope TimeScope("EmitDeferred", "");
+    EmitDeferred();
+  }
   applyGlobalValReplacements();
   applyReplacements();
   checkAliases();
@@ -1298,10 +1309,13 @@ void CodeGenModule::EmitDeferred() {
     // up with definitions in unusual ways (e.g. by an extern inline
     // function acquiring a strong function redefinition).  Just
     // ignore these cases.
-    if (!GV->isDeclaration())
+    if (!GV->isDeclaration()) {
+      ++NumDeferredDeclsSkipped;
       continue;
+    }
 
     // Otherwise, emit the definition and move on to the next one.
+    ++NumDeferredDeclsEmitted;
     EmitGlobalDefinition(D, GV);
 
     // If we found out that we need to emit more decls, do that recursively.
@@ -5074,6 +5074,9 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_print_source_range_info);
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_parseable_fixits);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_report);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_granularity_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_summary_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftrapv);
 
   if (Arg *A = Args.getLastArg(options::OPT_ftrapv_handler_EQ)) {
@@ -5971,8 +5974,35 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
       !C.getDriver().embedBitcodeEnabled() && isa<CompileJobAction>(JA))
     CmdArgs.push_back("-disable-llvm-passes");
 
+  // With -fparallel-codegen=N, the backend writes N partial objects, which
+  // are then combined into the requested object by a relocatable link.
+  SmallVector<const char *, 8> CodeGenPartitions;
+  if (Arg *A = Args.getLastArg(options::OPT_fparallel_codegen_EQ)) {
+    unsigned NumPartitions;
+    if (StringRef(A->getValue()).getAsInteger(10, NumPartitions) ||
+        NumPartitions == 0)
+      D.Diag(diag::err_drv_invalid_int_value) << A->getAsString(Args)
+                                              << A->getValue();
+    else if (NumPartitions > 1 && Output.isFilename() &&
+             Output.getType() == types::TY_Object &&
+             getToolChain().getTriple().isOSBinFormatELF())
+      for (unsigned I = 0; I != NumPartitions; ++I) {
+        const char *Partition = C.addTempFile(Args.MakeArgString(
+            D.GetTemporaryPath(llvm::sys::path::stem(Output.getFilename()),
+                               "o")));
+        CodeGenPartitions.push_back(Partition);
+      }
+  }
+
   if (Output.getType() == types::TY_Dependencies) {
     // Handled with other dependency code.
+  } else if (!CodeGenPartitions.empty()) {
+    CmdArgs.push_back("-o");
+    CmdArgs.push_back(CodeGenPartitions[0]);
+    for (const char *Partition : makeArrayRef(CodeGenPartitions).slice(1)) {
+      CmdArgs.push_back("-parallel-codegen-output");
+      CmdArgs.push_back(Partition);
+    }
   } else if (Output.isFilename()) {
     CmdArgs.push_back("-o");
     CmdArgs.push_back(Output.getFilename());
@@ -6059,6 +6089,20 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     C.addCommand(llvm::make_unique<Command>(JA, *this, Exec, CmdArgs, Inputs));
   }
 
+  if (!CodeGenPartitions.empty()) {
+    ArgStringList LinkArgs;
+    LinkArgs.push_back("-r");
+    LinkArgs.push_back("-o");
+    LinkArgs.push_back(Output.getFilename());
+    LinkArgs.append(CodeGenPartitions.begin(), CodeGenPartitions.end());
+
+    const char *LinkExec =
+        Args.MakeArgString(getToolChain().GetLinkerPath());
+    InputInfo II(types::TY_Object, CodeGenPartitions[0], CodeGenPartitions[0]);
+    C.addCommand(
+        llvm::make_unique<Command>(JA, *this, LinkExec, LinkArgs, II));
+  }
+
   // Handle the debug info splitting at object creation time if we're
   // creating an object.
   // TODO: Currently only works on linux with newer objcopy.
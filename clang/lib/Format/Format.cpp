@@ -790,17 +790,182 @@ std::string configurationAsText(const FormatStyle &Style) {
 
 namespace {
 
+/// \brief The properties of the input from which the style options that are
+/// left to be detected are derived.
+struct LocalStyleStats {
+  int VariableAlignments = 0;
+  bool HasBinPackedFunction = false;
+  bool HasOnePerLineFunction = false;
+  bool HasCpp03IncompatibleFormat = false;
+
+  void add(const LocalStyleStats &Other) {
+    VariableAlignments += Other.VariableAlignments;
+    HasBinPackedFunction |= Other.HasBinPackedFunction;
+    HasOnePerLineFunction |= Other.HasOnePerLineFunction;
+    HasCpp03IncompatibleFormat |= Other.HasCpp03IncompatibleFormat;
+  }
+};
+
+/// \brief A top-level line, as seen by the \c IncrementalFormatter.
+struct TopLevelLine {
+  /// \brief The offset of the whitespace before the line.
+  unsigned Offset;
+  /// \brief The offset of the first token of the line.
+  unsigned TokenOffset;
+  /// \brief Whether the line starts a region whose formatting does not
+  /// depend on the lines before it.
+  bool StartsRegion;
+  /// \brief Whether all braces and preprocessor conditionals opened since the
+  /// first line were closed before this line, and none that was opened before
+  /// the first line was.
+  bool Balanced;
+  LocalStyleStats Stats;
+};
+
+/// \brief Determines which top-level lines start independent regions.
+///
+/// A line starts a region if formatting it and the lines after it gives the
+/// same result whether or not they are preceded by the lines before it. This
+/// is the case for a line at level 0 and column 0 that is preceded by an
+/// empty line and by a line at level 0 and column 0 that ends a statement or
+/// a declaration, because neither the parser, nor the alignment of
+/// consecutive lines, nor the formatting of the first token look past these.
+/// The enclosing braces must be namespaces (whose contents are at level 0),
+/// and the enclosing preprocessor conditionals must be parsed normally.
+class RegionCollector {
+public:
+  RegionCollector(const SourceManager &SourceMgr) : SourceMgr(SourceMgr) {}
+
+  TopLevelLine add(const AnnotatedLine &Line, const LocalStyleStats &Stats) {
+    TopLevelLine Result;
+    Result.Offset =
+        SourceMgr.getFileOffset(Line.First->WhitespaceRange.getBegin());
+    Result.TokenOffset = SourceMgr.getFileOffset(Line.First->Tok.getLocation());
+    Result.StartsRegion = startsRegion(Line);
+    Result.Balanced = !Underflow && BraceDepth == 0 && PPConditionals.empty();
+    Result.Stats = Stats;
+    update(Line);
+    PreviousLine = &Line;
+    return Result;
+  }
+
+private:
+  bool startsRegion(const AnnotatedLine &Line) const {
+    if (!PreviousLine || Line.Level != 0 || Line.InPPDirective ||
+        Line.First->is(tok::eof) || Line.First->NewlinesBefore < 2 ||
+        Line.First->OriginalColumn != 0 || InObjCContainer ||
+        std::find(PPConditionals.begin(), PPConditionals.end(), false) !=
+            PPConditionals.end())
+      return false;
+    const AnnotatedLine &Previous = *PreviousLine;
+    return Previous.Level == 0 && !Previous.InPPDirective &&
+           Previous.First->OriginalColumn == 0 &&
+           Previous.First->isNot(tok::comment) &&
+           Previous.Last->isOneOf(tok::semi, tok::r_brace);
+  }
+
+  void update(const AnnotatedLine &Line) {
+    if (Line.InPPDirective) {
+      if (Line.First->is(tok::hash) && Line.First->Next)
+        updatePPConditionals(*Line.First->Next);
+      return;
+    }
+    if (Line.First->is(tok::at) && Line.First->Next) {
+      switch (Line.First->Next->Tok.getObjCKeywordID()) {
+      case tok::objc_interface:
+      case tok::objc_implementation:
+        InObjCContainer = true;
+        break;
+      case tok::objc_protocol:
+        InObjCContainer |= Line.Last->isNot(tok::semi);
+        break;
+      case tok::objc_end:
+        InObjCContainer = false;
+        break;
+      default:
+        break;
+      }
+    }
+    countBraces(Line);
+  }
+
+  void updatePPConditionals(const FormatToken &Directive) {
+    StringRef Name = Directive.TokenText;
+    if (Name == "if" || Name == "ifdef" || Name == "ifndef") {
+      // Mirrors UnwrappedLineParser::parsePPIf(), which skips "#if 0".
+      const FormatToken *Condition = Directive.Next;
+      bool Unreachable = Name == "if" && Condition &&
+                         (Condition->TokenText == "0" ||
+                          Condition->is(tok::kw_false));
+      PPConditionals.push_back(!Unreachable);
+    } else if (Name == "elif" || Name == "else" || Name == "endif") {
+      if (PPConditionals.empty())
+        Underflow = true;
+      else if (Name == "endif")
+        PPConditionals.pop_back();
+      else
+        PPConditionals.back() = false;
+    }
+  }
+
+  void countBraces(const AnnotatedLine &Line) {
+    for (const FormatToken *Tok = Line.First; Tok; Tok = Tok->Next) {
+      if (Tok->is(tok::l_brace)) {
+        ++BraceDepth;
+      } else if (Tok->is(tok::r_brace)) {
+        if (BraceDepth == 0)
+          Underflow = true;
+        else
+          --BraceDepth;
+      }
+    }
+    for (const AnnotatedLine *Child : Line.Children)
+      countBraces(*Child);
+  }
+
+  const SourceManager &SourceMgr;
+  const AnnotatedLine *PreviousLine = nullptr;
+  unsigned BraceDepth = 0;
+  /// \brief For each open preprocessor conditional, whether its contents are
+  /// parsed as if it was not there.
+  SmallVector<bool, 4> PPConditionals;
+  bool InObjCContainer = false;
+  bool Underflow = false;
+};
+
 class Formatter : public TokenAnalyzer {
 public:
   Formatter(const Environment &Env, const FormatStyle &Style,
             bool *IncompleteFormat)
       : TokenAnalyzer(Env, Style), IncompleteFormat(IncompleteFormat) {}
 
+  /// \brief Describe the top-level lines in \p Lines, and derive the style
+  /// options as if the code was preceded or followed by code with the
+  /// properties \p OtherStats.
+  void setIncremental(std::vector<TopLevelLine> *Lines,
+                      const LocalStyleStats &OtherStats) {
+    TopLevelLines = Lines;
+    this->OtherStats = OtherStats;
+  }
+
+  /// \brief The number of times the code was parsed, once for each
+  /// combination of preprocessor branches.
+  unsigned getNumRuns() const { return NumRuns; }
+
   tooling::Replacements
   analyze(TokenAnnotator &Annotator,
           SmallVectorImpl<AnnotatedLine *> &AnnotatedLines,
           FormatTokenLexer &Tokens, tooling::Replacements &Result) override {
-    deriveLocalStyle(AnnotatedLines);
+    ++NumRuns;
+    LocalStyleStats Stats = OtherStats;
+    RegionCollector Regions(Env.getSourceManager());
+    for (const AnnotatedLine *Line : AnnotatedLines) {
+      LocalStyleStats LineStats = getLocalStyleStats(*Line);
+      Stats.add(LineStats);
+      if (TopLevelLines)
+        TopLevelLines->push_back(Regions.add(*Line, LineStats));
+    }
+    deriveLocalStyle(Stats);
     AffectedRangeMgr.computeAffectedLines(AnnotatedLines.begin(),
                                           AnnotatedLines.end());
 
@@ -909,17 +1074,22 @@ private:
 
   bool
   hasCpp03IncompatibleFormat(const SmallVectorImpl<AnnotatedLine *> &Lines) {
-    for (const AnnotatedLine *Line : Lines) {
-      if (hasCpp03IncompatibleFormat(Line->Children))
+    for (const AnnotatedLine *Line : Lines)
+      if (hasCpp03IncompatibleFormat(*Line))
         return true;
-      for (FormatToken *Tok = Line->First->Next; Tok; Tok = Tok->Next) {
-        if (Tok->WhitespaceRange.getBegin() == Tok->WhitespaceRange.getEnd()) {
-          if (Tok->is(tok::coloncolon) && Tok->Previous->is(TT_TemplateOpener))
-            return true;
-          if (Tok->is(TT_TemplateCloser) &&
-              Tok->Previous->is(TT_TemplateCloser))
-            return true;
-        }
+    return false;
+  }
+
+  bool hasCpp03IncompatibleFormat(const AnnotatedLine &Line) {
+    if (hasCpp03IncompatibleFormat(Line.Children))
+      return true;
+    for (FormatToken *Tok = Line.First->Next; Tok; Tok = Tok->Next) {
+      if (Tok->WhitespaceRange.getBegin() == Tok->WhitespaceRange.getEnd()) {
+        if (Tok->is(tok::coloncolon) && Tok->Previous->is(TT_TemplateOpener))
+          return true;
+        if (Tok->is(TT_TemplateCloser) &&
+            Tok->Previous->is(TT_TemplateCloser))
+          return true;
       }
     }
     return false;
@@ -927,55 +1097,63 @@ private:
 
   int countVariableAlignments(const SmallVectorImpl<AnnotatedLine *> &Lines) {
     int AlignmentDiff = 0;
-    for (const AnnotatedLine *Line : Lines) {
-      AlignmentDiff += countVariableAlignments(Line->Children);
-      for (FormatToken *Tok = Line->First; Tok && Tok->Next; Tok = Tok->Next) {
-        if (!Tok->is(TT_PointerOrReference))
-          continue;
-        bool SpaceBefore =
-            Tok->WhitespaceRange.getBegin() != Tok->WhitespaceRange.getEnd();
-        bool SpaceAfter = Tok->Next->WhitespaceRange.getBegin() !=
-                          Tok->Next->WhitespaceRange.getEnd();
-        if (SpaceBefore && !SpaceAfter)
-          ++AlignmentDiff;
-        if (!SpaceBefore && SpaceAfter)
-          --AlignmentDiff;
-      }
-    }
+    for (const AnnotatedLine *Line : Lines)
+      AlignmentDiff += countVariableAlignments(*Line);
     return AlignmentDiff;
   }
 
-  void
-  deriveLocalStyle(const SmallVectorImpl<AnnotatedLine *> &AnnotatedLines) {
-    bool HasBinPackedFunction = false;
-    bool HasOnePerLineFunction = false;
-    for (unsigned i = 0, e = AnnotatedLines.size(); i != e; ++i) {
-      if (!AnnotatedLines[i]->First->Next)
+  int countVariableAlignments(const AnnotatedLine &Line) {
+    int AlignmentDiff = countVariableAlignments(Line.Children);
+    for (FormatToken *Tok = Line.First; Tok && Tok->Next; Tok = Tok->Next) {
+      if (!Tok->is(TT_PointerOrReference))
         continue;
-      FormatToken *Tok = AnnotatedLines[i]->First->Next;
-      while (Tok->Next) {
+      bool SpaceBefore =
+          Tok->WhitespaceRange.getBegin() != Tok->WhitespaceRange.getEnd();
+      bool SpaceAfter = Tok->Next->WhitespaceRange.getBegin() !=
+                        Tok->Next->WhitespaceRange.getEnd();
+      if (SpaceBefore && !SpaceAfter)
+        ++AlignmentDiff;
+      if (!SpaceBefore && SpaceAfter)
+        --AlignmentDiff;
+    }
+    return AlignmentDiff;
+  }
+
+  LocalStyleStats getLocalStyleStats(const AnnotatedLine &Line) {
+    LocalStyleStats Stats;
+    if (Line.First->Next) {
+      for (FormatToken *Tok = Line.First->Next; Tok->Next; Tok = Tok->Next) {
         if (Tok->PackingKind == PPK_BinPacked)
-          HasBinPackedFunction = true;
+          Stats.HasBinPackedFunction = true;
         if (Tok->PackingKind == PPK_OnePerLine)
-          HasOnePerLineFunction = true;
-
-        Tok = Tok->Next;
+          Stats.HasOnePerLineFunction = true;
       }
     }
     if (Style.DerivePointerAlignment)
-      Style.PointerAlignment = countVariableAlignments(AnnotatedLines) <= 0
+      Stats.VariableAlignments = countVariableAlignments(Line);
+    if (Style.Standard == FormatStyle::LS_Auto)
+      Stats.HasCpp03IncompatibleFormat = hasCpp03IncompatibleFormat(Line);
+    return Stats;
+  }
+
+  void deriveLocalStyle(const LocalStyleStats &Stats) {
+    if (Style.DerivePointerAlignment)
+      Style.PointerAlignment = Stats.VariableAlignments <= 0
                                    ? FormatStyle::PAS_Left
                                    : FormatStyle::PAS_Right;
     if (Style.Standard == FormatStyle::LS_Auto)
-      Style.Standard = hasCpp03IncompatibleFormat(AnnotatedLines)
+      Style.Standard = Stats.HasCpp03IncompatibleFormat
                            ? FormatStyle::LS_Cpp11
                            : FormatStyle::LS_Cpp03;
     BinPackInconclusiveFunctions =
-        HasBinPackedFunction || !HasOnePerLineFunction;
+        Stats.HasBinPackedFunction || !Stats.HasOnePerLineFunction;
   }
 
   bool BinPackInconclusiveFunctions;
   bool *IncompleteFormat;
+  std::vector<TopLevelLine> *TopLevelLines = nullptr;
+  LocalStyleStats OtherStats;
+  unsigned NumRuns = 0;
 };
 
 // This class clean up the erroneous/redundant code around the given ranges in
@@ -1635,6 +1813,186 @@ tooling::Replacements reformat(const FormatStyle &Style, StringRef Code,
   return Format.process();
 }
 
+struct IncrementalFormatter::State {
+  /// \brief The code passed to the previous call.
+  std::string Code;
+  /// \brief The top-level lines of \c Code.
+  std::vector<TopLevelLine> Lines;
+};
+
+IncrementalFormatter::IncrementalFormatter(const FormatStyle &Style,
+                                           StringRef FileName)
+    : Style(expandPresets(Style)), FileName(FileName) {}
+
+IncrementalFormatter::~IncrementalFormatter() {}
+
+tooling::Replacements
+IncrementalFormatter::reformat(StringRef Code, ArrayRef<tooling::Range> Ranges,
+                               bool *IncompleteFormat) {
+  LastProcessedLength = Code.size();
+  if (Style.DisableFormat)
+    return tooling::Replacements();
+
+  // Code that is parsed more than once, once per preprocessor branch, is
+  // handled by the fallback below.
+  if (Style.Language != FormatStyle::LK_Cpp || Style.MaxEmptyLinesToKeep == 0 ||
+      Code.find('\r') != StringRef::npos) {
+    S.reset();
+    return format::reformat(Style, Code, Ranges, FileName, IncompleteFormat);
+  }
+
+  auto FormatAll = [&]() {
+    std::unique_ptr<State> NewState(new State);
+    std::unique_ptr<Environment> Env =
+        Environment::CreateVirtualEnvironment(Code, FileName, Ranges);
+    Formatter Format(*Env, Style, IncompleteFormat);
+    Format.setIncremental(&NewState->Lines, LocalStyleStats());
+    tooling::Replacements Result = Format.process();
+    NewState->Code = Code;
+    if (Format.getNumRuns() == 1 && !NewState->Lines.empty())
+      S = std::move(NewState);
+    else
+      S.reset();
+    return Result;
+  };
+  if (!S)
+    return FormatAll();
+
+  StringRef OldCode = S->Code;
+  if (Code == OldCode && Ranges.empty())
+    return tooling::Replacements();
+
+  // Find the changed part of the code, [Prefix, Code.size() - Suffix).
+  unsigned Prefix = 0;
+  unsigned MaxCommon = std::min(Code.size(), OldCode.size());
+  while (Prefix < MaxCommon && Code[Prefix] == OldCode[Prefix])
+    ++Prefix;
+  // Unchanged code is both a prefix and a suffix of itself.
+  unsigned Suffix = Code == OldCode ? Code.size() : 0;
+  while (Prefix + Suffix < MaxCommon &&
+         Code[Code.size() - Suffix - 1] == OldCode[OldCode.size() - Suffix - 1])
+    ++Suffix;
+  int Delta = (int)Code.size() - (int)OldCode.size();
+
+  // [Lo, Hi) covers the changes and the ranges to format.
+  unsigned Lo = Prefix;
+  unsigned Hi = Code.size() - Suffix;
+  for (const tooling::Range &R : Ranges) {
+    Lo = std::min(Lo, R.getOffset());
+    Hi = std::max(Hi, R.getOffset() + R.getLength());
+  }
+
+  // The window starts at the last region before Lo whose first token and
+  // everything before it is unchanged, and ends at the first region after Hi
+  // whose text is unchanged. The first line of that region is included, so
+  // that its formatting can be compared.
+  const std::vector<TopLevelLine> &Lines = S->Lines;
+  unsigned First = 0;
+  for (unsigned I = 1, E = Lines.size(); I != E; ++I) {
+    if (Lines[I].Offset >= Lo || Lines[I].TokenOffset >= Prefix)
+      break;
+    if (Lines[I].StartsRegion)
+      First = I;
+  }
+  unsigned Last = Lines.size();
+  for (unsigned I = First + 1, E = Lines.size(); I != E; ++I) {
+    if (Lines[I].StartsRegion && Lines[I].Offset >= OldCode.size() - Suffix &&
+        Lines[I].Offset + Delta > Hi) {
+      Last = I;
+      break;
+    }
+  }
+  bool AtEnd = Last == Lines.size();
+  unsigned Begin = Lines[First].Offset;
+  unsigned LastOffset = AtEnd ? Code.size() : Lines[Last].Offset + Delta;
+  unsigned End = Last + 1 < Lines.size() ? Lines[Last + 1].Offset + Delta
+                                         : Code.size();
+
+  // Unless the window starts at the beginning of the file, it is preceded by
+  // a line that ends a declaration, as the line before the region is.
+  unsigned Pad = Begin > 0 ? 1 : 0;
+  std::string Window = Pad ? ";" : "";
+  Window += Code.substr(Begin, End - Begin);
+  auto ToWindow = [&](unsigned Offset) { return Offset - Begin + Pad; };
+  auto FromWindow = [&](unsigned Offset) { return Offset + Begin - Pad; };
+
+  std::vector<tooling::Range> WindowRanges;
+  for (const tooling::Range &R : Ranges)
+    WindowRanges.push_back(
+        tooling::Range(ToWindow(R.getOffset()), R.getLength()));
+
+  LocalStyleStats OtherStats;
+  for (unsigned I = 0; I != First; ++I)
+    OtherStats.add(Lines[I].Stats);
+  for (unsigned I = Last + 1, E = Lines.size(); I < E; ++I)
+    OtherStats.add(Lines[I].Stats);
+
+  std::vector<TopLevelLine> WindowLines;
+  bool WindowIncomplete = false;
+  std::unique_ptr<Environment> Env =
+      Environment::CreateVirtualEnvironment(Window, FileName, WindowRanges);
+  Formatter Format(*Env, Style, &WindowIncomplete);
+  Format.setIncremental(&WindowLines, OtherStats);
+  tooling::Replacements WindowResult = Format.process();
+  if (Format.getNumRuns() != 1)
+    return FormatAll();
+
+  // Check that the window splits where the file does: the first line after
+  // the synthetic one must still start a region, the line at LastOffset must
+  // start one outside of any brace or conditional opened in the window, and
+  // nothing after LastOffset may have been formatted differently.
+  std::vector<TopLevelLine> NewLines;
+  bool CheckedFirst = Pad == 0;
+  bool CheckedLast = AtEnd;
+  for (TopLevelLine &Line : WindowLines) {
+    if (Line.TokenOffset < Pad)
+      continue;
+    if (!CheckedFirst) {
+      if (!Line.StartsRegion)
+        return FormatAll();
+      CheckedFirst = true;
+    }
+    Line.Offset = FromWindow(Line.Offset);
+    Line.TokenOffset = FromWindow(Line.TokenOffset);
+    if (!AtEnd && Line.Offset >= LastOffset) {
+      if (Line.Offset != LastOffset || !Line.StartsRegion || !Line.Balanced)
+        return FormatAll();
+      CheckedLast = true;
+      break;
+    }
+    NewLines.push_back(Line);
+  }
+  if (!CheckedFirst || !CheckedLast || NewLines.empty())
+    return FormatAll();
+
+  tooling::Replacements Result;
+  for (const tooling::Replacement &R : WindowResult) {
+    if (R.getOffset() < Pad || FromWindow(R.getOffset()) + R.getLength() >
+                                   (AtEnd ? Code.size() : LastOffset))
+      return FormatAll();
+    Result.insert(tooling::Replacement(FileName, FromWindow(R.getOffset()),
+                                       R.getLength(),
+                                       R.getReplacementText()));
+  }
+
+  // Splice the lines of the window into the cached ones.
+  NewLines.front().StartsRegion = Lines[First].StartsRegion;
+  for (unsigned I = Last, E = Lines.size(); I < E; ++I) {
+    TopLevelLine Line = Lines[I];
+    Line.Offset += Delta;
+    Line.TokenOffset += Delta;
+    NewLines.push_back(Line);
+  }
+  S->Lines.resize(First);
+  S->Lines.insert(S->Lines.end(), NewLines.begin(), NewLines.end());
+  S->Code = Code;
+
+  if (IncompleteFormat && WindowIncomplete)
+    *IncompleteFormat = true;
+  LastProcessedLength = End - Begin;
+  return Result;
+}
+
 tooling::Replacements cleanup(const FormatStyle &Style, SourceManager &SM,
                               FileID ID, ArrayRef<CharSourceRange> Ranges) {
   Environment Env(SM, ID, Ranges);
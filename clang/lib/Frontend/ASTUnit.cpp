@@ -34,6 +34,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/ASTWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CrashRecoveryContext.h"
@@ -180,6 +181,34 @@ void OnDiskData::Cleanup() {
   CleanPreambleFile();
 }
 
+/// \brief A precompiled preamble, along with everything an ASTUnit needs to
+/// know about it to use it without having built it.
+struct ASTUnit::SharedPreamble {
+  /// \brief The main file the preamble was built for.
+  std::string MainFileName;
+
+  /// \brief The file containing the precompiled preamble, which is removed
+  /// when the last unit using it is done with it.
+  std::string PCHFile;
+
+  /// \brief The contents of the preamble.
+  std::vector<char> Contents;
+
+  bool EndsAtStartOfLine;
+
+  llvm::StringMap<PreambleFileHash> FilesInPreamble;
+
+  SmallVector<StandaloneDiagnostic, 4> Diagnostics;
+
+  unsigned NumWarnings;
+
+  std::vector<serialization::DeclID> TopLevelDecls;
+
+  unsigned TopLevelHashValue;
+
+  ~SharedPreamble() { llvm::sys::fs::remove(PCHFile); }
+};
+
 struct ASTUnit::ASTWriterData {
   SmallString<128> Buffer;
   llvm::BitstreamWriter Stream;
@@ -1114,7 +1143,7 @@ bool ASTUnit::Parse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
     PreprocessorOpts.PrecompiledPreambleBytes.first = Preamble.size();
     PreprocessorOpts.PrecompiledPreambleBytes.second
                                                     = PreambleEndsAtStartOfLine;
-    PreprocessorOpts.ImplicitPCHInclude = getPreambleFile(this);
+    PreprocessorOpts.ImplicitPCHInclude = getPrecompiledPreambleFile();
     PreprocessorOpts.DisablePCHValidation = true;
     
     // The stored diagnostic has the old source manager in it; update
@@ -1316,6 +1345,100 @@ makeStandaloneDiagnostic(const LangOptions &LangOpts,
   return OutDiag;
 }
 
+/// \brief Determine whether any of the files used to build a precompiled
+/// preamble have changed since, taking remapped files into account.
+static bool havePreambleFilesChanged(
+    FileManager &FileMgr, const PreprocessorOptions &PreprocessorOpts,
+    const llvm::StringMap<ASTUnit::PreambleFileHash> &FilesInPreamble) {
+  typedef ASTUnit::PreambleFileHash PreambleFileHash;
+
+  // First, make a record of those files that have been overridden via
+  // remapping or unsaved_files.
+  std::map<llvm::sys::fs::UniqueID, PreambleFileHash> OverriddenFiles;
+  for (const auto &R : PreprocessorOpts.RemappedFiles) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(R.second, Status)) {
+      // If we can't stat the file we're remapping to, assume that something
+      // horrible happened.
+      return true;
+    }
+
+    OverriddenFiles[Status.getUniqueID()] = PreambleFileHash::createForFile(
+        Status.getSize(), Status.getLastModificationTime().toEpochTime());
+  }
+
+  for (const auto &RB : PreprocessorOpts.RemappedFileBuffers) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(RB.first, Status))
+      return true;
+
+    OverriddenFiles[Status.getUniqueID()] =
+        PreambleFileHash::createForMemoryBuffer(RB.second);
+  }
+
+  // Check whether anything has changed.
+  for (const auto &F : FilesInPreamble) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(F.first(), Status)) {
+      // If we can't stat the file, assume that something horrible happened.
+      return true;
+    }
+
+    std::map<llvm::sys::fs::UniqueID, PreambleFileHash>::iterator Overridden
+      = OverriddenFiles.find(Status.getUniqueID());
+    if (Overridden != OverriddenFiles.end()) {
+      // This file was remapped; check whether the newly-mapped file
+      // matches up with the previous mapping.
+      if (Overridden->second != F.second)
+        return true;
+      continue;
+    }
+
+    // The file was not remapped; check whether it has changed on disk.
+    if (Status.getSize() != uint64_t(F.second.Size) ||
+        Status.getLastModificationTime().toEpochTime() !=
+            uint64_t(F.second.ModTime))
+      return true;
+  }
+
+  return false;
+}
+
+/// \brief Compute the key under which a precompiled preamble is shared with
+/// other ASTUnits.
+///
+/// Besides the main file and the preamble itself, this covers the options
+/// that affect how the preamble is preprocessed and parsed. Remapped files
+/// aren't included; they are validated against the files the preamble was
+/// built from instead.
+static std::string getSharedPreambleKey(const CompilerInvocation &Invocation,
+                                        StringRef MainFilename,
+                                        StringRef Preamble,
+                                        bool PreambleEndsAtStartOfLine) {
+  using llvm::hash_combine;
+
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  const DiagnosticOptions &DiagOpts = Invocation.getDiagnosticOpts();
+  llvm::hash_code Code =
+      hash_combine(Invocation.getModuleHash(), MainFilename, Preamble,
+                   PreambleEndsAtStartOfLine);
+  for (const auto &Entry : HSOpts.UserEntries)
+    Code = hash_combine(Code, Entry.Path, Entry.Group, Entry.IsFramework,
+                        Entry.IgnoreSysRoot);
+  for (const auto &Prefix : HSOpts.SystemHeaderPrefixes)
+    Code = hash_combine(Code, Prefix.Prefix, Prefix.IsSystemHeader);
+  for (const auto &Include : PPOpts.Includes)
+    Code = hash_combine(Code, Include);
+  for (const auto &Include : PPOpts.MacroIncludes)
+    Code = hash_combine(Code, Include);
+  Code = hash_combine(Code, PPOpts.ImplicitPCHInclude,
+                      Invocation.getFrontendOpts().SkipFunctionBodies);
+  for (const auto &Warning : DiagOpts.Warnings)
+    Code = hash_combine(Code, Warning);
+  return llvm::utohexstr(Code);
+}
+
 /// \brief Attempt to build or re-use a precompiled preamble when (re-)parsing
 /// the source file.
 ///
@@ -1355,6 +1478,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     // preamble, if we have one. It's obviously no good any more.
     Preamble.clear();
     erasePreambleFile(this);
+    CurrentSharedPreamble.reset();
 
     // The next time we actually see a preamble, precompile it.
     PreambleRebuildCounter = 1;
@@ -1374,70 +1498,9 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
       // preamble.
 
       // Check that none of the files used by the preamble have changed.
-      bool AnyFileChanged = false;
-          
-      // First, make a record of those files that have been overridden via
-      // remapping or unsaved_files.
-      std::map<llvm::sys::fs::UniqueID, PreambleFileHash> OverriddenFiles;
-      for (const auto &R : PreprocessorOpts.RemappedFiles) {
-        if (AnyFileChanged)
-          break;
-
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(R.second, Status)) {
-          // If we can't stat the file we're remapping to, assume that something
-          // horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
+      bool AnyFileChanged =
+          havePreambleFilesChanged(*FileMgr, PreprocessorOpts, FilesInPreamble);
 
-        OverriddenFiles[Status.getUniqueID()] = PreambleFileHash::createForFile(
-            Status.getSize(), Status.getLastModificationTime().toEpochTime());
-      }
-
-      for (const auto &RB : PreprocessorOpts.RemappedFileBuffers) {
-        if (AnyFileChanged)
-          break;
-
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(RB.first, Status)) {
-          AnyFileChanged = true;
-          break;
-        }
-
-        OverriddenFiles[Status.getUniqueID()] =
-            PreambleFileHash::createForMemoryBuffer(RB.second);
-      }
-       
-      // Check whether anything has changed.
-      for (llvm::StringMap<PreambleFileHash>::iterator
-             F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
-           !AnyFileChanged && F != FEnd; 
-           ++F) {
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(F->first(), Status)) {
-          // If we can't stat the file, assume that something horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
-
-        std::map<llvm::sys::fs::UniqueID, PreambleFileHash>::iterator Overridden
-          = OverriddenFiles.find(Status.getUniqueID());
-        if (Overridden != OverriddenFiles.end()) {
-          // This file was remapped; check whether the newly-mapped file 
-          // matches up with the previous mapping.
-          if (Overridden->second != F->second)
-            AnyFileChanged = true;
-          continue;
-        }
-        
-        // The file was not remapped; check whether it has changed on disk.
-        if (Status.getSize() != uint64_t(F->second.Size) ||
-            Status.getLastModificationTime().toEpochTime() !=
-                uint64_t(F->second.ModTime))
-          AnyFileChanged = true;
-      }
-          
       if (!AnyFileChanged) {
         // Okay! We can re-use the precompiled preamble.
 
@@ -1462,6 +1525,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     Preamble.clear();
     PreambleDiagnostics.clear();
     erasePreambleFile(this);
+    CurrentSharedPreamble.reset();
     PreambleRebuildCounter = 1;
   } else if (!AllowRebuild) {
     // We aren't allowed to rebuild the precompiled preamble; just
@@ -1469,6 +1533,54 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     return nullptr;
   }
 
+  // Another unit sharing our preamble cache may already have precompiled
+  // this preamble. If so, use theirs rather than building our own.
+  StringRef MainFilename = FrontendOpts.Inputs[0].getFile();
+  std::string SharedPreambleKey;
+  if (PreambleCache) {
+    StringRef PreambleText =
+        NewPreamble.Buffer->getBuffer().slice(0, NewPreamble.Size);
+    SharedPreambleKey =
+        getSharedPreambleKey(*PreambleInvocation, MainFilename, PreambleText,
+                             NewPreamble.PreambleEndsAtStartOfLine);
+    std::shared_ptr<const SharedPreamble> Shared = PreambleCache->getOrClaim(
+        SharedPreambleKey, [&](const SharedPreamble &Candidate) {
+          return Candidate.MainFileName == MainFilename &&
+                 Candidate.EndsAtStartOfLine ==
+                     NewPreamble.PreambleEndsAtStartOfLine &&
+                 StringRef(Candidate.Contents.data(),
+                           Candidate.Contents.size()) == PreambleText &&
+                 !havePreambleFilesChanged(*FileMgr, PreprocessorOpts,
+                                           Candidate.FilesInPreamble);
+        });
+    if (Shared) {
+      adoptSharedPreamble(std::move(Shared), FileMgr->getFile(MainFilename));
+
+      // Set the state of the diagnostic object to mimic its state
+      // after parsing the preamble.
+      getDiagnostics().Reset();
+      ProcessWarningOptions(getDiagnostics(),
+                            PreambleInvocation->getDiagnosticOpts());
+      getDiagnostics().setNumWarnings(NumWarningsInPreamble);
+
+      return llvm::MemoryBuffer::getMemBufferCopy(
+          NewPreamble.Buffer->getBuffer(), MainFilename);
+    }
+  }
+
+  // If we claimed this preamble in the cache, make sure that the units
+  // waiting for it learn how building it went, however we leave.
+  struct SharedPreambleBuild {
+    PrecompiledPreambleCache *Cache;
+    StringRef Key;
+    std::shared_ptr<const SharedPreamble> Built;
+
+    ~SharedPreambleBuild() {
+      if (Cache)
+        Cache->finishBuild(Key, std::move(Built));
+    }
+  } Build = {PreambleCache.get(), SharedPreambleKey, nullptr};
+
   // If the preamble rebuild counter > 1, it's because we previously
   // failed to build a preamble and we're not yet ready to try
   // again. Decrement the counter and return a failure.
@@ -1492,7 +1604,6 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
 
   // Save the preamble text for later; we'll need to compare against it for
   // subsequent reparses.
-  StringRef MainFilename = FrontendOpts.Inputs[0].getFile();
   Preamble.assign(FileMgr->getFile(MainFilename),
                   NewPreamble.Buffer->getBufferStart(),
                   NewPreamble.Buffer->getBufferStart() + NewPreamble.Size);
@@ -1642,10 +1753,61 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     PreambleTopLevelHashValue = CurrentTopLevelHashValue;
   }
 
+  // Share the new preamble with other units. From now on, the preamble file
+  // belongs to the shared preamble.
+  if (PreambleCache) {
+    auto Shared = std::make_shared<SharedPreamble>();
+    Shared->MainFileName = MainFilename;
+    Shared->PCHFile = FrontendOpts.OutputFile;
+    Shared->Contents.assign(Preamble.getBufferStart(),
+                            Preamble.getBufferStart() + Preamble.size());
+    Shared->EndsAtStartOfLine = PreambleEndsAtStartOfLine;
+    Shared->FilesInPreamble = FilesInPreamble;
+    Shared->Diagnostics = PreambleDiagnostics;
+    Shared->NumWarnings = NumWarningsInPreamble;
+    Shared->TopLevelDecls = TopLevelDeclsInPreamble;
+    Shared->TopLevelHashValue = CurrentTopLevelHashValue;
+    setPreambleFile(this, StringRef());
+    CurrentSharedPreamble = Shared;
+    Build.Built = std::move(Shared);
+  }
+
   return llvm::MemoryBuffer::getMemBufferCopy(NewPreamble.Buffer->getBuffer(),
                                               MainFilename);
 }
 
+const std::string &ASTUnit::getPrecompiledPreambleFile() {
+  if (CurrentSharedPreamble)
+    return CurrentSharedPreamble->PCHFile;
+  return getPreambleFile(this);
+}
+
+void ASTUnit::adoptSharedPreamble(std::shared_ptr<const SharedPreamble> Shared,
+                                  const FileEntry *MainFile) {
+  // Any preamble file of our own is obsolete now.
+  erasePreambleFile(this);
+
+  Preamble.assign(MainFile, Shared->Contents.data(),
+                  Shared->Contents.data() + Shared->Contents.size());
+  PreambleEndsAtStartOfLine = Shared->EndsAtStartOfLine;
+  FilesInPreamble = Shared->FilesInPreamble;
+  PreambleDiagnostics = Shared->Diagnostics;
+  NumWarningsInPreamble = Shared->NumWarnings;
+  TopLevelDeclsInPreamble = Shared->TopLevelDecls;
+  OriginalSourceFile = Shared->MainFileName;
+  PreambleRebuildCounter = 1;
+
+  // Mimic the effect building the preamble would have had on the
+  // code-completion cache.
+  CurrentTopLevelHashValue = Shared->TopLevelHashValue;
+  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+    CompletionCacheTopLevelHashValue = 0;
+    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+  }
+
+  CurrentSharedPreamble = std::move(Shared);
+}
+
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
   std::vector<Decl *> Resolved;
   Resolved.reserve(TopLevelDeclsInPreamble.size());
@@ -1945,7 +2107,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
     bool CacheCodeCompletionResults, bool IncludeBriefCommentsInCodeCompletion,
     bool AllowPCHWithCompilerErrors, bool SkipFunctionBodies,
     bool UserFilesAreVolatile, bool ForSerialization,
-    llvm::Optional<StringRef> ModuleFormat, std::unique_ptr<ASTUnit> *ErrAST) {
+    llvm::Optional<StringRef> ModuleFormat, std::unique_ptr<ASTUnit> *ErrAST,
+    std::shared_ptr<PrecompiledPreambleCache> PreambleCache) {
   assert(Diags.get() && "no DiagnosticsEngine was provided");
 
   SmallVector<StoredDiagnostic, 4> StoredDiagnostics;
@@ -2002,6 +2165,7 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
   AST->NumStoredDiagnosticsFromDriver = StoredDiagnostics.size();
   AST->StoredDiagnostics.swap(StoredDiagnostics);
   AST->Invocation = CI;
+  AST->PreambleCache = std::move(PreambleCache);
   if (ForSerialization)
     AST->WriterData.reset(new ASTWriterData());
   // Zero out now to ease cleanup during crash recovery.
@@ -2050,7 +2214,7 @@ bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   // If we have a preamble file lying around, or if we might try to
   // build a precompiled preamble, do so now.
   std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer;
-  if (!getPreambleFile(this).empty() || PreambleRebuildCounter > 0)
+  if (!getPrecompiledPreambleFile().empty() || PreambleRebuildCounter > 0)
     OverrideMainBuffer =
         getMainBufferWithPrecompiledPreamble(PCHContainerOps, *Invocation);
 
@@ -2418,7 +2582,7 @@ void ASTUnit::CodeComplete(
   // point is within the main file, after the end of the precompiled
   // preamble.
   std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer;
-  if (!getPreambleFile(this).empty()) {
+  if (!getPrecompiledPreambleFile().empty()) {
     std::string CompleteFilePath(File);
     llvm::sys::fs::UniqueID CompleteFileID;
 
@@ -2441,7 +2605,7 @@ void ASTUnit::CodeComplete(
     PreprocessorOpts.PrecompiledPreambleBytes.first = Preamble.size();
     PreprocessorOpts.PrecompiledPreambleBytes.second
                                                     = PreambleEndsAtStartOfLine;
-    PreprocessorOpts.ImplicitPCHInclude = getPreambleFile(this);
+    PreprocessorOpts.ImplicitPCHInclude = getPrecompiledPreambleFile();
     PreprocessorOpts.DisablePCHValidation = true;
 
     OwnedBuffers.push_back(OverrideMainBuffer.release());
@@ -2864,3 +3028,63 @@ void ASTUnit::ConcurrencyState::start() {}
 void ASTUnit::ConcurrencyState::finish() {}
 
 #endif // NDEBUG
+
+PrecompiledPreambleCache::SharedPreamblePtr
+PrecompiledPreambleCache::getOrClaim(
+    StringRef Key,
+    llvm::function_ref<bool(const ASTUnit::SharedPreamble &)> IsUsable) {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  BuildFinished.wait(Lock, [&] { return !InProgress.count(Key); });
+
+  auto Known = Preambles.find(Key);
+  if (Known != Preambles.end()) {
+    if (SharedPreamblePtr Cached = Known->second.lock()) {
+      if (IsUsable(*Cached)) {
+        ++NumHits;
+        return Cached;
+      }
+    } else {
+      Preambles.erase(Known);
+    }
+  }
+
+  ++NumMisses;
+  InProgress.insert(Key);
+  return nullptr;
+}
+
+void PrecompiledPreambleCache::finishBuild(StringRef Key,
+                                           SharedPreamblePtr Built) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    assert(InProgress.count(Key) && "preamble is not being built");
+    InProgress.erase(Key);
+    if (Built) {
+      // Forget the preambles that no unit uses anymore while we are here, so
+      // that their entries do not pile up.
+      for (auto I = Preambles.begin(), E = Preambles.end(); I != E;) {
+        auto Current = I;
+        ++I;
+        if (Current->second.expired())
+          Preambles.erase(Current);
+      }
+      Preambles[Key] = std::move(Built);
+    }
+  }
+  BuildFinished.notify_all();
+}
+
+void PrecompiledPreambleCache::clear() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Preambles.clear();
+}
+
+unsigned PrecompiledPreambleCache::getNumHits() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return NumHits;
+}
+
+unsigned PrecompiledPreambleCache::getNumMisses() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return NumMisses;
+}
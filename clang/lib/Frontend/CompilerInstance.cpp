@@ -22,6 +22,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/LogDiagnosticPrinter.h"
+#include "clang/Frontend/ModuleBuildService.h"
 #include "clang/Frontend/SerializedDiagnosticPrinter.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Frontend/Utils.h"
@@ -997,6 +998,7 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   // between all of the module CompilerInstances. Other than that, we don't
   // want to produce any dependency output from the module build.
   Instance.setModuleDepCollector(ImportingInstance.getModuleDepCollector());
+  Instance.setModuleBuildService(ImportingInstance.getModuleBuildService());
   Invocation->getDependencyOutputOpts() = DependencyOutputOptions();
 
   // Get or create the module map that we'll use to build this module.
@@ -1056,15 +1058,28 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   return !Instance.getDiagnostics().hasErrorOccurred();
 }
 
-static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
+static void diagnoseModuleBuildFailure(CompilerInstance &ImportingInstance,
+                                       SourceLocation ImportLoc,
+                                       SourceLocation ModuleNameLoc,
+                                       Module *Module) {
+  ImportingInstance.getDiagnostics().Report(ModuleNameLoc,
+                                            diag::err_module_not_built)
+      << Module->Name << SourceRange(ImportLoc, ModuleNameLoc);
+}
+
+/// \brief Compile the given module under the protection of a lock file, so
+/// that concurrent compiler processes don't build it at the same time, and
+/// load it into the importing instance.
+static bool
+compileAndLoadModuleWithLockFile(CompilerInstance &ImportingInstance,
                                  SourceLocation ImportLoc,
                                  SourceLocation ModuleNameLoc, Module *Module,
                                  StringRef ModuleFileName) {
   DiagnosticsEngine &Diags = ImportingInstance.getDiagnostics();
 
   auto diagnoseBuildFailure = [&] {
-    Diags.Report(ModuleNameLoc, diag::err_module_not_built)
-        << Module->Name << SourceRange(ImportLoc, ModuleNameLoc);
+    diagnoseModuleBuildFailure(ImportingInstance, ImportLoc, ModuleNameLoc,
+                               Module);
   };
 
   // FIXME: have LockFileManager return an error_code so that we can
@@ -1132,6 +1147,58 @@ static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
   }
 }
 
+static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
+                                 SourceLocation ImportLoc,
+                                 SourceLocation ModuleNameLoc, Module *Module,
+                                 StringRef ModuleFileName) {
+  ModuleBuildService *Builds = ImportingInstance.getModuleBuildService().get();
+  if (!Builds)
+    return compileAndLoadModuleWithLockFile(ImportingInstance, ImportLoc,
+                                            ModuleNameLoc, Module,
+                                            ModuleFileName);
+
+  // Other compiler instances in this process may be asking for the same
+  // module. Only the first of them builds it; the rest wait for that build
+  // and then read its result, rather than polling its lock file.
+  while (1) {
+    switch (Builds->beginBuild(ModuleFileName)) {
+    case ModuleBuildService::BS_Owned: {
+      bool Result = compileAndLoadModuleWithLockFile(
+          ImportingInstance, ImportLoc, ModuleNameLoc, Module, ModuleFileName);
+      Builds->endBuild(ModuleFileName, Result);
+      return Result;
+    }
+
+    case ModuleBuildService::BS_FailedByOther:
+      // The diagnostics explaining the failure went to the instance that
+      // attempted the build. Try again ourselves so that they are reported
+      // for this translation unit too.
+      continue;
+
+    case ModuleBuildService::BS_BuiltByOther:
+      break;
+    }
+
+    ASTReader::ASTReadResult ReadResult =
+        ImportingInstance.getModuleManager()->ReadAST(
+            ModuleFileName, serialization::MK_ImplicitModule, ImportLoc,
+            ASTReader::ARR_Missing | ASTReader::ARR_OutOfDate);
+
+    // The module may still be out of date for this instance, e.g. if one of
+    // its imports depends on header search paths that differ from those of
+    // the instance that built it. Try again...
+    if (ReadResult == ASTReader::OutOfDate)
+      continue;
+
+    if (ReadResult == ASTReader::Missing ||
+        (ReadResult != ASTReader::Success &&
+         !ImportingInstance.getDiagnostics().hasErrorOccurred()))
+      diagnoseModuleBuildFailure(ImportingInstance, ImportLoc, ModuleNameLoc,
+                                 Module);
+    return ReadResult == ASTReader::Success;
+  }
+}
+
 /// \brief Diagnose differences between the current definition of the given
 /// configuration macro and the definition provided on the command line.
 static void checkConfigMacro(Preprocessor &PP, StringRef ConfigMacro,
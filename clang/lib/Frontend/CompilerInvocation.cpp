@@ -302,6 +302,18 @@ static bool ParseAnalyzerArgs(AnalyzerOptions &Opts, ArgList &Args,
     }
   }
 
+  // Every analyzer process of a sharded run must own one of the shards.
+  if (Success && (Opts.Config.count("shard-count") ||
+                  Opts.Config.count("shard-index"))) {
+    int ShardCount = Opts.getOptionAsInteger("shard-count", 1);
+    int ShardIndex = Opts.getOptionAsInteger("shard-index", 0);
+    if (ShardIndex < 0 || ShardIndex >= std::max(ShardCount, 1)) {
+      Diags.Report(SourceLocation(), diag::err_analyzer_config_shard_index)
+          << std::max(ShardCount, 1);
+      Success = false;
+    }
+  }
+
   return Success;
 }
 
@@ -496,6 +508,8 @@ static bool ParseCodeGenArgs(CodeGenOptions &Opts, ArgList &Args, InputKind IK,
   Opts.WholeProgramVTables = Args.hasArg(OPT_fwhole_program_vtables);
   Opts.LTOVisibilityPublicStd = Args.hasArg(OPT_flto_visibility_public_std);
   Opts.SplitDwarfFile = Args.getLastArgValue(OPT_split_dwarf_file);
+  Opts.ParallelCodeGenOutputs =
+      Args.getAllArgValues(OPT_parallel_codegen_output);
   Opts.DebugTypeExtRefs = Args.hasArg(OPT_dwarf_ext_refs);
   Opts.DebugExplicitImport = Triple.isPS4CPU();
 
@@ -1186,6 +1200,11 @@ static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.ShowHelp = Args.hasArg(OPT_help);
   Opts.ShowStats = Args.hasArg(OPT_print_stats);
   Opts.ShowTimers = Args.hasArg(OPT_ftime_report);
+  Opts.TimeTrace = Args.hasArg(OPT_ftime_trace);
+  Opts.TimeTraceGranularity = getLastArgIntValue(
+      Args, OPT_ftime_trace_granularity_EQ, Opts.TimeTraceGranularity, Diags);
+  Opts.TimeTraceSummary =
+      getLastArgIntValue(Args, OPT_ftime_trace_summary_EQ, 0, Diags);
   Opts.ShowVersion = Args.hasArg(OPT_version);
   Opts.ASTMergeFiles = Args.getAllArgValues(OPT_ast_merge);
   Opts.LLVMArgs = Args.getAllArgValues(OPT_mllvm);
@@ -0,0 +1,52 @@
+//===--- ModuleBuildService.cpp - Shared implicit module builds -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/ModuleBuildService.h"
+#include <cassert>
+
+using namespace clang;
+
+ModuleBuildService::BuildStatus
+ModuleBuildService::beginBuild(StringRef ModuleFileName) {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  auto Known = InProgress.find(ModuleFileName);
+  if (Known == InProgress.end()) {
+    InProgress[ModuleFileName] = std::make_shared<BuildState>();
+    return BS_Owned;
+  }
+
+  // Someone else is building this module file. Keep the build state alive
+  // ourselves, since the owner drops it from the map when it finishes.
+  std::shared_ptr<BuildState> State = Known->second;
+  ++NumDeduplicatedRequests;
+  BuildFinished.wait(Lock, [&] { return State->Finished; });
+  return State->Succeeded ? BS_BuiltByOther : BS_FailedByOther;
+}
+
+void ModuleBuildService::endBuild(StringRef ModuleFileName, bool Succeeded) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto Known = InProgress.find(ModuleFileName);
+    assert(Known != InProgress.end() && "module file is not being built");
+    Known->second->Finished = true;
+    Known->second->Succeeded = Succeeded;
+    InProgress.erase(Known);
+  }
+  BuildFinished.notify_all();
+}
+
+bool ModuleBuildService::isBuilding(StringRef ModuleFileName) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return InProgress.count(ModuleFileName);
+}
+
+unsigned ModuleBuildService::getNumDeduplicatedRequests() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return NumDeduplicatedRequests;
+}
@@ -0,0 +1,445 @@
+//===--- BatchIndexer.cpp - Parallel indexing of many TUs -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Index/BatchIndexer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendAction.h"
+#include "clang/Frontend/ModuleBuildService.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "clang/Frontend/Utils.h"
+#include "clang/Index/IndexDataConsumer.h"
+#include "clang/Index/USRGeneration.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+
+using namespace clang;
+using namespace clang::index;
+
+namespace clang {
+namespace index {
+
+/// \brief Hands the occurrences of one translation unit to the BatchIndexer,
+/// except for those in headers that another translation unit has already
+/// indexed under the same macro context.
+///
+/// The decision is made when the preprocessor enters a header, before its
+/// declarations are parsed, so that skipped headers are not indexed at all.
+class BatchIndexDataConsumer : public IndexDataConsumer {
+  BatchIndexer &Indexer;
+  CompilerInstance &CI;
+  std::string ContextHash;
+  IndexStoreBuilder UnitStore;
+  unsigned NumSkippedHeaders = 0;
+
+  struct FileInfo {
+    bool ShouldIndex;
+    std::string Path;
+  };
+  llvm::DenseMap<FileID, FileInfo> Files;
+
+  /// A header that the preprocessor is in, and the macros defined outside of
+  /// it that it has used so far, with the values they had.
+  struct OpenHeader {
+    FileID FID;
+    /// The number of the first macro definition made inside the header.
+    unsigned FirstDefinition;
+    llvm::DenseMap<const IdentifierInfo *, std::string> UsedMacros;
+  };
+  std::vector<OpenHeader> OpenHeaders;
+
+  /// The number of the last \#define or \#undef of each macro.
+  llvm::DenseMap<const IdentifierInfo *, unsigned> MacroDefinitions;
+  unsigned NumMacroDefinitions = 0;
+
+  FileInfo *getFileInfo(FileID FID);
+  std::string getMacroValue(const IdentifierInfo *II);
+
+public:
+  BatchIndexDataConsumer(BatchIndexer &Indexer, CompilerInstance &CI,
+                         std::string ContextHash)
+      : Indexer(Indexer), CI(CI), ContextHash(std::move(ContextHash)) {}
+
+  void initialize(ASTContext &Ctx) override;
+
+  bool handleDeclOccurence(const Decl *D, SymbolRoleSet Roles,
+                           ArrayRef<SymbolRelation> Relations,
+                           FileID FID, unsigned Offset,
+                           ASTNodeInfo ASTNode) override;
+
+  bool shouldIndexFile(FileID FID) override {
+    auto Known = Files.find(FID);
+    return Known == Files.end() || Known->second.ShouldIndex;
+  }
+
+  void finish() override;
+
+  bool isInHeader() const { return !OpenHeaders.empty(); }
+  void enterFile(FileID FID);
+  void exitFile(FileID FID);
+  void defineMacro(const IdentifierInfo *II);
+  void useMacro(const IdentifierInfo *II);
+};
+
+} // namespace index
+} // namespace clang
+
+namespace {
+/// Reports the files the preprocessor enters and leaves, and the macros it
+/// defines and uses, to a BatchIndexDataConsumer.
+class BatchIndexPPCallbacks : public PPCallbacks {
+  BatchIndexDataConsumer &Consumer;
+  Preprocessor &PP;
+
+  /// Use every identifier of the condition of an \#if or \#elif; undefined
+  /// macros evaluate to 0 without being reported otherwise.
+  void useConditionMacros(SourceRange ConditionRange) {
+    if (!Consumer.isInHeader())
+      return;
+    bool Invalid = false;
+    std::string Condition = Lexer::getSourceText(
+        CharSourceRange::getCharRange(ConditionRange),
+        PP.getSourceManager(), PP.getLangOpts(), &Invalid);
+    if (Invalid)
+      return;
+    Lexer RawLex(ConditionRange.getBegin(), PP.getLangOpts(),
+                 Condition.data(), Condition.data(),
+                 Condition.data() + Condition.size());
+    Token Tok;
+    do {
+      RawLex.LexFromRawLexer(Tok);
+      if (Tok.is(tok::raw_identifier) && Tok.getRawIdentifier() != "defined")
+        Consumer.useMacro(PP.getIdentifierInfo(Tok.getRawIdentifier()));
+    } while (Tok.isNot(tok::eof));
+  }
+
+public:
+  BatchIndexPPCallbacks(BatchIndexDataConsumer &Consumer, Preprocessor &PP)
+      : Consumer(Consumer), PP(PP) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason == EnterFile)
+      Consumer.enterFile(PP.getSourceManager().getFileID(Loc));
+    else if (Reason == ExitFile)
+      Consumer.exitFile(PrevFID);
+  }
+
+  void MacroDefined(const Token &MacroNameTok,
+                    const MacroDirective *MD) override {
+    Consumer.defineMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void MacroUndefined(const Token &MacroNameTok,
+                      const MacroDefinition &MD) override {
+    Consumer.defineMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void MacroExpands(const Token &MacroNameTok, const MacroDefinition &MD,
+                    SourceRange Range, const MacroArgs *Args) override {
+    Consumer.useMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void Defined(const Token &MacroNameTok, const MacroDefinition &MD,
+               SourceRange Range) override {
+    Consumer.useMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void Ifdef(SourceLocation Loc, const Token &MacroNameTok,
+             const MacroDefinition &MD) override {
+    Consumer.useMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void Ifndef(SourceLocation Loc, const Token &MacroNameTok,
+              const MacroDefinition &MD) override {
+    Consumer.useMacro(MacroNameTok.getIdentifierInfo());
+  }
+
+  void If(SourceLocation Loc, SourceRange ConditionRange,
+          ConditionValueKind ConditionValue) override {
+    useConditionMacros(ConditionRange);
+  }
+
+  void Elif(SourceLocation Loc, SourceRange ConditionRange,
+            ConditionValueKind ConditionValue, SourceLocation IfLoc) override {
+    useConditionMacros(ConditionRange);
+  }
+};
+} // end anonymous namespace
+
+void BatchIndexDataConsumer::initialize(ASTContext &Ctx) {
+  if (Indexer.Opts.SkipIndexedHeaders)
+    CI.getPreprocessor().addPPCallbacks(
+        llvm::make_unique<BatchIndexPPCallbacks>(*this, CI.getPreprocessor()));
+}
+
+BatchIndexDataConsumer::FileInfo *
+BatchIndexDataConsumer::getFileInfo(FileID FID) {
+  auto Known = Files.find(FID);
+  if (Known != Files.end())
+    return &Known->second;
+
+  SourceManager &SM = CI.getSourceManager();
+  const FileEntry *FE = SM.getFileEntryForID(FID);
+  if (!FE)
+    return nullptr;
+
+  // Name files by their canonical directory, so that a header reached
+  // through different relative paths is recognized as the same header.
+  FileManager &FileMgr = CI.getFileManager();
+  SmallString<256> Path(FileMgr.getCanonicalName(FE->getDir()));
+  llvm::sys::path::append(Path, llvm::sys::path::filename(FE->getName()));
+
+  FileInfo Info{true, Path.str()};
+  return &Files.insert(std::make_pair(FID, std::move(Info))).first->second;
+}
+
+/// The value of a macro is its parameters and replacement tokens, which is
+/// what decides how its uses expand.
+std::string BatchIndexDataConsumer::getMacroValue(const IdentifierInfo *II) {
+  Preprocessor &PP = CI.getPreprocessor();
+  const MacroInfo *MI = PP.getMacroInfo(II);
+  if (!MI)
+    return std::string();
+
+  // Starts with '=' to tell an empty definition from an undefined macro.
+  std::string Value = "=";
+  if (MI->isFunctionLike()) {
+    Value += '(';
+    for (const IdentifierInfo *Arg : MI->args()) {
+      Value += Arg->getName();
+      Value += ',';
+    }
+    Value += ')';
+  }
+  for (const Token &Tok : MI->tokens()) {
+    Value += ' ';
+    Value += PP.getSpelling(Tok);
+  }
+  return Value;
+}
+
+void BatchIndexDataConsumer::enterFile(FileID FID) {
+  if (FID == CI.getSourceManager().getMainFileID())
+    return;
+  FileInfo *Info = getFileInfo(FID);
+  if (!Info)
+    return;
+
+  OpenHeader Header;
+  Header.FID = FID;
+  Header.FirstDefinition = NumMacroDefinitions + 1;
+  BatchIndexer::MacroContext Macros;
+  Preprocessor &PP = CI.getPreprocessor();
+  if (Indexer.isHeaderIndexed(
+          ContextHash, Info->Path,
+          [&](StringRef Name) {
+            return getMacroValue(PP.getIdentifierInfo(Name));
+          },
+          Macros)) {
+    // The header expands the same way as it did when it was indexed, at
+    // least until it uses a macro that it did not use then.
+    Info->ShouldIndex = false;
+    for (auto &Macro : Macros)
+      Header.UsedMacros[PP.getIdentifierInfo(Macro.first)] =
+          std::move(Macro.second);
+  }
+  OpenHeaders.push_back(std::move(Header));
+}
+
+void BatchIndexDataConsumer::exitFile(FileID FID) {
+  if (OpenHeaders.empty() || OpenHeaders.back().FID != FID)
+    return;
+  OpenHeader Header = std::move(OpenHeaders.back());
+  OpenHeaders.pop_back();
+
+  FileInfo *Info = getFileInfo(FID);
+  if (!Info->ShouldIndex) {
+    ++NumSkippedHeaders;
+    return;
+  }
+  BatchIndexer::MacroContext Macros;
+  for (auto &Macro : Header.UsedMacros)
+    Macros.emplace_back(Macro.first->getName(), std::move(Macro.second));
+  std::sort(Macros.begin(), Macros.end());
+  Indexer.addIndexedHeader(ContextHash, Info->Path, std::move(Macros));
+}
+
+void BatchIndexDataConsumer::defineMacro(const IdentifierInfo *II) {
+  MacroDefinitions[II] = ++NumMacroDefinitions;
+}
+
+void BatchIndexDataConsumer::useMacro(const IdentifierInfo *II) {
+  if (OpenHeaders.empty() || !II)
+    return;
+  // A macro counts for the headers that were entered after its definition,
+  // which are at the top of the stack.
+  unsigned Definition = MacroDefinitions.lookup(II);
+  std::string Value;
+  bool HaveValue = false;
+  for (OpenHeader &Header : llvm::reverse(OpenHeaders)) {
+    if (Definition >= Header.FirstDefinition)
+      break;
+    auto Inserted = Header.UsedMacros.insert(std::make_pair(II, Value));
+    if (!Inserted.second)
+      continue;
+    if (!HaveValue) {
+      Value = getMacroValue(II);
+      HaveValue = true;
+    }
+    Inserted.first->second = Value;
+    // A skipped header that uses a new macro may expand differently than
+    // when it was indexed, so index it from here on.
+    Files[Header.FID].ShouldIndex = true;
+  }
+}
+
+bool BatchIndexDataConsumer::handleDeclOccurence(
+    const Decl *D, SymbolRoleSet Roles, ArrayRef<SymbolRelation> Relations,
+    FileID FID, unsigned Offset, ASTNodeInfo ASTNode) {
+  const FileInfo *Info = getFileInfo(FID);
+  if (!Info || !Info->ShouldIndex)
+    return true;
+
+  SmallString<256> USR;
+  if (generateUSRForDecl(D, USR))
+    return true;
+  SmallString<64> Name;
+  llvm::raw_svector_ostream NameOS(Name);
+  printSymbolName(D, CI.getLangOpts(), NameOS);
+
+  SourceManager &SM = CI.getSourceManager();
+  UnitStore.addOccurrence(USR, Name, getSymbolInfo(D), Info->Path,
+                          SM.getLineNumber(FID, Offset),
+                          SM.getColumnNumber(FID, Offset), Roles);
+  return true;
+}
+
+void BatchIndexDataConsumer::finish() {
+  Indexer.addUnit(UnitStore, NumSkippedHeaders);
+}
+
+//===----------------------------------------------------------------------===//
+// BatchIndexer
+//===----------------------------------------------------------------------===//
+
+BatchIndexer::BatchIndexer(
+    BatchIndexingOptions Opts,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps)
+    : Opts(Opts), PCHContainerOps(std::move(PCHContainerOps)),
+      ModuleBuilds(std::make_shared<ModuleBuildService>()) {
+  if (!this->PCHContainerOps)
+    this->PCHContainerOps = std::make_shared<PCHContainerOperations>();
+}
+
+BatchIndexer::~BatchIndexer() {}
+
+static std::string getHeaderKey(StringRef ContextHash, StringRef File) {
+  return (ContextHash + ":" + File).str();
+}
+
+bool BatchIndexer::isHeaderIndexed(
+    StringRef ContextHash, StringRef File,
+    llvm::function_ref<std::string(StringRef)> GetMacroValue,
+    MacroContext &Macros) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto Known = IndexedHeaders.find(getHeaderKey(ContextHash, File));
+  if (Known == IndexedHeaders.end())
+    return false;
+  for (const MacroContext &Context : Known->second)
+    if (llvm::all_of(Context, [&](const std::pair<std::string,
+                                                  std::string> &Macro) {
+          return GetMacroValue(Macro.first) == Macro.second;
+        })) {
+      Macros = Context;
+      return true;
+    }
+  return false;
+}
+
+void BatchIndexer::addIndexedHeader(StringRef ContextHash, StringRef File,
+                                    MacroContext Macros) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::vector<MacroContext> &Contexts =
+      IndexedHeaders[getHeaderKey(ContextHash, File)];
+  if (!llvm::is_contained(Contexts, Macros))
+    Contexts.push_back(std::move(Macros));
+}
+
+void BatchIndexer::addUnit(const IndexStoreBuilder &UnitStore,
+                           unsigned NumSkipped) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Store.merge(UnitStore);
+  NumSkippedHeaders += NumSkipped;
+}
+
+void BatchIndexer::indexCommand(const tooling::CompileCommand &Command) {
+  // Resolve relative paths against the command's directory rather than
+  // changing the working directory of the whole process.
+  std::vector<const char *> Args;
+  for (const std::string &Arg : Command.CommandLine)
+    Args.push_back(Arg.c_str());
+  if (Args.empty())
+    Args.push_back("clang");
+  if (!Command.Directory.empty()) {
+    Args.insert(Args.begin() + 1, "-working-directory");
+    Args.insert(Args.begin() + 2, Command.Directory.c_str());
+  }
+
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions,
+                                          new IgnoringDiagConsumer);
+  IntrusiveRefCntPtr<CompilerInvocation> Invocation(
+      createInvocationFromCommandLine(Args, Diags));
+  if (!Invocation) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ++NumFailedUnits;
+    return;
+  }
+  Invocation->getFrontendOpts().DisableFree = false;
+  // Keep the per-unit "N errors generated" summary off the shared stderr.
+  Invocation->getDiagnosticOpts().ShowCarets = false;
+
+  CompilerInstance CI(PCHContainerOps);
+  CI.setInvocation(Invocation.get());
+  CI.setModuleBuildService(ModuleBuilds);
+  CI.createDiagnostics(new IgnoringDiagConsumer, /*ShouldOwnClient=*/true);
+
+  auto DataConsumer = std::make_shared<BatchIndexDataConsumer>(
+      *this, CI, Invocation->getModuleHash());
+  std::unique_ptr<FrontendAction> Action =
+      createIndexingAction(DataConsumer, Opts.IndexOpts,
+                           /*WrappedAction=*/nullptr);
+  bool Success = CI.ExecuteAction(*Action);
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  ++NumIndexedUnits;
+  if (!Success)
+    ++NumUnitsWithErrors;
+}
+
+void BatchIndexer::indexCommands(ArrayRef<tooling::CompileCommand> Commands) {
+  std::unique_ptr<llvm::ThreadPool> Pool;
+  if (Opts.NumThreads)
+    Pool.reset(new llvm::ThreadPool(Opts.NumThreads));
+  else
+    Pool.reset(new llvm::ThreadPool());
+
+  for (const tooling::CompileCommand &Command : Commands)
+    Pool->async([this, &Command] { indexCommand(Command); });
+  Pool->wait();
+}
@@ -443,6 +443,11 @@ bool IndexingContext::indexTopLevelDecl(const Decl *D) {
   if (isa<ObjCMethodDecl>(D))
     return true; // Wait for the objc container.
 
+  SourceManager &SM = Ctx->getSourceManager();
+  if (!DataConsumer.shouldIndexFile(
+          SM.getFileID(SM.getFileLoc(D->getLocation()))))
+    return true;
+
   return indexDecl(D);
 }
 
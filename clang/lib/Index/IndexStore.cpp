@@ -0,0 +1,344 @@
+//===--- IndexStore.cpp - Compact USR-keyed symbol store ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The store consists of a fixed-size header followed by three tables of
+// fixed-size little-endian records and a string blob:
+//
+//   header:      magic, version, #files, #symbols, #occurrences, #string bytes
+//   files:       {path offset, path length}, sorted by path
+//   symbols:     {USR offset, USR length, name offset, name length,
+//                 kind | language << 8, first occurrence, #occurrences},
+//                sorted by USR
+//   occurrences: {file, line, column, roles}, grouped by symbol
+//   strings
+//
+// Because every table is sorted and has fixed-size entries, the reader can
+// binary search the mapped file directly without deserializing it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Index/IndexStore.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <tuple>
+
+using namespace clang;
+using namespace clang::index;
+using namespace llvm::support;
+
+static const char IndexStoreMagic[] = {'C', 'I', 'D', 'X'};
+
+/// \brief The version of the store format. Bump this whenever the layout of
+/// any of the tables changes.
+static const uint32_t IndexStoreVersion = 1;
+
+static const unsigned HeaderSize = 6 * sizeof(uint32_t);
+static const unsigned FileEntrySize = 2 * sizeof(uint32_t);
+static const unsigned SymbolEntrySize = 7 * sizeof(uint32_t);
+static const unsigned OccurrenceEntrySize = 4 * sizeof(uint32_t);
+
+//===----------------------------------------------------------------------===//
+// IndexStoreBuilder
+//===----------------------------------------------------------------------===//
+
+unsigned IndexStoreBuilder::getSymbolID(StringRef USR, StringRef Name,
+                                        SymbolKind Kind, SymbolLanguage Lang) {
+  auto Known = SymbolIDs.insert(std::make_pair(USR, Symbols.size()));
+  if (Known.second)
+    Symbols.push_back(std::make_pair(Known.first->getKey(),
+                                     SymbolData{Name, Kind, Lang}));
+  return Known.first->second;
+}
+
+unsigned IndexStoreBuilder::getFileID(StringRef Path) {
+  auto Known = FileIDs.insert(std::make_pair(Path, Files.size()));
+  if (Known.second)
+    Files.push_back(Known.first->getKey());
+  return Known.first->second;
+}
+
+void IndexStoreBuilder::addOccurrence(StringRef USR, StringRef Name,
+                                      SymbolInfo Info, StringRef File,
+                                      unsigned Line, unsigned Column,
+                                      SymbolRoleSet Roles) {
+  unsigned Symbol = getSymbolID(USR, Name, Info.Kind, Info.Lang);
+  Occurrences.push_back({Symbol, getFileID(File), Line, Column, Roles});
+}
+
+void IndexStoreBuilder::merge(const IndexStoreBuilder &Other) {
+  std::vector<unsigned> SymbolMap;
+  SymbolMap.reserve(Other.Symbols.size());
+  for (const auto &Symbol : Other.Symbols)
+    SymbolMap.push_back(getSymbolID(Symbol.first, Symbol.second.Name,
+                                    Symbol.second.Kind, Symbol.second.Lang));
+
+  std::vector<unsigned> FileMap;
+  FileMap.reserve(Other.Files.size());
+  for (StringRef File : Other.Files)
+    FileMap.push_back(getFileID(File));
+
+  Occurrences.reserve(Occurrences.size() + Other.Occurrences.size());
+  for (const OccurrenceData &Occ : Other.Occurrences)
+    Occurrences.push_back({SymbolMap[Occ.Symbol], FileMap[Occ.File], Occ.Line,
+                           Occ.Column, Occ.Roles});
+}
+
+void IndexStoreBuilder::emit(llvm::raw_ostream &OS) const {
+  // Put files and symbols in a canonical order, so that the output does not
+  // depend on the order in which translation units were merged.
+  std::vector<unsigned> FileOrder(Files.size());
+  for (unsigned I = 0, N = Files.size(); I != N; ++I)
+    FileOrder[I] = I;
+  std::sort(FileOrder.begin(), FileOrder.end(),
+            [&](unsigned L, unsigned R) { return Files[L] < Files[R]; });
+  std::vector<unsigned> FileMap(Files.size());
+  for (unsigned I = 0, N = FileOrder.size(); I != N; ++I)
+    FileMap[FileOrder[I]] = I;
+
+  std::vector<unsigned> SymbolOrder(Symbols.size());
+  for (unsigned I = 0, N = Symbols.size(); I != N; ++I)
+    SymbolOrder[I] = I;
+  std::sort(SymbolOrder.begin(), SymbolOrder.end(),
+            [&](unsigned L, unsigned R) {
+              return Symbols[L].first < Symbols[R].first;
+            });
+  std::vector<unsigned> SymbolMap(Symbols.size());
+  for (unsigned I = 0, N = SymbolOrder.size(); I != N; ++I)
+    SymbolMap[SymbolOrder[I]] = I;
+
+  // Renumber the occurrences and drop the duplicates.
+  std::vector<OccurrenceData> Occs;
+  Occs.reserve(Occurrences.size());
+  for (const OccurrenceData &Occ : Occurrences)
+    Occs.push_back({SymbolMap[Occ.Symbol], FileMap[Occ.File], Occ.Line,
+                    Occ.Column, Occ.Roles});
+  auto Key = [](const OccurrenceData &Occ) {
+    return std::make_tuple(Occ.Symbol, Occ.File, Occ.Line, Occ.Column,
+                           Occ.Roles);
+  };
+  std::sort(Occs.begin(), Occs.end(),
+            [&](const OccurrenceData &L, const OccurrenceData &R) {
+              return Key(L) < Key(R);
+            });
+  Occs.erase(std::unique(Occs.begin(), Occs.end(),
+                         [&](const OccurrenceData &L, const OccurrenceData &R) {
+                           return Key(L) == Key(R);
+                         }),
+             Occs.end());
+
+  std::string StringData;
+  auto AddString = [&](StringRef S) {
+    uint32_t Offset = StringData.size();
+    StringData.append(S.begin(), S.end());
+    return Offset;
+  };
+
+  endian::Writer<little> W(OS);
+  OS.write(IndexStoreMagic, sizeof(IndexStoreMagic));
+  W.write<uint32_t>(IndexStoreVersion);
+  W.write<uint32_t>(Files.size());
+  W.write<uint32_t>(Symbols.size());
+  W.write<uint32_t>(Occs.size());
+
+  // The string table goes last, but its size is part of the header; lay it
+  // out before writing anything else.
+  std::vector<uint32_t> FileOffsets;
+  for (unsigned File : FileOrder)
+    FileOffsets.push_back(AddString(Files[File]));
+  std::vector<std::pair<uint32_t, uint32_t>> SymbolOffsets;
+  for (unsigned Symbol : SymbolOrder) {
+    uint32_t USROffset = AddString(Symbols[Symbol].first);
+    SymbolOffsets.push_back(
+        std::make_pair(USROffset, AddString(Symbols[Symbol].second.Name)));
+  }
+  W.write<uint32_t>(StringData.size());
+
+  for (unsigned I = 0, N = FileOrder.size(); I != N; ++I) {
+    W.write<uint32_t>(FileOffsets[I]);
+    W.write<uint32_t>(Files[FileOrder[I]].size());
+  }
+
+  unsigned FirstOcc = 0;
+  for (unsigned I = 0, N = SymbolOrder.size(); I != N; ++I) {
+    const auto &Symbol = Symbols[SymbolOrder[I]];
+    unsigned LastOcc = FirstOcc;
+    while (LastOcc != Occs.size() && Occs[LastOcc].Symbol == I)
+      ++LastOcc;
+    W.write<uint32_t>(SymbolOffsets[I].first);
+    W.write<uint32_t>(Symbol.first.size());
+    W.write<uint32_t>(SymbolOffsets[I].second);
+    W.write<uint32_t>(Symbol.second.Name.size());
+    W.write<uint32_t>(static_cast<uint32_t>(Symbol.second.Kind) |
+                      static_cast<uint32_t>(Symbol.second.Lang) << 8);
+    W.write<uint32_t>(FirstOcc);
+    W.write<uint32_t>(LastOcc - FirstOcc);
+    FirstOcc = LastOcc;
+  }
+
+  for (const OccurrenceData &Occ : Occs) {
+    W.write<uint32_t>(Occ.File);
+    W.write<uint32_t>(Occ.Line);
+    W.write<uint32_t>(Occ.Column);
+    W.write<uint32_t>(Occ.Roles);
+  }
+
+  OS << StringData;
+}
+
+std::error_code IndexStoreBuilder::writeToFile(StringRef Path) const {
+  // Write to a temporary file and rename it into place, so that readers never
+  // observe a partially written store.
+  int TmpFD;
+  llvm::SmallString<128> TmpPath;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", TmpFD, TmpPath))
+    return EC;
+
+  {
+    llvm::raw_fd_ostream OS(TmpFD, /*shouldClose=*/true);
+    emit(OS);
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TmpPath);
+      return llvm::make_error_code(llvm::errc::io_error);
+    }
+  }
+
+  if (std::error_code EC = llvm::sys::fs::rename(TmpPath, Path)) {
+    llvm::sys::fs::remove(TmpPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
+//===----------------------------------------------------------------------===//
+// IndexStoreReader
+//===----------------------------------------------------------------------===//
+
+IndexStoreReader::IndexStoreReader(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+    : Buffer(std::move(Buffer)) {}
+
+IndexStoreReader::~IndexStoreReader() {}
+
+bool IndexStoreReader::validate() {
+  const char *Start = Buffer->getBufferStart();
+  uint64_t Size = Buffer->getBufferSize();
+  if (Size < HeaderSize ||
+      memcmp(Start, IndexStoreMagic, sizeof(IndexStoreMagic)) != 0)
+    return false;
+
+  const char *Ptr = Start + sizeof(IndexStoreMagic);
+  if (endian::readNext<uint32_t, little, unaligned>(Ptr) != IndexStoreVersion)
+    return false;
+  NumFiles = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  NumSymbols = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  NumOccurrences = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  uint64_t StringsSize = endian::readNext<uint32_t, little, unaligned>(Ptr);
+
+  uint64_t Expected = HeaderSize + uint64_t(NumFiles) * FileEntrySize +
+                      uint64_t(NumSymbols) * SymbolEntrySize +
+                      uint64_t(NumOccurrences) * OccurrenceEntrySize +
+                      StringsSize;
+  if (Size != Expected)
+    return false;
+
+  FileTable = Start + HeaderSize;
+  SymbolTable = FileTable + NumFiles * FileEntrySize;
+  OccurrenceTable = SymbolTable + NumSymbols * SymbolEntrySize;
+  Strings = OccurrenceTable + NumOccurrences * OccurrenceEntrySize;
+
+  // Check every reference into another table up front, so that queries can
+  // trust the contents of the mapped file.
+  auto IsValidString = [&](const char *Entry) {
+    uint64_t Offset = endian::read32le(Entry);
+    uint64_t Length = endian::read32le(Entry + 4);
+    return Offset + Length <= StringsSize;
+  };
+  for (unsigned I = 0; I != NumFiles; ++I)
+    if (!IsValidString(FileTable + I * FileEntrySize))
+      return false;
+  for (unsigned I = 0; I != NumSymbols; ++I) {
+    const char *Entry = SymbolTable + I * SymbolEntrySize;
+    uint64_t FirstOcc = endian::read32le(Entry + 20);
+    uint64_t NumOcc = endian::read32le(Entry + 24);
+    if (!IsValidString(Entry) || !IsValidString(Entry + 8) ||
+        FirstOcc + NumOcc > NumOccurrences)
+      return false;
+  }
+  for (unsigned I = 0; I != NumOccurrences; ++I)
+    if (endian::read32le(OccurrenceTable + I * OccurrenceEntrySize) >=
+        NumFiles)
+      return false;
+  return true;
+}
+
+llvm::ErrorOr<std::unique_ptr<IndexStoreReader>>
+IndexStoreReader::create(StringRef Path) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return Buffer.getError();
+
+  std::unique_ptr<IndexStoreReader> Reader(
+      new IndexStoreReader(std::move(*Buffer)));
+  if (!Reader->validate())
+    return llvm::make_error_code(llvm::errc::invalid_argument);
+  return std::move(Reader);
+}
+
+StringRef IndexStoreReader::getString(const char *Entry) const {
+  return StringRef(Strings + endian::read32le(Entry),
+                   endian::read32le(Entry + 4));
+}
+
+IndexStoreReader::Symbol IndexStoreReader::getSymbol(unsigned Idx) const {
+  assert(Idx < NumSymbols && "symbol index out of range");
+  const char *Entry = SymbolTable + Idx * SymbolEntrySize;
+  uint32_t KindAndLang = endian::read32le(Entry + 16);
+  return Symbol{getString(Entry), getString(Entry + 8),
+                static_cast<SymbolKind>(KindAndLang & 0xFF),
+                static_cast<SymbolLanguage>(KindAndLang >> 8)};
+}
+
+llvm::Optional<unsigned> IndexStoreReader::lookupUSR(StringRef USR) const {
+  unsigned Low = 0, High = NumSymbols;
+  while (Low < High) {
+    unsigned Mid = Low + (High - Low) / 2;
+    if (getString(SymbolTable + Mid * SymbolEntrySize) < USR)
+      Low = Mid + 1;
+    else
+      High = Mid;
+  }
+  if (Low != NumSymbols &&
+      getString(SymbolTable + Low * SymbolEntrySize) == USR)
+    return Low;
+  return llvm::None;
+}
+
+void IndexStoreReader::forEachOccurrence(
+    unsigned Idx,
+    llvm::function_ref<void(const Occurrence &)> Receiver) const {
+  assert(Idx < NumSymbols && "symbol index out of range");
+  const char *Entry = SymbolTable + Idx * SymbolEntrySize;
+  unsigned FirstOcc = endian::read32le(Entry + 20);
+  unsigned NumOcc = endian::read32le(Entry + 24);
+  for (unsigned I = FirstOcc, E = FirstOcc + NumOcc; I != E; ++I) {
+    const char *Occ = OccurrenceTable + I * OccurrenceEntrySize;
+    Receiver(Occurrence{
+        getString(FileTable + endian::read32le(Occ) * FileEntrySize),
+        endian::read32le(Occ + 4), endian::read32le(Occ + 8),
+        endian::read32le(Occ + 12)});
+  }
+}
@@ -38,6 +38,10 @@ bool IndexDataConsumer::handleModuleOccurence(const ImportDecl *ImportD,
   return true;
 }
 
+bool IndexDataConsumer::shouldIndexFile(FileID FID) {
+  return true;
+}
+
 namespace {
 
 class IndexASTConsumer : public ASTConsumer {
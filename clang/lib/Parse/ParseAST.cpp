@@ -22,6 +22,7 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
 #include <memory>
 
@@ -115,6 +116,7 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   if (PrintStats) {
     Decl::EnableStatistics();
     Stmt::EnableStatistics();
+    S.getASTContext().enableAllocationStats();
   }
 
   // Also turn on collection of stats inside of the Sema object.
@@ -147,17 +149,20 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   if (External)
     External->StartTranslationUnit(Consumer);
 
-  if (P.ParseTopLevelDecl(ADecl)) {
-    if (!External && !S.getLangOpts().CPlusPlus)
-      P.Diag(diag::ext_empty_translation_unit);
-  } else {
-    do {
-      // If we got a null return and something *was* parsed, ignore it.  This
-      // is due to a top-level semicolon, an action override, or a parse error
-      // skipping something.
-      if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
-        return;
-    } while (!P.ParseTopLevelDecl(ADecl));
+  {
+    llvm::TimeTraceScope TimeScope("Frontend", "");
+    if (P.ParseTopLevelDecl(ADecl)) {
+      if (!External && !S.getLangOpts().CPlusPlus)
+        P.Diag(diag::ext_empty_translation_unit);
+    } else {
+      do {
+        // If we got a null return and something *was* parsed, ignore it.
+        // This is due to a top-level semicolon, an action override, or a
+        // parse error skipping something.
+        if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
+          return;
+      } while (!P.ParseTopLevelDecl(ADecl));
+    }
   }
 
   // Process any TopLevelDecls generated by #pragma weak.
@@ -24,6 +24,7 @@
 #include "clang/Sema/PrettyDeclStackTrace.h"
 #include "clang/Sema/Template.h"
 #include "clang/Sema/TemplateDeduction.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
 using namespace sema;
@@ -226,6 +227,9 @@ Sema::InstantiatingTemplate::InstantiatingTemplate(
     Inst.DeductionInfo = DeductionInfo;
     Inst.InstantiationRange = InstantiationRange;
     SemaRef.InNonInstantiationSFINAEContext = false;
+    if (SemaRef.ActiveTemplateInstantiations.empty())
+      SemaRef.Context.setAllocationSource(
+          ASTContext::AS_TemplateInstantiation);
     SemaRef.ActiveTemplateInstantiations.push_back(Inst);
     if (!Inst.isInstantiationRecord())
       ++SemaRef.NonInstantiationEntries;
@@ -346,6 +350,8 @@ void Sema::InstantiatingTemplate::Clear() {
     }
 
     SemaRef.ActiveTemplateInstantiations.pop_back();
+    if (SemaRef.ActiveTemplateInstantiations.empty())
+      SemaRef.Context.setAllocationSource(ASTContext::AS_Parse);
     Invalid = true;
   }
 }
@@ -1952,6 +1958,13 @@ Sema::InstantiateClass(SourceLocation PointOfInstantiation,
     return true;
   PrettyDeclStackTraceEntry CrashInfo(*this, Instantiation, SourceLocation(),
                                       "instantiating class definition");
+  llvm::TimeTraceScope TimeScope("InstantiateClass", [&]() {
+    std::string Name;
+    llvm::raw_string_ostream OS(Name);
+    Instantiation->getNameForDiagnostic(OS, getPrintingPolicy(),
+                                        /*Qualified=*/true);
+    return OS.str();
+  });
 
   // Enter the scope of this instantiation. We don't use
   // PushDeclContext because we don't have a scope.
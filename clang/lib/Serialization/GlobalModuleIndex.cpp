@@ -21,6 +21,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
@@ -33,6 +34,12 @@
 using namespace clang;
 using namespace serialization;
 
+#define DEBUG_TYPE "global-module-index"
+
+STATISTIC(NumModuleFilesRead, "Number of module files read into the index");
+STATISTIC(NumModuleFilesReused,
+          "Number of unchanged module files carried over from the old index");
+
 //----------------------------------------------------------------------------//
 // Shared constants
 //----------------------------------------------------------------------------//
@@ -239,8 +246,11 @@ GlobalModuleIndex::readIndex(StringRef Path) {
   IndexPath += Path;
   llvm::sys::path::append(IndexPath, IndexFileName);
 
+  // The index is only accessed lazily, through its on-disk hash table, so
+  // don't require a null terminator that could prevent it from being mapped.
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
-      llvm::MemoryBuffer::getFile(IndexPath.c_str());
+      llvm::MemoryBuffer::getFile(IndexPath.c_str(), /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
   if (!BufferOrErr)
     return std::make_pair(nullptr, EC_NotFound);
   std::unique_ptr<llvm::MemoryBuffer> Buffer = std::move(BufferOrErr.get());
@@ -381,12 +391,25 @@ namespace {
     /// a module ID.
     SmallVector<unsigned, 4> Dependencies;
   };
+}
 
+namespace clang {
   /// \brief Builder that generates the global module index file.
   class GlobalModuleIndexBuilder {
     FileManager &FileMgr;
     const PCHContainerReader &PCHContainerRdr;
 
+    /// \brief The index previously written for this module cache, if any.
+    GlobalModuleIndex *PreviousIndex;
+
+    /// \brief Mapping from the module files known to the previous index to
+    /// their IDs within it.
+    llvm::DenseMap<const FileEntry *, unsigned> PreviousModuleIDs;
+
+    /// \brief For each module ID in the previous index, the identifiers that
+    /// module file considers interesting. Populated lazily.
+    std::vector<SmallVector<StringRef, 4> > PreviousIdentifiers;
+
     /// \brief Mapping from files to module file information.
     typedef llvm::MapVector<const FileEntry *, ModuleFileInfo> ModuleFilesMap;
 
@@ -417,10 +440,30 @@ namespace {
       return Info;
     }
 
+    /// \brief Determine whether the given file is still the one described by
+    /// the previous index.
+    static bool isUnchanged(const FileEntry *File,
+                            const GlobalModuleIndex::ModuleInfo &Info) {
+      return File->getSize() == Info.Size &&
+             File->getModificationTime() == Info.ModTime;
+    }
+
+    /// \brief Retrieve the interesting identifiers of the module file with
+    /// the given ID in the previous index.
+    ArrayRef<StringRef> getPreviousIdentifiers(unsigned PreviousID);
+
+    /// \brief Carry over the information the previous index has about the
+    /// given module file, if neither it nor its dependencies have changed
+    /// since that index was written.
+    ///
+    /// \returns true if the module file was reused, false if it has to be
+    /// loaded.
+    bool reusePreviousModuleFile(const FileEntry *File);
+
   public:
-    explicit GlobalModuleIndexBuilder(
-        FileManager &FileMgr, const PCHContainerReader &PCHContainerRdr)
-        : FileMgr(FileMgr), PCHContainerRdr(PCHContainerRdr) {}
+    GlobalModuleIndexBuilder(FileManager &FileMgr,
+                             const PCHContainerReader &PCHContainerRdr,
+                             GlobalModuleIndex *PreviousIndex);
 
     /// \brief Load the contents of the given module file into the builder.
     ///
@@ -432,6 +475,92 @@ namespace {
   };
 }
 
+GlobalModuleIndexBuilder::GlobalModuleIndexBuilder(
+    FileManager &FileMgr, const PCHContainerReader &PCHContainerRdr,
+    GlobalModuleIndex *PreviousIndex)
+    : FileMgr(FileMgr), PCHContainerRdr(PCHContainerRdr),
+      PreviousIndex(PreviousIndex) {
+  if (!PreviousIndex)
+    return;
+
+  for (unsigned I = 0, N = PreviousIndex->Modules.size(); I != N; ++I) {
+    StringRef FileName = PreviousIndex->Modules[I].FileName;
+    if (FileName.empty())
+      continue;
+    if (const FileEntry *File = FileMgr.getFile(FileName, /*openFile=*/false,
+                                                /*cacheFailure=*/false))
+      PreviousModuleIDs[File] = I;
+  }
+}
+
+ArrayRef<StringRef>
+GlobalModuleIndexBuilder::getPreviousIdentifiers(unsigned PreviousID) {
+  if (PreviousIdentifiers.empty()) {
+    PreviousIdentifiers.resize(PreviousIndex->Modules.size());
+    if (PreviousIndex->IdentifierIndex) {
+      // Invert the identifier -> module files mapping of the previous index.
+      // This only touches the (mapped) index file itself.
+      IdentifierIndexTable &Table =
+          *static_cast<IdentifierIndexTable *>(PreviousIndex->IdentifierIndex);
+      IdentifierIndexTable::data_iterator D = Table.data_begin();
+      for (IdentifierIndexTable::key_iterator K = Table.key_begin(),
+                                              KEnd = Table.key_end();
+           K != KEnd; ++K, ++D) {
+        StringRef Name = *K;
+        SmallVector<unsigned, 2> ModuleIDs = *D;
+        // Keep the identifier known to the index even if none of the module
+        // files that provide it survive, as a freshly-built index would.
+        (void)InterestingIdentifiers[Name];
+        for (unsigned ID : ModuleIDs)
+          if (ID < PreviousIdentifiers.size())
+            PreviousIdentifiers[ID].push_back(Name);
+      }
+    }
+  }
+  return PreviousIdentifiers[PreviousID];
+}
+
+bool GlobalModuleIndexBuilder::reusePreviousModuleFile(const FileEntry *File) {
+  auto Known = PreviousModuleIDs.find(File);
+  if (Known == PreviousModuleIDs.end())
+    return false;
+
+  unsigned PreviousID = Known->second;
+  const GlobalModuleIndex::ModuleInfo &Info =
+      PreviousIndex->Modules[PreviousID];
+  if (!isUnchanged(File, Info))
+    return false;
+
+  // The module file itself only records the size and modification time of
+  // its imports, so if any of them changed we have to load it to find out
+  // whether it's still valid.
+  SmallVector<const FileEntry *, 4> DependsOnFiles;
+  for (unsigned DependsOnID : Info.Dependencies) {
+    if (DependsOnID >= PreviousIndex->Modules.size())
+      return false;
+    const GlobalModuleIndex::ModuleInfo &DependsOnInfo =
+        PreviousIndex->Modules[DependsOnID];
+    const FileEntry *DependsOnFile =
+        FileMgr.getFile(DependsOnInfo.FileName, /*openFile=*/false,
+                        /*cacheFailure=*/false);
+    if (!DependsOnFile || !isUnchanged(DependsOnFile, DependsOnInfo))
+      return false;
+    DependsOnFiles.push_back(DependsOnFile);
+  }
+
+  unsigned ID = getModuleFileInfo(File).ID;
+  for (const FileEntry *DependsOnFile : DependsOnFiles) {
+    unsigned DependsOnID = getModuleFileInfo(DependsOnFile).ID;
+    getModuleFileInfo(File).Dependencies.push_back(DependsOnID);
+  }
+
+  for (StringRef Name : getPreviousIdentifiers(PreviousID))
+    InterestingIdentifiers[Name].push_back(ID);
+
+  ++NumModuleFilesReused;
+  return true;
+}
+
 static void emitBlockID(unsigned ID, const char *Name,
                         llvm::BitstreamWriter &Stream,
                         SmallVectorImpl<uint64_t> &Record) {
@@ -496,6 +625,9 @@ namespace {
 }
 
 bool GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
+  if (PreviousIndex && reusePreviousModuleFile(File))
+    return false;
+
   // Open the module file.
 
   auto Buffer = FileMgr.getBufferForFile(File, /*isVolatile=*/true);
@@ -519,6 +651,7 @@ bool GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
   // Record this module file and assign it a unique ID (if it doesn't have
   // one already).
   unsigned ID = getModuleFileInfo(File).ID;
+  ++NumModuleFilesRead;
 
   // Search for the blocks and records we care about.
   enum { Other, ControlBlock, ASTBlock } State = Other;
@@ -789,38 +922,44 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
     return EC_Building;
   }
 
-  // The module index builder.
-  GlobalModuleIndexBuilder Builder(FileMgr, PCHContainerRdr);
-
-  // Load each of the module files.
-  std::error_code EC;
-  for (llvm::sys::fs::directory_iterator D(Path, EC), DEnd;
-       D != DEnd && !EC;
-       D.increment(EC)) {
-    // If this isn't a module file, we don't care.
-    if (llvm::sys::path::extension(D->path()) != ".pcm") {
-      // ... unless it's a .pcm.lock file, which indicates that someone is
-      // in the process of rebuilding a module. They'll rebuild the index
-      // at the end of that translation unit, so we don't have to.
-      if (llvm::sys::path::extension(D->path()) == ".pcm.lock")
-        return EC_Building;
+  // The output buffer, into which the global index will be written.
+  SmallVector<char, 16> OutputBuffer;
+  {
+    // The existing index, if any. Module files that haven't changed since it
+    // was written don't need to be read again. It has to be released before
+    // we replace it below.
+    std::unique_ptr<GlobalModuleIndex> PreviousIndex(readIndex(Path).first);
+
+    // The module index builder.
+    GlobalModuleIndexBuilder Builder(FileMgr, PCHContainerRdr,
+                                     PreviousIndex.get());
+
+    // Load each of the module files.
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator D(Path, EC), DEnd;
+         D != DEnd && !EC;
+         D.increment(EC)) {
+      // If this isn't a module file, we don't care.
+      if (llvm::sys::path::extension(D->path()) != ".pcm") {
+        // ... unless it's a .pcm.lock file, which indicates that someone is
+        // in the process of rebuilding a module. They'll rebuild the index
+        // at the end of that translation unit, so we don't have to.
+        if (llvm::sys::path::extension(D->path()) == ".pcm.lock")
+          return EC_Building;
 
-      continue;
-    }
+        continue;
+      }
 
-    // If we can't find the module file, skip it.
-    const FileEntry *ModuleFile = FileMgr.getFile(D->path());
-    if (!ModuleFile)
-      continue;
+      // If we can't find the module file, skip it.
+      const FileEntry *ModuleFile = FileMgr.getFile(D->path());
+      if (!ModuleFile)
+        continue;
 
-    // Load this module file.
-    if (Builder.loadModuleFile(ModuleFile))
-      return EC_IOError;
-  }
+      // Load this module file.
+      if (Builder.loadModuleFile(ModuleFile))
+        return EC_IOError;
+    }
 
-  // The output buffer, into which the global index will be written.
-  SmallVector<char, 16> OutputBuffer;
-  {
     llvm::BitstreamWriter OutputStream(OutputBuffer);
     Builder.writeIndex(OutputStream);
   }
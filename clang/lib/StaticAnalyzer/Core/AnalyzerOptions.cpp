@@ -344,3 +344,21 @@ bool AnalyzerOptions::shouldWidenLoops() {
     WidenLoops = getBooleanOption("widen-loops", /*Default=*/false);
   return WidenLoops.getValue();
 }
+
+unsigned AnalyzerOptions::getShardCount() {
+  if (!ShardCount.hasValue()) {
+    int Count = getOptionAsInteger("shard-count", 1);
+    ShardCount = Count > 0 ? Count : 1;
+  }
+  return ShardCount.getValue();
+}
+
+unsigned AnalyzerOptions::getShardIndex() {
+  if (!ShardIndex.hasValue())
+    ShardIndex = getOptionAsInteger("shard-index", 0);
+  return ShardIndex.getValue();
+}
+
+StringRef AnalyzerOptions::getSummaryCacheDir() {
+  return getOptionAsString("summary-cache-dir", "");
+}
@@ -0,0 +1,214 @@
+//== FunctionSummaryCache.cpp - Persistent function summaries -----*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an on-disk store of function summaries that is shared
+// by the analyzer runs of different translation units.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/PathSensitive/FunctionSummaryCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+using namespace clang;
+using namespace ento;
+
+/// The first line of every store. Stores written in another format are
+/// ignored and replaced.
+static const char Magic[] = "clang-analyzer-function-summaries-v2";
+
+/// Entries, and stores of other configurations, that have not been used for
+/// this many seconds are removed.
+static const uint64_t MaxAge = 31 * 24 * 60 * 60;
+
+/// The maximum number of entries in a store. The least recently used ones are
+/// removed first.
+static const size_t MaxEntries = 1 << 16;
+
+FunctionSummaryCache::FunctionSummaryCache(StringRef Directory,
+                                           StringRef Configuration)
+    : Directory(Directory), HasExpiredEntries(false) {
+  llvm::MD5 Hash;
+  Hash.update(Configuration);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+
+  llvm::sys::fs::create_directories(Directory);
+  SmallString<128> P(Directory);
+  llvm::sys::path::append(P, "summaries-" + Digest.str() + ".txt");
+  Path = P.str();
+
+  read(Path, Exhausted);
+}
+
+std::string FunctionSummaryCache::getKey(StringRef USR, StringRef BodyHash) {
+  return (BodyHash + " " + USR).str();
+}
+
+void FunctionSummaryCache::read(StringRef Path, EntriesTy &Entries) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return;
+
+  StringRef Line, Rest = (*Buffer)->getBuffer();
+  std::tie(Line, Rest) = Rest.split('\n');
+  if (Line != Magic)
+    return;
+
+  // Each entry is the time it was last used, followed by the keys of the
+  // top-level function and of the function that exhausted the budget,
+  // separated by tabs.
+  const uint64_t Now = time(nullptr);
+  while (!Rest.empty()) {
+    std::tie(Line, Rest) = Rest.split('\n');
+    StringRef Time, Root, Callee;
+    std::tie(Time, Line) = Line.split('\t');
+    std::tie(Root, Callee) = Line.split('\t');
+    uint64_t LastUsed;
+    if (Time.getAsInteger(10, LastUsed) || Root.empty() || Callee.empty())
+      continue;
+    if (LastUsed + MaxAge < Now) {
+      HasExpiredEntries = true;
+      continue;
+    }
+    uint64_t &Entry = Entries[Root][Callee];
+    Entry = std::max(Entry, LastUsed);
+  }
+}
+
+void FunctionSummaryCache::getExhausted(StringRef Root,
+                                        SmallVectorImpl<StringRef> &Callees) {
+  auto I = Exhausted.find(Root);
+  if (I == Exhausted.end())
+    return;
+  const uint64_t Now = time(nullptr);
+  for (const auto &Callee : I->second) {
+    Callees.push_back(Callee.getKey());
+    Updated[Root][Callee.getKey()] = Now;
+  }
+}
+
+void FunctionSummaryCache::markExhausted(StringRef Root, StringRef Callee) {
+  Updated[Root][Callee] = time(nullptr);
+}
+
+/// Remove the stores of other configurations, e.g. of older versions of
+/// clang, that have not been used for a while.
+void FunctionSummaryCache::pruneStores() {
+  const uint64_t Now = time(nullptr);
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator File(Directory, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    StringRef Name = llvm::sys::path::filename(File->path());
+    if (File->path() == Path || !Name.startswith("summaries-") ||
+        !Name.endswith(".txt"))
+      continue;
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(File->path(), Status))
+      continue;
+    if (Status.getLastModificationTime().toEpochTime() + MaxAge < Now)
+      llvm::sys::fs::remove(File->path());
+  }
+}
+
+std::error_code FunctionSummaryCache::save() {
+  if (Updated.empty() && !HasExpiredEntries)
+    return std::error_code();
+
+  while (true) {
+    llvm::LockFileManager Locked(Path);
+    switch (Locked) {
+    case llvm::LockFileManager::LFS_Error:
+      return std::make_error_code(std::errc::no_lock_available);
+
+    case llvm::LockFileManager::LFS_Shared:
+      // Another analyzer is updating the store. Wait for it and merge our
+      // entries into its result.
+      if (Locked.waitForUnlock() == llvm::LockFileManager::Res_Timeout)
+        return std::make_error_code(std::errc::timed_out);
+      continue;
+
+    case llvm::LockFileManager::LFS_Owned:
+      break;
+    }
+
+    // Re-read the store, as other analyzers may have extended it since it
+    // was opened.
+    EntriesTy Merged;
+    read(Path, Merged);
+    for (const auto &Root : Updated)
+      for (const auto &Callee : Root.getValue())
+        Merged[Root.getKey()][Callee.getKey()] = Callee.getValue();
+
+    // Sort the entries by key, and keep the most recently used ones if there
+    // are too many.
+    typedef std::tuple<uint64_t, StringRef, StringRef> EntryTy;
+    std::vector<EntryTy> Entries;
+    for (const auto &Root : Merged)
+      for (const auto &Callee : Root.getValue())
+        Entries.emplace_back(Callee.getValue(), Root.getKey(),
+                             Callee.getKey());
+    if (Entries.size() > MaxEntries) {
+      std::nth_element(Entries.begin(), Entries.begin() + MaxEntries,
+                       Entries.end(), std::greater<EntryTy>());
+      Entries.resize(MaxEntries);
+    }
+    std::sort(Entries.begin(), Entries.end(),
+              [](const EntryTy &L, const EntryTy &R) {
+                return std::tie(std::get<1>(L), std::get<2>(L)) <
+                       std::tie(std::get<1>(R), std::get<2>(R));
+              });
+
+    // Write to a temporary file and rename it into place, so that readers
+    // never see a partially written store.
+    int TmpFD;
+    SmallString<128> TmpPath;
+    if (std::error_code EC = llvm::sys::fs::createUniqueFile(
+            Path + "-%%%%%%%%", TmpFD, TmpPath))
+      return EC;
+    {
+      llvm::raw_fd_ostream OS(TmpFD, /*shouldClose=*/true);
+      OS << Magic << '\n';
+      for (const EntryTy &Entry : Entries)
+        OS << std::get<0>(Entry) << '\t' << std::get<1>(Entry) << '\t'
+           << std::get<2>(Entry) << '\n';
+      OS.close();
+      if (OS.has_error()) {
+        OS.clear_error();
+        llvm::sys::fs::remove(TmpPath);
+        return std::make_error_code(std::errc::io_error);
+      }
+    }
+    if (std::error_code EC = llvm::sys::fs::rename(TmpPath, Path)) {
+      llvm::sys::fs::remove(TmpPath);
+      return EC;
+    }
+
+    for (const auto &Root : Updated)
+      for (const auto &Callee : Root.getValue())
+        Exhausted[Root.getKey()][Callee.getKey()] = Callee.getValue();
+    Updated.clear();
+    HasExpiredEntries = false;
+    pruneStores();
+    return std::error_code();
+  }
+}
@@ -22,7 +22,10 @@
 #include "clang/Analysis/CallGraph.h"
 #include "clang/Analysis/CodeInjector.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Index/USRGeneration.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/StaticAnalyzer/Checkers/LocalCheckers.h"
 #include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
@@ -32,17 +35,23 @@
 #include "clang/StaticAnalyzer/Core/PathDiagnosticConsumers.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/FunctionSummaryCache.h"
 #include "clang/StaticAnalyzer/Frontend/CheckerRegistration.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <memory>
 #include <queue>
 #include <utility>
+#include <vector>
 
 using namespace clang;
 using namespace ento;
@@ -59,6 +68,11 @@ STATISTIC(NumBlocksInAnalyzedFunctions,
                       "The # of basic blocks in the analyzed functions.");
 STATISTIC(PercentReachableBlocks, "The % of reachable basic blocks.");
 STATISTIC(MaxCFGSize, "The maximum number of basic blocks in a function.");
+STATISTIC(NumFunctionsInOtherShards,
+          "The # of top level functions left to other analyzer shards.");
+STATISTIC(NumCachedExhaustedFunctions,
+          "The # of functions not inlined because the summary cache knows "
+          "they exhaust the block visit budget.");
 
 //===----------------------------------------------------------------------===//
 // Special PathDiagnosticConsumers.
@@ -180,6 +194,15 @@ public:
   /// translation unit.
   FunctionSummariesTy FunctionSummaries;
 
+  /// The information about analyzed functions shared with the analyzer runs
+  /// of other translation units, if enabled.
+  std::unique_ptr<FunctionSummaryCache> SummaryCache;
+
+  /// The key in the summary cache of every function definition that can be
+  /// looked up in it, and the other way around.
+  llvm::DenseMap<const Decl *, std::string> SummaryKeys;
+  llvm::StringMap<const Decl *> SummaryDecls;
+
   AnalysisConsumer(const Preprocessor &pp, const std::string &outdir,
                    AnalyzerOptionsRef opts, ArrayRef<std::string> plugins,
                    CodeInjector *injector)
@@ -308,6 +331,22 @@ public:
   /// use it to define the order in which the functions should be visited.
   void HandleDeclsCallGraph(const unsigned LocalTUDeclsSize);
 
+  /// \brief Open the summary cache, if any, and compute the keys of the
+  /// functions of \p CG in it.
+  void loadCachedSummaries(CallGraph &CG);
+
+  /// \brief Mark the functions that the summary cache knows to exhaust the
+  /// block visit budget during the analysis of \p Root as not inlinable.
+  void applyCachedSummaries(const Decl *Root);
+
+  /// \brief Record in the summary cache that the functions in \p Exhausted
+  /// exhausted the block visit budget during the analysis of \p Root.
+  void recordCachedSummaries(const Decl *Root,
+                             ArrayRef<const Decl *> Exhausted);
+
+  /// \brief Write the summaries recorded during this run to the cache.
+  void saveCachedSummaries();
+
   /// \brief Run analyzes(syntax or path sensitive) on the given function.
   /// \param Mode - determines if we are requesting syntax only or path
   /// sensitive only analysis.
@@ -453,6 +492,60 @@ AnalysisConsumer::getInliningModeForFunction(const Decl *D,
   return ExprEngine::Inline_Regular;
 }
 
+/// \brief Distribute the functions of \p CG over \p ShardCount shards.
+///
+/// Functions that are connected in the call graph may be inlined into each
+/// other, which lets the analyzer skip analyzing the callee as top level, so
+/// each connected component goes to a single shard. Components are assigned
+/// greedily, largest first, to the shard with the fewest functions so far.
+/// Every shard of a translation unit computes the same assignment, as it only
+/// depends on the order of the declarations in the translation unit.
+static void assignShards(CallGraph &CG, unsigned ShardCount,
+                         llvm::DenseMap<const Decl *, unsigned> &ShardOf) {
+  llvm::EquivalenceClasses<const Decl *> Components;
+  std::vector<const Decl *> Order;
+  llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
+  for (CallGraphNode *N : RPOT) {
+    const Decl *D = N->getDecl();
+    if (!D)
+      continue;
+    Order.push_back(D);
+    Components.insert(D);
+    for (CallGraphNode *Callee : *N)
+      Components.unionSets(D, Callee->getDecl());
+  }
+
+  // Number the components in the order in which they are first reached,
+  // rather than by the address of their leader.
+  llvm::DenseMap<const Decl *, unsigned> ComponentOf;
+  std::vector<std::pair<unsigned, unsigned>> Sizes;
+  for (const Decl *D : Order) {
+    auto Inserted = ComponentOf.insert(
+        std::make_pair(Components.getLeaderValue(D), Sizes.size()));
+    if (Inserted.second)
+      Sizes.push_back(std::make_pair(0, Sizes.size()));
+    ++Sizes[Inserted.first->second].first;
+  }
+
+  std::stable_sort(Sizes.begin(), Sizes.end(),
+                   [](const std::pair<unsigned, unsigned> &L,
+                      const std::pair<unsigned, unsigned> &R) {
+                     return L.first > R.first;
+                   });
+  std::vector<unsigned> ShardOfComponent(Sizes.size());
+  std::vector<unsigned> Load(ShardCount);
+  for (const auto &Component : Sizes) {
+    unsigned Shard =
+        std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[Shard] += Component.first;
+    ShardOfComponent[Component.second] = Shard;
+  }
+
+  for (const Decl *D : Order)
+    ShardOf[D] =
+        ShardOfComponent[ComponentOf[Components.getLeaderValue(D)]];
+}
+
 void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   // Build the Call Graph by adding all the top level declarations to the graph.
   // Note: CallGraph can trigger deserialization of more items from a pch
@@ -463,6 +556,14 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     CG.addToCallGraph(LocalTUDecls[i]);
   }
 
+  loadCachedSummaries(CG);
+
+  const unsigned ShardCount = Opts->getShardCount();
+  const unsigned ShardIndex = Opts->getShardIndex();
+  llvm::DenseMap<const Decl *, unsigned> ShardOf;
+  if (ShardCount > 1)
+    assignShards(CG, ShardCount, ShardOf);
+
   // Walk over all of the call graph nodes in topological order, so that we
   // analyze parents before the children. Skip the functions inlined into
   // the previously processed functions. Use external Visited set to identify
@@ -488,11 +589,23 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     if (shouldSkipFunction(D, Visited, VisitedAsTopLevel))
       continue;
 
+    // Skip the functions another shard is responsible for.
+    if (ShardCount > 1 && ShardOf.lookup(D) != ShardIndex) {
+      NumFunctionsInOtherShards++;
+      continue;
+    }
+
     // Analyze the function.
     SetOfConstDecls VisitedCallees;
 
+    applyCachedSummaries(D);
+    const size_t NumExhausted =
+        FunctionSummaries.getReachedMaxBlockCountDecls().size();
     HandleCode(D, AM_Path, getInliningModeForFunction(D, Visited),
                (Mgr->options.InliningMode == All ? nullptr : &VisitedCallees));
+    recordCachedSummaries(
+        D, FunctionSummaries.getReachedMaxBlockCountDecls().drop_front(
+               NumExhausted));
 
     // Add the visited callees to the global visited set.
     for (const Decl *Callee : VisitedCallees)
@@ -502,6 +615,124 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
                                                  : Callee->getCanonicalDecl());
     VisitedAsTopLevel.insert(D);
   }
+
+  saveCachedSummaries();
+}
+
+/// \brief Compute a hash of the body of \p D, to tell whether it changed
+/// since a summary of it was cached.
+///
+/// This hashes the source text of the body, so changes to the macros or
+/// types it uses go unnoticed. A stale summary only affects which calls get
+/// inlined, not the correctness of the analysis of the function itself.
+static bool getBodyHash(const Decl *D, const SourceManager &SM,
+                        const LangOptions &LangOpts,
+                        SmallString<32> &Hash) {
+  const Stmt *Body = D->getBody();
+  if (!Body)
+    return false;
+  SourceRange Range(SM.getExpansionLoc(Body->getLocStart()),
+                    SM.getExpansionLoc(Body->getLocEnd()));
+  StringRef Text = Lexer::getSourceText(CharSourceRange::getTokenRange(Range),
+                                        SM, LangOpts);
+  if (Text.empty())
+    return false;
+
+  llvm::MD5 MD5;
+  MD5.update(Text);
+  llvm::MD5::MD5Result Result;
+  MD5.final(Result);
+  llvm::MD5::stringifyResult(Result, Hash);
+  return true;
+}
+
+/// \brief The declaration that the summaries of \p D are attached to.
+///
+/// The analyzer summarizes the definition of a function rather than the
+/// canonical declaration the call graph uses.
+static const Decl *getSummaryDecl(const Decl *D) {
+  if (const auto *FD = dyn_cast_or_null<FunctionDecl>(D)) {
+    const FunctionDecl *Definition;
+    if (!FD->hasBody(Definition))
+      return nullptr;
+    return Definition;
+  }
+  return D;
+}
+
+void AnalysisConsumer::loadCachedSummaries(CallGraph &CG) {
+  StringRef Dir = Opts->getSummaryCacheDir();
+  if (Dir.empty())
+    return;
+
+  // Summaries only carry over between runs that explore functions the same
+  // way.
+  std::string Configuration;
+  llvm::raw_string_ostream OS(Configuration);
+  OS << getClangFullVersion() << '\n'
+     << "max-loop=" << Opts->maxBlockVisitOnPath << '\n'
+     << "inline-max-stack-depth=" << Opts->InlineMaxStackDepth << '\n'
+     << "ipa=" << Opts->getIPAMode() << '\n'
+     << "max-nodes=" << Opts->getMaxNodesPerTopLevelFunction() << '\n'
+     << "max-inlinable-size=" << Opts->getMaxInlinableSize() << '\n'
+     << "widen-loops=" << Opts->shouldWidenLoops() << '\n';
+  for (const auto &Checker : Opts->CheckersControlList)
+    OS << Checker.first << '=' << Checker.second << '\n';
+  SummaryCache = llvm::make_unique<FunctionSummaryCache>(Dir, OS.str());
+
+  const SourceManager &SM = Ctx->getSourceManager();
+  for (const auto &Entry : CG) {
+    const Decl *D = getSummaryDecl(Entry.first);
+    if (!D)
+      continue;
+    SmallString<128> USR;
+    SmallString<32> BodyHash;
+    if (index::generateUSRForDecl(D, USR) ||
+        !getBodyHash(D, SM, PP.getLangOpts(), BodyHash))
+      continue;
+    std::string Key = FunctionSummaryCache::getKey(USR, BodyHash);
+    SummaryDecls[Key] = D;
+    SummaryKeys[D] = std::move(Key);
+  }
+}
+
+void AnalysisConsumer::applyCachedSummaries(const Decl *Root) {
+  if (!SummaryCache)
+    return;
+  auto I = SummaryKeys.find(getSummaryDecl(Root));
+  if (I == SummaryKeys.end())
+    return;
+
+  SmallVector<StringRef, 4> Callees;
+  SummaryCache->getExhausted(I->second, Callees);
+  for (StringRef Callee : Callees)
+    if (const Decl *D = SummaryDecls.lookup(Callee)) {
+      FunctionSummaries.markReachedMaxBlockCount(D);
+      NumCachedExhaustedFunctions++;
+    }
+}
+
+void AnalysisConsumer::recordCachedSummaries(
+    const Decl *Root, ArrayRef<const Decl *> Exhausted) {
+  if (!SummaryCache || Exhausted.empty())
+    return;
+  auto I = SummaryKeys.find(getSummaryDecl(Root));
+  if (I == SummaryKeys.end())
+    return;
+
+  for (const Decl *D : Exhausted) {
+    auto Callee = SummaryKeys.find(D);
+    if (Callee != SummaryKeys.end())
+      SummaryCache->markExhausted(I->second, Callee->second);
+  }
+}
+
+void AnalysisConsumer::saveCachedSummaries() {
+  if (!SummaryCache)
+    return;
+
+  // The cache only saves work; failing to update it is not an error.
+  SummaryCache->save();
 }
 
 void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
@@ -521,7 +752,13 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
     // Introduce a scope to destroy BR before Mgr.
     BugReporter BR(*Mgr);
     TranslationUnitDecl *TU = C.getTranslationUnitDecl();
-    checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
+
+    // When the analysis is split into shards, the first shard runs the
+    // AST-only checks and the others only analyze their share of the
+    // top-level functions path-sensitively.
+    const bool IsPrimaryShard = Opts->getShardIndex() == 0;
+    if (IsPrimaryShard)
+      checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
 
     // Run the AST-only checks using the order in which functions are defined.
     // If inlining is not turned on, use the simplest function order for path
@@ -538,15 +775,18 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
     // random access.  By doing so, we automatically compensate for iterators
     // possibly being invalidated, although this is a bit slower.
     const unsigned LocalTUDeclsSize = LocalTUDecls.size();
-    for (unsigned i = 0 ; i < LocalTUDeclsSize ; ++i) {
-      TraverseDecl(LocalTUDecls[i]);
+    if (IsPrimaryShard) {
+      for (unsigned i = 0 ; i < LocalTUDeclsSize ; ++i) {
+        TraverseDecl(LocalTUDecls[i]);
+      }
     }
 
     if (Mgr->shouldInlineCall())
       HandleDeclsCallGraph(LocalTUDeclsSize);
 
     // After all decls handled, run checkers on the entire TranslationUnit.
-    checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
+    if (IsPrimaryShard)
+      checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
 
     RecVisitorBR = nullptr;
   }
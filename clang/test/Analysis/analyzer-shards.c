@@ -0,0 +1,31 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-display-progress -analyzer-config shard-count=2,shard-index=0 %s 2>&1 | FileCheck %s --check-prefix=SHARD0
+// RUN: %clang_cc1 -analyze -analyzer-checker=core -analyzer-display-progress -analyzer-config shard-count=2,shard-index=1 %s 2>&1 | FileCheck %s --check-prefix=SHARD1
+// RUN: not %clang_cc1 -analyze -analyzer-checker=core -analyzer-config shard-count=2,shard-index=2 %s 2>&1 | FileCheck %s --check-prefix=INVALID
+// RUN: not %clang_cc1 -analyze -analyzer-checker=core -analyzer-config shard-index=1 %s 2>&1 | FileCheck %s --check-prefix=INVALID1
+
+// The call graph has three components: {leaf, caller}, {b} and {c}. The
+// largest goes to shard 0 and the two others to shard 1, so that caller is
+// still analyzed together with the function it inlines.
+
+void leaf() {}
+void caller() { leaf(); }
+void b() {}
+void c() {}
+
+// Shard 0 runs the AST-only checks on every function.
+// SHARD0: ANALYZE (Syntax): {{.*}} leaf
+// SHARD0: ANALYZE (Syntax): {{.*}} caller
+// SHARD0: ANALYZE (Syntax): {{.*}} b
+// SHARD0: ANALYZE (Syntax): {{.*}} c
+// SHARD0-NOT: Inline_Regular): {{.*}} {{b|c}}{{$}}
+// SHARD0: ANALYZE (Path,  Inline_Regular): {{.*}} caller{{$}}
+// SHARD0-NOT: Inline_Regular): {{.*}} {{b|c}}{{$}}
+
+// SHARD1-NOT: ANALYZE (Syntax)
+// SHARD1-NOT: caller{{$}}
+// SHARD1-DAG: ANALYZE (Path,  Inline_Regular): {{.*}} b{{$}}
+// SHARD1-DAG: ANALYZE (Path,  Inline_Regular): {{.*}} c{{$}}
+// SHARD1-NOT: caller{{$}}
+
+// INVALID: error: analyzer-config option 'shard-index' must be less than 'shard-count' (2)
+// INVALID1: error: analyzer-config option 'shard-index' must be less than 'shard-count' (1)
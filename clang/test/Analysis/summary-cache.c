@@ -0,0 +1,61 @@
+// REQUIRES: shell
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-cache-dir=%t -DFIRST -verify %s
+// RUN: ls %t | FileCheck %s
+// RUN: cat %t/summaries-*.txt | FileCheck %s --check-prefix=STORE
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -verify %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-cache-dir=%t -verify %s
+
+// With the cached summary, 'exhaust' does not inline 'sum' at all, so
+// clang_analyzer_checkInlined() in 'sum' stays silent.
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-cache-dir=%t -DFIRST -DCACHED -verify %s
+
+// Entries that have not been used for a long time, and the stores of other
+// configurations, are removed when the store is written.
+// RUN: sed -e 's/^[0-9][0-9]*/1/' %t/summaries-*.txt > %t/expired
+// RUN: cp %t/expired %t/summaries-*.txt
+// RUN: touch -m -a -t 201101010000 %t/summaries-00000000000000000000000000000000.txt
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,debug.ExprInspection -analyzer-config summary-cache-dir=%t -verify %s
+// RUN: ls %t | FileCheck %s --check-prefix=PRUNED
+// RUN: cat %t/summaries-*.txt | FileCheck %s --check-prefix=EXPIRED
+
+// CHECK: summaries-{{[0-9a-f]+}}.txt
+
+// The entry is specific to the top-level function whose analysis exhausted
+// the budget.
+// STORE: clang-analyzer-function-summaries-v2
+// STORE-NEXT: {{[0-9]+}} {{[0-9a-f]+}} c:@F@exhaust {{[0-9a-f]+}} c:@F@sum{{$}}
+
+// PRUNED-NOT: summaries-00000000000000000000000000000000.txt
+// EXPIRED: clang-analyzer-function-summaries-v2
+// EXPIRED-NOT: c:@F@sum
+
+void clang_analyzer_eval(int);
+void clang_analyzer_checkInlined(int);
+
+int sum(int n) {
+  clang_analyzer_checkInlined(1);
+  int s = 0;
+  for (int i = 0; i < n; ++i)
+    s += i;
+  return s;
+}
+#if !defined(CACHED)
+// expected-warning@-7 {{TRUE}}
+#else
+// expected-no-diagnostics
+#endif
+
+#ifdef FIRST
+// Inlining 'sum' here exhausts the block visit budget, which the first run
+// records in the cache.
+void exhaust(int n) {
+  sum(n);
+}
+#else
+void useSum() {
+  // That 'sum' exhausted the budget in the analysis of 'exhaust' says nothing
+  // about this call, so it is still inlined with the cache.
+  clang_analyzer_eval(sum(0) == 0); // expected-warning{{TRUE}}
+}
+#endif
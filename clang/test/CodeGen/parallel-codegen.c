@@ -0,0 +1,26 @@
+// REQUIRES: x86-registered-target
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -emit-obj -o %t.0.o \
+// RUN:   -parallel-codegen-output %t.1.o -parallel-codegen-output %t.2.o %s
+// RUN: llvm-nm %t.0.o %t.1.o %t.2.o | FileCheck %s
+
+// Every definition is emitted into exactly one partition, and internal
+// functions keep their linkage in the partition of their callers.
+
+// CHECK-DAG: t helper
+// CHECK-DAG: T f0
+// CHECK-DAG: T f1
+// CHECK-DAG: T f2
+// CHECK-DAG: T f3
+// CHECK-DAG: T f4
+// CHECK-DAG: T f5
+// CHECK-DAG: D table
+
+static int helper(int x) { return x * 3; }
+int table[4] = {1, 2, 3, 4};
+
+int f0(int x) { return helper(x) + table[0]; }
+int f1(int x) { return helper(x) + table[1]; }
+int f2(int x) { return x + 2; }
+int f3(int x) { return x + 3; }
+int f4(int x) { return x + 4; }
+int f5(int x) { return x + 5; }
@@ -0,0 +1,22 @@
+// REQUIRES: asserts
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -emit-llvm -mllvm -stats -o /dev/null %s 2>&1 | FileCheck --check-prefix=STATS %s
+// RUN: rm -rf %t && mkdir %t
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -emit-llvm -ftime-trace -ftime-trace-granularity=0 -o %t/out.ll %s
+// RUN: FileCheck --check-prefix=TRACE %s < %t/out.json
+
+// The inline function and the template instantiation are only emitted once
+// they are used, from the deferred queue; use() is emitted right away.
+
+inline int one() { return 1; }
+template <typename T> T twice(T X) { return X + X; }
+
+int use() { return twice(one()); }
+
+// STATS: 2 irgen{{ +}}- Number of deferred definitions emitted
+
+// TRACE: {"traceEvents":[
+// TRACE-DAG: "name":"CodeGen Function","args":{"detail":"_Z3onev"}
+// TRACE-DAG: "name":"CodeGen Function","args":{"detail":"_Z5twiceIiET_S0_"}
+// TRACE-DAG: "name":"EmitDeferred","args":{"detail":""}
+// TRACE-DAG: "name":"Total EmitDeferred","args":{"detail":"1 calls"}
+// TRACE: "displayTimeUnit":"ms"}
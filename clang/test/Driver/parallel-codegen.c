@@ -0,0 +1,21 @@
+// RUN: %clang -target x86_64-linux-gnu -### -c -fparallel-codegen=3 %s -o %t.o 2>&1 \
+// RUN:   | FileCheck --check-prefix=SPLIT %s
+// SPLIT: "-cc1"
+// SPLIT-SAME: "-o" "[[P0:[^"]+\.o]]"
+// SPLIT-SAME: "-parallel-codegen-output" "[[P1:[^"]+\.o]]"
+// SPLIT-SAME: "-parallel-codegen-output" "[[P2:[^"]+\.o]]"
+// SPLIT: "-r" "-o" "{{[^"]*}}.o" "[[P0]]" "[[P1]]" "[[P2]]"
+
+// A single partition, and outputs that are not objects, need no splitting.
+// RUN: %clang -target x86_64-linux-gnu -### -c -fparallel-codegen=1 %s -o %t.o 2>&1 \
+// RUN:   | FileCheck --check-prefix=NOSPLIT %s
+// RUN: %clang -target x86_64-linux-gnu -### -S -fparallel-codegen=4 %s -o %t.s 2>&1 \
+// RUN:   | FileCheck --check-prefix=NOSPLIT %s
+// RUN: %clang -target x86_64-apple-darwin -### -c -fparallel-codegen=4 %s -o %t.o 2>&1 \
+// RUN:   | FileCheck --check-prefix=NOSPLIT %s
+// NOSPLIT-NOT: -parallel-codegen-output
+// NOSPLIT-NOT: "-r"
+
+// RUN: not %clang -target x86_64-linux-gnu -### -c -fparallel-codegen=0 %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=INVALID %s
+// INVALID: invalid integral value '0' in '-fparallel-codegen=0'
@@ -0,0 +1,47 @@
+// RUN: rm -rf %t && mkdir %t && cd %t
+// RUN: %clang_cc1 -std=c++14 -emit-llvm -ftime-trace -ftime-trace-granularity=0 -ftime-trace-summary=2 -o %t/out.ll %s 2> %t/summary.txt
+// RUN: FileCheck --check-prefix=TRACE %s < %t/out.json
+// RUN: FileCheck --check-prefix=SUMMARY %s < %t/summary.txt
+
+// When writing to stdout, the trace is named after the input file.
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -ftime-trace %s
+// RUN: FileCheck --check-prefix=SYNTAX %s < %t/ftime-trace.json
+
+// The driver forwards the flags to the frontend.
+// RUN: %clang -### -c -ftime-trace -ftime-trace-granularity=100 -ftime-trace-summary=5 %s 2>&1 | FileCheck --check-prefix=DRIVER %s
+// DRIVER: "-ftime-trace" "-ftime-trace-granularity=100" "-ftime-trace-summary=5"
+
+template <int N> struct Fib {
+  static constexpr int value = Fib<N - 1>::value + Fib<N - 2>::value;
+};
+template <> struct Fib<0> { static constexpr int value = 0; };
+template <> struct Fib<1> { static constexpr int value = 1; };
+
+constexpr int square(int X) { return X * X; }
+constexpr int Squared = square(12);
+
+template <typename T> T twice(T X) { return X + X; }
+
+int use() { return twice(Fib<10>::value) + Squared; }
+
+// TRACE: {"traceEvents":[
+// TRACE-DAG: "name":"InstantiateClass","args":{"detail":"Fib<10>"}
+// TRACE-DAG: "name":"InstantiateFunction","args":{"detail":"twice<int>"}
+// TRACE-DAG: "name":"EvaluateAsInitializer","args":{"detail":"Squared"}
+// TRACE-DAG: "name":"ParseFunctionDefinition","args":{"detail":"use"}
+// TRACE-DAG: "name":"CodeGen Function","args":{"detail":"_Z3usev"}
+// TRACE-DAG: "name":"Frontend"
+// TRACE-DAG: "name":"Backend"
+// TRACE-DAG: "name":"Total InstantiateClass","args":{"detail":"{{[0-9]+}} calls"}
+// TRACE: "displayTimeUnit":"ms"}
+
+// SUMMARY: Time trace summary (top 2)
+// SUMMARY: InstantiateClass:
+// SUMMARY-NEXT: ms
+// SUMMARY-NEXT: ms
+// SUMMARY-NOT: ms
+// SUMMARY: InstantiateFunction:
+// SUMMARY-NEXT: ms {{ *}}1  twice<int>
+
+// SYNTAX: "name":"InstantiateFunction","args":{"detail":"twice<int>"}
+// SYNTAX-NOT: "CodeGen Function"
@@ -0,0 +1,2 @@
+#include "shared.h"
+int b_fn(void) { return shared_fn(); }
@@ -0,0 +1,2 @@
+#include "shared.h"
+int c_fn(void) { return variant_fn(); }
@@ -0,0 +1,3 @@
+#define LOCAL_VARIANT
+#include "shared.h"
+int d_fn(void) { return local_fn(); }
@@ -0,0 +1,3 @@
+#define shared_fn renamed_fn
+#include "shared.h"
+int e_fn(void) { return renamed_fn(); }
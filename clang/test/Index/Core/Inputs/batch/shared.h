@@ -0,0 +1,10 @@
+#ifndef SHARED_H
+#define SHARED_H
+int shared_fn(void);
+#ifdef VARIANT
+int variant_fn(void);
+#endif
+#ifdef LOCAL_VARIANT
+int local_fn(void);
+#endif
+#endif
@@ -0,0 +1,35 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: cp %S/Inputs/batch/a.c %S/Inputs/batch/b.c %S/Inputs/batch/c.c %S/Inputs/batch/d.c %S/Inputs/batch/e.c %S/Inputs/batch/shared.h %t
+// RUN: echo "[{\"directory\":\"%t\",\"command\":\"clang -c a.c\",\"file\":\"a.c\"},{\"directory\":\"%t\",\"command\":\"clang -c b.c\",\"file\":\"b.c\"},{\"directory\":\"%t\",\"command\":\"clang -c c.c -DVARIANT\",\"file\":\"c.c\"},{\"directory\":\"%t\",\"command\":\"clang -c d.c\",\"file\":\"d.c\"},{\"directory\":\"%t\",\"command\":\"clang -c e.c\",\"file\":\"e.c\"}]" | sed -e 's/\\/\//g' > %t/compile_commands.json
+// RUN: c-index-test core -index-compilation-database -build-path %t -index-store %t/store -j 1 | FileCheck -check-prefix=SUMMARY %s
+// RUN: c-index-test core -print-index-store -index-store %t/store | FileCheck %s
+
+// Translation units that are indexed at the same time may both index a
+// header, which must not change the store.
+// RUN: c-index-test core -index-compilation-database -build-path %t -index-store %t/store-parallel -j 2
+// RUN: c-index-test core -print-index-store -index-store %t/store-parallel | FileCheck %s
+
+// a.c and b.c are compiled the same way, so only one of them indexes
+// shared.h. c.c defines VARIANT, so it indexes shared.h again. d.c and e.c
+// are compiled like a.c, but define macros that change what shared.h
+// declares before including it, so they index it again as well.
+// SUMMARY: indexed 5 translation units (0 with errors, 0 failed), skipped 1 already indexed headers
+
+// CHECK: function/C | a_fn | c:@F@a_fn
+// CHECK-NEXT: {{.*}}a.c:2:5 | Def
+
+// CHECK: function/C | local_fn | c:@F@local_fn
+// CHECK-NEXT: {{.*}}d.c:3:25 | Ref,Call,RelCall
+// CHECK-NEXT: {{.*}}shared.h:8:5 | Decl
+// CHECK-NEXT: function/C | renamed_fn | c:@F@renamed_fn
+// CHECK-NEXT: {{.*}}e.c:3:25 | Ref,Call,RelCall
+// CHECK-NEXT: {{.*}}shared.h:3:5 | Decl
+// CHECK-NEXT: function/C | shared_fn | c:@F@shared_fn
+// CHECK-NEXT: {{.*}}a.c:2:25 | Ref,Call,RelCall
+// CHECK-NEXT: {{.*}}b.c:2:25 | Ref,Call,RelCall
+// The declaration is seen by two contexts but recorded once.
+// CHECK-NEXT: {{.*}}shared.h:3:5 | Decl
+// CHECK-NEXT: function/C | variant_fn | c:@F@variant_fn
+// CHECK-NEXT: {{.*}}c.c:2:25 | Ref,Call,RelCall
+// CHECK-NEXT: {{.*}}shared.h:5:5 | Decl
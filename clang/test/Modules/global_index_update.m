@@ -0,0 +1,29 @@
+// REQUIRES: asserts
+// RUN: rm -rf %t
+// Build some modules and create the global module index
+// RUN: %clang_cc1 -fmodules-cache-path=%t -fdisable-module-hash -fmodules -fimplicit-module-maps -F %S/Inputs %s -verify -mllvm -stats 2>&1 | FileCheck -check-prefix=CHECK-CREATE %s
+// RUN: ls %t|grep modules.idx
+// Build one more module. Updating the index only reads the new module file.
+// RUN: %clang_cc1 -fmodules-cache-path=%t -fdisable-module-hash -fmodules -fimplicit-module-maps -F %S/Inputs %s -verify -DIMPORT_CMDLINE -mllvm -stats 2>&1 | FileCheck -check-prefix=CHECK-UPDATE %s
+// The updated index is still used for lookups
+// RUN: %clang_cc1 -fmodules-cache-path=%t -fdisable-module-hash -fmodules -fimplicit-module-maps -F %S/Inputs %s -verify -DIMPORT_CMDLINE -print-stats 2>&1 | FileCheck -check-prefix=CHECK-USE %s
+
+// expected-no-diagnostics
+@import DependsOnModule;
+@import Module;
+#ifdef IMPORT_CMDLINE
+@import CmdLine;
+#endif
+
+// CHECK-CREATE-NOT: Number of unchanged module files carried over
+// CHECK-CREATE: global-module-index {{ *}}- Number of module files read into the index
+// CHECK-CREATE-NOT: Number of unchanged module files carried over
+
+// CHECK-UPDATE-DAG: {{^ *}}1 global-module-index {{ *}}- Number of module files read into the index
+// CHECK-UPDATE-DAG: global-module-index {{ *}}- Number of unchanged module files carried over from the old index
+
+// CHECK-USE: *** Global Module Index Statistics:
+
+int *get_sub() {
+  return Module_Sub;
+}
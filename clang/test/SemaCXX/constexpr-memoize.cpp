@@ -0,0 +1,36 @@
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// Calls to a constexpr function with the same argument values are memoized,
+// so this naive recursion takes a linear number of steps instead of an
+// exponential one.
+constexpr unsigned long long fib(int n) {
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+static_assert(fib(90) == 2880067194370816120ull, "");
+
+struct Pair { int a, b; };
+constexpr Pair swap(Pair p) { return {p.b, p.a}; }
+static_assert(swap({1, 2}).a == 2 && swap({1, 2}).b == 1, "");
+static_assert(swap({2, 1}).a == 1, "");
+
+// A call taking a reference can observe the current value of the referenced
+// object, so it must not be memoized.
+constexpr int read(const int &r) { return r; }
+constexpr int readTwice() {
+  int x = 1;
+  int a = read(x);
+  x = 2;
+  return a * 10 + read(x);
+}
+static_assert(readTwice() == 12, "");
+
+// Calls that are not constant expressions are never memoized, so later
+// evaluations diagnose them again.
+constexpr int plusMax(int n) {
+  return n + __INT_MAX__; // expected-note 2{{outside the range of representable values}}
+}
+static_assert(plusMax(1), ""); // expected-error {{not an integral constant expression}} expected-note {{in call to 'plusMax(1)'}}
+constexpr int k = plusMax(1); // expected-error {{must be initialized by a constant expression}} expected-note {{in call to 'plusMax(1)'}}
+
+// CHECK: {{[1-9][0-9]*}} constexpr function call results memoized
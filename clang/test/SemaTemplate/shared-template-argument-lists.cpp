@@ -0,0 +1,46 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// Template argument lists with the same arguments are shared by the
+// specializations and deductions that use them. Sharing must not confuse
+// arguments that are equivalent but not identical.
+
+// expected-no-diagnostics
+
+template <typename T> struct Box { T value; };
+template <typename T> T unbox(Box<T> b) { return b.value; }
+
+int a = unbox(Box<int>{1}) + unbox(Box<int>{2});
+long b = unbox(Box<long>{3});
+
+template <typename T, T V> struct Constant {
+  static constexpr T value = V;
+};
+static_assert(Constant<int, 1>::value == 1, "");
+static_assert(Constant<unsigned, 1>::value == 1u, "");
+static_assert(Constant<long, -1>::value == -1l, "");
+
+template <int N> struct Int { static const int value = N; };
+template <int N, typename T> int get(Int<N>, T) { return N; }
+static_assert(Int<1>::value != Int<2>::value, "");
+int c = get(Int<1>(), 0) + get(Int<1>(), 0l) + get(Int<2>(), 0);
+
+template <typename... Ts> struct Count {
+  static const unsigned value = sizeof...(Ts);
+};
+static_assert(Count<int, int>::value == 2, "");
+static_assert(Count<int, int, int>::value == 3, "");
+static_assert(Count<Count<int>, Count<int, int>>::value == 2, "");
+
+template <typename T> struct IsInt { static const bool value = false; };
+template <> struct IsInt<int> { static const bool value = true; };
+static_assert(IsInt<int>::value && !IsInt<long>::value, "");
+static_assert(!IsInt<Box<int>>::value, "");
+
+// CHECK: *** AST Context Stats:
+// CHECK: {{[1-9][0-9]*}} shared template argument lists
+// CHECK: *** AST Allocations By Source:
+// CHECK-NEXT: {{[1-9][0-9]*}} bytes allocated for parsing
+// CHECK-NEXT: {{[1-9][0-9]*}} bytes allocated for template instantiation
+// CHECK: *** Decl Stats:
+// CHECK: {{[1-9][0-9]*}} decls created by template instantiation.
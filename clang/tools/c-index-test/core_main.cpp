@@ -11,10 +11,13 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/CompilerInvocation.h"
 #include "clang/Frontend/FrontendAction.h"
+#include "clang/Index/BatchIndexer.h"
+#include "clang/Index/IndexStore.h"
 #include "clang/Index/IndexingAction.h"
 #include "clang/Index/IndexDataConsumer.h"
 #include "clang/Index/USRGeneration.h"
 #include "clang/Index/CodegenNameGenerator.h"
+#include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
@@ -31,6 +34,8 @@ namespace {
 enum class ActionType {
   None,
   PrintSourceSymbols,
+  IndexCompilationDatabase,
+  PrintIndexStore,
 };
 
 namespace options {
@@ -42,9 +47,27 @@ Action(cl::desc("Action:"), cl::init(ActionType::None),
        cl::values(
           clEnumValN(ActionType::PrintSourceSymbols,
                      "print-source-symbols", "Print symbols from source"),
+          clEnumValN(ActionType::IndexCompilationDatabase,
+                     "index-compilation-database",
+                     "Index a compilation database into an index store"),
+          clEnumValN(ActionType::PrintIndexStore,
+                     "print-index-store",
+                     "Print the contents of an index store"),
           clEnumValEnd),
        cl::cat(IndexTestCoreCategory));
 
+static cl::opt<std::string>
+BuildPath("build-path", cl::desc("Directory containing compile_commands.json"),
+          cl::cat(IndexTestCoreCategory));
+
+static cl::opt<std::string>
+IndexStorePath("index-store", cl::desc("Path of the index store"),
+               cl::cat(IndexTestCoreCategory));
+
+static cl::opt<unsigned>
+NumThreads("j", cl::desc("Number of translation units to index in parallel"),
+           cl::init(0), cl::cat(IndexTestCoreCategory));
+
 static cl::extrahelp MoreHelp(
   "\nAdd \"-- <compiler arguments>\" at the end to setup the compiler "
   "invocation\n"
@@ -162,6 +185,63 @@ static bool printSourceSymbols(ArrayRef<const char *> Args) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// Index Store
+//===----------------------------------------------------------------------===//
+
+static bool indexCompilationDatabase(StringRef BuildPath,
+                                     StringRef StorePath) {
+  std::string ErrorMessage;
+  std::unique_ptr<tooling::CompilationDatabase> Compilations =
+      tooling::CompilationDatabase::loadFromDirectory(BuildPath, ErrorMessage);
+  if (!Compilations) {
+    errs() << "error: " << ErrorMessage << '\n';
+    return true;
+  }
+
+  BatchIndexingOptions Opts;
+  Opts.NumThreads = options::NumThreads;
+  BatchIndexer Indexer(Opts);
+  Indexer.indexCommands(Compilations->getAllCompileCommands());
+
+  if (std::error_code EC = Indexer.getStore().writeToFile(StorePath)) {
+    errs() << "error: cannot write '" << StorePath << "': " << EC.message()
+           << '\n';
+    return true;
+  }
+
+  outs() << "indexed " << Indexer.getNumIndexedUnits()
+         << " translation units (" << Indexer.getNumUnitsWithErrors()
+         << " with errors, " << Indexer.getNumFailedUnits() << " failed), "
+         << "skipped " << Indexer.getNumSkippedHeaders()
+         << " already indexed headers\n";
+  return Indexer.getNumFailedUnits() != 0;
+}
+
+static bool printIndexStore(StringRef StorePath) {
+  auto Reader = IndexStoreReader::create(StorePath);
+  if (!Reader) {
+    errs() << "error: cannot read '" << StorePath
+           << "': " << Reader.getError().message() << '\n';
+    return true;
+  }
+
+  for (unsigned I = 0, N = (*Reader)->getNumSymbols(); I != N; ++I) {
+    IndexStoreReader::Symbol Sym = (*Reader)->getSymbol(I);
+    outs() << getSymbolKindString(Sym.Kind) << '/'
+           << getSymbolLanguageString(Sym.Lang) << " | " << Sym.Name << " | "
+           << Sym.USR << '\n';
+    (*Reader)->forEachOccurrence(
+        I, [](const IndexStoreReader::Occurrence &Occ) {
+          outs() << '\t' << Occ.File << ':' << Occ.Line << ':' << Occ.Column
+                 << " | ";
+          printSymbolRoles(Occ.Roles, outs());
+          outs() << '\n';
+        });
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 // Helper Utils
 //===----------------------------------------------------------------------===//
@@ -226,5 +306,25 @@ int indextest_core_main(int argc, const char **argv) {
     return printSourceSymbols(CompArgs);
   }
 
+  if (options::Action == ActionType::IndexCompilationDatabase ||
+      options::Action == ActionType::PrintIndexStore) {
+    if (options::IndexStorePath.empty()) {
+      errs() << "error: missing index store; pass '-index-store <path>'\n";
+      return 1;
+    }
+  }
+
+  if (options::Action == ActionType::IndexCompilationDatabase) {
+    if (options::BuildPath.empty()) {
+      errs() << "error: missing build path; pass '-build-path <dir>'\n";
+      return 1;
+    }
+    return indexCompilationDatabase(options::BuildPath,
+                                    options::IndexStorePath);
+  }
+
+  if (options::Action == ActionType::PrintIndexStore)
+    return printIndexStore(options::IndexStorePath);
+
   return 0;
 }
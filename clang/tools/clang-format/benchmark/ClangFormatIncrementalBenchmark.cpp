@@ -0,0 +1,134 @@
+//===-- ClangFormatIncrementalBenchmark.cpp - Format-as-you-type latency --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file implements a tool that measures the latency of formatting
+/// a file after each of a series of edits, as an editor that formats as the
+/// user types does, once with reformat() and once with an
+/// IncrementalFormatter.
+///
+//===----------------------------------------------------------------------===//
+
+#include "clang/Format/Format.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <random>
+
+using namespace llvm;
+using namespace clang;
+using namespace clang::format;
+
+static cl::opt<std::string> InputFile(cl::Positional,
+                                      cl::desc("<file to edit>"),
+                                      cl::Required);
+
+static cl::opt<unsigned> NumEdits("edits",
+                                  cl::desc("The number of edits to simulate"),
+                                  cl::init(100));
+
+static cl::opt<std::string>
+    Style("style", cl::desc("The style to format with, as for clang-format"),
+          cl::init("file"));
+
+static cl::opt<unsigned> Seed("seed",
+                              cl::desc("The seed for the edit positions"),
+                              cl::init(0));
+
+namespace {
+
+typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+/// \brief The time spent formatting after each edit.
+struct Timing {
+  Milliseconds Total = Milliseconds(0);
+  Milliseconds Max = Milliseconds(0);
+
+  void add(Milliseconds Time) {
+    Total += Time;
+    Max = std::max(Max, Time);
+  }
+
+  void print(StringRef Name) const {
+    outs() << llvm::format("%-12s %10.3f ms average %10.3f ms max\n",
+                           Name.str().c_str(), Total.count() / NumEdits,
+                           Max.count());
+  }
+};
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv,
+                              "Measures the latency of formatting a file "
+                              "after each of a series of edits.\n");
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(InputFile);
+  if (std::error_code EC = Buffer.getError()) {
+    errs() << InputFile << ": " << EC.message() << "\n";
+    return 1;
+  }
+  std::string Code = (*Buffer)->getBuffer();
+  FormatStyle FormatStyle = getStyle(Style, InputFile, "LLVM");
+
+  IncrementalFormatter Incremental(FormatStyle, InputFile);
+  Incremental.reformat(Code, {});
+
+  // Insert a statement at the beginning of a random line, and format it.
+  std::mt19937 Random(Seed);
+  Timing Full, Inc;
+  uint64_t ProcessedLength = 0;
+  unsigned Mismatches = 0;
+  for (unsigned I = 0; I != NumEdits; ++I) {
+    unsigned Offset =
+        std::uniform_int_distribution<unsigned>(0, Code.size())(Random);
+    size_t LineStart = StringRef(Code).rfind('\n', Offset);
+    Offset = LineStart == StringRef::npos ? 0 : LineStart + 1;
+    std::string Statement = "int  edit" + std::to_string(I) + "  =  0 ;\n";
+    Code.insert(Offset, Statement);
+    std::vector<tooling::Range> Ranges(
+        1, tooling::Range(Offset, Statement.size() - 1));
+
+    auto Start = std::chrono::steady_clock::now();
+    tooling::Replacements FullResult =
+        reformat(FormatStyle, Code, Ranges, InputFile);
+    auto Middle = std::chrono::steady_clock::now();
+    tooling::Replacements IncResult = Incremental.reformat(Code, Ranges);
+    auto End = std::chrono::steady_clock::now();
+
+    Full.add(Middle - Start);
+    Inc.add(End - Middle);
+    ProcessedLength += Incremental.getLastProcessedLength();
+    if (FullResult != IncResult)
+      ++Mismatches;
+
+    // Apply the replacements, as the editor would.
+    auto NewCode = tooling::applyAllReplacements(Code, FullResult);
+    if (!NewCode) {
+      errs() << toString(NewCode.takeError()) << "\n";
+      return 1;
+    }
+    Code = std::move(*NewCode);
+  }
+
+  outs() << NumEdits << " edits of a " << Code.size() << " byte file\n";
+  Full.print("reformat");
+  Inc.print("incremental");
+  outs() << llvm::format(
+      "incremental formatting processed %.1f%% of the code\n",
+      100.0 * ProcessedLength / NumEdits / Code.size());
+  if (Mismatches) {
+    errs() << Mismatches << " edits were formatted differently\n";
+    return 1;
+  }
+  return 0;
+}
@@ -29,9 +29,12 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
@@ -64,6 +67,31 @@ void initializePollyPasses(llvm::PassRegistry &Registry);
 }
 #endif
 
+/// \brief Write the -ftime-trace output next to the output file, or next to
+/// the input file when writing to stdout.
+static void writeTimeTrace(CompilerInstance &Clang) {
+  const FrontendOptions &FrontendOpts = Clang.getFrontendOpts();
+  SmallString<128> Path(FrontendOpts.OutputFile);
+  if ((Path.empty() || Path == "-") && !FrontendOpts.Inputs.empty())
+    Path = llvm::sys::path::filename(FrontendOpts.Inputs[0].getFile());
+  if (Path.empty() || Path == "-")
+    return;
+  llvm::sys::path::replace_extension(Path, "json");
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_Text);
+  if (EC) {
+    Clang.getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+        << Path << EC.message();
+    return;
+  }
+  llvm::timeTraceProfilerWrite(OS);
+
+  if (FrontendOpts.TimeTraceSummary)
+    llvm::timeTraceProfilerPrintSummary(llvm::errs(),
+                                        FrontendOpts.TimeTraceSummary);
+}
+
 int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   std::unique_ptr<CompilerInstance> Clang(new CompilerInstance());
   IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
@@ -112,9 +140,18 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   if (!Success)
     return 1;
 
+  const FrontendOptions &FrontendOpts = Clang->getFrontendOpts();
+  if (FrontendOpts.TimeTrace)
+    llvm::timeTraceProfilerInitialize(FrontendOpts.TimeTraceGranularity);
+
   // Execute the frontend actions.
   Success = ExecuteCompilerInvocation(Clang.get());
 
+  if (llvm::timeTraceProfilerEnabled()) {
+    writeTimeTrace(*Clang);
+    llvm::timeTraceProfilerCleanup();
+  }
+
   // If any timers were active but haven't been destroyed yet, print their
   // results now.  This happens in -disable-free mode.
   llvm::TimerGroup::printAll(llvm::errs());
@@ -16,6 +16,7 @@
 #define LLVM_CLANG_TOOLS_LIBCLANG_CINDEXER_H
 
 #include "clang-c/Index.h"
+#include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/PCHContainerOperations.h"
 #include "llvm/ADT/STLExtras.h"
 #include <utility>
@@ -40,11 +41,22 @@ class CIndexer {
   std::string ResourcesPath;
   std::shared_ptr<PCHContainerOperations> PCHContainerOps;
 
+  /// \brief Precompiled preambles shared by the translation units of this
+  /// index.
+  std::shared_ptr<PrecompiledPreambleCache> PreambleCache;
+
 public:
   CIndexer(std::shared_ptr<PCHContainerOperations> PCHContainerOps =
                std::make_shared<PCHContainerOperations>())
       : OnlyLocalDecls(false), DisplayDiagnostics(false),
-        Options(CXGlobalOpt_None), PCHContainerOps(std::move(PCHContainerOps)) {
+        Options(CXGlobalOpt_None), PCHContainerOps(std::move(PCHContainerOps)),
+        PreambleCache(std::make_shared<PrecompiledPreambleCache>()) {
+  }
+
+  ~CIndexer() {
+    // Units disposed of after their index keep their preambles, but no
+    // longer share them with each other.
+    PreambleCache->clear();
   }
 
   /// \brief Whether we only want to see "local" declarations (that did not
@@ -62,6 +74,10 @@ public:
     return PCHContainerOps;
   }
 
+  std::shared_ptr<PrecompiledPreambleCache> getPreambleCache() const {
+    return PreambleCache;
+  }
+
   unsigned getCXGlobalOptFlags() const { return Options; }
   void setCXGlobalOptFlags(unsigned options) { Options = options; }
 
@@ -119,6 +119,72 @@ TEST(MatchFinder, CheckProfiling) {
   EXPECT_EQ("MyID", Records.begin()->getKey());
 }
 
+static std::vector<std::string>
+requiredNames(const internal::DynTypedMatcher &M) {
+  SmallVector<StringRef, 4> Names;
+  if (!M.getRequiredNames(Names))
+    return {"<any>"};
+  return std::vector<std::string>(Names.begin(), Names.end());
+}
+
+TEST(DynTypedMatcher, RequiredNames) {
+  typedef std::vector<std::string> V;
+  EXPECT_EQ(V({"f"}), requiredNames(functionDecl(hasName("f"))));
+  EXPECT_EQ(V({"f"}), requiredNames(functionDecl(hasName("::a::f"))));
+  EXPECT_EQ(V({"f"}), requiredNames(functionDecl(hasName("f")).bind("x")));
+  EXPECT_EQ(V({"f", "g"}), requiredNames(namedDecl(hasAnyName("f", "a::g"))));
+  EXPECT_EQ(V({"f", "g"}),
+            requiredNames(decl(anyOf(functionDecl(hasName("f")),
+                                     varDecl(hasName("g"))))));
+  EXPECT_EQ(V({"f"}), requiredNames(namedDecl(hasAnyName("g", "h"),
+                                              hasName("f"), isImplicit())));
+
+  EXPECT_EQ(V({"<any>"}), requiredNames(functionDecl()));
+  EXPECT_EQ(V({"<any>"}), requiredNames(functionDecl(unless(hasName("f")))));
+  EXPECT_EQ(V({"<any>"}),
+            requiredNames(decl(anyOf(functionDecl(hasName("f")), varDecl()))));
+  EXPECT_EQ(V({"<any>"}), requiredNames(functionDecl(hasName("operator+"))));
+  EXPECT_EQ(V({"<any>"}), requiredNames(recordDecl(hasName("S<int>"))));
+}
+
+TEST(MatchFinder, DispatchesOnRequiredNames) {
+  struct RecordingCallback : public MatchFinder::MatchCallback {
+    RecordingCallback(StringRef ID, std::vector<std::string> &Log)
+        : ID(ID), Log(Log) {}
+    void run(const MatchFinder::MatchResult &Result) override {
+      const auto *D = Result.Nodes.getNodeAs<NamedDecl>("d");
+      Log.push_back(ID + ":" + D->getNameAsString());
+    }
+    std::string ID;
+    std::vector<std::string> &Log;
+  };
+
+  std::vector<std::string> Log;
+  RecordingCallback First("1", Log), Second("2", Log), Third("3", Log),
+      Fourth("4", Log);
+  MatchFinder Finder;
+  Finder.addMatcher(functionDecl(hasName("::n::f")).bind("d"), &First);
+  Finder.addMatcher(functionDecl(isDefinition()).bind("d"), &Second);
+  Finder.addMatcher(decl(anyOf(functionDecl(hasName("g")),
+                               cxxConstructorDecl(hasName("S"))))
+                        .bind("d"),
+                    &Third);
+  Finder.addMatcher(functionDecl(hasName("f")).bind("d"), &Fourth);
+  std::unique_ptr<FrontendActionFactory> Factory(
+      newFrontendActionFactory(&Finder));
+  ASSERT_TRUE(tooling::runToolOnCode(
+      Factory->create(),
+      "namespace n { void f() {} void g(); }\n"
+      "void f();\n"
+      "struct S { S(); };\n"));
+
+  // Callbacks still run in the order in which their matchers were added, and
+  // the constructor, which has no identifier, is still matched by name.
+  EXPECT_EQ(
+      std::vector<std::string>({"1:f", "2:f", "4:f", "3:g", "4:f", "3:S"}),
+      Log);
+}
+
 class VerifyStartOfTranslationUnit : public MatchFinder::MatchCallback {
 public:
   VerifyStartOfTranslationUnit() : Called(false) {}
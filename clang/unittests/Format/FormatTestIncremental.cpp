@@ -0,0 +1,153 @@
+//===- unittest/Format/FormatTestIncremental.cpp - Formatting unit tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Format/Format.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace format {
+namespace {
+
+class FormatTestIncremental : public ::testing::Test {
+protected:
+  /// \brief Formats [Offset, Offset + Length) of \p Code both with the
+  /// incremental formatter and with reformat(), and returns the number of
+  /// bytes the incremental formatter processed.
+  unsigned verify(llvm::StringRef Code, unsigned Offset, unsigned Length) {
+    if (!Formatter)
+      Formatter.reset(new IncrementalFormatter(Style));
+    std::vector<tooling::Range> Ranges(1, tooling::Range(Offset, Length));
+
+    bool ExpectedIncomplete = false;
+    auto Expected = applyAllReplacements(
+        Code, reformat(Style, Code, Ranges, "<stdin>", &ExpectedIncomplete));
+    bool ActualIncomplete = false;
+    auto Actual = applyAllReplacements(
+        Code, Formatter->reformat(Code, Ranges, &ActualIncomplete));
+    EXPECT_TRUE(static_cast<bool>(Expected));
+    EXPECT_TRUE(static_cast<bool>(Actual));
+    EXPECT_EQ(*Expected, *Actual) << Code;
+    EXPECT_EQ(ExpectedIncomplete, ActualIncomplete) << Code;
+    return Formatter->getLastProcessedLength();
+  }
+
+  /// \brief Returns \p N functions separated by empty lines.
+  static std::string functions(unsigned N) {
+    std::string Code;
+    for (unsigned I = 0; I != N; ++I)
+      Code += "int f" + std::to_string(I) + "(int a) {\n  return a;\n}\n\n";
+    return Code;
+  }
+
+  FormatStyle Style = getLLVMStyle();
+  std::unique_ptr<IncrementalFormatter> Formatter;
+};
+
+TEST_F(FormatTestIncremental, OnlyProcessesChangedRegions) {
+  std::string Code = functions(20);
+  EXPECT_EQ(Code.size(), verify(Code, 0, 0));
+
+  unsigned Middle = Code.find("return a;", Code.size() / 2);
+  Code.insert(Middle, "a  =  1 ;\n");
+  EXPECT_GT(Code.size() / 4, verify(Code, Middle, 10));
+  // Formatting the same code again.
+  EXPECT_GT(Code.size() / 4, verify(Code, Middle, 10));
+
+  // Edits at the beginning and the end of the file.
+  Code.insert(0, "int  x;\n\n");
+  EXPECT_GT(Code.size() / 4, verify(Code, 0, 8));
+  Code += "int  y;\n";
+  EXPECT_GT(Code.size() / 4, verify(Code, Code.size() - 8, 8));
+
+  // Removing the empty line between two regions merges them.
+  unsigned Gap = Code.find("}\n\nint f10");
+  Code.erase(Gap + 1, 1);
+  EXPECT_GT(Code.size() / 4, verify(Code, Gap, 0));
+}
+
+TEST_F(FormatTestIncremental, UnbalancedEdits) {
+  std::string Code = functions(10);
+  verify(Code, 0, 0);
+
+  // An unterminated block changes the indentation of everything after it.
+  unsigned Position = Code.find("int f4");
+  Code.insert(Position, "void g() {\n");
+  EXPECT_EQ(Code.size(), verify(Code, 0, Code.size()));
+  Code.erase(Position, 11);
+  verify(Code, 0, Code.size());
+
+  // So does an unterminated comment.
+  Code.insert(Position, "/* ");
+  verify(Code, Position, 3);
+  Code.erase(Position, 3);
+  verify(Code, Position, 0);
+}
+
+TEST_F(FormatTestIncremental, Namespaces) {
+  std::string Code =
+      "namespace n {\n\n" + functions(10) + "} // namespace n\n";
+  verify(Code, 0, 0);
+
+  unsigned Position = Code.find("int f5");
+  Code.insert(Position, "int   g;\n\n");
+  EXPECT_GT(Code.size() / 2, verify(Code, Position, 8));
+
+  // Closing the namespace early moves all the functions after it out of it.
+  Code.insert(Position, "}\n\n");
+  verify(Code, Position, 1);
+  Code.erase(Position, 3);
+  verify(Code, Position, 0);
+}
+
+TEST_F(FormatTestIncremental, IncludeGuards) {
+  std::string Code =
+      "#ifndef A_H\n#define A_H\n\n" + functions(10) + "#endif\n";
+  verify(Code, 0, 0);
+
+  unsigned Position = Code.find("return a;", Code.size() / 2);
+  Code.insert(Position, "a=2;\n");
+  EXPECT_GT(Code.size() / 2, verify(Code, Position, 5));
+}
+
+TEST_F(FormatTestIncremental, ProcessesCodeWithBranchesAsAWhole) {
+  std::string Code =
+      "#if A\nint a;\n#else\nint b;\n#endif\n\n" + functions(10);
+  verify(Code, 0, 0);
+
+  unsigned Position = Code.find("return a;", Code.size() / 2);
+  Code.insert(Position, "a=2;\n");
+  EXPECT_EQ(Code.size(), verify(Code, Position, 5));
+}
+
+TEST_F(FormatTestIncremental, DerivesStyleFromTheWholeFile) {
+  Style.DerivePointerAlignment = true;
+  std::string Code = "int *a;\n\nint *b;\n\nint* c;\n\n" + functions(10);
+  verify(Code, 0, 0);
+
+  // Each edit changes the pointer alignment that is derived from the file.
+  unsigned Position = Code.find("int f8");
+  Code.insert(Position, "int* d;\nint* e;\n\n");
+  EXPECT_GT(Code.size() / 2, verify(Code, Position, 16));
+  Code.insert(Position, "int *f;\nint *g;\nint *h;\n\n");
+  EXPECT_GT(Code.size() / 2, verify(Code, Position, 24));
+  Code.erase(Position, 24);
+  verify(Code, Position, 0);
+}
+
+TEST_F(FormatTestIncremental, FallsBackForOtherLanguages) {
+  Style = getGoogleStyle(FormatStyle::LK_JavaScript);
+  std::string Code = "var a = 1;\n\nvar b = 2;\n\nvar c = 3;\n";
+  verify(Code, 0, 0);
+  Code.insert(Code.find("var b"), "var  x;\n");
+  EXPECT_EQ(Code.size(), verify(Code, 0, 0));
+}
+
+} // end namespace
+} // end namespace format
+} // end namespace clang
@@ -0,0 +1,74 @@
+//===- unittests/Frontend/ModuleBuildServiceTest.cpp - ModuleBuildService -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/ModuleBuildService.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace clang;
+
+namespace {
+
+TEST(ModuleBuildService, FirstRequestOwnsBuild) {
+  ModuleBuildService Builds;
+  EXPECT_FALSE(Builds.isBuilding("A.pcm"));
+  EXPECT_EQ(ModuleBuildService::BS_Owned, Builds.beginBuild("A.pcm"));
+  EXPECT_TRUE(Builds.isBuilding("A.pcm"));
+
+  // Builds of different module files are independent.
+  EXPECT_EQ(ModuleBuildService::BS_Owned, Builds.beginBuild("B.pcm"));
+  Builds.endBuild("B.pcm", true);
+  Builds.endBuild("A.pcm", true);
+  EXPECT_FALSE(Builds.isBuilding("A.pcm"));
+
+  // Once a build is finished, a new request builds the module again.
+  EXPECT_EQ(ModuleBuildService::BS_Owned, Builds.beginBuild("A.pcm"));
+  Builds.endBuild("A.pcm", false);
+  EXPECT_EQ(0u, Builds.getNumDeduplicatedRequests());
+}
+
+#if LLVM_ENABLE_THREADS
+static void waitForWaiters(ModuleBuildService &Builds, unsigned N) {
+  while (Builds.getNumDeduplicatedRequests() < N)
+    std::this_thread::yield();
+}
+
+TEST(ModuleBuildService, ConcurrentRequestsWaitForOwner) {
+  ModuleBuildService Builds;
+  ASSERT_EQ(ModuleBuildService::BS_Owned, Builds.beginBuild("A.pcm"));
+
+  ModuleBuildService::BuildStatus Status1, Status2;
+  std::thread Waiter1([&] { Status1 = Builds.beginBuild("A.pcm"); });
+  std::thread Waiter2([&] { Status2 = Builds.beginBuild("A.pcm"); });
+  waitForWaiters(Builds, 2);
+
+  Builds.endBuild("A.pcm", true);
+  Waiter1.join();
+  Waiter2.join();
+  EXPECT_EQ(ModuleBuildService::BS_BuiltByOther, Status1);
+  EXPECT_EQ(ModuleBuildService::BS_BuiltByOther, Status2);
+  EXPECT_FALSE(Builds.isBuilding("A.pcm"));
+}
+
+TEST(ModuleBuildService, ConcurrentRequestsSeeFailure) {
+  ModuleBuildService Builds;
+  ASSERT_EQ(ModuleBuildService::BS_Owned, Builds.beginBuild("A.pcm"));
+
+  ModuleBuildService::BuildStatus Status;
+  std::thread Waiter([&] { Status = Builds.beginBuild("A.pcm"); });
+  waitForWaiters(Builds, 1);
+
+  Builds.endBuild("A.pcm", false);
+  Waiter.join();
+  EXPECT_EQ(ModuleBuildService::BS_FailedByOther, Status);
+}
+#endif
+
+} // anonymous namespace
@@ -0,0 +1,100 @@
+//===- unittests/Frontend/PrecompiledPreambleCacheTest.cpp ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+class PrecompiledPreambleCacheTest : public ::testing::Test {
+protected:
+  SmallString<128> Dir;
+  std::vector<std::string> Files;
+  std::string MainFile;
+  std::shared_ptr<PCHContainerOperations> PCHContainerOps =
+      std::make_shared<PCHContainerOperations>();
+  std::shared_ptr<PrecompiledPreambleCache> Cache =
+      std::make_shared<PrecompiledPreambleCache>();
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("preamble-cache-test", Dir));
+    writeFile("header.h", "struct Foo { int bar; };\n");
+    MainFile = writeFile("main.cpp", "#include \"header.h\"\n"
+                                     "int main() { Foo foo; foo.bar = 7; }\n");
+  }
+
+  void TearDown() override {
+    for (const std::string &File : Files)
+      sys::fs::remove(File);
+    sys::fs::remove(Dir);
+  }
+
+  std::string writeFile(StringRef Name, StringRef Contents) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Name);
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+    EXPECT_FALSE(EC);
+    OS << Contents;
+    Files.push_back(Path.str());
+    return Path.str();
+  }
+
+  /// Parse the main file into a unit that precompiles its preamble on the
+  /// first parse, through the shared cache.
+  std::unique_ptr<ASTUnit> parse() {
+    const char *Args[] = {"clang", "-xc++", MainFile.c_str()};
+    IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+        CompilerInstance::createDiagnostics(new DiagnosticOptions());
+    std::unique_ptr<ASTUnit> Unit(ASTUnit::LoadFromCommandLine(
+        std::begin(Args), std::end(Args), PCHContainerOps, Diags, "",
+        /*OnlyLocalDecls=*/false, /*CaptureDiagnostics=*/true, None,
+        /*RemappedFilesKeepOriginalName=*/true,
+        /*PrecompilePreambleAfterNParses=*/1, TU_Complete,
+        /*CacheCodeCompletionResults=*/false,
+        /*IncludeBriefCommentsInCodeCompletion=*/false,
+        /*AllowPCHWithCompilerErrors=*/false, /*SkipFunctionBodies=*/false,
+        /*UserFilesAreVolatile=*/false, /*ForSerialization=*/false,
+        /*ModuleFormat=*/None, /*ErrAST=*/nullptr, Cache));
+    EXPECT_TRUE(Unit != nullptr);
+    return Unit;
+  }
+};
+
+TEST_F(PrecompiledPreambleCacheTest, UnitsShareThePreamble) {
+  std::unique_ptr<ASTUnit> First = parse();
+  std::unique_ptr<ASTUnit> Second = parse();
+  EXPECT_EQ(1u, Cache->getNumMisses());
+  EXPECT_EQ(1u, Cache->getNumHits());
+
+  // The preamble stays usable after the unit that built it is gone.
+  First.reset();
+  ASSERT_FALSE(Second->Reparse(PCHContainerOps));
+  EXPECT_EQ(1u, Cache->getNumMisses());
+}
+
+TEST_F(PrecompiledPreambleCacheTest, PreambleIsRebuiltAfterItsUnitsAreGone) {
+  // The cache does not keep the preamble of a destroyed unit alive, so the
+  // next unit for the file builds it again.
+  parse().reset();
+  std::unique_ptr<ASTUnit> Unit = parse();
+  EXPECT_EQ(2u, Cache->getNumMisses());
+  EXPECT_EQ(0u, Cache->getNumHits());
+}
+
+} // anonymous namespace
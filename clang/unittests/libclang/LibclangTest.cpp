@@ -494,3 +494,30 @@ TEST_F(LibclangReparseTest, clang_parseTranslationUnit2FullArgv) {
   EXPECT_EQ(0U, clang_getNumDiagnostics(ClangTU));
   DisplayDiagnostics();
 }
+
+TEST_F(LibclangReparseTest, SharedPreambleOutlivesFirstUnit) {
+  const char *HeaderFile = "#ifndef H\n#define H\nstruct Foo { int bar; };\n"
+                           "#endif\n";
+  const char *CppFile = "#include \"HeaderFile.h\"\nint main() {"
+                        " Foo foo; foo.bar = 7; foo.baz = 8; }\n";
+  std::string HeaderName = "HeaderFile.h";
+  std::string CppName = "CppFile.cpp";
+  WriteFile(CppName, CppFile);
+  WriteFile(HeaderName, HeaderFile);
+
+  // Two units for the same file in one index end up sharing the precompiled
+  // preamble built by whichever of them reparses first.
+  CXTranslationUnit OtherTU = clang_parseTranslationUnit(
+      Index, CppName.c_str(), nullptr, 0, nullptr, 0, TUFlags);
+  ClangTU = clang_parseTranslationUnit(Index, CppName.c_str(), nullptr, 0,
+                                       nullptr, 0, TUFlags);
+  ASSERT_FALSE(clang_reparseTranslationUnit(
+      OtherTU, 0, nullptr, clang_defaultReparseOptions(OtherTU)));
+  ASSERT_TRUE(ReparseTU(0, nullptr /* No unsaved files. */));
+  EXPECT_EQ(1U, clang_getNumDiagnostics(ClangTU));
+
+  // The preamble must stay usable after the unit that built it is gone.
+  clang_disposeTranslationUnit(OtherTU);
+  ASSERT_TRUE(ReparseTU(0, nullptr /* No unsaved files. */));
+  EXPECT_EQ(1U, clang_getNumDiagnostics(ClangTU));
+}
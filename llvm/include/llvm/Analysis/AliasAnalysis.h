@@ -38,6 +38,8 @@
 #ifndef LLVM_ANALYSIS_ALIASANALYSIS_H
 #define LLVM_ANALYSIS_ALIASANALYSIS_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/PassManager.h"
@@ -167,7 +169,9 @@ class AAResults {
 public:
   // Make these results default constructable and movable. We have to spell
   // these out because MSVC won't synthesize them.
-  AAResults(const TargetLibraryInfo &TLI) : TLI(TLI) {}
+  AAResults(const TargetLibraryInfo &TLI)
+      : TLI(TLI), QueryDepth(0), NumCacheScopes(0), CacheEpoch(0),
+        CurCacheStats(nullptr) {}
   AAResults(AAResults &&Arg);
   ~AAResults();
 
@@ -179,6 +183,58 @@ public:
     AAs.emplace_back(new Model<AAResultT>(AAResult, *this));
   }
 
+  //===--------------------------------------------------------------------===//
+  /// \name Query Caching
+  /// @{
+
+  /// Hit and miss counters of the query cache for one client.
+  struct QueryCacheStats {
+    unsigned AliasHits = 0;
+    unsigned AliasMisses = 0;
+    unsigned DecomposedGEPHits = 0;
+    unsigned DecomposedGEPMisses = 0;
+  };
+
+  /// \brief An RAII object that caches alias query results while it is alive.
+  ///
+  /// The client creating the scope promises not to modify the IR of the
+  /// function until the scope ends. Within it, the results of top-level
+  /// \c alias queries are remembered, and the aggregated alias analyses may
+  /// keep their own intermediate results (BasicAA keeps decomposed GEPs).
+  /// Scopes nest, so an analysis built by a pass can share the cache of that
+  /// pass. All cached results are dropped when the outermost scope ends.
+  /// Caching a query costs a hash table lookup and insertion, so only open a
+  /// scope around a batch of queries that repeat, such as alias set
+  /// construction.
+  ///
+  /// \p Client names the scope in the hit and miss counts printed with
+  /// -aa-query-cache-stats.
+  class QueryCacheScope {
+    AAResults &AAR;
+    QueryCacheStats *PrevStats;
+
+  public:
+    QueryCacheScope(AAResults &AAR, StringRef Client);
+    ~QueryCacheScope();
+  };
+
+  /// Returns true if a query cache scope is active.
+  bool isCachingQueries() const { return NumCacheScopes != 0; }
+
+  /// Returns a nonzero number identifying the outermost active query cache
+  /// scope, or zero if none is active. Alias analyses that keep their own
+  /// caches use it to notice that those caches are stale.
+  unsigned getQueryCacheEpoch() const { return CacheEpoch; }
+
+  /// Returns the counters of the client of the innermost active query cache
+  /// scope.
+  QueryCacheStats &getQueryCacheStats() {
+    assert(CurCacheStats && "No active query cache scope!");
+    return *CurCacheStats;
+  }
+
+  /// @}
+
   //===--------------------------------------------------------------------===//
   /// \name Alias Queries
   /// @{
@@ -571,6 +627,26 @@ private:
   const TargetLibraryInfo &TLI;
 
   std::vector<std::unique_ptr<Concept>> AAs;
+
+  /// Ask the aggregated alias analyses, bypassing the query cache.
+  AliasResult aliasUncached(const MemoryLocation &LocA,
+                            const MemoryLocation &LocB);
+
+  /// The nesting depth of the \c alias queries being answered. Only the
+  /// results of top-level queries are cached; nested queries made by an alias
+  /// analysis while it recurses may depend on assumptions it made.
+  unsigned QueryDepth;
+
+  /// The number of active query cache scopes and the epoch of the outermost.
+  unsigned NumCacheScopes;
+  unsigned CacheEpoch;
+
+  typedef std::pair<MemoryLocation, MemoryLocation> LocPair;
+  DenseMap<LocPair, AliasResult> AliasQueryCache;
+
+  /// Counters for each client of the active query cache scopes.
+  StringMap<QueryCacheStats> CacheStats;
+  QueryCacheStats *CurCacheStats;
 };
 
 /// Temporary typedef for legacy code that uses a generic \c AliasAnalysis
@@ -773,6 +849,10 @@ protected:
   AAResultBase(const AAResultBase &Arg) {}
   AAResultBase(AAResultBase &&Arg) {}
 
+  /// Get the aggregation this result is part of, or null if it is used in
+  /// isolation.
+  AAResults *getAAResults() const { return AAR; }
+
   /// Get a proxy for the best AA result set to query at this time.
   ///
   /// When this result is part of a larger aggregation, this will proxy to that
@@ -14,6 +14,7 @@
 #ifndef LLVM_ANALYSIS_BASICALIASANALYSIS_H
 #define LLVM_ANALYSIS_BASICALIASANALYSIS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -49,14 +50,15 @@ public:
   BasicAAResult(const DataLayout &DL, const TargetLibraryInfo &TLI,
                 AssumptionCache &AC, DominatorTree *DT = nullptr,
                 LoopInfo *LI = nullptr)
-      : AAResultBase(), DL(DL), TLI(TLI), AC(AC), DT(DT), LI(LI) {}
+      : AAResultBase(), DL(DL), TLI(TLI), AC(AC), DT(DT), LI(LI),
+        QueryCacheEpoch(0) {}
 
   BasicAAResult(const BasicAAResult &Arg)
       : AAResultBase(Arg), DL(Arg.DL), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
-        LI(Arg.LI) {}
+        LI(Arg.LI), QueryCacheEpoch(0) {}
   BasicAAResult(BasicAAResult &&Arg)
       : AAResultBase(std::move(Arg)), DL(Arg.DL), TLI(Arg.TLI), AC(Arg.AC),
-        DT(Arg.DT), LI(Arg.LI) {}
+        DT(Arg.DT), LI(Arg.LI), QueryCacheEpoch(0) {}
 
   /// Handle invalidation events from the new pass manager.
   ///
@@ -123,6 +125,17 @@ private:
     SmallVector<VariableGEPIndex, 4> VarIndices;
   };
 
+  /// Decomposed GEPs, reused across queries while the aggregation this result
+  /// is part of has a query cache scope active. The flag of each entry is the
+  /// result of DecomposeGEPExpression.
+  DenseMap<const Value *, std::pair<DecomposedGEP, bool>> DecomposedGEPCache;
+
+  /// Underlying objects of pointers, cached like DecomposedGEPCache.
+  DenseMap<const Value *, const Value *> UnderlyingObjectCache;
+
+  /// The query cache epoch the entries of the caches above belong to.
+  unsigned QueryCacheEpoch;
+
   /// Track alias queries to guard against recursion.
   typedef std::pair<MemoryLocation, MemoryLocation> LocPair;
   typedef SmallDenseMap<LocPair, AliasResult, 8> AliasCacheTy;
@@ -156,6 +169,18 @@ private:
   static bool DecomposeGEPExpression(const Value *V, DecomposedGEP &Decomposed,
       const DataLayout &DL, AssumptionCache *AC, DominatorTree *DT);
 
+  /// Returns true if a query cache scope is active, dropping the cached
+  /// results of an earlier scope.
+  bool useQueryCaches();
+
+  /// Decompose \p V with DecomposeGEPExpression, reusing an earlier result if
+  /// a query cache scope is active.
+  bool decomposeGEP(const Value *V, DecomposedGEP &Decomposed);
+
+  /// Returns GetUnderlyingObject(V), reusing an earlier result if a query
+  /// cache scope is active.
+  const Value *getUnderlyingObject(const Value *V);
+
   static bool isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
       const DecomposedGEP &DecompGEP, const DecomposedGEP &DecompObject,
       uint64_t ObjectAccessSize);
@@ -14,10 +14,12 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include <cassert>
 #include <climits>
+#include <memory>
 
 namespace llvm {
 class AssumptionCacheTracker;
@@ -100,6 +102,42 @@ public:
   int getCostDelta() const { return Threshold - getCost(); }
 };
 
+/// \brief Caches the call site independent part of the inline cost analysis.
+///
+/// Most of the work of analyzing a call site is a walk over the callee body,
+/// and for a call site which tells us nothing about its arguments (no
+/// constants, no caller allocas, no aliasing pointer arguments) that walk is
+/// the same every time. The cache keeps a summary of it per callee which is
+/// computed on first use and replayed for every such call site, together with
+/// the callee's ephemeral values which are needed by every call site.
+///
+/// The cache does not observe changes to the IR, only the deletion of a
+/// function. Clients must invalidate the summary of a function whenever they
+/// change its body, for example by inlining into it.
+class InlineCostCache {
+public:
+  /// \brief The cached analysis of a single callee. Its layout is private to
+  /// the inline cost analysis.
+  struct Summary;
+
+  InlineCostCache();
+  InlineCostCache(InlineCostCache &&Arg);
+  InlineCostCache &operator=(InlineCostCache &&RHS);
+  ~InlineCostCache();
+
+  /// \brief Get the summary of \p F, creating an empty one if necessary.
+  Summary &getSummary(Function &F);
+
+  /// \brief Forget everything known about \p F.
+  void invalidate(Function &F);
+
+  /// \brief Forget everything known about every function.
+  void clear();
+
+private:
+  DenseMap<Function *, std::unique_ptr<Summary>> Summaries;
+};
+
 /// \brief Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -110,11 +148,13 @@ public:
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
+/// inlining the callsite. It is an expensive, heavyweight call. When a \p
+/// Cache is provided, the parts of the analysis which only depend on the
+/// callee are computed once per callee and reused.
 InlineCost
 getInlineCost(CallSite CS, int DefaultThreshold, TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
-              ProfileSummaryInfo *PSI);
+              ProfileSummaryInfo *PSI, InlineCostCache *Cache = nullptr);
 
 /// \brief Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
@@ -125,7 +165,7 @@ InlineCost
 getInlineCost(CallSite CS, Function *Callee, int DefaultThreshold,
               TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
-              ProfileSummaryInfo *PSI);
+              ProfileSummaryInfo *PSI, InlineCostCache *Cache = nullptr);
 
 int computeThresholdFromOptLevels(unsigned OptLevel, unsigned SizeOptLevel);
 
@@ -510,6 +510,15 @@ namespace llvm {
     ///
     ValueExprMapType ValueExprMap;
 
+    /// The number of getSCEV calls that are currently creating a new SCEV.
+    unsigned CreationDepth;
+
+    /// The values that the creation depth limit made unknown during the
+    /// current outermost getSCEV call. Whether a value hits the limit depends
+    /// on where the query started, so they are forgotten when the outermost
+    /// call returns.
+    SmallVector<Value *, 4> DepthLimitedValues;
+
     /// Mark predicate values currently being processed by isImpliedCond.
     DenseSet<Value*> PendingLoopPredicates;
 
@@ -1201,29 +1210,41 @@ namespace llvm {
     const SCEV *getZeroExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getSignExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getAnyExtendExpr(const SCEV *Op, Type *Ty);
+    /// Get a canonical add expression, or something simpler if possible.
+    /// \p Depth is the number of enclosing getAddExpr and getMulExpr calls;
+    /// past -scalar-evolution-max-arith-depth the operands are combined
+    /// without further simplification.
     const SCEV *getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getAddExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops = {LHS, RHS};
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
     const SCEV *getAddExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops = {Op0, Op1, Op2};
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
+    /// Get a canonical multiply expression, or something simpler if possible.
+    /// \p Depth is used like for getAddExpr.
     const SCEV *getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getMulExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops = {LHS, RHS};
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getMulExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops = {Op0, Op1, Op2};
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getUDivExpr(const SCEV *LHS, const SCEV *RHS);
     const SCEV *getUDivExactExpr(const SCEV *LHS, const SCEV *RHS);
@@ -1279,7 +1300,8 @@ namespace llvm {
 
     /// Return LHS-RHS.  Minus is represented in SCEV as A+B*-1.
     const SCEV *getMinusSCEV(const SCEV *LHS, const SCEV *RHS,
-                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                             unsigned Depth = 0);
 
     /// Return a SCEV corresponding to a conversion of the input value to the
     /// specified type.  If the type must be extended, it is zero extended.
@@ -1661,7 +1683,40 @@ namespace llvm {
     bool doesIVOverflowOnGT(const SCEV *RHS, const SCEV *Stride,
                             bool IsSigned, bool NoWrap);
 
+  public:
+    /// Counters describing how much work this instance has done, and how
+    /// often it gave up on simplifying an expression because of one of the
+    /// compile time limits.
+    struct CostStats {
+      unsigned UniqueSCEVHits = 0;
+      unsigned UniqueSCEVMisses = 0;
+      unsigned ValueExprMapHits = 0;
+      unsigned ValueExprMapMisses = 0;
+      unsigned MaxCreationDepth = 0;
+      unsigned ArithDepthLimitHits = 0;
+      unsigned CreationDepthLimitHits = 0;
+      unsigned ExprSizeLimitHits = 0;
+    };
+
+    const CostStats &getCostStats() const { return Stats; }
+
+    /// Print a one line summary of the cost statistics for the function.
+    void printCostReport(raw_ostream &OS) const;
+
   private:
+    /// Return the uniqued SCEV with the given profile, or null after setting
+    /// \p IP to where a new one should be inserted.
+    SCEV *findUniqueSCEV(const FoldingSetNodeID &ID, void *&IP);
+
+    /// Return the add expression with exactly the operands \p Ops.
+    const SCEV *getOrCreateAddExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
+    /// Return the multiply expression with exactly the operands \p Ops.
+    const SCEV *getOrCreateMulExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
+    CostStats Stats;
     FoldingSet<SCEV> UniqueSCEVs;
     FoldingSet<SCEVPredicate> UniquePreds;
     BumpPtrAllocator SCEVAllocator;
@@ -201,6 +201,13 @@ public:
   /// Get the entry count for this function.
   Optional<uint64_t> getEntryCount() const;
 
+  /// Set the section prefix for this function, such as ".hot" or
+  /// ".unlikely".
+  void setSectionPrefix(StringRef Prefix);
+
+  /// Get the section prefix for this function.
+  Optional<StringRef> getSectionPrefix() const;
+
   /// @brief Return true if the function has the attribute.
   bool hasFnAttribute(Attribute::AttrKind Kind) const {
     return AttributeSets.hasFnAttribute(Kind);
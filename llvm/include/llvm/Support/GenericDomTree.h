@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -27,6 +28,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <queue>
 
 namespace llvm {
 
@@ -209,6 +211,7 @@ template <class NodeT> class DominatorTreeBase : public DominatorBase<NodeT> {
     IDoms.clear();
     Vertex.clear();
     Info.clear();
+    PendingUpdates.clear();
     RootNode = nullptr;
   }
 
@@ -238,11 +241,22 @@ protected:
   // Info - Collection of information used during the computation of idoms.
   DenseMap<NodeT *, InfoRec> Info;
 
+  /// A change to the edges of the CFG that the tree does not reflect yet.
+  struct PendingUpdate {
+    NodeT *From;
+    NodeT *To;
+    bool IsInsertion;
+  };
+
+  /// Edge updates queued by insertEdge and deleteEdge.
+  SmallVector<PendingUpdate, 4> PendingUpdates;
+
   void reset() {
     DomTreeNodes.clear();
     IDoms.clear();
     this->Roots.clear();
     Vertex.clear();
+    PendingUpdates.clear();
     RootNode = nullptr;
     DFSInfoValid = false;
     SlowQueries = 0;
@@ -324,7 +338,8 @@ public:
         RootNode(std::move(Arg.RootNode)),
         DFSInfoValid(std::move(Arg.DFSInfoValid)),
         SlowQueries(std::move(Arg.SlowQueries)), IDoms(std::move(Arg.IDoms)),
-        Vertex(std::move(Arg.Vertex)), Info(std::move(Arg.Info)) {
+        Vertex(std::move(Arg.Vertex)), Info(std::move(Arg.Info)),
+        PendingUpdates(std::move(Arg.PendingUpdates)) {
     Arg.wipe();
   }
   DominatorTreeBase &operator=(DominatorTreeBase &&RHS) {
@@ -337,6 +352,7 @@ public:
     IDoms = std::move(RHS.IDoms);
     Vertex = std::move(RHS.Vertex);
     Info = std::move(RHS.Info);
+    PendingUpdates = std::move(RHS.PendingUpdates);
     RHS.wipe();
     return *this;
   }
@@ -608,6 +624,27 @@ public:
       this->Split<NodeT *, GraphTraits<NodeT *>>(*this, NewBB);
   }
 
+  /// insertEdge - Inform the tree that the CFG edge From -> To was inserted.
+  /// The update is queued; the tree must not be queried until the queued
+  /// updates are applied with applyUpdates(). Updates can be queued in any
+  /// order, but blocks they mention must not be erased before they are
+  /// applied.
+  void insertEdge(NodeT *From, NodeT *To) {
+    assert(From && To && "Cannot insert an edge from or to a null block!");
+    PendingUpdates.push_back({From, To, /*IsInsertion=*/true});
+  }
+
+  /// deleteEdge - Inform the tree that the CFG edge From -> To was deleted.
+  /// The update is queued like the ones made by insertEdge().
+  void deleteEdge(NodeT *From, NodeT *To) {
+    assert(From && To && "Cannot delete an edge from or to a null block!");
+    PendingUpdates.push_back({From, To, /*IsInsertion=*/false});
+  }
+
+  /// hasPendingUpdates - Return true if edge updates were queued that have
+  /// not been applied yet.
+  bool hasPendingUpdates() const { return !PendingUpdates.empty(); }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -736,6 +773,256 @@ public:
       Calculate<FT, Inverse<NodeT *>>(*this, F);
     }
   }
+
+  /// applyUpdates - Bring the tree up to date with the edges inserted and
+  /// deleted since it was last valid for function F, which must already be in
+  /// its final shape. Only the part of the tree below the nearest common
+  /// dominator of the changed edges is recomputed; a single inserted edge is
+  /// handled with the depth based search of Georgiadis et al., which only
+  /// visits the blocks whose immediate dominator changes. Post-dominator trees
+  /// and updates that make new blocks reachable fall back to recalculate().
+  template <class FT> void applyUpdates(FT &F) {
+    if (PendingUpdates.empty())
+      return;
+    if (this->IsPostDominators) {
+      recalculate(F);
+      return;
+    }
+
+    SmallVector<PendingUpdate, 4> Updates;
+    for (const PendingUpdate &U : PendingUpdates) {
+      // An edge that was inserted and deleted again, or one of several
+      // parallel edges that was deleted, does not change anything.
+      if (U.IsInsertion != hasEdge(U.From, U.To))
+        continue;
+      // Neither do edges leaving an unreachable block.
+      if (!getNode(U.From))
+        continue;
+      if (!getNode(U.To)) {
+        if (U.IsInsertion) {
+          // The edge made new blocks reachable.
+          recalculate(F);
+          return;
+        }
+        continue;
+      }
+      // Deleting a back edge to a dominator does not change reachability.
+      if (!U.IsInsertion && dominates(U.To, U.From))
+        continue;
+      if (std::any_of(Updates.begin(), Updates.end(),
+                      [&](const PendingUpdate &V) {
+                        return V.From == U.From && V.To == U.To;
+                      }))
+        continue;
+      Updates.push_back(U);
+    }
+    PendingUpdates.clear();
+    if (Updates.empty())
+      return;
+
+    DFSInfoValid = false;
+    if (Updates.size() == 1 && Updates.front().IsInsertion)
+      insertReachableEdge(Updates.front().From, Updates.front().To);
+    else
+      recalculateSubtree(F, Updates);
+  }
+
+private:
+  static bool hasEdge(NodeT *From, NodeT *To) {
+    typedef GraphTraits<NodeT *> GT;
+    return std::find(GT::child_begin(From), GT::child_end(From), To) !=
+           GT::child_end(From);
+  }
+
+  /// insertReachableEdge - Update the tree for a new edge between two
+  /// reachable blocks. The blocks whose immediate dominator changes are those
+  /// reachable from To along paths whose blocks are no shallower in the tree
+  /// than themselves and deeper than the common dominator of From and To,
+  /// which becomes their immediate dominator. They are found by visiting the
+  /// candidate blocks deepest first.
+  void insertReachableEdge(NodeT *From, NodeT *To) {
+    typedef GraphTraits<NodeT *> GT;
+    typedef DomTreeNodeBase<NodeT> TreeNode;
+    TreeNode *ToTN = getNode(To);
+    TreeNode *NCD = getNode(findNearestCommonDominator(From, To));
+    if (NCD == ToTN || NCD == ToTN->getIDom())
+      return;
+
+    DenseMap<TreeNode *, unsigned> Levels;
+    auto getLevel = [&Levels](TreeNode *TN) {
+      SmallVector<TreeNode *, 8> Path;
+      unsigned Level = 0;
+      for (; TN; TN = TN->getIDom()) {
+        auto I = Levels.find(TN);
+        if (I != Levels.end()) {
+          Level = I->second + 1;
+          break;
+        }
+        Path.push_back(TN);
+      }
+      for (TreeNode *N : reverse(Path))
+        Levels[N] = Level++;
+      return Level - 1;
+    };
+
+    typedef std::pair<unsigned, TreeNode *> LevelAndNode;
+    auto Shallower = [](const LevelAndNode &A, const LevelAndNode &B) {
+      return A.first < B.first;
+    };
+    std::priority_queue<LevelAndNode, SmallVector<LevelAndNode, 8>,
+                        decltype(Shallower)>
+        Bucket(Shallower);
+    SmallPtrSet<TreeNode *, 16> Visited;
+    SmallVector<TreeNode *, 8> Affected;
+    SmallVector<TreeNode *, 8> Stack;
+    const unsigned NCDLevel = getLevel(NCD);
+
+    Bucket.push({getLevel(ToTN), ToTN});
+    Visited.insert(ToTN);
+    while (!Bucket.empty()) {
+      unsigned CurrentLevel = Bucket.top().first;
+      TreeNode *TN = Bucket.top().second;
+      Bucket.pop();
+      Affected.push_back(TN);
+
+      Stack.push_back(TN);
+      while (!Stack.empty()) {
+        NodeT *BB = Stack.pop_back_val()->getBlock();
+        for (auto SI = GT::child_begin(BB), SE = GT::child_end(BB); SI != SE;
+             ++SI) {
+          TreeNode *SuccTN = getNode(*SI);
+          if (!SuccTN)
+            continue;
+          unsigned SuccLevel = getLevel(SuccTN);
+          // Blocks deeper than the current one keep their immediate
+          // dominator, but paths through them can reach affected blocks.
+          if (SuccLevel > CurrentLevel) {
+            if (Visited.insert(SuccTN).second)
+              Stack.push_back(SuccTN);
+            continue;
+          }
+          if (SuccLevel > NCDLevel + 1 && Visited.insert(SuccTN).second)
+            Bucket.push({SuccLevel, SuccTN});
+        }
+      }
+    }
+
+    for (TreeNode *TN : Affected)
+      TN->setIDom(NCD);
+  }
+
+  /// recalculateSubtree - Recompute the subtree of the nearest common
+  /// dominator of all updated edges, which no path from outside it can enter
+  /// other than through its root, using the iterative algorithm of Cooper,
+  /// Harvey and Kennedy. Blocks of the subtree that are no longer reachable
+  /// are removed from the tree. When they had successors outside of the
+  /// subtree, the whole tree is recalculated instead.
+  template <class FT>
+  void recalculateSubtree(FT &F, ArrayRef<PendingUpdate> Updates) {
+    typedef GraphTraits<NodeT *> GT;
+    typedef GraphTraits<Inverse<NodeT *>> InvGT;
+    typedef DomTreeNodeBase<NodeT> TreeNode;
+
+    NodeT *Root = nullptr;
+    for (const PendingUpdate &U : Updates) {
+      NodeT *NCD = findNearestCommonDominator(U.From, U.To);
+      Root = Root ? findNearestCommonDominator(Root, NCD) : NCD;
+    }
+    TreeNode *RootTN = getNode(Root);
+    if (!RootTN->getIDom()) {
+      recalculate(F);
+      return;
+    }
+
+    SmallPtrSet<NodeT *, 32> Subtree;
+    SmallVector<TreeNode *, 32> Worklist(1, RootTN);
+    while (!Worklist.empty()) {
+      TreeNode *TN = Worklist.pop_back_val();
+      Subtree.insert(TN->getBlock());
+      Worklist.append(TN->begin(), TN->end());
+    }
+
+    // Number the blocks that are still reachable from the root in post-order.
+    DenseMap<NodeT *, unsigned> PostNum;
+    SmallVector<NodeT *, 32> PostOrder;
+    SmallVector<std::pair<NodeT *, typename GT::ChildIteratorType>, 32> Stack;
+    SmallPtrSet<NodeT *, 32> Seen;
+    Seen.insert(Root);
+    Stack.push_back({Root, GT::child_begin(Root)});
+    while (!Stack.empty()) {
+      NodeT *BB = Stack.back().first;
+      if (Stack.back().second == GT::child_end(BB)) {
+        PostNum[BB] = PostOrder.size();
+        PostOrder.push_back(BB);
+        Stack.pop_back();
+        continue;
+      }
+      NodeT *Succ = *Stack.back().second++;
+      if (Subtree.count(Succ) && Seen.insert(Succ).second)
+        Stack.push_back({Succ, GT::child_begin(Succ)});
+    }
+
+    DenseMap<NodeT *, NodeT *> IDom;
+    IDom[Root] = Root;
+    auto Intersect = [&](NodeT *A, NodeT *B) {
+      while (A != B) {
+        while (PostNum[A] < PostNum[B])
+          A = IDom[A];
+        while (PostNum[B] < PostNum[A])
+          B = IDom[B];
+      }
+      return A;
+    };
+    for (bool Changed = true; Changed;) {
+      Changed = false;
+      for (NodeT *BB : reverse(ArrayRef<NodeT *>(PostOrder).drop_back())) {
+        NodeT *NewIDom = nullptr;
+        for (auto PI = InvGT::child_begin(BB), PE = InvGT::child_end(BB);
+             PI != PE; ++PI) {
+          NodeT *Pred = *PI;
+          if (!IDom.count(Pred))
+            continue;
+          NewIDom = NewIDom ? Intersect(Pred, NewIDom) : Pred;
+        }
+        NodeT *&CurIDom = IDom[BB];
+        if (CurIDom != NewIDom) {
+          CurIDom = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // A block outside of the subtree that was also entered from blocks which
+    // became unreachable can now have a different immediate dominator, which
+    // may be anywhere above the subtree.
+    SmallVector<NodeT *, 8> Unreachable;
+    for (NodeT *BB : Subtree)
+      if (!PostNum.count(BB))
+        Unreachable.push_back(BB);
+    for (NodeT *BB : Unreachable)
+      for (auto SI = GT::child_begin(BB), SE = GT::child_end(BB); SI != SE;
+           ++SI)
+        if (!Subtree.count(*SI) && getNode(*SI)) {
+          recalculate(F);
+          return;
+        }
+
+    for (NodeT *BB : PostOrder)
+      if (BB != Root)
+        getNode(BB)->setIDom(getNode(IDom[BB]));
+
+    // Only the blocks that became unreachable are left below their old
+    // immediate dominators now.
+    for (NodeT *BB : Unreachable) {
+      TreeNode *TN = getNode(BB);
+      TreeNode *OldIDom = TN->getIDom();
+      if (PostNum.count(OldIDom->getBlock()))
+        OldIDom->Children.erase(std::find(OldIDom->Children.begin(),
+                                          OldIDom->Children.end(), TN));
+    }
+    for (NodeT *BB : Unreachable)
+      DomTreeNodes.erase(BB);
+  }
 };
 
 // These two functions are declared out of line as a workaround for building
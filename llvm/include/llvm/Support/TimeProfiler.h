@@ -0,0 +1,102 @@
+//===- llvm/Support/TimeProfiler.h - Hierarchical Time Profiler -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a lightweight profiler that records nested, named time
+// sections (for example "InstantiateFunction" with the name of the function
+// as detail) and writes them out in the Chrome trace event format, which can
+// be loaded into chrome://tracing or speedscope.
+//
+// The profiler is per thread and disabled unless timeTraceProfilerInitialize()
+// was called on that thread, in which case TimeTraceScope only costs a check
+// of a thread-local pointer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMEPROFILER_H
+#define LLVM_SUPPORT_TIMEPROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+#include <type_traits>
+
+namespace llvm {
+
+class raw_ostream;
+
+struct TimeTraceProfiler;
+extern LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// \brief Start recording time sections on the current thread.
+///
+/// \param TimeTraceGranularity the minimum duration, in microseconds, of a
+/// section to be written to the trace. Shorter sections still count towards
+/// the totals.
+void timeTraceProfilerInitialize(unsigned TimeTraceGranularity);
+
+/// \brief Stop recording and release everything recorded on this thread.
+void timeTraceProfilerCleanup();
+
+/// \brief Whether the current thread is recording time sections.
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != nullptr;
+}
+
+/// \brief Write everything recorded on this thread as Chrome trace JSON.
+///
+/// Besides the individual sections, the trace contains one "Total <name>"
+/// section per section name, holding the summed duration of all sections of
+/// that name. Recursive sections are only counted once.
+void timeTraceProfilerWrite(raw_ostream &OS);
+
+/// \brief Print the \p N most expensive section details of every section
+/// name, for example the N slowest template instantiations.
+///
+/// Only sections that reached the granularity are taken into account.
+void timeTraceProfilerPrintSummary(raw_ostream &OS, unsigned N);
+
+/// \brief Start a time section named \p Name.
+///
+/// \p Detail is a free-form description, such as the name of the entity being
+/// processed. Sections must be ended in the reverse order in which they were
+/// started.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// \brief End the most recently started time section.
+void timeTraceProfilerEnd();
+
+/// \brief Records a time section for as long as it is alive, if the profiler
+/// is enabled on the current thread.
+struct TimeTraceScope {
+  TimeTraceScope(StringRef Name, StringRef Detail) {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  /// \brief Records a time section whose detail is only computed when the
+  /// profiler is enabled.
+  template <typename Callable,
+            typename = typename std::enable_if<
+                !std::is_convertible<Callable, StringRef>::value>::type>
+  TimeTraceScope(StringRef Name, Callable &&Detail) {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerBegin(Name, Detail());
+  }
+  ~TimeTraceScope() {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerEnd();
+  }
+
+private:
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+};
+
+} // end namespace llvm
+
+#endif
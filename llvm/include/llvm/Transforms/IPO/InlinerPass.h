@@ -12,14 +12,21 @@
 // subclass determines WHAT to inline, which is the much more interesting
 // component.
 //
+// It also defines a test-only inliner pass for the new pass manager, which
+// walks the lazy call graph bottom-up and inlines the most profitable calls
+// first.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_TRANSFORMS_IPO_INLINERPASS_H
 #define LLVM_TRANSFORMS_IPO_INLINERPASS_H
 
+#include "llvm/Analysis/CGSCCPassManager.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/InlineCost.h"
+#include "llvm/Analysis/LazyCallGraph.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/PassManager.h"
 
 namespace llvm {
 class AssumptionCacheTracker;
@@ -75,9 +82,44 @@ private:
   // InsertLifetime - Insert @llvm.lifetime intrinsics.
   bool InsertLifetime;
 
+  /// Forget the callee summaries of the functions in \p SCC.
+  void invalidateSummaries(CallGraphSCC &SCC);
+
 protected:
   AssumptionCacheTracker *ACT;
   ProfileSummaryInfo *PSI;
+
+  /// Callee summaries for the inline cost analysis. They are kept for the
+  /// whole walk over the call graph, except for the functions of the SCC
+  /// being visited, which other passes may change before and after the visit.
+  InlineCostCache CostCache;
+};
+
+/// \brief The inliner pass for the new pass manager.
+///
+/// Like the legacy inliner this visits the call graph bottom-up, so the
+/// callees of an SCC have already been simplified when their calls are
+/// considered. Within an SCC the call sites are not visited in program order
+/// but by how far their inline cost is below the threshold, so the most
+/// profitable inlining happens first. The cost analysis keeps callee
+/// summaries for as long as the pass lives, so a pass object must not walk a
+/// module again after other passes changed it.
+///
+/// This pass is for testing only, and no pipeline built by PassBuilder uses
+/// it. The CGSCC pass manager cannot yet update the call graph when an SCC
+/// changes shape. For that reason, calls between functions of the same
+/// RefSCC are not inlined at all, which includes all recursive calls.
+/// Functions that become dead are left to a later global DCE.
+class InlinerPass : public PassInfoMixin<InlinerPass> {
+public:
+  InlinerPass() : DefaultThreshold(getDefaultInlineThreshold()) {}
+  explicit InlinerPass(int Threshold) : DefaultThreshold(Threshold) {}
+
+  PreservedAnalyses run(LazyCallGraph::SCC &C, CGSCCAnalysisManager &AM);
+
+private:
+  int DefaultThreshold;
+  InlineCostCache CostCache;
 };
 
 } // End llvm namespace
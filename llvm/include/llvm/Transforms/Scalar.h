@@ -320,9 +320,9 @@ extern char &LCSSAID;
 //===----------------------------------------------------------------------===//
 //
 // EarlyCSE - This pass performs a simple and fast CSE pass over the dominator
-// tree.
+// tree. With UseMemorySSA, it uses and preserves MemorySSA.
 //
-FunctionPass *createEarlyCSEPass();
+FunctionPass *createEarlyCSEPass(bool UseMemorySSA = false);
 
 //===----------------------------------------------------------------------===//
 //
@@ -27,8 +27,14 @@ namespace llvm {
 /// cases so that instcombine and other passes are more effective. It is
 /// expected that a later pass of GVN will catch the interesting/hard cases.
 struct EarlyCSEPass : PassInfoMixin<EarlyCSEPass> {
+  EarlyCSEPass(bool UseMemorySSA = false) : UseMemorySSA(UseMemorySSA) {}
+
   /// \brief Run the pass over the function.
   PreservedAnalyses run(Function &F, AnalysisManager<Function> &AM);
+
+  /// \brief Whether to use MemorySSA to find redundant loads and calls across
+  /// writes that do not clobber them, and to keep it up to date.
+  bool UseMemorySSA;
 };
 
 }
@@ -26,6 +26,7 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 
 namespace llvm {
 
@@ -68,6 +69,7 @@ public:
     DenseMap<Expression, uint32_t> expressionNumbering;
     AliasAnalysis *AA;
     MemoryDependenceResults *MD;
+    MemorySSA *MSSA;
     DominatorTree *DT;
 
     uint32_t nextValueNumber;
@@ -77,6 +79,7 @@ public:
                              Value *LHS, Value *RHS);
     Expression createExtractvalueExpr(ExtractValueInst *EI);
     uint32_t lookupOrAddCall(CallInst *C);
+    uint32_t lookupOrAddMemoryExpr(Expression Exp, MemoryAccess *Clobber);
 
   public:
     ValueTable();
@@ -88,6 +91,9 @@ public:
     uint32_t lookup(Value *V) const;
     uint32_t lookupOrAddCmp(unsigned Opcode, CmpInst::Predicate Pred,
                             Value *LHS, Value *RHS);
+    /// Returns the value number of a simple load of type \p Ty from \p Ptr
+    /// that is clobbered by \p Clobber. Only used with MemorySSA.
+    uint32_t lookupOrAddLoad(Type *Ty, Value *Ptr, MemoryAccess *Clobber);
     bool exists(Value *V) const;
     void add(Value *V, uint32_t num);
     void clear();
@@ -95,6 +101,7 @@ public:
     void setAliasAnalysis(AliasAnalysis *A) { AA = A; }
     AliasAnalysis *getAliasAnalysis() const { return AA; }
     void setMemDep(MemoryDependenceResults *M) { MD = M; }
+    void setMemorySSA(MemorySSA *M) { MSSA = M; }
     void setDomTree(DominatorTree *D) { DT = D; }
     uint32_t getNextUnusedValueNumber() { return nextValueNumber; }
     void verifyRemoved(const Value *) const;
@@ -105,6 +112,11 @@ private:
   friend struct DenseMapInfo<Expression>;
 
   MemoryDependenceResults *MD;
+  /// When GVN uses MemorySSA instead of MemoryDependenceResults to find the
+  /// memory dependencies of loads and calls, the MemorySSA of the current
+  /// iteration. MD is null in that case.
+  std::unique_ptr<MemorySSA> MSSA;
+  bool UseMemorySSA;
   DominatorTree *DT;
   const TargetLibraryInfo *TLI;
   AssumptionCache *AC;
@@ -202,6 +214,18 @@ private:
   bool PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
                       UnavailBlkVect &UnavailableBlocks);
 
+  // Helper functions of MemorySSA based load elimination
+  /// Returns the dependency of \p LI on the access \p Clobber, which
+  /// clobbers \p Address, as MemoryDependenceResults would describe it.
+  MemDepResult getMemorySSADependency(LoadInst *LI, Value *Address,
+                                      MemoryAccess *Clobber);
+  /// Returns the dependency of \p LI on its clobbering access.
+  MemDepResult getMemorySSADependency(LoadInst *LI);
+  /// Finds the dependencies of \p LI at the ends of the predecessors of the
+  /// MemoryPhi that clobbers it.
+  void getNonLocalMemorySSADependencies(LoadInst *LI, LoadDepVect &Deps);
+  void removeMemoryAccess(Instruction *I);
+
   // Other helper routines
   bool processInstruction(Instruction *I);
   bool processBlock(BasicBlock *BB);
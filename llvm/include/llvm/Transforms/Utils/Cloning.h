@@ -191,7 +191,7 @@ public:
   SmallVector<AllocaInst *, 4> StaticAllocas;
 
   /// InlinedCalls - InlineFunction fills this in with callsites that were
-  /// inlined from the callee.  This is only filled in if CG is non-null.
+  /// inlined from the callee.
   SmallVector<WeakVH, 8> InlinedCalls;
 
   void reset() {
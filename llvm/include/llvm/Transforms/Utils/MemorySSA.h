@@ -493,7 +493,13 @@ class MemorySSAWalker;
 /// accesses.
 class MemorySSA {
 public:
-  MemorySSA(Function &, AliasAnalysis *, DominatorTree *);
+  /// \p WalkerCheckLimit bounds the number of MemoryDefs a single clobber
+  /// query of the walker looks at, and \p WalkerCacheLimit the number of
+  /// clobbers the walker remembers, including while MemorySSA is built. Zero
+  /// means the limits of -memssa-check-limit and -memssa-max-walker-cache-size,
+  /// which are unbounded by default.
+  MemorySSA(Function &, AliasAnalysis *, DominatorTree *,
+            unsigned WalkerCacheLimit = 0, unsigned WalkerCheckLimit = 0);
   MemorySSA(MemorySSA &&);
   ~MemorySSA();
 
@@ -576,6 +582,28 @@ public:
   /// on the MemoryAccess for that store/load.
   void removeMemoryAccess(MemoryAccess *);
 
+  /// \brief Move a MemoryUse to the beginning or end of \p BB.
+  ///
+  /// This should be called when the instruction of the MemoryUse is moved to
+  /// the corresponding place in \p BB, e.g. when it is hoisted out of a loop.
+  /// The defining access is not changed, so the caller must make sure that it
+  /// still dominates the MemoryUse and that nothing in between clobbers it.
+  void moveTo(MemoryUse *What, BasicBlock *BB, InsertionPlace Point);
+
+  /// \brief Make a MemoryUse that was created by one of the
+  /// createMemoryAccess functions use the definition that reaches it,
+  /// creating MemoryPhis where needed.
+  void insertUse(MemoryUse *Use);
+
+  /// \brief Add a MemoryDef that was created by one of the createMemoryAccess
+  /// functions to the def chains.
+  ///
+  /// This sets the defining access of \p Def, makes the MemoryDefs and
+  /// MemoryPhis that it now reaches use it and creates the MemoryPhis that
+  /// merge it with other definitions. MemoryUses that \p Def may clobber are
+  /// changed to use the definition that reaches them.
+  void insertDef(MemoryDef *Def);
+
   /// \brief Given two memory accesses in the same basic block, determine
   /// whether MemoryAccess \p A dominates MemoryAccess \p B.
   bool locallyDominates(const MemoryAccess *A, const MemoryAccess *B) const;
@@ -612,6 +640,13 @@ private:
   MemoryUseOrDef *createNewAccess(Instruction *);
   MemoryUseOrDef *createDefinedAccess(Instruction *, MemoryAccess *);
   MemoryAccess *findDominatingDef(BasicBlock *, enum InsertionPlace);
+  MemoryAccess *getReachingDefAtStart(BasicBlock *);
+  MemoryAccess *getReachingDefAtEnd(BasicBlock *);
+  MemoryAccess *getReachingDefBefore(MemoryUseOrDef *);
+  MemoryAccess *tryRemoveTrivialPhi(MemoryPhi *);
+  void renameAfterInsert(MemoryDef *, MemoryAccess *Root,
+                         const SmallPtrSetImpl<BasicBlock *> &Roots,
+                         DenseMap<BasicBlock *, MemoryAccess *> &EndDefs);
   void removeFromLookups(MemoryAccess *);
 
   MemoryAccess *renameBlock(BasicBlock *, MemoryAccess *);
@@ -637,6 +672,8 @@ private:
 
   // Memory SSA building info
   std::unique_ptr<CachingWalker> Walker;
+  unsigned WalkerCacheLimit;
+  unsigned WalkerCheckLimit;
   unsigned NextID;
 };
 
@@ -49,6 +49,7 @@
 #ifndef LLVM_TRANSFORMS_VECTORIZE_LOOPVECTORIZE_H
 #define LLVM_TRANSFORMS_VECTORIZE_LOOPVECTORIZE_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -89,6 +90,10 @@ struct LoopVectorizePass : public PassInfoMixin<LoopVectorizePass> {
 
   BlockFrequency ColdEntryFreq;
 
+  /// The vectorization factors planned for the outer loops whose inner loop
+  /// was replicated.
+  DenseMap<Loop *, unsigned> ReplicatedLoopVFs;
+
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
 
   // Shim for old PM.
@@ -100,6 +105,16 @@ struct LoopVectorizePass : public PassInfoMixin<LoopVectorizePass> {
                OptimizationRemarkEmitter &ORE);
 
   bool processLoop(Loop *L);
+
+  /// Replicate the inner loop of \p L if the planner finds vectorizing \p L
+  /// more profitable. \return true if \p L became an innermost loop.
+  bool processOuterLoop(Loop *L);
+
+  /// \return true if \p L can be vectorized with width \p VF once its inner
+  /// loop \p Inner, which runs \p TripCount times, is replicated.
+  /// \p AllowReordering permits reductions of floating-point values.
+  bool canVectorizeOuterLoop(Loop *L, Loop *Inner, unsigned TripCount,
+                             unsigned VF, bool AllowReordering);
 };
 }
 
@@ -25,6 +25,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/CFLAndersAliasAnalysis.h"
@@ -46,14 +47,33 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
 using namespace llvm;
 
+#define DEBUG_TYPE "aa"
+
+STATISTIC(NumAliasCacheHits, "Number of alias queries answered from the cache");
+STATISTIC(NumAliasCacheMisses, "Number of alias queries missing the cache");
+
 /// Allow disabling BasicAA from the AA results. This is particularly useful
 /// when testing to isolate a single AA implementation.
 static cl::opt<bool> DisableBasicAA("disable-basicaa", cl::Hidden,
                                     cl::init(false));
 
-AAResults::AAResults(AAResults &&Arg) : TLI(Arg.TLI), AAs(std::move(Arg.AAs)) {
+/// Print the hit and miss counts of the alias query cache for each client when
+/// its outermost query cache scope ends.
+static cl::opt<bool> PrintQueryCacheStats(
+    "aa-query-cache-stats", cl::Hidden, cl::init(false),
+    cl::desc("Print alias query cache statistics for each client"));
+
+/// The source of query cache epochs. Zero is never handed out.
+static std::atomic<unsigned> NextQueryCacheEpoch(0);
+
+AAResults::AAResults(AAResults &&Arg)
+    : TLI(Arg.TLI), AAs(std::move(Arg.AAs)), QueryDepth(0),
+      NumCacheScopes(0), CacheEpoch(0), CurCacheStats(nullptr) {
+  assert(!Arg.NumCacheScopes && "Moving AAResults with an active cache scope!");
   for (auto &AA : AAs)
     AA->setAAResults(this);
 }
@@ -75,14 +95,76 @@ AAResults::~AAResults() {
 
 AliasResult AAResults::alias(const MemoryLocation &LocA,
                              const MemoryLocation &LocB) {
+  // Outside of a query cache scope, queries cost what they did before there
+  // was a cache.
+  if (!NumCacheScopes)
+    return aliasUncached(LocA, LocB);
+
+  if (QueryDepth) {
+    ++QueryDepth;
+    AliasResult Result = aliasUncached(LocA, LocB);
+    --QueryDepth;
+    return Result;
+  }
+
+  // Alias queries are symmetric, so order the cache key by pointer.
+  LocPair Key =
+      LocA.Ptr <= LocB.Ptr ? LocPair(LocA, LocB) : LocPair(LocB, LocA);
+  auto CacheIt = AliasQueryCache.find(Key);
+  if (CacheIt != AliasQueryCache.end()) {
+    ++NumAliasCacheHits;
+    ++CurCacheStats->AliasHits;
+    return CacheIt->second;
+  }
+  ++NumAliasCacheMisses;
+  ++CurCacheStats->AliasMisses;
+
+  ++QueryDepth;
+  AliasResult Result = aliasUncached(LocA, LocB);
+  --QueryDepth;
+  AliasQueryCache[Key] = Result;
+  return Result;
+}
+
+AliasResult AAResults::aliasUncached(const MemoryLocation &LocA,
+                                     const MemoryLocation &LocB) {
   for (const auto &AA : AAs) {
-    auto Result = AA->alias(LocA, LocB);
+    AliasResult Result = AA->alias(LocA, LocB);
     if (Result != MayAlias)
       return Result;
   }
   return MayAlias;
 }
 
+AAResults::QueryCacheScope::QueryCacheScope(AAResults &AAR, StringRef Client)
+    : AAR(AAR), PrevStats(AAR.CurCacheStats) {
+  if (AAR.NumCacheScopes++ == 0)
+    do
+      AAR.CacheEpoch = ++NextQueryCacheEpoch;
+    while (!AAR.CacheEpoch);
+  AAR.CurCacheStats = &AAR.CacheStats[Client];
+}
+
+AAResults::QueryCacheScope::~QueryCacheScope() {
+  AAR.CurCacheStats = PrevStats;
+  if (--AAR.NumCacheScopes)
+    return;
+
+  if (PrintQueryCacheStats)
+    for (const auto &Entry : AAR.CacheStats) {
+      const QueryCacheStats &Stats = Entry.getValue();
+      errs() << "AA query cache for '" << Entry.getKey() << "': alias "
+             << Stats.AliasHits << " hits, " << Stats.AliasMisses
+             << " misses; decomposed GEPs " << Stats.DecomposedGEPHits
+             << " hits, " << Stats.DecomposedGEPMisses << " misses\n";
+    }
+
+  // The IR may change once the outermost scope ends, so forget everything.
+  AAR.CacheEpoch = 0;
+  AAR.AliasQueryCache.clear();
+  AAR.CacheStats.clear();
+}
+
 bool AAResults::pointsToConstantMemory(const MemoryLocation &Loc,
                                        bool OrLocal) {
   for (const auto &AA : AAs)
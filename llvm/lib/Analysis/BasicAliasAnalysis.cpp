@@ -494,6 +494,47 @@ bool BasicAAResult::DecomposeGEPExpression(const Value *V,
   return true;
 }
 
+bool BasicAAResult::useQueryCaches() {
+  AAResults *AAR = getAAResults();
+  if (!AAR || !AAR->isCachingQueries())
+    return false;
+
+  if (QueryCacheEpoch != AAR->getQueryCacheEpoch()) {
+    DecomposedGEPCache.clear();
+    UnderlyingObjectCache.clear();
+    QueryCacheEpoch = AAR->getQueryCacheEpoch();
+  }
+  return true;
+}
+
+bool BasicAAResult::decomposeGEP(const Value *V, DecomposedGEP &Decomposed) {
+  if (!useQueryCaches())
+    return DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+
+  AAResults::QueryCacheStats &Stats = getAAResults()->getQueryCacheStats();
+  auto CacheIt = DecomposedGEPCache.find(V);
+  if (CacheIt != DecomposedGEPCache.end()) {
+    ++Stats.DecomposedGEPHits;
+    Decomposed = CacheIt->second.first;
+    return CacheIt->second.second;
+  }
+
+  ++Stats.DecomposedGEPMisses;
+  bool MaxLookupReached = DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+  DecomposedGEPCache[V] = std::make_pair(Decomposed, MaxLookupReached);
+  return MaxLookupReached;
+}
+
+const Value *BasicAAResult::getUnderlyingObject(const Value *V) {
+  if (!useQueryCaches())
+    return GetUnderlyingObject(V, DL, MaxLookupSearchDepth);
+
+  const Value *&Object = UnderlyingObjectCache[V];
+  if (!Object)
+    Object = GetUnderlyingObject(V, DL, MaxLookupSearchDepth);
+  return Object;
+}
+
 /// Returns whether the given pointer value points to memory that is local to
 /// the function, with global constants being considered local to all
 /// functions.
@@ -1021,10 +1062,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
                                     const Value *UnderlyingV1,
                                     const Value *UnderlyingV2) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = decomposeGEP(GEP1, DecompGEP1);
+  bool GEP2MaxLookupReached = decomposeGEP(V2, DecompGEP2);
 
   int64_t GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   int64_t GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
@@ -1416,8 +1455,8 @@ AliasResult BasicAAResult::aliasCheck(const Value *V1, uint64_t V1Size,
     return NoAlias; // Scalars cannot alias each other
 
   // Figure out what objects these things are pointing to if we can.
-  const Value *O1 = GetUnderlyingObject(V1, DL, MaxLookupSearchDepth);
-  const Value *O2 = GetUnderlyingObject(V2, DL, MaxLookupSearchDepth);
+  const Value *O1 = getUnderlyingObject(V1);
+  const Value *O2 = getUnderlyingObject(V2);
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
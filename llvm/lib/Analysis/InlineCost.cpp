@@ -31,6 +31,7 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -39,6 +40,11 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCalleesSummarized, "Number of callee summaries computed");
+STATISTIC(NumSummariesTruncated,
+          "Number of callee summaries cut short at the largest threshold");
+STATISTIC(NumSummariesReplayed,
+          "Number of call sites analyzed by replaying a callee summary");
 
 // Threshold to use when optsize is specified (and there is no
 // -inline-threshold).
@@ -66,6 +72,95 @@ static cl::opt<int> ColdThreshold(
     "inlinecold-threshold", cl::Hidden, cl::init(225),
     cl::desc("Threshold for inlining functions with cold attribute"));
 
+static cl::opt<bool> EnableCostCache(
+    "inline-cost-cache", cl::Hidden, cl::init(true),
+    cl::desc("Reuse the call site independent analysis of a callee across "
+             "its call sites"));
+
+/// The part of the cost analysis of a callee which does not depend on the
+/// call site. The walk fields describe a walk over the body which knows
+/// nothing about the arguments besides the callee's own attributes, and which
+/// only stops at a threshold that no call site can reach. Costs are relative
+/// to the start of the walk.
+struct InlineCostCache::Summary {
+  /// Forgets the summary when its function is deleted, so that a function
+  /// created later at the same address does not find it.
+  class DeletionHandle final : public CallbackVH {
+    InlineCostCache *Cache;
+    void deleted() override {
+      Cache->invalidate(*cast<Function>(getValPtr()));
+      // this now dangles!
+    }
+
+  public:
+    DeletionHandle(Function &F, InlineCostCache &Cache)
+        : CallbackVH(&F), Cache(&Cache) {}
+    void setCache(InlineCostCache &NewCache) { Cache = &NewCache; }
+  };
+  DeletionHandle Handle;
+
+  Summary(Function &F, InlineCostCache &Cache) : Handle(F, Cache) {}
+
+  bool HasEphValues = false;
+  SmallPtrSet<const Value *, 32> EphValues;
+
+  bool IsWalked = false;
+  /// The walk can only be replayed if the cost never decreased during it, and
+  /// if it did not stop at its threshold.
+  bool IsReplayable = true;
+
+  /// Whether the walk stopped at a construct which cannot be inlined, and the
+  /// cost before the instruction or block which contained it.
+  bool Aborted = false;
+  int CostBeforeAbort = 0;
+
+  int Cost = 0;
+  bool SingleBB = true;
+  /// The cost at the point the body stopped being a single basic block.
+  int CostAtMultiBB = 0;
+
+  /// Where the static allocas first exceeded the limit for recursive callers.
+  bool ExceedsRecursiveCallerAllocaSize = false;
+  bool SingleBBAtAllocaLimit = true;
+  int CostBeforeAllocaLimit = 0;
+  int CostAtAllocaLimit = 0;
+
+  bool ContainsNoDuplicateCall = false;
+  unsigned NumInstructions = 0;
+  unsigned NumVectorInstructions = 0;
+  unsigned NumInstructionsSimplified = 0;
+  unsigned NumConstantPtrCmps = 0;
+  unsigned NumConstantPtrDiffs = 0;
+};
+
+InlineCostCache::InlineCostCache() {}
+
+InlineCostCache::InlineCostCache(InlineCostCache &&Arg)
+    : Summaries(std::move(Arg.Summaries)) {
+  for (auto &Entry : Summaries)
+    Entry.second->Handle.setCache(*this);
+}
+
+InlineCostCache &InlineCostCache::operator=(InlineCostCache &&RHS) {
+  Summaries = std::move(RHS.Summaries);
+  for (auto &Entry : Summaries)
+    Entry.second->Handle.setCache(*this);
+  return *this;
+}
+
+InlineCostCache::~InlineCostCache() {}
+
+InlineCostCache::Summary &InlineCostCache::getSummary(Function &F) {
+  std::unique_ptr<Summary> &S = Summaries[&F];
+  if (!S)
+    S.reset(new Summary(F, *this));
+  return *S;
+}
+
+void InlineCostCache::invalidate(Function &F) { Summaries.erase(&F); }
+
+void InlineCostCache::clear() { Summaries.clear(); }
+
 namespace {
 
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
@@ -81,6 +176,13 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// Profile summary information.
   ProfileSummaryInfo *PSI;
 
+  /// Cache of callee summaries, if any.
+  InlineCostCache *Cache;
+
+  /// The summary being computed when this analyzer walks a callee without
+  /// a call site.
+  InlineCostCache::Summary *Recording;
+
   // The called function.
   Function &F;
 
@@ -101,6 +203,9 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   bool HasIndirectBr;
   bool HasFrameEscape;
 
+  /// Whether the post-inlining function is still a single basic block.
+  bool SingleBB;
+
   /// Number of bytes allocated statically by the callee.
   uint64_t AllocatedSize;
   unsigned NumInstructions, NumVectorInstructions;
@@ -158,11 +263,20 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// analysis.
   void updateThreshold(CallSite CS, Function &Callee);
 
+  /// Return the largest cost of the callee body that the analysis of any call
+  /// site could look at before giving up, if its threshold was \p Threshold
+  /// before updateThreshold().
+  int getMaxWalkCost(int Threshold);
+
   /// Return true if size growth is allowed when inlining the callee at CS.
   bool allowSizeGrowth(CallSite CS);
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB, SmallPtrSetImpl<const Value *> &EphValues);
+  bool analyzeBody(SmallPtrSetImpl<const Value *> &EphValues,
+                   int SingleBBBonus);
+  bool replaySummary(const InlineCostCache::Summary &S, int SingleBBBonus,
+                     bool &IsViable);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -206,13 +320,14 @@ public:
   CallAnalyzer(const TargetTransformInfo &TTI,
                std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
                ProfileSummaryInfo *PSI, Function &Callee, int Threshold,
-               CallSite CSArg)
-      : TTI(TTI), GetAssumptionCache(GetAssumptionCache), PSI(PSI), F(Callee),
-        CandidateCS(CSArg), Threshold(Threshold), Cost(0),
-        IsCallerRecursive(false), IsRecursiveCall(false),
-        ExposesReturnsTwice(false), HasDynamicAlloca(false),
-        ContainsNoDuplicateCall(false), HasReturn(false), HasIndirectBr(false),
-        HasFrameEscape(false), AllocatedSize(0), NumInstructions(0),
+               CallSite CSArg, InlineCostCache *Cache = nullptr)
+      : TTI(TTI), GetAssumptionCache(GetAssumptionCache), PSI(PSI),
+        Cache(Cache), Recording(nullptr), F(Callee), CandidateCS(CSArg),
+        Threshold(Threshold), Cost(0), IsCallerRecursive(false),
+        IsRecursiveCall(false), ExposesReturnsTwice(false),
+        HasDynamicAlloca(false), ContainsNoDuplicateCall(false),
+        HasReturn(false), HasIndirectBr(false), HasFrameEscape(false),
+        SingleBB(true), AllocatedSize(0), NumInstructions(0),
         NumVectorInstructions(0), FiftyPercentVectorBonus(0),
         TenPercentVectorBonus(0), VectorBonus(0), NumConstantArgs(0),
         NumConstantOffsetPtrArgs(0), NumAllocaArgs(0), NumConstantPtrCmps(0),
@@ -220,6 +335,7 @@ public:
         SROACostSavings(0), SROACostSavingsLost(0) {}
 
   bool analyzeCall(CallSite CS);
+  void summarize(InlineCostCache::Summary &S);
 
   int getThreshold() { return Threshold; }
   int getCost() { return Cost; }
@@ -562,6 +678,9 @@ bool CallAnalyzer::visitUnaryInstruction(UnaryInstruction &I) {
 
 bool CallAnalyzer::paramHasAttr(Argument *A, Attribute::AttrKind Attr) {
   unsigned ArgNo = A->getArgNo();
+  // Without a call site only the declaration is known.
+  if (!CandidateCS)
+    return F.getAttributes().hasAttribute(ArgNo + 1, Attr);
   return CandidateCS.paramHasAttr(ArgNo + 1, Attr);
 }
 
@@ -663,6 +782,28 @@ void CallAnalyzer::updateThreshold(CallSite CS, Function &Callee) {
   Threshold *= TTI.getInliningThresholdMultiplier();
 }
 
+int CallAnalyzer::getMaxWalkCost(int Threshold) {
+  // Extra variadic arguments get bonuses as well, and there is no telling how
+  // many of them a call site passes.
+  if (F.isVarArg())
+    return INT_MAX;
+
+  // updateThreshold() raises the threshold at most to the hint threshold, and
+  // analyzeCall() adds the single basic block and vector bonuses to it.
+  if (DefaultInlineThreshold.getNumOccurrences() > 0)
+    Threshold = DefaultInlineThreshold;
+  int64_t MaxThreshold = std::max<int64_t>(Threshold, HintThreshold);
+  MaxThreshold *= TTI.getInliningThresholdMultiplier();
+  MaxThreshold *= 3;
+
+  // The walk starts lowest for the last call to a local function which passes
+  // all of its arguments by value in at least 8 words.
+  int64_t MinStartCost = InlineConstants::LastCallToStaticBonus -
+                         int64_t(F.arg_size()) * 2 * 8 *
+                             InlineConstants::InstrCost;
+  return std::min<int64_t>(MaxThreshold - MinStartCost, INT_MAX);
+}
+
 bool CallAnalyzer::visitCmpInst(CmpInst &I) {
   Value *LHS = I.getOperand(0), *RHS = I.getOperand(1);
   // First try to handle simplified comparisons.
@@ -964,6 +1105,10 @@ bool CallAnalyzer::visitCallSite(CallSite CS) {
     // We were able to inline the indirect call! Subtract the cost from the
     // threshold to get the bonus we want to apply, but don't go below zero.
     Cost -= std::max(0, CA.getThreshold() - CA.getCost());
+
+    // A summary relies on the cost never decreasing.
+    if (Recording)
+      Recording->IsReplayable = false;
   }
 
   return Base::visitCallSite(CS);
@@ -1090,6 +1235,7 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
     if (EphValues.count(&*I))
       continue;
 
+    int CostBefore = Cost;
     ++NumInstructions;
     if (isa<ExtractElementInst>(I) || I->getType()->isVectorTy())
       ++NumVectorInstructions;
@@ -1126,8 +1272,21 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
 
     // If the visit this instruction detected an uninlinable pattern, abort.
     if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca ||
-        HasIndirectBr || HasFrameEscape)
+        HasIndirectBr || HasFrameEscape) {
+      if (Recording)
+        Recording->CostBeforeAbort = CostBefore;
       return false;
+    }
+
+    // A summary does not know whether the caller is recursive, so remember
+    // where we would have stopped if it were.
+    if (Recording && !Recording->ExceedsRecursiveCallerAllocaSize &&
+        AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller) {
+      Recording->ExceedsRecursiveCallerAllocaSize = true;
+      Recording->SingleBBAtAllocaLimit = SingleBB;
+      Recording->CostBeforeAllocaLimit = CostBefore;
+      Recording->CostAtAllocaLimit = Cost;
+    }
 
     // If the caller is a recursive function then we don't want to inline
     // functions which allocate a lot of stack space because it would increase
@@ -1184,6 +1343,185 @@ ConstantInt *CallAnalyzer::stripAndComputeInBoundsConstantOffsets(Value *&V) {
   return cast<ConstantInt>(ConstantInt::get(IntPtrTy, Offset));
 }
 
+/// \brief Analyze the body of the callee.
+///
+/// This walks the basic blocks which are live after inlining, and accounts for
+/// their cost. It returns false if inlining is not viable, either because of
+/// an uninlinable construct or because the cost crossed the threshold.
+bool CallAnalyzer::analyzeBody(SmallPtrSetImpl<const Value *> &EphValues,
+                               int SingleBBBonus) {
+  // The worklist of live basic blocks in the callee *after* inlining. We avoid
+  // adding basic blocks of the callee which can be proven to be dead for this
+  // particular call site in order to get more accurate cost estimates. This
+  // requires a somewhat heavyweight iteration pattern: we need to walk the
+  // basic blocks in a breadth-first order as we insert live successors. To
+  // accomplish this, prioritizing for small iterations because we exit after
+  // crossing our threshold, we use a small-size optimized SetVector.
+  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
+                    SmallPtrSet<BasicBlock *, 16>>
+      BBSetVector;
+  BBSetVector BBWorklist;
+  BBWorklist.insert(&F.getEntryBlock());
+  // Note that we *must not* cache the size, this loop grows the worklist.
+  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
+    // Bail out the moment we cross the threshold. This means we'll under-count
+    // the cost, but only when undercounting doesn't matter.
+    if (Cost > Threshold)
+      break;
+
+    BasicBlock *BB = BBWorklist[Idx];
+    if (BB->empty())
+      continue;
+
+    // Disallow inlining a blockaddress. A blockaddress only has defined
+    // behavior for an indirect branch in the same function, and we do not
+    // currently support inlining indirect branches. But, the inliner may not
+    // see an indirect branch that ends up being dead code at a particular call
+    // site. If the blockaddress escapes the function, e.g., via a global
+    // variable, inlining may lead to an invalid cross-function reference.
+    if (BB->hasAddressTaken()) {
+      if (Recording)
+        Recording->CostBeforeAbort = Cost;
+      return false;
+    }
+
+    // Analyze the cost of this block. If we blow through the threshold, this
+    // returns false, and we can bail on out.
+    if (!analyzeBlock(BB, EphValues))
+      return false;
+
+    TerminatorInst *TI = BB->getTerminator();
+
+    // Add in the live successors by first checking whether we have terminator
+    // that may be simplified based on the values simplified by this call.
+    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+      if (BI->isConditional()) {
+        Value *Cond = BI->getCondition();
+        if (ConstantInt *SimpleCond =
+                dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+          BBWorklist.insert(BI->getSuccessor(SimpleCond->isZero() ? 1 : 0));
+          continue;
+        }
+      }
+    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+      Value *Cond = SI->getCondition();
+      if (ConstantInt *SimpleCond =
+              dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+        BBWorklist.insert(SI->findCaseValue(SimpleCond).getCaseSuccessor());
+        continue;
+      }
+    }
+
+    // If we're unable to select a particular successor, just count all of
+    // them.
+    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
+         ++TIdx)
+      BBWorklist.insert(TI->getSuccessor(TIdx));
+
+    // If we had any successors at this point, than post-inlining is likely to
+    // have them as well. Note that we assume any basic blocks which existed
+    // due to branches or switches which folded above will also fold after
+    // inlining.
+    if (SingleBB && TI->getNumSuccessors() > 1) {
+      // Take off the bonus we applied to the threshold.
+      Threshold -= SingleBBBonus;
+      SingleBB = false;
+      if (Recording)
+        Recording->CostAtMultiBB = Cost;
+    }
+  }
+
+  return true;
+}
+
+/// \brief Account for the callee body by replaying its summary.
+///
+/// This is only valid for a call site which tells us nothing about the
+/// arguments beyond what the summary walk assumed. The cost can only grow and
+/// the threshold can only shrink during a walk, so as long as the summary
+/// walk stayed below the threshold everywhere it was checked, the walk for
+/// this call site would have seen exactly the same thing. Otherwise it would
+/// have stopped early with a smaller cost, and we return false to leave that
+/// walk to the caller.
+bool CallAnalyzer::replaySummary(const InlineCostCache::Summary &S,
+                                 int SingleBBBonus, bool &IsViable) {
+  // Find the point at which a walk for this call site would have stopped.
+  bool StopsAtAllocaLimit =
+      IsCallerRecursive && S.ExceedsRecursiveCallerAllocaSize;
+  bool StopSingleBB = StopsAtAllocaLimit ? S.SingleBBAtAllocaLimit
+                                         : S.SingleBB;
+  int LastCheckedCost = StopsAtAllocaLimit
+                            ? S.CostBeforeAllocaLimit
+                            : S.Aborted ? S.CostBeforeAbort : S.Cost;
+  int StopThreshold = StopSingleBB ? Threshold : Threshold - SingleBBBonus;
+  if (Cost + LastCheckedCost > StopThreshold)
+    return false;
+  if (!StopSingleBB && Cost + S.CostAtMultiBB > Threshold)
+    return false;
+
+  Threshold = StopThreshold;
+  SingleBB = StopSingleBB;
+  if (StopsAtAllocaLimit) {
+    Cost += S.CostAtAllocaLimit;
+    IsViable = false;
+    return true;
+  }
+
+  Cost += S.Cost;
+  ContainsNoDuplicateCall = S.ContainsNoDuplicateCall;
+  NumInstructions = S.NumInstructions;
+  NumVectorInstructions = S.NumVectorInstructions;
+  NumInstructionsSimplified = S.NumInstructionsSimplified;
+  NumConstantPtrCmps = S.NumConstantPtrCmps;
+  NumConstantPtrDiffs = S.NumConstantPtrDiffs;
+  IsViable = !S.Aborted;
+  return true;
+}
+
+/// \brief Compute the summary of the callee.
+///
+/// This walks the body with no call site, up to a threshold which no call
+/// site can exceed. Pointer arguments are assumed to point to distinct
+/// objects, which is what lets the walk fold comparisons and differences of
+/// pointers derived from the same argument.
+void CallAnalyzer::summarize(InlineCostCache::Summary &S) {
+  assert(!CandidateCS && "Summaries are computed without a call site");
+  ++NumCalleesSummarized;
+  Recording = &S;
+
+  if (!S.HasEphValues) {
+    CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F),
+                                        S.EphValues);
+    S.HasEphValues = true;
+  }
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  APInt Zero = APInt::getNullValue(DL.getPointerSizeInBits());
+  for (Argument &A : F.args())
+    if (A.getType()->isPointerTy())
+      ConstantOffsetPtrs[&A] = std::make_pair(&A, Zero);
+
+  bool Completed = F.empty() || analyzeBody(S.EphValues, 0);
+  S.IsWalked = true;
+  if (Cost > Threshold) {
+    // Every call site stops before this point. The summary does not know the
+    // rest of the body, so they have to walk it themselves.
+    ++NumSummariesTruncated;
+    S.IsReplayable = false;
+  } else {
+    S.Aborted = !Completed;
+  }
+  S.Cost = Cost;
+  S.SingleBB = SingleBB;
+  S.ContainsNoDuplicateCall = ContainsNoDuplicateCall;
+  S.NumInstructions = NumInstructions;
+  S.NumVectorInstructions = NumVectorInstructions;
+  S.NumInstructionsSimplified = NumInstructionsSimplified;
+  S.NumConstantPtrCmps = NumConstantPtrCmps;
+  S.NumConstantPtrDiffs = NumConstantPtrDiffs;
+  Recording = nullptr;
+}
+
 /// \brief Analyze a call site for potential inlining.
 ///
 /// Returns true if inlining this call is viable, and false if it is not
@@ -1208,6 +1546,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   assert(NumVectorInstructions == 0);
 
   // Update the threshold based on callsite properties
+  int BaseThreshold = Threshold;
   updateThreshold(CS, F);
 
   FiftyPercentVectorBonus = 3 * Threshold / 2;
@@ -1217,7 +1556,6 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   // Track whether the post-inlining function would have more than one basic
   // block. A single basic block is often intended for inlining. Balloon the
   // threshold by 50% until we pass the single-BB phase.
-  bool SingleBB = true;
   int SingleBBBonus = Threshold / 2;
 
   // Speculatively apply all possible bonuses to Threshold. If cost exceeds
@@ -1286,7 +1624,12 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   }
 
   // Populate our simplified values by mapping from function arguments to call
-  // arguments with known important simplifications.
+  // arguments with known important simplifications. Along the way, find out
+  // whether the call site tells us anything a callee summary does not know:
+  // constant or alloca arguments, pointer arguments which are not known to
+  // point to distinct objects, or extra non-null attributes.
+  bool IsContextFree = true;
+  SmallPtrSet<Value *, 4> PtrArgBases;
   CallSite::arg_iterator CAI = CS.arg_begin();
   for (Function::arg_iterator FAI = F.arg_begin(), FAE = F.arg_end();
        FAI != FAE; ++FAI, ++CAI) {
@@ -1303,92 +1646,61 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
         SROAArgValues[&*FAI] = PtrArg;
         SROAArgCosts[PtrArg] = 0;
       }
+
+      if (!FAI->getType()->isPointerTy() || !C->isZero() ||
+          !PtrArgBases.insert(PtrArg).second)
+        IsContextFree = false;
+    } else if (FAI->getType()->isPointerTy()) {
+      IsContextFree = false;
     }
+
+    if (paramHasAttr(&*FAI, Attribute::NonNull) !=
+        F.getAttributes().hasAttribute(FAI->getArgNo() + 1,
+                                       Attribute::NonNull))
+      IsContextFree = false;
   }
   NumConstantArgs = SimplifiedValues.size();
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
-
-  // FIXME: If a caller has multiple calls to a callee, we end up recomputing
-  // the ephemeral values multiple times (and they're completely determined by
-  // the callee, so this is purely duplicate work).
-  SmallPtrSet<const Value *, 32> EphValues;
-  CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F), EphValues);
-
-  // The worklist of live basic blocks in the callee *after* inlining. We avoid
-  // adding basic blocks of the callee which can be proven to be dead for this
-  // particular call site in order to get more accurate cost estimates. This
-  // requires a somewhat heavyweight iteration pattern: we need to walk the
-  // basic blocks in a breadth-first order as we insert live successors. To
-  // accomplish this, prioritizing for small iterations because we exit after
-  // crossing our threshold, we use a small-size optimized SetVector.
-  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
-                    SmallPtrSet<BasicBlock *, 16>>
-      BBSetVector;
-  BBSetVector BBWorklist;
-  BBWorklist.insert(&F.getEntryBlock());
-  // Note that we *must not* cache the size, this loop grows the worklist.
-  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
-    // Bail out the moment we cross the threshold. This means we'll under-count
-    // the cost, but only when undercounting doesn't matter.
-    if (Cost > Threshold)
-      break;
-
-    BasicBlock *BB = BBWorklist[Idx];
-    if (BB->empty())
-      continue;
-
-    // Disallow inlining a blockaddress. A blockaddress only has defined
-    // behavior for an indirect branch in the same function, and we do not
-    // currently support inlining indirect branches. But, the inliner may not
-    // see an indirect branch that ends up being dead code at a particular call
-    // site. If the blockaddress escapes the function, e.g., via a global
-    // variable, inlining may lead to an invalid cross-function reference.
-    if (BB->hasAddressTaken())
-      return false;
-
-    // Analyze the cost of this block. If we blow through the threshold, this
-    // returns false, and we can bail on out.
-    if (!analyzeBlock(BB, EphValues))
-      return false;
-
-    TerminatorInst *TI = BB->getTerminator();
-
-    // Add in the live successors by first checking whether we have terminator
-    // that may be simplified based on the values simplified by this call.
-    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
-      if (BI->isConditional()) {
-        Value *Cond = BI->getCondition();
-        if (ConstantInt *SimpleCond =
-                dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-          BBWorklist.insert(BI->getSuccessor(SimpleCond->isZero() ? 1 : 0));
-          continue;
-        }
-      }
-    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
-      Value *Cond = SI->getCondition();
-      if (ConstantInt *SimpleCond =
-              dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-        BBWorklist.insert(SI->findCaseValue(SimpleCond).getCaseSuccessor());
-        continue;
-      }
+  if (NumConstantArgs || NumAllocaArgs)
+    IsContextFree = false;
+
+  // The ephemeral values are completely determined by the callee, so keep
+  // them in the cache if we have one.
+  InlineCostCache::Summary *S = Cache ? &Cache->getSummary(F) : nullptr;
+  SmallPtrSet<const Value *, 32> LocalEphValues;
+  SmallPtrSetImpl<const Value *> *EphValues = &LocalEphValues;
+  if (S) {
+    if (!S->HasEphValues) {
+      CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F),
+                                          S->EphValues);
+      S->HasEphValues = true;
     }
+    EphValues = &S->EphValues;
+  } else {
+    CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F),
+                                        LocalEphValues);
+  }
 
-    // If we're unable to select a particular successor, just count all of
-    // them.
-    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
-         ++TIdx)
-      BBWorklist.insert(TI->getSuccessor(TIdx));
-
-    // If we had any successors at this point, than post-inlining is likely to
-    // have them as well. Note that we assume any basic blocks which existed
-    // due to branches or switches which folded above will also fold after
-    // inlining.
-    if (SingleBB && TI->getNumSuccessors() > 1) {
-      // Take off the bonus we applied to the threshold.
-      Threshold -= SingleBBBonus;
-      SingleBB = false;
+  // The summary relies on the threshold only ever going down during the walk,
+  // which does not hold for the bonuses of a negative threshold.
+  if (S && IsContextFree && SingleBBBonus >= 0 &&
+      FiftyPercentVectorBonus >= 0) {
+    if (!S->IsWalked) {
+      CallAnalyzer CA(TTI, GetAssumptionCache, PSI, F,
+                      getMaxWalkCost(BaseThreshold), CallSite());
+      CA.summarize(*S);
+    }
+    bool IsViable;
+    if (S->IsReplayable && replaySummary(*S, SingleBBBonus, IsViable)) {
+      ++NumSummariesReplayed;
+      if (!IsViable)
+        return false;
+    } else if (!analyzeBody(*EphValues, SingleBBBonus)) {
+      return false;
     }
+  } else if (!analyzeBody(*EphValues, SingleBBBonus)) {
+    return false;
   }
 
   // If this is a noduplicate call, we can still inline as long as
@@ -1447,9 +1759,9 @@ static bool functionsHaveCompatibleAttributes(Function *Caller,
 InlineCost llvm::getInlineCost(
     CallSite CS, int DefaultThreshold, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI, InlineCostCache *Cache) {
   return getInlineCost(CS, CS.getCalledFunction(), DefaultThreshold, CalleeTTI,
-                       GetAssumptionCache, PSI);
+                       GetAssumptionCache, PSI, Cache);
 }
 
 int llvm::computeThresholdFromOptLevels(unsigned OptLevel,
@@ -1469,7 +1781,7 @@ InlineCost llvm::getInlineCost(
     CallSite CS, Function *Callee, int DefaultThreshold,
     TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI, InlineCostCache *Cache) {
 
   // Cannot inline indirect calls.
   if (!Callee)
@@ -1503,7 +1815,8 @@ InlineCost llvm::getInlineCost(
   DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
                      << "...\n");
 
-  CallAnalyzer CA(CalleeTTI, GetAssumptionCache, PSI, *Callee, DefaultThreshold, CS);
+  CallAnalyzer CA(CalleeTTI, GetAssumptionCache, PSI, *Callee, DefaultThreshold,
+                  CS, EnableCostCache ? Cache : nullptr);
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
@@ -293,8 +293,12 @@ selectELFSectionForGlobal(MCContext &Ctx, const GlobalValue *GV,
   } else {
     Name = getSectionPrefixForGlobal(Kind);
   }
-  // FIXME: Extend the section prefix to include hotness catagories such as .hot
-  //  or .unlikely for functions.
+
+  // Functions with a hotness category go to .text.hot or .text.unlikely so
+  // that the linker can group them.
+  if (const Function *F = dyn_cast<Function>(GV))
+    if (Optional<StringRef> Prefix = F->getSectionPrefix())
+      Name += *Prefix;
 
   if (EmitUniqueSection && UniqueSectionNames) {
     Name.push_back('.');
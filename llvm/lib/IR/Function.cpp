@@ -1265,3 +1265,19 @@ Optional<uint64_t> Function::getEntryCount() const {
       }
   return None;
 }
+
+void Function::setSectionPrefix(StringRef Prefix) {
+  MDBuilder MDB(getContext());
+  setMetadata(LLVMContext::MD_section_prefix,
+              MDB.createFunctionSectionPrefix(Prefix));
+}
+
+Optional<StringRef> Function::getSectionPrefix() const {
+  MDNode *MD = getMetadata(LLVMContext::MD_section_prefix);
+  if (MD && MD->getNumOperands() == 2)
+    if (MDString *MDS = dyn_cast<MDString>(MD->getOperand(0)))
+      if (MDS->getString().equals("function_section_prefix"))
+        if (MDString *Prefix = dyn_cast<MDString>(MD->getOperand(1)))
+          return Prefix->getString();
+  return None;
+}
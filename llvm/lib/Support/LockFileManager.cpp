@@ -13,6 +13,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Signals.h"
+#include <algorithm>
 #include <sys/stat.h>
 #include <sys/types.h>
 #if LLVM_ON_WIN32
@@ -283,26 +284,27 @@ LockFileManager::WaitForUnlockResult LockFileManager::waitForUnlock() {
   if (getState() != LFS_Shared)
     return Res_Success;
 
-#if LLVM_ON_WIN32
-  unsigned long Interval = 1;
-#else
-  struct timespec Interval;
-  Interval.tv_sec = 0;
-  Interval.tv_nsec = 1000000;
-#endif
-  // Don't wait more than five minutes per iteration. Total timeout for the file
-  // to appear is ~8.5 mins.
-  const unsigned MaxSeconds = 5*60;
+  // Poll with an exponentially increasing interval, but don't sleep for more
+  // than half a second at a time so that we notice promptly when the owner is
+  // done. Total timeout for the file to appear is ~8.5 mins.
+  const unsigned MaxIntervalMS = 500;
+  const unsigned MaxWaitMS = 510 * 1000;
+  unsigned IntervalMS = 1;
+  unsigned WaitedMS = 0;
   do {
     // Sleep for the designated interval, to allow the owning process time to
     // finish up and remove the lock file.
     // FIXME: Should we hook in to system APIs to get a notification when the
     // lock file is deleted?
 #if LLVM_ON_WIN32
-    Sleep(Interval);
+    Sleep(IntervalMS);
 #else
+    struct timespec Interval;
+    Interval.tv_sec = IntervalMS / 1000;
+    Interval.tv_nsec = (IntervalMS % 1000) * 1000000;
     nanosleep(&Interval, nullptr);
 #endif
+    WaitedMS += IntervalMS;
 
     if (sys::fs::access(LockFileName.c_str(), sys::fs::AccessMode::Exist) ==
         errc::no_such_file_or_directory) {
@@ -317,23 +319,8 @@ LockFileManager::WaitForUnlockResult LockFileManager::waitForUnlock() {
       return Res_OwnerDied;
 
     // Exponentially increase the time we wait for the lock to be removed.
-#if LLVM_ON_WIN32
-    Interval *= 2;
-#else
-    Interval.tv_sec *= 2;
-    Interval.tv_nsec *= 2;
-    if (Interval.tv_nsec >= 1000000000) {
-      ++Interval.tv_sec;
-      Interval.tv_nsec -= 1000000000;
-    }
-#endif
-  } while (
-#if LLVM_ON_WIN32
-           Interval < MaxSeconds * 1000
-#else
-           Interval.tv_sec < (time_t)MaxSeconds
-#endif
-           );
+    IntervalMS = std::min(IntervalMS * 2, MaxIntervalMS);
+  } while (WaitedMS < MaxWaitMS);
 
   // Give up.
   return Res_Timeout;
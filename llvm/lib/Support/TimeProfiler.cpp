@@ -0,0 +1,229 @@
+//===-- TimeProfiler.cpp - Hierarchical Time Profiler ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the hierarchical time profiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+
+namespace llvm {
+
+LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+
+typedef std::chrono::microseconds DurationType;
+typedef std::chrono::steady_clock::time_point TimePointType;
+
+namespace {
+struct Entry {
+  TimePointType Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+
+  Entry(TimePointType Start, std::string Name, std::string Detail)
+      : Start(Start), Duration(0), Name(std::move(Name)),
+        Detail(std::move(Detail)) {}
+};
+
+/// The number of times a section was entered and the time spent in it.
+struct Total {
+  unsigned Count = 0;
+  DurationType Duration = DurationType(0);
+};
+} // end anonymous namespace
+
+struct TimeTraceProfiler {
+  TimeTraceProfiler(unsigned TimeTraceGranularity)
+      : StartTime(std::chrono::steady_clock::now()),
+        TimeTraceGranularity(TimeTraceGranularity) {}
+
+  void begin(std::string Name, std::string Detail) {
+    Stack.emplace_back(std::chrono::steady_clock::now(), std::move(Name),
+                       std::move(Detail));
+  }
+
+  void end() {
+    // The profiler may have been enabled while sections were open.
+    if (Stack.empty())
+      return;
+
+    Entry &E = Stack.back();
+    E.Duration = std::chrono::duration_cast<DurationType>(
+        std::chrono::steady_clock::now() - E.Start);
+
+    // A section nested in a section of the same name, as in a recursive
+    // instantiation, is already part of the outer section's time.
+    auto SameName = [&](const Entry &Outer) { return Outer.Name == E.Name; };
+    if (std::none_of(Stack.begin(), Stack.end() - 1, SameName)) {
+      Total &T = TotalPerName[E.Name];
+      ++T.Count;
+      T.Duration += E.Duration;
+    }
+
+    if (E.Duration.count() >= (int64_t)TimeTraceGranularity) {
+      auto SameDetail = [&](const Entry &Outer) {
+        return Outer.Name == E.Name && Outer.Detail == E.Detail;
+      };
+      if (std::none_of(Stack.begin(), Stack.end() - 1, SameDetail)) {
+        Total &T = TotalPerDetail[E.Name][E.Detail];
+        ++T.Count;
+        T.Duration += E.Duration;
+      }
+      Entries.push_back(std::move(E));
+    }
+    Stack.pop_back();
+  }
+
+  void write(raw_ostream &OS);
+  void printSummary(raw_ostream &OS, unsigned N);
+
+  std::vector<Entry> Stack;
+  std::vector<Entry> Entries;
+  StringMap<Total> TotalPerName;
+  StringMap<StringMap<Total>> TotalPerDetail;
+  const TimePointType StartTime;
+  const unsigned TimeTraceGranularity;
+};
+
+} // end namespace llvm
+
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << "\\u" << format_hex_no_prefix(C, 4);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+static void writeEvent(raw_ostream &OS, unsigned Tid, int64_t Start,
+                       int64_t Duration, StringRef Name, StringRef Detail) {
+  OS << "{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"X\",\"ts\":" << Start
+     << ",\"dur\":" << Duration << ",\"name\":";
+  writeJSONString(OS, Name);
+  OS << ",\"args\":{\"detail\":";
+  writeJSONString(OS, Detail);
+  OS << "}}";
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) {
+  assert(Stack.empty() && "time sections are still open");
+
+  OS << "{\"traceEvents\":[";
+  StringRef Separator = "";
+  for (const Entry &E : Entries) {
+    int64_t Start = std::chrono::duration_cast<DurationType>(
+                        E.Start - StartTime).count();
+    OS << Separator << '\n';
+    writeEvent(OS, 0, Start, E.Duration.count(), E.Name, E.Detail);
+    Separator = ",";
+  }
+
+  // Emit the totals on their own rows, most expensive first, each starting at
+  // the beginning of the trace so that their lengths can be compared.
+  std::vector<const StringMapEntry<Total> *> Totals;
+  for (const auto &T : TotalPerName)
+    Totals.push_back(&T);
+  std::sort(Totals.begin(), Totals.end(),
+            [](const StringMapEntry<Total> *L, const StringMapEntry<Total> *R) {
+              if (L->getValue().Duration != R->getValue().Duration)
+                return L->getValue().Duration > R->getValue().Duration;
+              return L->getKey() < R->getKey();
+            });
+  unsigned Tid = 1;
+  for (const StringMapEntry<Total> *T : Totals) {
+    OS << Separator << '\n';
+    std::string Detail;
+    raw_string_ostream(Detail) << T->getValue().Count << " calls";
+    writeEvent(OS, Tid++, 0, T->getValue().Duration.count(),
+               "Total " + T->getKey().str(), Detail);
+    Separator = ",";
+  }
+
+  OS << "\n],\n\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void TimeTraceProfiler::printSummary(raw_ostream &OS, unsigned N) {
+  std::vector<StringRef> Names;
+  for (const auto &T : TotalPerDetail)
+    Names.push_back(T.getKey());
+  std::sort(Names.begin(), Names.end());
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                      Time trace summary (top " << N << ")\n"
+     << "===" << std::string(73, '-') << "===\n";
+  for (StringRef Name : Names) {
+    std::vector<const StringMapEntry<Total> *> Details;
+    for (const auto &D : TotalPerDetail[Name])
+      Details.push_back(&D);
+    std::sort(Details.begin(), Details.end(),
+              [](const StringMapEntry<Total> *L,
+                 const StringMapEntry<Total> *R) {
+                if (L->getValue().Duration != R->getValue().Duration)
+                  return L->getValue().Duration > R->getValue().Duration;
+                return L->getKey() < R->getKey();
+              });
+    if (Details.size() > N)
+      Details.resize(N);
+
+    OS << Name << ":\n";
+    for (const StringMapEntry<Total> *D : Details) {
+      double Milliseconds = D->getValue().Duration.count() / 1000.0;
+      OS << format("  %10.3f ms %8u  ", Milliseconds, D->getValue().Count)
+         << D->getKey() << '\n';
+    }
+  }
+}
+
+void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity) {
+  assert(TimeTraceProfilerInstance == nullptr &&
+         "profiler should not be initialized");
+  TimeTraceProfilerInstance = new TimeTraceProfiler(TimeTraceGranularity);
+}
+
+void llvm::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void llvm::timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "profiler object not initialized");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+void llvm::timeTraceProfilerPrintSummary(raw_ostream &OS, unsigned N) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "profiler object not initialized");
+  TimeTraceProfilerInstance->printSummary(OS, N);
+}
+
+void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void llvm::timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->end();
+}
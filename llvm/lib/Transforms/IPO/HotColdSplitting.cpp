@@ -0,0 +1,311 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass uses the profile to find the cold regions of functions and
+// outlines them into separate cold functions, so that the hot code of a
+// function is laid out densely and the cold code is placed in .text.unlikely.
+//
+// A cold region is a set of cold blocks with a single entry block that
+// dominates the rest of the region. Regions are grown from the first cold
+// block found in reverse post-order, so that they are as large as possible.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/EHPersonalities.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+#include "llvm/Transforms/Utils/Local.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumFunctionsSplit, "Number of functions split");
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+
+static cl::opt<unsigned> MinOutlineSize(
+    "hotcoldsplit-min-size", cl::init(4), cl::Hidden,
+    cl::desc("Minimum number of instructions in a cold region for it to be "
+             "outlined"));
+
+namespace {
+/// A cold region and the profile count of its entry.
+struct ColdRegion {
+  SmallVector<BasicBlock *, 8> Blocks;
+  uint64_t EntryCount;
+};
+
+class HotColdSplitting {
+public:
+  HotColdSplitting(ProfileSummaryInfo &PSI) : PSI(PSI) {}
+  bool run(Module &M);
+
+private:
+  bool shouldSplit(const Function &F);
+  void findColdRegions(Function &F, SmallVectorImpl<ColdRegion> &Regions);
+  bool splitFunction(Function &F);
+
+  ProfileSummaryInfo &PSI;
+};
+
+struct HotColdSplittingLegacyPass : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  HotColdSplittingLegacyPass() : ModulePass(ID) {
+    initializeHotColdSplittingLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
+  bool runOnModule(Module &M) override {
+    if (skipModule(M))
+      return false;
+
+    ProfileSummaryInfo *PSI =
+        getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI(M);
+    return HotColdSplitting(*PSI).run(M);
+  }
+};
+}
+
+/// Only functions that have a profile, and that are not cold as a whole, are
+/// split.
+bool HotColdSplitting::shouldSplit(const Function &F) {
+  if (F.isDeclaration() || !F.getEntryCount())
+    return false;
+  if (F.hasFnAttribute(Attribute::OptimizeNone) ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+  // A cold region could contain the second return of a setjmp.
+  if (F.callsFunctionThatReturnsTwice())
+    return false;
+  // Calls in funclets need a funclet operand bundle, which the code extractor
+  // does not add.
+  if (F.hasPersonalityFn() &&
+      isFuncletEHPersonality(classifyEHPersonality(F.getPersonalityFn())))
+    return false;
+  return !PSI.isColdFunction(&F);
+}
+
+/// Return true if \p BB contains a call that must be followed by a return of
+/// its function, which outlining would separate.
+static bool mustReturnFromFunction(const BasicBlock &BB) {
+  for (const Instruction &I : BB)
+    if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+      if (CI->isMustTailCall())
+        return true;
+      if (const Function *Callee = CI->getCalledFunction())
+        if (Callee->getIntrinsicID() == Intrinsic::experimental_deoptimize)
+          return true;
+    }
+  return false;
+}
+
+/// Return true if the instructions of \p Blocks are worth a call to an
+/// outlined function.
+static bool isLargeEnough(ArrayRef<BasicBlock *> Blocks) {
+  unsigned Size = 0;
+  for (BasicBlock *BB : Blocks)
+    for (Instruction &I : *BB) {
+      if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (++Size >= MinOutlineSize)
+        return true;
+    }
+  return false;
+}
+
+/// The code extractor merges the incoming values of an exit block that come
+/// from different blocks of the region, which is only correct when there is
+/// at most one such block.
+static bool hasMergingExit(const SmallPtrSetImpl<BasicBlock *> &Region) {
+  for (BasicBlock *BB : Region)
+    for (BasicBlock *Succ : successors(BB)) {
+      if (Region.count(Succ) || !isa<PHINode>(Succ->begin()))
+        continue;
+      SmallPtrSet<BasicBlock *, 4> RegionPreds;
+      for (BasicBlock *Pred : predecessors(Succ))
+        if (Region.count(Pred))
+          RegionPreds.insert(Pred);
+      if (RegionPreds.size() > 1)
+        return true;
+    }
+  return false;
+}
+
+void HotColdSplitting::findColdRegions(Function &F,
+                                       SmallVectorImpl<ColdRegion> &Regions) {
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+  BranchProbabilityInfo BPI(F, LI);
+  BlockFrequencyInfo BFI(F, BPI, LI);
+
+  SmallPtrSet<BasicBlock *, 16> ColdBlocks;
+  for (BasicBlock &BB : F) {
+    if (&BB == &F.getEntryBlock() ||
+        !CodeExtractor::isBlockValidForExtraction(BB) ||
+        mustReturnFromFunction(BB))
+      continue;
+    Optional<uint64_t> Count = BFI.getBlockProfileCount(&BB);
+    if (Count && PSI.isColdCount(*Count))
+      ColdBlocks.insert(&BB);
+  }
+  if (ColdBlocks.empty())
+    return;
+
+  SmallPtrSet<BasicBlock *, 16> Taken;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *Header : RPOT) {
+    if (!ColdBlocks.count(Header) || Taken.count(Header))
+      continue;
+
+    // Collect the cold blocks that the header dominates and that are reached
+    // from it through cold blocks.
+    SmallSetVector<BasicBlock *, 8> Candidates;
+    SmallVector<BasicBlock *, 8> Worklist;
+    Candidates.insert(Header);
+    Worklist.push_back(Header);
+    while (!Worklist.empty()) {
+      BasicBlock *BB = Worklist.pop_back_val();
+      for (BasicBlock *Succ : successors(BB))
+        if (ColdBlocks.count(Succ) && !Taken.count(Succ) &&
+            DT.dominates(Header, Succ) && Candidates.insert(Succ))
+          Worklist.push_back(Succ);
+    }
+
+    // Only the header may be entered from outside of the region. Dropping a
+    // block can make its successors entered from outside, so iterate.
+    SmallPtrSet<BasicBlock *, 16> Region(Candidates.begin(), Candidates.end());
+    bool Pruned;
+    do {
+      Pruned = false;
+      for (BasicBlock *BB : Candidates) {
+        if (BB == Header || !Region.count(BB))
+          continue;
+        for (BasicBlock *Pred : predecessors(BB))
+          if (!Region.count(Pred)) {
+            Region.erase(BB);
+            Pruned = true;
+            break;
+          }
+      }
+    } while (Pruned);
+
+    ColdRegion R;
+    for (BasicBlock *BB : Candidates)
+      if (Region.count(BB)) {
+        R.Blocks.push_back(BB);
+        Taken.insert(BB);
+      }
+    if (!isLargeEnough(R.Blocks) || hasMergingExit(Region))
+      continue;
+
+    R.EntryCount = BFI.getBlockProfileCount(Header).getValueOr(0);
+    Regions.push_back(std::move(R));
+  }
+}
+
+bool HotColdSplitting::splitFunction(Function &F) {
+  SmallVector<ColdRegion, 4> Regions;
+  findColdRegions(F, Regions);
+
+  bool Changed = false;
+  for (ColdRegion &R : Regions) {
+    // Each extraction changes the CFG of the function, so the code extractor
+    // gets a fresh dominator tree.
+    DominatorTree DT(F);
+    CodeExtractor CE(R.Blocks, &DT);
+    if (!CE.isEligible())
+      continue;
+
+    // Tokens cannot be passed to or returned from the outlined function.
+    SetVector<Value *> Inputs, Outputs;
+    CE.findInputsOutputs(Inputs, Outputs);
+    auto IsToken = [](Value *V) { return V->getType()->isTokenTy(); };
+    if (any_of(Inputs, IsToken) || any_of(Outputs, IsToken))
+      continue;
+
+    Function *Outlined = CE.extractCodeRegion();
+    if (!Outlined)
+      continue;
+
+    DEBUG(dbgs() << "HotColdSplitting: outlined " << Outlined->getName()
+                 << " from " << F.getName() << "\n");
+    Outlined->addFnAttr(Attribute::Cold);
+    Outlined->addFnAttr(Attribute::MinSize);
+    Outlined->addFnAttr(Attribute::NoInline);
+    Outlined->setEntryCount(R.EntryCount);
+    Outlined->setSectionPrefix(getUnlikelySectionPrefix());
+
+    // Error paths usually end in a call to a noreturn function. When the
+    // outlined region never leaves, neither does the call to it.
+    if (none_of(*Outlined, [](const BasicBlock &BB) {
+          return isa<ReturnInst>(BB.getTerminator());
+        })) {
+      Outlined->setDoesNotReturn();
+      CallInst *CI = cast<CallInst>(Outlined->user_back());
+      CI->setDoesNotReturn();
+      changeToUnreachable(CI->getNextNode(), /*UseLLVMTrap=*/false);
+    }
+    ++NumColdRegionsOutlined;
+    Changed = true;
+  }
+
+  if (Changed)
+    ++NumFunctionsSplit;
+  return Changed;
+}
+
+bool HotColdSplitting::run(Module &M) {
+  // Collect the functions first, the module grows as regions are outlined.
+  std::vector<Function *> Worklist;
+  for (Function &F : M)
+    if (shouldSplit(F))
+      Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= splitFunction(*F);
+  return Changed;
+}
+
+char HotColdSplittingLegacyPass::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplittingLegacyPass, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(HotColdSplittingLegacyPass, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplittingLegacyPass();
+}
+
+PreservedAnalyses HotColdSplittingPass::run(Module &M,
+                                            ModuleAnalysisManager &AM) {
+  ProfileSummaryInfo &PSI = AM.getResult<ProfileSummaryAnalysis>(M);
+  if (HotColdSplitting(PSI).run(M))
+    return PreservedAnalyses::none();
+  return PreservedAnalyses::all();
+}
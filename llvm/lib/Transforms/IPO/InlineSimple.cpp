@@ -66,7 +66,7 @@ public:
       return ACT->getAssumptionCache(F);
     };
     return llvm::getInlineCost(CS, DefaultThreshold, TTI, GetAssumptionCache,
-                               PSI);
+                               PSI, &CostCache);
   }
 
   bool runOnSCC(CallGraphSCC &SCC) override;
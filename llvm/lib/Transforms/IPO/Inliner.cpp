@@ -13,6 +13,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -33,6 +35,7 @@
 #include "llvm/Transforms/IPO/InlinerPass.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include <queue>
 using namespace llvm;
 
 #define DEBUG_TYPE "inline"
@@ -382,7 +385,7 @@ static bool
 inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
                 std::function<AssumptionCache &(Function &)> GetAssumptionCache,
                 ProfileSummaryInfo *PSI, TargetLibraryInfo &TLI,
-                bool InsertLifetime,
+                bool InsertLifetime, InlineCostCache &CostCache,
                 std::function<InlineCost(CallSite CS)> GetInlineCost,
                 std::function<AAResults &(Function &)> AARGetter) {
   SmallPtrSet<Function*, 8> SCCFunctions;
@@ -470,6 +473,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
         CS.getInstruction()->eraseFromParent();
+        CostCache.invalidate(*Caller);
         ++NumCallsDeleted;
       } else {
         // We can only inline direct calls to non-declarations.
@@ -511,6 +515,10 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         }
         ++NumInlined;
 
+        // The caller changed, so its summary is stale for the analysis of
+        // the calls to it.
+        CostCache.invalidate(*Caller);
+
         // Report the inline decision.
         emitOptimizationRemark(
             CallerCtx, DEBUG_TYPE, *Caller, DLoc,
@@ -547,6 +555,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         CalleeNode->removeAllCalledFunctions();
         
         // Removing the node for callee from the call graph and delete it.
+        CostCache.invalidate(*Callee);
         delete CG.removeFunctionFromModule(CalleeNode);
         ++NumDeleted;
       }
@@ -589,9 +598,23 @@ bool Inliner::inlineCalls(CallGraphSCC &SCC) {
   auto GetAssumptionCache = [&](Function &F) -> AssumptionCache & {
     return ACT->getAssumptionCache(F);
   };
-  return inlineCallsImpl(SCC, CG, GetAssumptionCache, PSI, TLI, InsertLifetime,
-                         [this](CallSite CS) { return getInlineCost(CS); },
-                         AARGetter);
+  // The summaries of the functions in SCCs below this one are kept: the
+  // bottom-up walk is done with those functions, so nothing changes them
+  // until the walk is over. The functions of this SCC may have been changed
+  // by other passes since they were summarized, and the passes that run on
+  // this SCC after the inliner may change them again.
+  invalidateSummaries(SCC);
+  bool Changed = inlineCallsImpl(
+      SCC, CG, GetAssumptionCache, PSI, TLI, InsertLifetime, CostCache,
+      [this](CallSite CS) { return getInlineCost(CS); }, AARGetter);
+  invalidateSummaries(SCC);
+  return Changed;
+}
+
+void Inliner::invalidateSummaries(CallGraphSCC &SCC) {
+  for (CallGraphNode *Node : SCC)
+    if (Function *F = Node->getFunction())
+      CostCache.invalidate(*F);
 }
 
 /// Remove now-dead linkonce functions at the end of
@@ -602,6 +625,10 @@ bool Inliner::doFinalization(CallGraph &CG) {
 
 /// Remove dead functions that are not included in DNR (Do Not Remove) list.
 bool Inliner::removeDeadFunctions(CallGraph &CG, bool AlwaysInlineOnly) {
+  // The walk over the call graph is done, and any function may change before
+  // the next one.
+  CostCache.clear();
+
   SmallVector<CallGraphNode*, 16> FunctionsToRemove;
   SmallVector<CallGraphNode *, 16> DeadFunctionsInComdats;
   SmallDenseMap<const Comdat *, int, 16> ComdatEntriesAlive;
@@ -703,3 +730,275 @@ bool Inliner::removeDeadFunctions(CallGraph &CG, bool AlwaysInlineOnly) {
   }
   return true;
 }
+
+namespace {
+/// A call site waiting to be considered by the new pass manager's inliner.
+struct InlineCandidate {
+  WeakVH Call;
+  int InlineHistoryID;
+  int Priority;
+  /// Breaks ties in favor of the call sites found first.
+  unsigned Order;
+};
+
+struct InlineCandidateCompare {
+  bool operator()(const InlineCandidate &LHS,
+                  const InlineCandidate &RHS) const {
+    if (LHS.Priority != RHS.Priority)
+      return LHS.Priority < RHS.Priority;
+    return LHS.Order > RHS.Order;
+  }
+};
+} // end anonymous namespace
+
+/// The priority of inlining a call site with the given cost. The further the
+/// cost is below the threshold the more profitable inlining is expected to
+/// be.
+static int getInlinePriority(const InlineCost &IC) {
+  if (IC.isAlways())
+    return INT_MAX;
+  if (IC.isNever())
+    return INT_MIN;
+  return IC.getCostDelta();
+}
+
+/// Bring the outgoing edges of \p N up to date after inlining into its
+/// function.
+///
+/// Inlining a callee from a child RefSCC only adds references to descendants
+/// of that RefSCC, and may drop references to any function. The edges which
+/// stay within the RefSCC of \p N are kept as they are, which at worst leaves
+/// it more connected than necessary.
+static void updateOutgoingEdges(LazyCallGraph &G, LazyCallGraph::Node &N) {
+  LazyCallGraph::RefSCC &RC = *G.lookupRefSCC(N);
+
+  // Find the functions referenced now, the same way the graph does.
+  MapVector<Function *, LazyCallGraph::Edge::Kind> NewEdges;
+  SmallVector<Constant *, 16> Worklist;
+  SmallPtrSet<Constant *, 16> Visited;
+  for (BasicBlock &BB : N.getFunction())
+    for (Instruction &I : BB) {
+      if (auto CS = CallSite(&I))
+        if (Function *Callee = CS.getCalledFunction())
+          if (!Callee->isDeclaration()) {
+            Visited.insert(Callee);
+            NewEdges[Callee] = LazyCallGraph::Edge::Call;
+          }
+
+      for (Value *Op : I.operand_values())
+        if (Constant *C = dyn_cast<Constant>(Op))
+          if (Visited.insert(C).second)
+            Worklist.push_back(C);
+    }
+  while (!Worklist.empty()) {
+    Constant *C = Worklist.pop_back_val();
+    if (Function *F = dyn_cast<Function>(C)) {
+      if (!F->isDeclaration())
+        NewEdges.insert(std::make_pair(F, LazyCallGraph::Edge::Ref));
+      continue;
+    }
+    for (Value *Op : C->operand_values())
+      if (Constant *OpC = dyn_cast<Constant>(Op))
+        if (Visited.insert(OpC).second)
+          Worklist.push_back(OpC);
+  }
+
+  SmallVector<std::pair<Function *, bool>, 16> OldEdges;
+  SmallPtrSet<Function *, 16> OldTargets;
+  for (LazyCallGraph::Edge &E : N) {
+    OldEdges.push_back(std::make_pair(&E.getFunction(), E.isCall()));
+    OldTargets.insert(&E.getFunction());
+  }
+
+  // Insert the new edges before removing the old ones, so that the targets
+  // stay reachable through the inlined callees while we do so.
+  for (auto &Entry : NewEdges) {
+    LazyCallGraph::Node &TargetN = G.get(*Entry.first);
+    if (G.lookupRefSCC(TargetN) == &RC || OldTargets.count(Entry.first))
+      continue;
+    RC.insertOutgoingEdge(N, TargetN, Entry.second);
+  }
+  for (auto &Edge : OldEdges) {
+    LazyCallGraph::Node &TargetN = G.get(*Edge.first);
+    if (G.lookupRefSCC(TargetN) == &RC)
+      continue;
+    auto NewI = NewEdges.find(Edge.first);
+    if (NewI == NewEdges.end())
+      RC.removeOutgoingEdge(N, TargetN);
+    else if (Edge.second && NewI->second != LazyCallGraph::Edge::Call)
+      RC.switchOutgoingEdgeToRef(N, TargetN);
+    else if (!Edge.second && NewI->second == LazyCallGraph::Edge::Call)
+      RC.switchOutgoingEdgeToCall(N, TargetN);
+  }
+}
+
+PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &C,
+                                   CGSCCAnalysisManager &AM) {
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerCGSCCProxy>(C).getManager();
+  const ModuleAnalysisManager &MAM =
+      AM.getResult<ModuleAnalysisManagerCGSCCProxy>(C).getManager();
+  Module &M = *C.begin()->getFunction().getParent();
+  LazyCallGraph &G = *MAM.getCachedResult<LazyCallGraphAnalysis>(M);
+  LazyCallGraph::RefSCC &RC = C.getOuterRefSCC();
+  // The module analyses can't be computed from here. Without a cached profile
+  // summary, use one of our own.
+  ProfileSummaryInfo *PSI = MAM.getCachedResult<ProfileSummaryAnalysis>(M);
+  Optional<ProfileSummaryInfo> LocalPSI;
+  if (!PSI) {
+    LocalPSI.emplace(M);
+    PSI = LocalPSI.getPointer();
+  }
+
+  std::function<AssumptionCache &(Function &)> GetAssumptionCache =
+      [&](Function &F) -> AssumptionCache & {
+    return FAM.getResult<AssumptionAnalysis>(F);
+  };
+  std::function<AAResults &(Function &)> AARGetter =
+      [&](Function &F) -> AAResults & { return FAM.getResult<AAManager>(F); };
+
+  // The callees are never in this RefSCC, and the bottom-up walk is done with
+  // them, so their summaries are kept across visits. The functions of this
+  // SCC may be changed by other passes before and after the visit.
+  for (LazyCallGraph::Node &N : C)
+    CostCache.invalidate(N.getFunction());
+  std::function<InlineCost(CallSite CS)> GetInlineCost = [&](CallSite CS) {
+    Function &Callee = *CS.getCalledFunction();
+    TargetTransformInfo &TTI = FAM.getResult<TargetIRAnalysis>(Callee);
+    return getInlineCost(CS, DefaultThreshold, TTI, GetAssumptionCache, PSI,
+                         &CostCache);
+  };
+
+  auto IsCandidate = [&](CallSite CS) {
+    if (!CS || isa<IntrinsicInst>(CS.getInstruction()))
+      return false;
+    Function *Callee = CS.getCalledFunction();
+    if (!Callee || Callee->isDeclaration())
+      return false;
+    LazyCallGraph::Node *CalleeN = G.lookup(*Callee);
+    if (!CalleeN)
+      return false;
+    LazyCallGraph::RefSCC *CalleeRC = G.lookupRefSCC(*CalleeN);
+    return CalleeRC && CalleeRC != &RC;
+  };
+
+  std::priority_queue<InlineCandidate, std::vector<InlineCandidate>,
+                      InlineCandidateCompare>
+      Candidates;
+  unsigned NextOrder = 0;
+  auto Enqueue = [&](CallSite CS, int InlineHistoryID) {
+    Candidates.push({CS.getInstruction(), InlineHistoryID,
+                     getInlinePriority(GetInlineCost(CS)), NextOrder++});
+  };
+
+  DEBUG(dbgs() << "Inliner visiting SCC: " << C << "\n");
+  for (LazyCallGraph::Node &N : C)
+    for (BasicBlock &BB : N.getFunction())
+      for (Instruction &I : BB) {
+        CallSite CS(&I);
+        if (IsCandidate(CS))
+          Enqueue(CS, -1);
+      }
+
+  SmallVector<std::pair<Function *, int>, 8> InlineHistory;
+  SmallSetVector<Function *, 4> ChangedFunctions;
+  InlinedArrayAllocasTy InlinedArrayAllocas;
+  InlineFunctionInfo InlineInfo(nullptr, &GetAssumptionCache);
+
+  while (!Candidates.empty()) {
+    InlineCandidate Candidate = Candidates.top();
+    Candidates.pop();
+
+    // The call may have been deleted or rewritten by earlier inlining.
+    if (!Candidate.Call)
+      continue;
+    CallSite CS(Candidate.Call);
+    if (!IsCandidate(CS))
+      continue;
+    Function *Caller = CS.getCaller();
+    Function *Callee = CS.getCalledFunction();
+
+    // Dead calls to readonly functions are deleted rather than inlined, see
+    // the legacy inliner.
+    if (isInstructionTriviallyDead(CS.getInstruction(),
+                                   &FAM.getResult<TargetLibraryAnalysis>(
+                                       *Caller))) {
+      DEBUG(dbgs() << "    -> Deleting dead call: " << *CS.getInstruction()
+                   << "\n");
+      CS.getInstruction()->eraseFromParent();
+      CostCache.invalidate(*Caller);
+      ChangedFunctions.insert(Caller);
+      ++NumCallsDeleted;
+      continue;
+    }
+
+    int InlineHistoryID = Candidate.InlineHistoryID;
+    if (InlineHistoryID != -1 &&
+        InlineHistoryIncludes(Callee, InlineHistoryID, InlineHistory))
+      continue;
+
+    // Inlining into the caller may have made this call less attractive than
+    // the next one, in which case it has to wait for its new turn.
+    InlineCost IC = GetInlineCost(CS);
+    int Priority = getInlinePriority(IC);
+    if (Priority < Candidate.Priority) {
+      Candidate.Priority = Priority;
+      if (!Candidates.empty() &&
+          InlineCandidateCompare()(Candidate, Candidates.top())) {
+        Candidates.push(Candidate);
+        continue;
+      }
+    }
+
+    LLVMContext &CallerCtx = Caller->getContext();
+    DebugLoc DLoc = CS.getInstruction()->getDebugLoc();
+
+    // Reuse the cost we just computed for this call site.
+    auto GetCandidateCost = [&](CallSite Other) {
+      return Other == CS ? IC : GetInlineCost(Other);
+    };
+    if (!shouldInline(CS, GetCandidateCost) ||
+        !InlineCallIfPossible(CS, InlineInfo, InlinedArrayAllocas,
+                              InlineHistoryID, /*InsertLifetime=*/true,
+                              AARGetter)) {
+      emitOptimizationRemarkMissed(CallerCtx, DEBUG_TYPE, *Caller, DLoc,
+                                   Twine(Callee->getName() +
+                                         " will not be inlined into " +
+                                         Caller->getName()));
+      continue;
+    }
+    ++NumInlined;
+    CostCache.invalidate(*Caller);
+    ChangedFunctions.insert(Caller);
+
+    emitOptimizationRemark(
+        CallerCtx, DEBUG_TYPE, *Caller, DLoc,
+        Twine(Callee->getName() + " inlined into " + Caller->getName()));
+
+    // The call sites which came from the callee are candidates as well. Keep
+    // track of where they came from so that we don't inline recursion
+    // forever.
+    if (!InlineInfo.InlinedCalls.empty()) {
+      int NewHistoryID = InlineHistory.size();
+      InlineHistory.push_back(std::make_pair(Callee, InlineHistoryID));
+
+      for (Value *Ptr : InlineInfo.InlinedCalls) {
+        if (!Ptr)
+          continue;
+        CallSite NewCS(Ptr);
+        if (IsCandidate(NewCS))
+          Enqueue(NewCS, NewHistoryID);
+      }
+    }
+  }
+
+  for (LazyCallGraph::Node &N : C)
+    CostCache.invalidate(N.getFunction());
+
+  if (ChangedFunctions.empty())
+    return PreservedAnalyses::all();
+
+  for (Function *F : ChangedFunctions)
+    updateOutgoingEdges(G, G.get(*F));
+  return PreservedAnalyses::none();
+}
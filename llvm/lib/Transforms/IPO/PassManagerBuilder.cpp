@@ -141,6 +141,10 @@ static cl::opt<bool> EnableGVNHoist(
     "enable-gvn-hoist", cl::init(false), cl::Hidden,
     cl::desc("Enable the experimental GVN Hoisting pass"));
 
+static cl::opt<bool> EnableHotColdSplit(
+    "hot-cold-split", cl::init(false), cl::Hidden,
+    cl::desc("Enable the profile guided hot/cold splitting pass"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -600,6 +604,12 @@ void PassManagerBuilder::populateModulePassManager(
   // about pointer alignments.
   MPM.add(createAlignmentFromAssumptionsPass());
 
+  // Outline the cold regions of profiled functions. This runs late so that the
+  // earlier passes see whole functions. With LTO it runs at link time, after
+  // the last inliner.
+  if (EnableHotColdSplit && !PrepareForLTO)
+    MPM.add(createHotColdSplittingPass());
+
   if (!DisableUnitAtATime) {
     // FIXME: We shouldn't bother with this anymore.
     MPM.add(createStripDeadPrototypesPass()); // Get rid of dead prototypes
@@ -767,6 +777,10 @@ void PassManagerBuilder::addLateLTOOptimizationPasses(
   // Drop bodies of available externally objects to improve GlobalDCE.
   PM.add(createEliminateAvailableExternallyPass());
 
+  // Outline the cold regions of profiled functions.
+  if (EnableHotColdSplit)
+    PM.add(createHotColdSplittingPass());
+
   // Now that we have optimized the program, discard unreachable functions.
   PM.add(createGlobalDCEPass());
 
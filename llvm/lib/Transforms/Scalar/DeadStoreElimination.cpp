@@ -21,6 +21,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
@@ -40,6 +41,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include <map>
 using namespace llvm;
 
@@ -55,6 +57,16 @@ EnablePartialOverwriteTracking("enable-dse-partial-overwrite-tracking",
   cl::init(true), cl::Hidden,
   cl::desc("Enable partial-overwrite tracking in DSE"));
 
+static cl::opt<bool>
+EnableDSEMemorySSA("enable-dse-memoryssa", cl::init(false), cl::Hidden,
+  cl::desc("Use MemorySSA instead of MemoryDependenceAnalysis in DSE, and "
+           "keep MemorySSA up to date"));
+
+static cl::opt<unsigned>
+MemorySSAScanLimit("dse-memoryssa-scan-limit", cl::init(100), cl::Hidden,
+  cl::desc("The number of memory accesses of a block that DSE looks at "
+           "before giving up when it uses MemorySSA"));
+
 
 //===----------------------------------------------------------------------===//
 // Helper functions
@@ -66,10 +78,11 @@ typedef DenseMap<Instruction *, OverlapIntervalsTy> InstOverlapIntervalsTy;
 /// operands of this instruction.  If any of them become dead, delete them and
 /// the computation tree that feeds them.
 /// If ValueSet is non-null, remove any deleted instructions from it as well.
+/// Exactly one of MD and MSSA is non-null, and it is kept up to date.
 static void
 deleteDeadInstruction(Instruction *I, BasicBlock::iterator *BBI,
-                      MemoryDependenceResults &MD, const TargetLibraryInfo &TLI,
-                      InstOverlapIntervalsTy &IOL,
+                      MemoryDependenceResults *MD, MemorySSA *MSSA,
+                      const TargetLibraryInfo &TLI, InstOverlapIntervalsTy &IOL,
                       SmallSetVector<Value *, 16> *ValueSet = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
 
@@ -88,7 +101,10 @@ deleteDeadInstruction(Instruction *I, BasicBlock::iterator *BBI,
     // This instruction is dead, zap it, in stages.  Start by removing it from
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
-    MD.removeInstruction(DeadInst);
+    if (MD)
+      MD->removeInstruction(DeadInst);
+    else if (MemoryAccess *MA = MSSA->getMemoryAccess(DeadInst))
+      MSSA->removeMemoryAccess(MA);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -516,7 +532,17 @@ static bool isPossibleSelfRead(Instruction *Inst,
 /// instruction.
 static bool memoryIsNotModifiedBetween(Instruction *FirstI,
                                        Instruction *SecondI,
-                                       AliasAnalysis *AA) {
+                                       AliasAnalysis *AA, MemorySSA *MSSA) {
+  // With MemorySSA, nothing in between modifies the memory if the clobber of
+  // the second instruction dominates the first one.
+  if (MSSA) {
+    MemoryAccess *FirstMA = MSSA->getMemoryAccess(FirstI);
+    MemoryAccess *SecondMA = MSSA->getMemoryAccess(SecondI);
+    if (FirstMA && SecondMA)
+      return MSSA->dominates(
+          MSSA->getWalker()->getClobberingMemoryAccess(SecondMA), FirstMA);
+  }
+
   SmallVector<BasicBlock *, 16> WorkList;
   SmallPtrSet<BasicBlock *, 8> Visited;
   BasicBlock::iterator FirstBBI(FirstI);
@@ -569,6 +595,65 @@ static bool memoryIsNotModifiedBetween(Instruction *FirstI,
   return true;
 }
 
+/// Returns true if \p I is a monotonic load or store, which a simple store may
+/// be reordered with if they access different memory.
+static bool isMonotonicLoadOrStore(const Instruction *I) {
+  if (const auto *LI = dyn_cast<LoadInst>(I))
+    return !LI->isVolatile() && LI->getOrdering() == AtomicOrdering::Monotonic;
+  if (const auto *SI = dyn_cast<StoreInst>(I))
+    return !SI->isVolatile() && SI->getOrdering() == AtomicOrdering::Monotonic;
+  return false;
+}
+
+/// Find the nearest instruction before \p ScanPt in \p BB that may read or
+/// write \p Loc, like MemoryDependenceResults::getPointerDependencyFrom does
+/// for the store \p QueryInst, but only looking at the MemorySSA accesses of
+/// the block. If \p ScanPt is null, the scan starts at the end of the block.
+static MemDepResult getMemorySSADependencyFrom(const MemoryLocation &Loc,
+                                               Instruction *QueryInst,
+                                               Instruction *ScanPt,
+                                               BasicBlock *BB,
+                                               AliasAnalysis *AA,
+                                               MemorySSA *MSSA) {
+  const MemorySSA::AccessList *Accesses = MSSA->getBlockAccesses(BB);
+  if (!Accesses)
+    return MemDepResult::getNonLocal();
+
+  // Start at the first access at or after ScanPt, the reverse iterator then
+  // visits the accesses before it.
+  MemorySSA::AccessList::const_reverse_iterator AI = Accesses->rbegin();
+  if (ScanPt)
+    for (Instruction &I : make_range(ScanPt->getIterator(), BB->end()))
+      if (MemoryAccess *MA = MSSA->getMemoryAccess(&I)) {
+        AI = MemorySSA::AccessList::const_reverse_iterator(
+            MemorySSA::AccessList::const_iterator(MA));
+        break;
+      }
+
+  auto *QueryStore = dyn_cast_or_null<StoreInst>(QueryInst);
+  bool QuerySimpleStore = QueryStore && QueryStore->isSimple();
+  unsigned Limit = MemorySSAScanLimit;
+  for (auto AE = Accesses->rend(); AI != AE; ++AI) {
+    // The MemoryPhi, if there is one, comes first.
+    const auto *MUD = dyn_cast<MemoryUseOrDef>(&*AI);
+    if (!MUD)
+      break;
+    if (!Limit--)
+      return MemDepResult::getUnknown();
+
+    // DSE does not distinguish between Def and Clobber results.
+    Instruction *I = MUD->getMemoryInst();
+    if (QuerySimpleStore && isMonotonicLoadOrStore(I)) {
+      if (!AA->isNoAlias(MemoryLocation::get(I), Loc))
+        return MemDepResult::getClobber(I);
+      continue;
+    }
+    if (AA->getModRefInfo(I, Loc) != MRI_NoModRef)
+      return MemDepResult::getClobber(I);
+  }
+  return MemDepResult::getNonLocal();
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void findUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
@@ -588,8 +673,8 @@ static void findUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
 /// Handle frees of entire structures whose dependency is a store
 /// to a field of that structure.
 static bool handleFree(CallInst *F, AliasAnalysis *AA,
-                       MemoryDependenceResults *MD, DominatorTree *DT,
-                       const TargetLibraryInfo *TLI,
+                       MemoryDependenceResults *MD, MemorySSA *MSSA,
+                       DominatorTree *DT, const TargetLibraryInfo *TLI,
                        InstOverlapIntervalsTy &IOL) {
   bool MadeChange = false;
 
@@ -604,7 +689,9 @@ static bool handleFree(CallInst *F, AliasAnalysis *AA,
     if (BB == F->getParent()) InstPt = F;
 
     MemDepResult Dep =
-        MD->getPointerDependencyFrom(Loc, false, InstPt->getIterator(), BB);
+        MSSA ? getMemorySSADependencyFrom(Loc, nullptr, InstPt, BB, AA, MSSA)
+             : MD->getPointerDependencyFrom(Loc, false, InstPt->getIterator(),
+                                            BB);
     while (Dep.isDef() || Dep.isClobber()) {
       Instruction *Dependency = Dep.getInst();
       if (!hasMemoryWrite(Dependency, *TLI) || !isRemovable(Dependency))
@@ -622,7 +709,7 @@ static bool handleFree(CallInst *F, AliasAnalysis *AA,
 
       // DCE instructions only used to calculate that store.
       BasicBlock::iterator BBI(Dependency);
-      deleteDeadInstruction(Dependency, &BBI, *MD, *TLI, IOL);
+      deleteDeadInstruction(Dependency, &BBI, MD, MSSA, *TLI, IOL);
       ++NumFastStores;
       MadeChange = true;
 
@@ -631,7 +718,8 @@ static bool handleFree(CallInst *F, AliasAnalysis *AA,
       //    s[0] = 0;
       //    s[1] = 0; // This has just been deleted.
       //    free(s);
-      Dep = MD->getPointerDependencyFrom(Loc, false, BBI, BB);
+      Dep = MSSA ? getMemorySSADependencyFrom(Loc, nullptr, &*BBI, BB, AA, MSSA)
+                 : MD->getPointerDependencyFrom(Loc, false, BBI, BB);
     }
 
     if (Dep.isNonLocal())
@@ -676,7 +764,7 @@ static void removeAccessedObjects(const MemoryLocation &LoadedLoc,
 /// store i32 1, i32* %A
 /// ret void
 static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
-                             MemoryDependenceResults *MD,
+                             MemoryDependenceResults *MD, MemorySSA *MSSA,
                              const TargetLibraryInfo *TLI,
                              InstOverlapIntervalsTy &IOL) {
   bool MadeChange = false;
@@ -737,7 +825,8 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        deleteDeadInstruction(Dead, &BBI, *MD, *TLI, IOL, &DeadStackObjects);
+        deleteDeadInstruction(Dead, &BBI, MD, MSSA, *TLI, IOL,
+                              &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -748,7 +837,8 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
     if (isInstructionTriviallyDead(&*BBI, TLI)) {
       DEBUG(dbgs() << "DSE: Removing trivially dead instruction:\n  DEAD: "
                    << *&*BBI << '\n');
-      deleteDeadInstruction(&*BBI, &BBI, *MD, *TLI, IOL, &DeadStackObjects);
+      deleteDeadInstruction(&*BBI, &BBI, MD, MSSA, *TLI, IOL,
+                            &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -945,7 +1035,7 @@ static bool removePartiallyOverlappedStores(AliasAnalysis *AA,
 
 static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
                                AliasAnalysis *AA, MemoryDependenceResults *MD,
-                               const DataLayout &DL,
+                               MemorySSA *MSSA, const DataLayout &DL,
                                const TargetLibraryInfo *TLI,
                                InstOverlapIntervalsTy &IOL) {
   // Must be a store instruction.
@@ -957,12 +1047,12 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
   // then the store can be removed.
   if (LoadInst *DepLoad = dyn_cast<LoadInst>(SI->getValueOperand())) {
     if (SI->getPointerOperand() == DepLoad->getPointerOperand() &&
-        isRemovable(SI) && memoryIsNotModifiedBetween(DepLoad, SI, AA)) {
+        isRemovable(SI) && memoryIsNotModifiedBetween(DepLoad, SI, AA, MSSA)) {
 
       DEBUG(dbgs() << "DSE: Remove Store Of Load from same pointer:\n  LOAD: "
                    << *DepLoad << "\n  STORE: " << *SI << '\n');
 
-      deleteDeadInstruction(SI, &BBI, *MD, *TLI, IOL);
+      deleteDeadInstruction(SI, &BBI, MD, MSSA, *TLI, IOL);
       ++NumRedundantStores;
       return true;
     }
@@ -975,12 +1065,12 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
         dyn_cast<Instruction>(GetUnderlyingObject(SI->getPointerOperand(), DL));
 
     if (UnderlyingPointer && isCallocLikeFn(UnderlyingPointer, TLI) &&
-        memoryIsNotModifiedBetween(UnderlyingPointer, SI, AA)) {
+        memoryIsNotModifiedBetween(UnderlyingPointer, SI, AA, MSSA)) {
       DEBUG(
           dbgs() << "DSE: Remove null store to the calloc'ed object:\n  DEAD: "
                  << *Inst << "\n  OBJECT: " << *UnderlyingPointer << '\n');
 
-      deleteDeadInstruction(SI, &BBI, *MD, *TLI, IOL);
+      deleteDeadInstruction(SI, &BBI, MD, MSSA, *TLI, IOL);
       ++NumRedundantStores;
       return true;
     }
@@ -989,7 +1079,8 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
 }
 
 static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
-                                MemoryDependenceResults *MD, DominatorTree *DT,
+                                MemoryDependenceResults *MD, MemorySSA *MSSA,
+                                DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
   const DataLayout &DL = BB.getModule()->getDataLayout();
   bool MadeChange = false;
@@ -1001,7 +1092,7 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
   for (BasicBlock::iterator BBI = BB.begin(), BBE = BB.end(); BBI != BBE; ) {
     // Handle 'free' calls specially.
     if (CallInst *F = isFreeCall(&*BBI, TLI)) {
-      MadeChange |= handleFree(F, AA, MD, DT, TLI, IOL);
+      MadeChange |= handleFree(F, AA, MD, MSSA, DT, TLI, IOL);
       // Increment BBI after handleFree has potentially deleted instructions.
       // This ensures we maintain a valid iterator.
       ++BBI;
@@ -1015,19 +1106,11 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
       continue;
 
     // eliminateNoopStore will update in iterator, if necessary.
-    if (eliminateNoopStore(Inst, BBI, AA, MD, DL, TLI, IOL)) {
+    if (eliminateNoopStore(Inst, BBI, AA, MD, MSSA, DL, TLI, IOL)) {
       MadeChange = true;
       continue;
     }
 
-    // If we find something that writes memory, get its memory dependence.
-    MemDepResult InstDep = MD->getDependency(Inst);
-
-    // Ignore any store where we can't find a local dependence.
-    // FIXME: cross-block DSE would be fun. :)
-    if (!InstDep.isDef() && !InstDep.isClobber())
-      continue;
-
     // Figure out what location is being stored to.
     MemoryLocation Loc = getLocForWrite(Inst, *AA);
 
@@ -1035,6 +1118,16 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
     if (!Loc.Ptr)
       continue;
 
+    // If we find something that writes memory, get its memory dependence.
+    MemDepResult InstDep =
+        MSSA ? getMemorySSADependencyFrom(Loc, Inst, Inst, &BB, AA, MSSA)
+             : MD->getDependency(Inst);
+
+    // Ignore any store where we can't find a local dependence.
+    // FIXME: cross-block DSE would be fun. :)
+    if (!InstDep.isDef() && !InstDep.isClobber())
+      continue;
+
     while (InstDep.isDef() || InstDep.isClobber()) {
       // Get the memory clobbered by the instruction we depend on.  MemDep will
       // skip any instructions that 'Loc' clearly doesn't interact with.  If we
@@ -1063,12 +1156,14 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          deleteDeadInstruction(DepWrite, &BBI, *MD, *TLI, IOL);
+          deleteDeadInstruction(DepWrite, &BBI, MD, MSSA, *TLI, IOL);
           ++NumFastStores;
           MadeChange = true;
 
           // We erased DepWrite; start over.
-          InstDep = MD->getDependency(Inst);
+          InstDep = MSSA ? getMemorySSADependencyFrom(Loc, Inst, Inst, &BB, AA,
+                                                      MSSA)
+                         : MD->getDependency(Inst);
           continue;
         } else if ((OR == OverwriteEnd && isShortenableAtTheEnd(DepWrite)) ||
                    ((OR == OverwriteBegin &&
@@ -1098,8 +1193,11 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
       if (AA->getModRefInfo(DepWrite, Loc) & MRI_Ref)
         break;
 
-      InstDep = MD->getPointerDependencyFrom(Loc, false,
-                                             DepWrite->getIterator(), &BB);
+      InstDep = MSSA ? getMemorySSADependencyFrom(Loc, nullptr, DepWrite, &BB,
+                                                  AA, MSSA)
+                     : MD->getPointerDependencyFrom(Loc, false,
+                                                    DepWrite->getIterator(),
+                                                    &BB);
     }
   }
 
@@ -1109,20 +1207,21 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
   // If this block ends in a return, unwind, or unreachable, all allocas are
   // dead at its end, which means stores to them are also dead.
   if (BB.getTerminator()->getNumSuccessors() == 0)
-    MadeChange |= handleEndBlock(BB, AA, MD, TLI, IOL);
+    MadeChange |= handleEndBlock(BB, AA, MD, MSSA, TLI, IOL);
 
   return MadeChange;
 }
 
 static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
-                                MemoryDependenceResults *MD, DominatorTree *DT,
+                                MemoryDependenceResults *MD, MemorySSA *MSSA,
+                                DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
   bool MadeChange = false;
   for (BasicBlock &BB : F)
     // Only check non-dead blocks.  Dead blocks may have strange pointer
     // cycles that will confuse alias analysis.
     if (DT->isReachableFromEntry(&BB))
-      MadeChange |= eliminateDeadStores(BB, AA, MD, DT, TLI);
+      MadeChange |= eliminateDeadStores(BB, AA, MD, MSSA, DT, TLI);
   return MadeChange;
 }
 
@@ -1132,15 +1231,23 @@ static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
 PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
   AliasAnalysis *AA = &AM.getResult<AAManager>(F);
   DominatorTree *DT = &AM.getResult<DominatorTreeAnalysis>(F);
-  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
+  MemoryDependenceResults *MD = nullptr;
+  MemorySSA *MSSA = nullptr;
+  if (EnableDSEMemorySSA)
+    MSSA = &AM.getResult<MemorySSAAnalysis>(F);
+  else
+    MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   const TargetLibraryInfo *TLI = &AM.getResult<TargetLibraryAnalysis>(F);
 
-  if (!eliminateDeadStores(F, AA, MD, DT, TLI))
+  if (!eliminateDeadStores(F, AA, MD, MSSA, DT, TLI))
     return PreservedAnalyses::all();
   PreservedAnalyses PA;
   PA.preserve<DominatorTreeAnalysis>();
   PA.preserve<GlobalsAA>();
-  PA.preserve<MemoryDependenceAnalysis>();
+  if (MSSA)
+    PA.preserve<MemorySSAAnalysis>();
+  else
+    PA.preserve<MemoryDependenceAnalysis>();
   return PA;
 }
 
@@ -1158,23 +1265,36 @@ public:
 
     DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     AliasAnalysis *AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
-    MemoryDependenceResults *MD =
-        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
+    MemoryDependenceResults *MD = nullptr;
+    MemorySSA *MSSA = nullptr;
+    if (EnableDSEMemorySSA)
+      MSSA = &getAnalysis<MemorySSAWrapperPass>().getMSSA();
+    else
+      MD = &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
-    return eliminateDeadStores(F, AA, MD, DT, TLI);
+    return eliminateDeadStores(F, AA, MD, MSSA, DT, TLI);
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.setPreservesCFG();
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<AAResultsWrapperPass>();
-    AU.addRequired<MemoryDependenceWrapperPass>();
+    if (EnableDSEMemorySSA)
+      AU.addRequired<MemorySSAWrapperPass>();
+    else
+      AU.addRequired<MemoryDependenceWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
-    AU.addPreserved<MemoryDependenceWrapperPass>();
+    if (EnableDSEMemorySSA) {
+      // MemorySSA keeps using the alias analysis it was built with.
+      AU.addPreserved<MemorySSAWrapperPass>();
+      AU.addPreserved<AAResultsWrapperPass>();
+      AU.addPreserved<BasicAAWrapperPass>();
+    } else
+      AU.addPreserved<MemoryDependenceWrapperPass>();
   }
 
   static char ID; // Pass identification, replacement for typeid
@@ -1188,6 +1308,7 @@ INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(GlobalsAAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_END(DSELegacyPass, "dse", "Dead Store Elimination", false,
                     false)
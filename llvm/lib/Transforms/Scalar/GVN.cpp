@@ -49,6 +49,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
 #include <vector>
 using namespace llvm;
@@ -64,10 +65,30 @@ STATISTIC(NumGVNBlocks, "Number of blocks merged");
 STATISTIC(NumGVNSimpl,  "Number of instructions simplified");
 STATISTIC(NumGVNEqProp, "Number of equalities propagated");
 STATISTIC(NumPRELoad,   "Number of loads PRE'd");
+STATISTIC(NumGVNMemorySSAQueries,
+          "Number of MemorySSA clobber queries made by GVN");
 
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+// Experimental. The MemorySSA mode is not faster than the default one in
+// general, and it misses some load PRE that the default mode does.
+static cl::opt<bool> EnableGVNMemorySSA(
+    "enable-gvn-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Use MemorySSA instead of MemoryDependenceAnalysis to find the "
+             "memory dependencies of loads and calls in GVN (experimental)"));
+
+// GVN queries the clobber of every load and call, so in MemorySSA mode the
+// walker is bounded to keep large functions tractable.
+static cl::opt<unsigned> GVNMemorySSAWalkerCacheLimit(
+    "gvn-memoryssa-max-walker-cache-size", cl::init(1 << 18), cl::Hidden,
+    cl::desc("The number of clobbers the MemorySSA walker of GVN remembers "
+             "before it forgets all of them "
+             "(0 = -memssa-max-walker-cache-size)"));
+static cl::opt<unsigned> GVNMemorySSACheckLimit(
+    "gvn-memoryssa-check-limit", cl::init(100), cl::Hidden,
+    cl::desc("The maximum number of MemoryDefs the MemorySSA walker of GVN "
+             "looks at for a single clobber query (0 = -memssa-check-limit)"));
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -337,16 +358,16 @@ GVN::Expression GVN::ValueTable::createExtractvalueExpr(ExtractValueInst *EI) {
 //                     ValueTable External Functions
 //===----------------------------------------------------------------------===//
 
-GVN::ValueTable::ValueTable() : nextValueNumber(1) {}
+GVN::ValueTable::ValueTable() : MSSA(nullptr), nextValueNumber(1) {}
 GVN::ValueTable::ValueTable(const ValueTable &Arg)
     : valueNumbering(Arg.valueNumbering),
       expressionNumbering(Arg.expressionNumbering), AA(Arg.AA), MD(Arg.MD),
-      DT(Arg.DT), nextValueNumber(Arg.nextValueNumber) {}
+      MSSA(Arg.MSSA), DT(Arg.DT), nextValueNumber(Arg.nextValueNumber) {}
 GVN::ValueTable::ValueTable(ValueTable &&Arg)
     : valueNumbering(std::move(Arg.valueNumbering)),
       expressionNumbering(std::move(Arg.expressionNumbering)),
-      AA(std::move(Arg.AA)), MD(std::move(Arg.MD)), DT(std::move(Arg.DT)),
-      nextValueNumber(std::move(Arg.nextValueNumber)) {}
+      AA(std::move(Arg.AA)), MD(std::move(Arg.MD)), MSSA(std::move(Arg.MSSA)),
+      DT(std::move(Arg.DT)), nextValueNumber(std::move(Arg.nextValueNumber)) {}
 GVN::ValueTable::~ValueTable() {}
 
 /// add - Insert a value into the table with a specified value number.
@@ -354,6 +375,26 @@ void GVN::ValueTable::add(Value *V, uint32_t num) {
   valueNumbering.insert(std::make_pair(V, num));
 }
 
+/// Numbers an expression that reads memory, and thus has the same value as
+/// another instance of it only if both read the same version of memory: the
+/// one written by \p Clobber.
+uint32_t GVN::ValueTable::lookupOrAddMemoryExpr(Expression Exp,
+                                                MemoryAccess *Clobber) {
+  Exp.varargs.push_back(lookupOrAdd(Clobber));
+  uint32_t &e = expressionNumbering[Exp];
+  if (!e) e = nextValueNumber++;
+  return e;
+}
+
+uint32_t GVN::ValueTable::lookupOrAddLoad(Type *Ty, Value *Ptr,
+                                          MemoryAccess *Clobber) {
+  Expression e;
+  e.type = Ty;
+  e.opcode = Instruction::Load;
+  e.varargs.push_back(lookupOrAdd(Ptr));
+  return lookupOrAddMemoryExpr(e, Clobber);
+}
+
 uint32_t GVN::ValueTable::lookupOrAddCall(CallInst *C) {
   if (AA->doesNotAccessMemory(C)) {
     Expression exp = createExpr(C);
@@ -363,6 +404,19 @@ uint32_t GVN::ValueTable::lookupOrAddCall(CallInst *C) {
     return e;
   } else if (AA->onlyReadsMemory(C)) {
     Expression exp = createExpr(C);
+    if (MSSA) {
+      // Two calls that read the same version of memory are equivalent.
+      MemoryAccess *MA = MSSA->getMemoryAccess(C);
+      if (!MA) {
+        valueNumbering[C] = nextValueNumber;
+        return nextValueNumber++;
+      }
+      ++NumGVNMemorySSAQueries;
+      uint32_t e = lookupOrAddMemoryExpr(
+          exp, MSSA->getWalker()->getClobberingMemoryAccess(MA));
+      valueNumbering[C] = e;
+      return e;
+    }
     uint32_t &e = expressionNumbering[exp];
     if (!e) {
       e = nextValueNumber++;
@@ -526,6 +580,22 @@ uint32_t GVN::ValueTable::lookupOrAdd(Value *V) {
     case Instruction::ExtractValue:
       exp = createExtractvalueExpr(cast<ExtractValueInst>(I));
       break;
+    case Instruction::Load: {
+      // With MemorySSA, two simple loads of the same type from the same
+      // address that read the same version of memory are equivalent.
+      LoadInst *LI = cast<LoadInst>(I);
+      MemoryAccess *MA = MSSA ? MSSA->getMemoryAccess(LI) : nullptr;
+      if (!MA || !LI->isSimple()) {
+        valueNumbering[V] = nextValueNumber;
+        return nextValueNumber++;
+      }
+      ++NumGVNMemorySSAQueries;
+      uint32_t e =
+          lookupOrAddLoad(LI->getType(), LI->getPointerOperand(),
+                          MSSA->getWalker()->getClobberingMemoryAccess(MA));
+      valueNumbering[V] = e;
+      return e;
+    }
     default:
       valueNumbering[V] = nextValueNumber;
       return nextValueNumber++;
@@ -1591,7 +1661,8 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
     // Add the newly created load.
     ValuesPerBlock.push_back(AvailableValueInBlock::get(UnavailablePred,
                                                         NewLoad));
-    MD->invalidateCachedPointerInfo(LoadPtr);
+    if (MD)
+      MD->invalidateCachedPointerInfo(LoadPtr);
     DEBUG(dbgs() << "GVN INSERTED " << *NewLoad << '\n');
   }
 
@@ -1602,7 +1673,7 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
     V->takeName(LI);
   if (Instruction *I = dyn_cast<Instruction>(V))
     I->setDebugLoc(LI->getDebugLoc());
-  if (V->getType()->getScalarType()->isPointerTy())
+  if (MD && V->getType()->getScalarType()->isPointerTy())
     MD->invalidateCachedPointerInfo(V);
   markInstructionForDeletion(LI);
   ++NumPRELoad;
@@ -1618,7 +1689,10 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
 
   // Step 1: Find the non-local dependencies of the load.
   LoadDepVect Deps;
-  MD->getNonLocalPointerDependency(LI, Deps);
+  if (MSSA)
+    getNonLocalMemorySSADependencies(LI, Deps);
+  else
+    MD->getNonLocalPointerDependency(LI, Deps);
 
   // If we had to process more than one hundred blocks to find the
   // dependencies, this load isn't worth worrying about.  Optimizing
@@ -1675,7 +1749,7 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
     if (Instruction *I = dyn_cast<Instruction>(V))
       if (LI->getDebugLoc())
         I->setDebugLoc(LI->getDebugLoc());
-    if (V->getType()->getScalarType()->isPointerTy())
+    if (MD && V->getType()->getScalarType()->isPointerTy())
       MD->invalidateCachedPointerInfo(V);
     markInstructionForDeletion(LI);
     ++NumGVNLoad;
@@ -1689,6 +1763,125 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   return PerformLoadPRE(LI, ValuesPerBlock, UnavailableBlocks);
 }
 
+MemDepResult GVN::getMemorySSADependency(LoadInst *LI, Value *Address,
+                                         MemoryAccess *Clobber) {
+  const DataLayout &DL = LI->getModule()->getDataLayout();
+  if (MSSA->isLiveOnEntryDef(Clobber)) {
+    // Nothing in the function has written to the memory yet. If it is a local
+    // allocation, its contents are undefined.
+    if (auto *AI = dyn_cast<AllocaInst>(GetUnderlyingObject(Address, DL)))
+      return MemDepResult::getDef(AI);
+    return MemDepResult::getNonFuncLocal();
+  }
+
+  // The memory is written to in different ways along different paths.
+  if (isa<MemoryPhi>(Clobber))
+    return MemDepResult::getNonLocal();
+
+  // Classify the clobber the way MemoryDependenceResults does: writes that
+  // are known to define exactly the loaded value are Defs.
+  Instruction *DepInst = cast<MemoryDef>(Clobber)->getMemoryInst();
+  MemoryLocation Loc = MemoryLocation::get(LI).getWithNewPtr(Address);
+  AliasAnalysis *AA = VN.getAliasAnalysis();
+  if (auto *SI = dyn_cast<StoreInst>(DepInst)) {
+    if (AA->alias(MemoryLocation::get(SI), Loc) == MustAlias)
+      return MemDepResult::getDef(SI);
+  } else if (isLifetimeStart(DepInst)) {
+    if (AA->isMustAlias(MemoryLocation(DepInst->getOperand(1)), Loc))
+      return MemDepResult::getDef(DepInst);
+  } else if (isNoAliasFn(DepInst, TLI)) {
+    if (GetUnderlyingObject(Address, DL) == DepInst)
+      return MemDepResult::getDef(DepInst);
+  }
+  return MemDepResult::getClobber(DepInst);
+}
+
+MemDepResult GVN::getMemorySSADependency(LoadInst *LI) {
+  // Loads inserted since MemorySSA was built have no memory access.
+  MemoryAccess *MA = MSSA->getMemoryAccess(LI);
+  if (!MA)
+    return MemDepResult::getUnknown();
+  ++NumGVNMemorySSAQueries;
+  MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(MA);
+  MemDepResult Dep =
+      getMemorySSADependency(LI, LI->getPointerOperand(), Clobber);
+
+  // Like MemoryDependenceResults, only report clobbers in the load's own
+  // block, so that loads of the same memory in the predecessors are found.
+  BasicBlock *BB = LI->getParent();
+  if (!Dep.isDef() && Clobber->getBlock() != BB &&
+      BB != &BB->getParent()->getEntryBlock())
+    return MemDepResult::getNonLocal();
+  return Dep;
+}
+
+void GVN::getNonLocalMemorySSADependencies(LoadInst *LI, LoadDepVect &Deps) {
+  MemorySSAWalker *Walker = MSSA->getWalker();
+  BasicBlock *BB = LI->getParent();
+  MemoryAccess *BlockClobber =
+      Walker->getClobberingMemoryAccess(MSSA->getMemoryAccess(LI));
+  MemoryPhi *Phi = nullptr;
+  if (BlockClobber->getBlock() == BB) {
+    Phi = dyn_cast<MemoryPhi>(BlockClobber);
+    if (!Phi) {
+      Deps.push_back(
+          NonLocalDepResult(BB, MemDepResult::getUnknown(), nullptr));
+      return;
+    }
+  }
+
+  // The memory written along each incoming edge of a MemoryPhi is the memory
+  // at the end of the predecessor, so look for the dependency of the
+  // (PHI translated) address there. Without a MemoryPhi, the clobber outside
+  // of the block is the clobber at the end of every predecessor. Unlike
+  // MemoryDependenceResults, this does not walk past another MemoryPhi: the
+  // dependency is unknown in that case, which bounds the number of walker
+  // queries by the number of predecessors.
+  const DataLayout &DL = LI->getModule()->getDataLayout();
+  SmallPtrSet<BasicBlock *, 8> Visited;
+  for (BasicBlock *Pred : predecessors(BB)) {
+    if (!Visited.insert(Pred).second)
+      continue;
+
+    PHITransAddr Address(LI->getPointerOperand(), DL, AC);
+    if (Address.PHITranslateValue(BB, Pred, DT, /*MustDominate=*/true) ||
+        (!Phi && Address.getAddr() != LI->getPointerOperand())) {
+      Deps.push_back(
+          NonLocalDepResult(Pred, MemDepResult::getUnknown(), nullptr));
+      continue;
+    }
+    Value *PredAddr = Address.getAddr();
+
+    MemoryAccess *Clobber = BlockClobber;
+    if (Phi) {
+      ++NumGVNMemorySSAQueries;
+      MemoryLocation Loc = MemoryLocation::get(LI).getWithNewPtr(PredAddr);
+      Clobber = Walker->getClobberingMemoryAccess(
+          cast<MemoryAccess>(Phi->getIncomingValueForBlock(Pred)), Loc);
+    }
+    MemDepResult Dep = getMemorySSADependency(LI, PredAddr, Clobber);
+    if (Dep.isNonLocal())
+      Dep = MemDepResult::getUnknown();
+
+    // A load of the address that reads the same memory is as good as a store
+    // to it.
+    if (!Dep.isDef() && LI->isSimple()) {
+      uint32_t Num = VN.lookupOrAddLoad(LI->getType(), PredAddr, Clobber);
+      if (auto *Leader = dyn_cast_or_null<LoadInst>(findLeader(Pred, Num)))
+        Dep = MemDepResult::getDef(Leader);
+    }
+    Deps.push_back(NonLocalDepResult(Pred, Dep, PredAddr));
+  }
+}
+
+void GVN::removeMemoryAccess(Instruction *I) {
+  if (MemoryAccess *MA = MSSA->getMemoryAccess(I)) {
+    // The access may have been numbered as the clobber of some load.
+    VN.erase(MA);
+    MSSA->removeMemoryAccess(MA);
+  }
+}
+
 bool GVN::processAssumeIntrinsic(IntrinsicInst *IntrinsicI) {
   assert(IntrinsicI->getIntrinsicID() == Intrinsic::assume &&
          "This function can only be called with llvm.assume intrinsic");
@@ -1781,7 +1974,7 @@ static void patchAndReplaceAllUsesWith(Instruction *I, Value *Repl) {
 /// Attempt to eliminate a load, first by eliminating it
 /// locally, and then attempting non-local elimination if that fails.
 bool GVN::processLoad(LoadInst *L) {
-  if (!MD)
+  if (!MD && !MSSA)
     return false;
 
   // This code hasn't been audited for ordered or volatile memory access
@@ -1794,7 +1987,7 @@ bool GVN::processLoad(LoadInst *L) {
   }
 
   // ... to a pointer that has been loaded from before...
-  MemDepResult Dep = MD->getDependency(L);
+  MemDepResult Dep = MSSA ? getMemorySSADependency(L) : MD->getDependency(L);
 
   // If it is defined in another block, try harder.
   if (Dep.isNonLocal())
@@ -2093,6 +2286,17 @@ bool GVN::processInstruction(Instruction *I) {
       return true;
 
     unsigned Num = VN.lookupOrAdd(LI);
+    // With MemorySSA, loads are numbered by the memory they read, so a load
+    // is redundant with a dominating load of the same number.
+    if (MSSA) {
+      Value *Repl = findLeader(LI->getParent(), Num);
+      if (Repl && Repl != LI) {
+        patchAndReplaceAllUsesWith(LI, Repl);
+        markInstructionForDeletion(LI);
+        ++NumGVNLoad;
+        return true;
+      }
+    }
     addToLeaderTable(Num, LI, LI->getParent());
     return false;
   }
@@ -2204,6 +2408,10 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   TLI = &RunTLI;
   VN.setAliasAnalysis(&RunAA);
   MD = RunMD;
+  // MemorySSA replaces MemoryDependenceResults if loads are processed at all.
+  UseMemorySSA = MD && EnableGVNMemorySSA;
+  if (UseMemorySSA)
+    MD = nullptr;
   VN.setMemDep(MD);
 
   bool Changed = false;
@@ -2229,6 +2437,11 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
     ++Iteration;
   }
 
+  // PRE splits edges without updating MemorySSA, and does not process loads.
+  // The MemorySSA is kept until the value table, which may refer to its
+  // accesses, is cleared.
+  VN.setMemorySSA(nullptr);
+
   if (EnablePRE) {
     // Fabricate val-num for dead-code in order to suppress assertion in
     // performPRE().
@@ -2246,6 +2459,7 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   // Actually, when this happens, we should just fully integrate PRE into GVN.
 
   cleanupGlobalSets();
+  MSSA.reset();
   // Do not cleanup DeadBlocks in cleanupGlobalSets() as it's called for each
   // iteration.
   DeadBlocks.clear();
@@ -2288,6 +2502,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      if (MSSA) removeMemoryAccess(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2509,6 +2724,14 @@ BasicBlock *GVN::splitCriticalEdges(BasicBlock *Pred, BasicBlock *Succ) {
       SplitCriticalEdge(Pred, Succ, CriticalEdgeSplittingOptions(DT));
   if (MD)
     MD->invalidateCachedPredecessors();
+  // The memory state flowing into Succ along the split edge now comes from
+  // the new block, which does not access memory.
+  if (MSSA && BB)
+    if (MemoryPhi *Phi = MSSA->getMemoryAccess(Succ)) {
+      int Idx = Phi->getBasicBlockIndex(Pred);
+      if (Idx >= 0)
+        Phi->setIncomingBlock(Idx, BB);
+    }
   return BB;
 }
 
@@ -2530,6 +2753,16 @@ bool GVN::splitCriticalEdges() {
 bool GVN::iterateOnFunction(Function &F) {
   cleanupGlobalSets();
 
+  // Loads inserted by PRE in the previous iteration have no memory accesses,
+  // so build MemorySSA again. This is linear in the size of the function, and
+  // only happens when the previous iteration changed something.
+  if (UseMemorySSA) {
+    MSSA = make_unique<MemorySSA>(F, VN.getAliasAnalysis(), DT,
+                                  GVNMemorySSAWalkerCacheLimit,
+                                  GVNMemorySSACheckLimit);
+    VN.setMemorySSA(MSSA.get());
+  }
+
   // Top-down walk of the dominator tree
   bool Changed = false;
   // Save the blocks this function have before transformation begins. GVN may
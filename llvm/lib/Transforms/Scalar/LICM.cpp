@@ -63,6 +63,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
 #include <algorithm>
 #include <utility>
@@ -75,19 +76,29 @@ STATISTIC(NumHoisted, "Number of instructions hoisted out of loop");
 STATISTIC(NumMovedLoads, "Number of load insts hoisted or sunk");
 STATISTIC(NumMovedCalls, "Number of call insts hoisted or sunk");
 STATISTIC(NumPromoted, "Number of memory locations promoted to registers");
+STATISTIC(NumMSSAChecks,
+          "Number of loads and calls checked for invariance with MemorySSA");
+
 
 static cl::opt<bool>
     DisablePromotion("disable-licm-promotion", cl::Hidden,
                      cl::desc("Disable memory promotion in LICM pass"));
 
+static cl::opt<bool> EnableMSSALoopDependency(
+    "enable-mssa-loop-dependency", cl::Hidden, cl::init(false),
+    cl::desc("Use MemorySSA instead of alias sets to decide whether loads "
+             "and calls are invariant in LICM, and keep MemorySSA up to "
+             "date"));
+
 static bool inSubLoop(BasicBlock *BB, Loop *CurLoop, LoopInfo *LI);
+static bool hasPromotableStores(const Loop *CurLoop);
 static bool isNotUsedInLoop(const Instruction &I, const Loop *CurLoop,
                             const LoopSafetyInfo *SafetyInfo);
 static bool hoist(Instruction &I, const DominatorTree *DT, const Loop *CurLoop,
-                  const LoopSafetyInfo *SafetyInfo);
+                  const LoopSafetyInfo *SafetyInfo, MemorySSA *MSSA);
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
                  const Loop *CurLoop, AliasSetTracker *CurAST,
-                 const LoopSafetyInfo *SafetyInfo);
+                 const LoopSafetyInfo *SafetyInfo, MemorySSA *MSSA);
 static bool isSafeToExecuteUnconditionally(const Instruction &Inst,
                                            const DominatorTree *DT,
                                            const Loop *CurLoop,
@@ -96,6 +107,9 @@ static bool isSafeToExecuteUnconditionally(const Instruction &Inst,
 static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
                                      const AAMDNodes &AAInfo,
                                      AliasSetTracker *CurAST);
+static bool pointerInvalidatedByLoopWithMSSA(MemorySSA *MSSA,
+                                             Instruction *I, Loop *CurLoop);
+static void removeMemoryAccess(Instruction *I, MemorySSA *MSSA);
 static Instruction *
 CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
                             const LoopInfo *LI,
@@ -103,12 +117,13 @@ CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
 static bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA,
                                DominatorTree *DT, TargetLibraryInfo *TLI,
                                Loop *CurLoop, AliasSetTracker *CurAST,
-                               LoopSafetyInfo *SafetyInfo);
+                               LoopSafetyInfo *SafetyInfo, MemorySSA *MSSA);
 
 namespace {
 struct LoopInvariantCodeMotion {
   bool runOnLoop(Loop *L, AliasAnalysis *AA, LoopInfo *LI, DominatorTree *DT,
-                 TargetLibraryInfo *TLI, ScalarEvolution *SE, bool DeleteAST);
+                 TargetLibraryInfo *TLI, ScalarEvolution *SE, MemorySSA *MSSA,
+                 bool DeleteAST);
 
   DenseMap<Loop *, AliasSetTracker *> &getLoopToAliasSetMap() {
     return LoopToAliasSetMap;
@@ -132,12 +147,15 @@ struct LegacyLICMPass : public LoopPass {
       return false;
 
     auto *SE = getAnalysisIfAvailable<ScalarEvolutionWrapperPass>();
+    MemorySSA *MSSA = EnableMSSALoopDependency
+                          ? &getAnalysis<MemorySSAWrapperPass>().getMSSA()
+                          : nullptr;
     return LICM.runOnLoop(L,
                           &getAnalysis<AAResultsWrapperPass>().getAAResults(),
                           &getAnalysis<LoopInfoWrapperPass>().getLoopInfo(),
                           &getAnalysis<DominatorTreeWrapperPass>().getDomTree(),
                           &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(),
-                          SE ? &SE->getSE() : nullptr, false);
+                          SE ? &SE->getSE() : nullptr, MSSA, false);
   }
 
   /// This transformation requires natural loop information & requires that
@@ -147,6 +165,12 @@ struct LegacyLICMPass : public LoopPass {
     AU.setPreservesCFG();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     getLoopAnalysisUsage(AU);
+    // Build MemorySSA after the loop canonicalization passes so it is not
+    // invalidated before LICM gets to use it.
+    if (EnableMSSALoopDependency) {
+      AU.addRequired<MemorySSAWrapperPass>();
+      AU.addPreserved<MemorySSAWrapperPass>();
+    }
   }
 
   using llvm::Pass::doFinalization;
@@ -184,15 +208,21 @@ PreservedAnalyses LICMPass::run(Loop &L, AnalysisManager<Loop> &AM) {
   auto *TLI = FAM.getCachedResult<TargetLibraryAnalysis>(*F);
   auto *SE = FAM.getCachedResult<ScalarEvolutionAnalysis>(*F);
   assert((AA && LI && DT && TLI && SE) && "Analyses for LICM not available");
+  auto *MSSA = EnableMSSALoopDependency
+                   ? FAM.getCachedResult<MemorySSAAnalysis>(*F)
+                   : nullptr;
 
   LoopInvariantCodeMotion LICM;
 
-  if (!LICM.runOnLoop(&L, AA, LI, DT, TLI, SE, true))
+  if (!LICM.runOnLoop(&L, AA, LI, DT, TLI, SE, MSSA, true))
     return PreservedAnalyses::all();
 
   // FIXME: There is no setPreservesCFG in the new PM. When that becomes
   // available, it should be used here.
-  return getLoopPassPreservedAnalyses();
+  auto PA = getLoopPassPreservedAnalyses();
+  if (MSSA)
+    PA.preserve<MemorySSAAnalysis>();
+  return PA;
 }
 
 char LegacyLICMPass::ID = 0;
@@ -200,6 +230,7 @@ INITIALIZE_PASS_BEGIN(LegacyLICMPass, "licm", "Loop Invariant Code Motion",
                       false, false)
 INITIALIZE_PASS_DEPENDENCY(LoopPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
 INITIALIZE_PASS_END(LegacyLICMPass, "licm", "Loop Invariant Code Motion", false,
                     false)
 
@@ -211,15 +242,22 @@ Pass *llvm::createLICMPass() { return new LegacyLICMPass(); }
 /// We should delete AST for inner loops in the new pass manager to avoid
 /// memory leak.
 ///
+/// With MemorySSA, loads and calls are checked for invariance by asking the
+/// MemorySSA walker for their clobbers instead of building alias sets. Alias
+/// sets are then only built for loops that have stores to promote, and they
+/// are not kept for the outer loops.
+///
 bool LoopInvariantCodeMotion::runOnLoop(Loop *L, AliasAnalysis *AA,
                                         LoopInfo *LI, DominatorTree *DT,
                                         TargetLibraryInfo *TLI,
-                                        ScalarEvolution *SE, bool DeleteAST) {
+                                        ScalarEvolution *SE, MemorySSA *MSSA,
+                                        bool DeleteAST) {
   bool Changed = false;
 
   assert(L->isLCSSAForm(*DT) && "Loop is not in LCSSA form.");
 
-  AliasSetTracker *CurAST = collectAliasInfoForLoop(L, LI, AA);
+  AliasSetTracker *CurAST =
+      MSSA ? nullptr : collectAliasInfoForLoop(L, LI, AA);
 
   // Get the preheader block to move instructions into...
   BasicBlock *Preheader = L->getLoopPreheader();
@@ -240,22 +278,28 @@ bool LoopInvariantCodeMotion::runOnLoop(Loop *L, AliasAnalysis *AA,
   //
   if (L->hasDedicatedExits())
     Changed |= sinkRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI, L,
-                          CurAST, &SafetyInfo);
+                          CurAST, &SafetyInfo, MSSA);
   if (Preheader)
     Changed |= hoistRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI, L,
-                           CurAST, &SafetyInfo);
+                           CurAST, &SafetyInfo, MSSA);
 
   // Now that all loop invariants have been removed from the loop, promote any
-  // memory references to scalars that we can.
-  if (!DisablePromotion && (Preheader || L->hasDedicatedExits())) {
+  // memory references to scalars that we can. With MemorySSA, the alias sets
+  // are only needed for this, so only build them if there is a store that
+  // might be promoted.
+  bool CanPromote = !DisablePromotion && (Preheader || L->hasDedicatedExits());
+  if (CanPromote && !CurAST && hasPromotableStores(L))
+    CurAST = collectAliasInfoForLoop(L, LI, AA);
+  if (CanPromote && CurAST) {
     SmallVector<BasicBlock *, 8> ExitBlocks;
     SmallVector<Instruction *, 8> InsertPts;
     PredIteratorCache PIC;
 
     // Loop over all of the alias sets in the tracker object.
     for (AliasSet &AS : *CurAST)
-      Changed |= promoteLoopAccessesToScalars(
-          AS, ExitBlocks, InsertPts, PIC, LI, DT, TLI, L, CurAST, &SafetyInfo);
+      Changed |=
+          promoteLoopAccessesToScalars(AS, ExitBlocks, InsertPts, PIC, LI, DT,
+                                       TLI, L, CurAST, &SafetyInfo, MSSA);
 
     // Once we have promoted values across the loop body we have to recursively
     // reform LCSSA as any nested loop may now have values defined within the
@@ -277,7 +321,7 @@ bool LoopInvariantCodeMotion::runOnLoop(Loop *L, AliasAnalysis *AA,
 
   // If this loop is nested inside of another one, save the alias information
   // for when we process the outer loop.
-  if (L->getParentLoop() && !DeleteAST)
+  if (L->getParentLoop() && !DeleteAST && !MSSA)
     LoopToAliasSetMap[L] = CurAST;
   else
     delete CurAST;
@@ -294,12 +338,13 @@ bool LoopInvariantCodeMotion::runOnLoop(Loop *L, AliasAnalysis *AA,
 ///
 bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                       DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                      AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo) {
+                      AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo,
+                      MemorySSA *MSSA) {
 
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && DT != nullptr &&
-         CurLoop != nullptr && CurAST != nullptr && SafetyInfo != nullptr &&
-         "Unexpected input to sinkRegion");
+         CurLoop != nullptr && (CurAST != nullptr || MSSA != nullptr) &&
+         SafetyInfo != nullptr && "Unexpected input to sinkRegion");
 
   BasicBlock *BB = N->getBlock();
   // If this subregion is not in the top level loop at all, exit.
@@ -310,7 +355,8 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
   bool Changed = false;
   const std::vector<DomTreeNode *> &Children = N->getChildren();
   for (DomTreeNode *Child : Children)
-    Changed |= sinkRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |=
+        sinkRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo, MSSA);
 
   // Only need to process the contents of this block if it is not part of a
   // subloop (which would already have been processed).
@@ -325,7 +371,9 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
     if (isInstructionTriviallyDead(&I, TLI)) {
       DEBUG(dbgs() << "LICM deleting dead inst: " << I << '\n');
       ++II;
-      CurAST->deleteValue(&I);
+      if (CurAST)
+        CurAST->deleteValue(&I);
+      removeMemoryAccess(&I, MSSA);
       I.eraseFromParent();
       Changed = true;
       continue;
@@ -337,9 +385,10 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
     // operands of the instruction are loop invariant.
     //
     if (isNotUsedInLoop(I, CurLoop, SafetyInfo) &&
-        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo)) {
+        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo,
+                           MSSA)) {
       ++II;
-      Changed |= sink(I, LI, DT, CurLoop, CurAST, SafetyInfo);
+      Changed |= sink(I, LI, DT, CurLoop, CurAST, SafetyInfo, MSSA);
     }
   }
   return Changed;
@@ -352,11 +401,12 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
 ///
 bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                        DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                       AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo) {
+                       AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo,
+                       MemorySSA *MSSA) {
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && DT != nullptr &&
-         CurLoop != nullptr && CurAST != nullptr && SafetyInfo != nullptr &&
-         "Unexpected input to hoistRegion");
+         CurLoop != nullptr && (CurAST != nullptr || MSSA != nullptr) &&
+         SafetyInfo != nullptr && "Unexpected input to hoistRegion");
 
   BasicBlock *BB = N->getBlock();
 
@@ -376,10 +426,13 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       if (Constant *C = ConstantFoldInstruction(
               &I, I.getModule()->getDataLayout(), TLI)) {
         DEBUG(dbgs() << "LICM folding inst: " << I << "  --> " << *C << '\n');
-        CurAST->copyValue(&I, C);
+        if (CurAST)
+          CurAST->copyValue(&I, C);
         I.replaceAllUsesWith(C);
         if (isInstructionTriviallyDead(&I, TLI)) {
-          CurAST->deleteValue(&I);
+          if (CurAST)
+            CurAST->deleteValue(&I);
+          removeMemoryAccess(&I, MSSA);
           I.eraseFromParent();
         }
         continue;
@@ -390,16 +443,18 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       // is safe to hoist the instruction.
       //
       if (CurLoop->hasLoopInvariantOperands(&I) &&
-          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo) &&
+          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo,
+                             MSSA) &&
           isSafeToExecuteUnconditionally(
               I, DT, CurLoop, SafetyInfo,
               CurLoop->getLoopPreheader()->getTerminator()))
-        Changed |= hoist(I, DT, CurLoop, SafetyInfo);
+        Changed |= hoist(I, DT, CurLoop, SafetyInfo, MSSA);
     }
 
   const std::vector<DomTreeNode *> &Children = N->getChildren();
   for (DomTreeNode *Child : Children)
-    Changed |= hoistRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |=
+        hoistRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo, MSSA);
   return Changed;
 }
 
@@ -441,7 +496,8 @@ void llvm::computeLoopSafetyInfo(LoopSafetyInfo *SafetyInfo, Loop *CurLoop) {
 ///
 bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
                         TargetLibraryInfo *TLI, Loop *CurLoop,
-                        AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo) {
+                        AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo,
+                        MemorySSA *MSSA) {
   // Loads have extra constraints we have to verify before we can hoist them.
   if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
     if (!LI->isUnordered())
@@ -455,6 +511,9 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
       return true;
 
     // Don't hoist loads which have may-aliased stores in loop.
+    if (MSSA)
+      return !pointerInvalidatedByLoopWithMSSA(MSSA, LI, CurLoop);
+
     uint64_t Size = 0;
     if (LI->getType()->isSized())
       Size = I.getModule()->getDataLayout().getTypeStoreSize(LI->getType());
@@ -477,6 +536,11 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
     if (Behavior == FMRB_DoesNotAccessMemory)
       return true;
     if (AliasAnalysis::onlyReadsMemory(Behavior)) {
+      // With MemorySSA, the walker tells us whether anything in the loop may
+      // write to the memory the call reads, whether it is argmemonly or not.
+      if (MSSA)
+        return !pointerInvalidatedByLoopWithMSSA(MSSA, CI, CurLoop);
+
       // A readonly argmemonly function only reads from memory pointed to by
       // it's arguments with arbitrary offsets.  If we can prove there are no
       // writes to this memory in the loop, we can hoist or sink.
@@ -651,7 +715,7 @@ CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
 ///
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
                  const Loop *CurLoop, AliasSetTracker *CurAST,
-                 const LoopSafetyInfo *SafetyInfo) {
+                 const LoopSafetyInfo *SafetyInfo, MemorySSA *MSSA) {
   DEBUG(dbgs() << "LICM sinking instruction: " << I << "\n");
   bool Changed = false;
   if (isa<LoadInst>(I))
@@ -702,15 +766,24 @@ static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
     auto It = SunkCopies.find(ExitBlock);
     if (It != SunkCopies.end())
       New = It->second;
-    else
+    else {
       New = SunkCopies[ExitBlock] =
           CloneInstructionInExitBlock(I, *ExitBlock, *PN, LI, SafetyInfo);
+      // Only loads and readonly calls are sunk, so the copy is a MemoryUse.
+      if (MSSA && MSSA->getMemoryAccess(&I)) {
+        auto *NewMU = cast<MemoryUse>(MSSA->createMemoryAccessInBB(
+            New, nullptr, ExitBlock, MemorySSA::Beginning));
+        MSSA->insertUse(NewMU);
+      }
+    }
 
     PN->replaceAllUsesWith(New);
     PN->eraseFromParent();
   }
 
-  CurAST->deleteValue(&I);
+  if (CurAST)
+    CurAST->deleteValue(&I);
+  removeMemoryAccess(&I, MSSA);
   I.eraseFromParent();
   return Changed;
 }
@@ -719,7 +792,7 @@ static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
 /// is safe to hoist, this instruction is called to do the dirty work.
 ///
 static bool hoist(Instruction &I, const DominatorTree *DT, const Loop *CurLoop,
-                  const LoopSafetyInfo *SafetyInfo) {
+                  const LoopSafetyInfo *SafetyInfo, MemorySSA *MSSA) {
   auto *Preheader = CurLoop->getLoopPreheader();
   DEBUG(dbgs() << "LICM hoisting to " << Preheader->getName() << ": " << I
                << "\n");
@@ -738,6 +811,15 @@ static bool hoist(Instruction &I, const DominatorTree *DT, const Loop *CurLoop,
   // Move the new node to the Preheader, before its terminator.
   I.moveBefore(Preheader->getTerminator());
 
+  // Only loads and readonly calls are hoisted, so the access is a MemoryUse.
+  // Its defining access may be a MemoryPhi of the loop, so find the one that
+  // reaches the end of the preheader.
+  if (MSSA)
+    if (auto *MU = cast_or_null<MemoryUse>(MSSA->getMemoryAccess(&I))) {
+      MSSA->moveTo(MU, Preheader, MemorySSA::End);
+      MSSA->insertUse(MU);
+    }
+
   if (isa<LoadInst>(I))
     ++NumMovedLoads;
   else if (isa<CallInst>(I))
@@ -769,6 +851,7 @@ class LoopPromoter : public LoadAndStorePromoter {
   PredIteratorCache &PredCache;
   AliasSetTracker &AST;
   LoopInfo &LI;
+  MemorySSA *MSSA;
   DebugLoc DL;
   int Alignment;
   AAMDNodes AATags;
@@ -793,11 +876,12 @@ public:
                SmallPtrSetImpl<Value *> &PMA,
                SmallVectorImpl<BasicBlock *> &LEB,
                SmallVectorImpl<Instruction *> &LIP, PredIteratorCache &PIC,
-               AliasSetTracker &ast, LoopInfo &li, DebugLoc dl, int alignment,
-               const AAMDNodes &AATags)
+               AliasSetTracker &ast, LoopInfo &li, MemorySSA *MSSA, DebugLoc dl,
+               int alignment, const AAMDNodes &AATags)
       : LoadAndStorePromoter(Insts, S), SomePtr(SP), PointerMustAliases(PMA),
         LoopExitBlocks(LEB), LoopInsertPts(LIP), PredCache(PIC), AST(ast),
-        LI(li), DL(std::move(dl)), Alignment(alignment), AATags(AATags) {}
+        LI(li), MSSA(MSSA), DL(std::move(dl)), Alignment(alignment),
+        AATags(AATags) {}
 
   bool isInstInList(Instruction *I,
                     const SmallVectorImpl<Instruction *> &) const override {
@@ -825,14 +909,36 @@ public:
       NewSI->setDebugLoc(DL);
       if (AATags)
         NewSI->setAAMetadata(AATags);
+      if (MSSA)
+        insertMemoryDef(NewSI);
+    }
+  }
+
+  /// Add a MemoryDef for the store \p SI inserted into an exit block.
+  void insertMemoryDef(StoreInst *SI) const {
+    // Place it after the last access before it in its block, if any.
+    MemoryUseOrDef *NewMA = nullptr;
+    for (BasicBlock::iterator II = SI->getIterator(),
+                              IE = SI->getParent()->begin();
+         II != IE && !NewMA;) {
+      if (MemoryAccess *Prev = MSSA->getMemoryAccess(&*--II))
+        NewMA = cast<MemoryUseOrDef>(MSSA->createMemoryAccessAfter(
+            SI, nullptr, Prev));
     }
+    if (!NewMA)
+      NewMA = cast<MemoryUseOrDef>(MSSA->createMemoryAccessInBB(
+          SI, nullptr, SI->getParent(), MemorySSA::Beginning));
+    MSSA->insertDef(cast<MemoryDef>(NewMA));
   }
 
   void replaceLoadWithValue(LoadInst *LI, Value *V) const override {
     // Update alias analysis.
     AST.copyValue(LI, V);
   }
-  void instructionDeleted(Instruction *I) const override { AST.deleteValue(I); }
+  void instructionDeleted(Instruction *I) const override {
+    AST.deleteValue(I);
+    removeMemoryAccess(I, MSSA);
+  }
 };
 } // end anon namespace
 
@@ -845,7 +951,8 @@ bool llvm::promoteLoopAccessesToScalars(
     AliasSet &AS, SmallVectorImpl<BasicBlock *> &ExitBlocks,
     SmallVectorImpl<Instruction *> &InsertPts, PredIteratorCache &PIC,
     LoopInfo *LI, DominatorTree *DT, const TargetLibraryInfo *TLI,
-    Loop *CurLoop, AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo) {
+    Loop *CurLoop, AliasSetTracker *CurAST, LoopSafetyInfo *SafetyInfo,
+    MemorySSA *MSSA) {
   // Verify inputs.
   assert(LI != nullptr && DT != nullptr && CurLoop != nullptr &&
          CurAST != nullptr && SafetyInfo != nullptr &&
@@ -1046,7 +1153,8 @@ bool llvm::promoteLoopAccessesToScalars(
   SmallVector<PHINode *, 16> NewPHIs;
   SSAUpdater SSA(&NewPHIs);
   LoopPromoter Promoter(SomePtr, LoopUses, SSA, PointerMustAliases, ExitBlocks,
-                        InsertPts, PIC, *CurAST, *LI, DL, Alignment, AATags);
+                        InsertPts, PIC, *CurAST, *LI, MSSA, DL, Alignment,
+                        AATags);
 
   // Set up the preheader to have a definition of the value.  It is the live-out
   // value from the preheader that uses in the loop will use.
@@ -1057,14 +1165,21 @@ bool llvm::promoteLoopAccessesToScalars(
   if (AATags)
     PreheaderLoad->setAAMetadata(AATags);
   SSA.AddAvailableValue(Preheader, PreheaderLoad);
+  if (MSSA) {
+    auto *PreheaderMU = cast<MemoryUse>(MSSA->createMemoryAccessInBB(
+        PreheaderLoad, nullptr, Preheader, MemorySSA::End));
+    MSSA->insertUse(PreheaderMU);
+  }
 
   // Rewrite all the loads in the loop and remember all the definitions from
   // stores in the loop.
   Promoter.run(LoopUses);
 
   // If the SSAUpdater didn't use the load in the preheader, just zap it now.
-  if (PreheaderLoad->use_empty())
+  if (PreheaderLoad->use_empty()) {
+    removeMemoryAccess(PreheaderLoad, MSSA);
     PreheaderLoad->eraseFromParent();
+  }
 
   return Changed;
 }
@@ -1078,6 +1193,9 @@ bool llvm::promoteLoopAccessesToScalars(
 AliasSetTracker *
 LoopInvariantCodeMotion::collectAliasInfoForLoop(Loop *L, LoopInfo *LI,
                                                  AliasAnalysis *AA) {
+  // Building the alias sets does not change the IR, and decomposes the same
+  // GEPs for every pair of pointers it compares.
+  AliasAnalysis::QueryCacheScope CacheScope(*AA, DEBUG_TYPE);
   AliasSetTracker *CurAST = nullptr;
   SmallVector<Loop *, 4> RecomputeLoops;
   for (Loop *InnerL : L->getSubLoops()) {
@@ -1167,6 +1285,28 @@ static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
   return CurAST->getAliasSetForPointer(V, Size, AAInfo).isMod();
 }
 
+/// Return true if the body of this loop may write to the memory that \p I
+/// reads, according to MemorySSA.
+///
+static bool pointerInvalidatedByLoopWithMSSA(MemorySSA *MSSA, Instruction *I,
+                                             Loop *CurLoop) {
+  MemoryAccess *MA = MSSA->getMemoryAccess(I);
+  if (!MA)
+    return false;
+  ++NumMSSAChecks;
+  MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(MA);
+  return !MSSA->isLiveOnEntryDef(Clobber) &&
+         CurLoop->contains(Clobber->getBlock());
+}
+
+/// Remove the MemoryAccess of \p I, if there is one, before \p I is deleted.
+///
+static void removeMemoryAccess(Instruction *I, MemorySSA *MSSA) {
+  if (MSSA)
+    if (MemoryAccess *MA = MSSA->getMemoryAccess(I))
+      MSSA->removeMemoryAccess(MA);
+}
+
 /// Little predicate that returns true if the specified basic block is in
 /// a subloop of the current one, not the current one itself.
 ///
@@ -1174,3 +1314,15 @@ static bool inSubLoop(BasicBlock *BB, Loop *CurLoop, LoopInfo *LI) {
   assert(CurLoop->contains(BB) && "Only valid if BB is IN the loop");
   return LI->getLoopFor(BB) != CurLoop;
 }
+
+/// Return true if the loop has a simple store to a loop invariant address,
+/// which promoteLoopAccessesToScalars might be able to promote.
+///
+static bool hasPromotableStores(const Loop *CurLoop) {
+  for (BasicBlock *BB : CurLoop->blocks())
+    for (Instruction &I : *BB)
+      if (auto *SI = dyn_cast<StoreInst>(&I))
+        if (SI->isSimple() && CurLoop->isLoopInvariant(SI->getPointerOperand()))
+          return true;
+  return false;
+}
@@ -27,6 +27,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
@@ -251,7 +252,7 @@ namespace {
     void EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                         BasicBlock *TrueDest,
                                         BasicBlock *FalseDest,
-                                        Instruction *InsertPt,
+                                        BranchInst *OldBranch,
                                         TerminatorInst *TI);
 
     void SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L);
@@ -477,9 +478,7 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
     Changed |= processCurrentLoop();
   } while(redoLoop);
 
-  // FIXME: Reconstruct dom info, because it is not preserved properly.
-  if (Changed)
-    DT->recalculate(*F);
+  assert(!DT->hasPendingUpdates() && "Dominator tree updates not applied!");
   return Changed;
 }
 
@@ -779,12 +778,17 @@ static void copyMetadata(Instruction *DstInst, const Instruction *SrcInst,
 }
 
 /// Emit a conditional branch on two values if LIC == Val, branch to TrueDst,
-/// otherwise branch to FalseDest. Insert the code immediately before InsertPt.
+/// otherwise branch to FalseDest. The new branch replaces OldBranch, and the
+/// dominator tree is updated for it and any other queued CFG changes.
 void LoopUnswitch::EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                                   BasicBlock *TrueDest,
                                                   BasicBlock *FalseDest,
-                                                  Instruction *InsertPt,
+                                                  BranchInst *OldBranch,
                                                   TerminatorInst *TI) {
+  assert(OldBranch->isUnconditional() && "Preheader is not split correctly");
+  BasicBlock *BB = OldBranch->getParent();
+  BasicBlock *OldSucc = OldBranch->getSuccessor(0);
+  Instruction *InsertPt = OldBranch;
   // Insert a conditional branch on LIC to the two preheaders.  The original
   // code is the true version and the new code is the false version.
   Value *BranchVal = LIC;
@@ -801,6 +805,14 @@ void LoopUnswitch::EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
   // Insert the new branch.
   BranchInst *BI = BranchInst::Create(TrueDest, FalseDest, BranchVal, InsertPt);
   copyMetadata(BI, TI, Swapped);
+  LPM->deleteSimpleAnalysisValue(OldBranch, currentLoop);
+  OldBranch->eraseFromParent();
+
+  if (TrueDest != OldSucc)
+    DT->insertEdge(BB, TrueDest);
+  if (FalseDest != OldSucc)
+    DT->insertEdge(BB, FalseDest);
+  DT->applyUpdates(*BB->getParent());
 
   // If either edge is critical, split it. This helps preserve LoopSimplify
   // form for enclosing loops.
@@ -841,10 +853,9 @@ void LoopUnswitch::UnswitchTrivialCondition(Loop *L, Value *Cond, Constant *Val,
 
   // Okay, now we have a position to branch from and a position to branch to,
   // insert the new conditional branch.
-  EmitPreheaderBranchOnCondition(Cond, Val, NewExit, NewPH,
-                                 loopPreheader->getTerminator(), TI);
-  LPM->deleteSimpleAnalysisValue(loopPreheader->getTerminator(), L);
-  loopPreheader->getTerminator()->eraseFromParent();
+  EmitPreheaderBranchOnCondition(
+      Cond, Val, NewExit, NewPH,
+      cast<BranchInst>(loopPreheader->getTerminator()), TI);
 
   // We need to reprocess this loop, it could be unswitched again.
   redoLoop = true;
@@ -1096,6 +1107,17 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
     ParentLoop->addBasicBlockToLoop(NewBlocks[0], *LI);
   }
 
+  // The cloned blocks dominate each other like the original ones do. The
+  // cloned preheader will be entered from the original preheader.
+  DT->addNewBlock(NewBlocks[0], loopPreheader);
+  for (DomTreeNode *N : depth_first(DT->getNode(NewPreheader))) {
+    BasicBlock *BB = N->getBlock();
+    if (BB == NewPreheader || !VMap.count(BB))
+      continue;
+    DT->addNewBlock(cast<BasicBlock>(VMap[BB]),
+                    cast<BasicBlock>(VMap[N->getIDom()->getBlock()]));
+  }
+
   for (unsigned i = 0, e = ExitBlocks.size(); i != e; ++i) {
     BasicBlock *NewExit = cast<BasicBlock>(VMap[ExitBlocks[i]]);
     // The new exit block should be in the same loop as the old one.
@@ -1105,6 +1127,7 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
     assert(NewExit->getTerminator()->getNumSuccessors() == 1 &&
            "Exit block should have been split to have one successor!");
     BasicBlock *ExitSucc = NewExit->getTerminator()->getSuccessor(0);
+    DT->insertEdge(NewExit, ExitSucc);
 
     // If the successor of the exit block had PHI nodes, add an entry for
     // NewExit.
@@ -1144,8 +1167,6 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
   // Emit the new branch that selects between the two versions of this loop.
   EmitPreheaderBranchOnCondition(LIC, Val, NewBlocks[0], LoopBlocks[0], OldBR,
                                  TI);
-  LPM->deleteSimpleAnalysisValue(OldBR, L);
-  OldBR->eraseFromParent();
 
   LoopProcessWorklist.push_back(NewLoop);
   redoLoop = true;
@@ -1306,10 +1327,7 @@ void LoopUnswitch::RewriteLoopBodyWithConditionConstant(Loop *L, Value *LIC,
          PHINode *PN = dyn_cast<PHINode>(II); ++II)
       PN->setIncomingValue(PN->getBasicBlockIndex(Switch),
                            UndefValue::get(PN->getType()));
-    // Tell the domtree about the new block. We don't fully update the
-    // domtree here -- instead we force it to do a full recomputation
-    // after the pass is complete -- but we do need to inform it of
-    // new blocks.
+    // Tell the domtree about the new block. No other edges changed.
     DT->addNewBlock(Abort, NewSISucc);
   }
 
@@ -1383,6 +1401,15 @@ void LoopUnswitch::SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L) {
         BI->eraseFromParent();
         RemoveFromWorklist(BI, Worklist);
 
+        // Pred now dominates what Succ dominated.
+        if (DomTreeNode *SuccNode = DT->getNode(Succ)) {
+          DomTreeNode *PredNode = DT->getNode(Pred);
+          while (!SuccNode->getChildren().empty())
+            DT->changeImmediateDominator(SuccNode->getChildren().back(),
+                                         PredNode);
+          DT->eraseNode(Succ);
+        }
+
         // Remove Succ from the loop tree.
         LI->removeBlock(Succ);
         LPM->deleteSimpleAnalysisValue(Succ, L);
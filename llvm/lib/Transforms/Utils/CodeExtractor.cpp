@@ -217,10 +217,17 @@ void CodeExtractor::severSplitPHINodes(BasicBlock *&Header) {
   Blocks.insert(NewBB);
   Header = NewBB;
 
-  // Okay, update dominator sets. The blocks that dominate the new one are the
-  // blocks that dominate TIBB plus the new block itself.
-  if (DT)
-    DT->splitBlock(NewBB);
+  // Okay, update dominator sets. OldPred dominates NewBB, which takes over
+  // the nodes that OldPred used to dominate.
+  if (DT) {
+    DomTreeNode *OldNode = DT->getNode(OldPred);
+    SmallVector<DomTreeNode *, 8> Children(OldNode->begin(), OldNode->end());
+
+    DomTreeNode *NewNode = DT->addNewBlock(NewBB, OldPred);
+
+    for (DomTreeNode *I : Children)
+      DT->changeImmediateDominator(I, NewNode);
+  }
 
   // Okay, now we need to adjust the PHI nodes and any branches from within the
   // region to go to the new header block instead of the old header block.
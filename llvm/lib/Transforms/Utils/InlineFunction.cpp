@@ -1088,6 +1088,34 @@ static void AddAlignmentAssumptions(CallSite CS, InlineFunctionInfo &IFI) {
   }
 }
 
+/// Without a callgraph to update, still tell the client which call sites were
+/// inlined from the callee.
+static void collectInlinedCalls(const Function *Callee,
+                                ValueToValueMapTy &VMap,
+                                InlineFunctionInfo &IFI) {
+  for (const BasicBlock &BB : *Callee)
+    for (const Instruction &I : BB) {
+      if (!ImmutableCallSite(&I))
+        continue;
+
+      // Only report the call if it was inlined and not constant folded.
+      ValueToValueMapTy::iterator VMI = VMap.find(&I);
+      if (VMI == VMap.end() || VMI->second == nullptr)
+        continue;
+      Instruction *NewCall = dyn_cast<Instruction>(VMI->second);
+      if (!NewCall)
+        continue;
+
+      // Intrinsic calls are not inlining candidates.
+      CallSite CS(NewCall);
+      if (!CS || (CS.getCalledFunction() &&
+                  CS.getCalledFunction()->isIntrinsic()))
+        continue;
+
+      IFI.InlinedCalls.push_back(NewCall);
+    }
+}
+
 /// Once we have cloned code over from a callee into the caller,
 /// update the specified callgraph to reflect the changes we made.
 /// Note that it's possible that not all code was copied over, so only
@@ -1589,6 +1617,8 @@ bool llvm::InlineFunction(CallSite CS, InlineFunctionInfo &IFI,
     // Update the callgraph if requested.
     if (IFI.CG)
       UpdateCallGraphAfterInlining(CS, FirstNewBlock, VMap, IFI);
+    else
+      collectInlinedCalls(CalledFunc, VMap, IFI);
 
     // Update inlined instructions' line number information.
     fixupLineNumbers(Caller, FirstNewBlock, TheCall);
@@ -47,6 +47,10 @@ using namespace llvm;
 STATISTIC(NumClobberCacheLookups, "Number of Memory SSA version cache lookups");
 STATISTIC(NumClobberCacheHits, "Number of Memory SSA version cache hits");
 STATISTIC(NumClobberCacheInserts, "Number of MemorySSA version cache inserts");
+STATISTIC(NumClobberCacheResets,
+          "Number of times the MemorySSA version cache was full");
+STATISTIC(NumClobberWalkLimits,
+          "Number of MemorySSA clobber queries that hit the walk limit");
 
 INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
                       true)
@@ -65,6 +69,16 @@ static cl::opt<bool>
     VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
                     cl::desc("Verify MemorySSA in legacy printer pass."));
 
+static cl::opt<unsigned> MaxWalkerCacheSize(
+    "memssa-max-walker-cache-size", cl::init(0), cl::Hidden,
+    cl::desc("The number of clobbers the caching MemorySSA walker remembers "
+             "before it forgets all of them (0 = unlimited)"));
+
+static cl::opt<unsigned> MaxCheckLimit(
+    "memssa-check-limit", cl::init(0), cl::Hidden,
+    cl::desc("The maximum number of MemoryDefs the MemorySSA walker looks at "
+             "for a single clobber query (0 = unlimited)"));
+
 namespace llvm {
 /// \brief An assembly annotator class to print Memory SSA information in
 /// comments.
@@ -128,8 +142,12 @@ static bool instructionClobbersQuery(MemoryDef *MD, const MemoryLocation &Loc,
 class WalkerCache {
   DenseMap<ConstMemoryAccessPair, MemoryAccess *> Accesses;
   DenseMap<const MemoryAccess *, MemoryAccess *> Calls;
+  /// The number of clobbers to remember, or 0 for all of them.
+  unsigned MaxSize;
 
 public:
+  WalkerCache(unsigned MaxSize) : MaxSize(MaxSize) {}
+
   MemoryAccess *lookup(const MemoryAccess *MA, const MemoryLocation &Loc,
                        bool IsCall) const {
     ++NumClobberCacheLookups;
@@ -146,6 +164,13 @@ public:
     assert((MA != To || isa<MemoryPhi>(MA)) &&
            "Something can't clobber itself!");
 
+    // Bound the memory used on huge functions. Forgetting clobbers only costs
+    // the time to walk to them again.
+    if (MaxSize && Accesses.size() + Calls.size() >= MaxSize) {
+      ++NumClobberCacheResets;
+      clear();
+    }
+
     ++NumClobberCacheInserts;
     bool Inserted;
     if (IsCall)
@@ -312,11 +337,17 @@ class ClobberWalker {
         : DefPath(Loc, Init, Init, Previous) {}
   };
 
-  const MemorySSA &MSSA;
+  const MemorySSA *MSSA;
   AliasAnalysis &AA;
   DominatorTree &DT;
   WalkerCache &WC;
   UpwardsMemoryQuery *Query;
+  /// The number of MemoryDefs a query may look at, or 0 for no limit.
+  unsigned CheckLimit;
+  /// The number of MemoryDefs the current query may still look at.
+  unsigned WalkBudget;
+  /// Whether the current query ran out of WalkBudget.
+  bool WalkLimitReached;
   bool UseCache;
 
   // Phi optimization bookkeeping
@@ -335,7 +366,7 @@ class ClobberWalker {
                      const MemoryLocation &Loc) const {
 // EXPENSIVE_CHECKS because most of these queries are redundant.
 #ifdef EXPENSIVE_CHECKS
-    assert(MSSA.dominates(To, What));
+    assert(MSSA->dominates(To, What));
 #endif
     if (shouldIgnoreCache())
       return;
@@ -375,7 +406,7 @@ class ClobberWalker {
     SmallVector<const BasicBlock *, 8> ToCache;
     ToCache.push_back(BB);
 
-    MemoryAccess *Result = MSSA.getLiveOnEntryDef();
+    MemoryAccess *Result = MSSA->getLiveOnEntryDef();
     DomTreeNode *Node = DT.getNode(BB);
     while ((Node = Node->getIDom())) {
       auto At = WalkTargetCache.find(BB);
@@ -384,7 +415,7 @@ class ClobberWalker {
         break;
       }
 
-      auto *Accesses = MSSA.getBlockAccesses(Node->getBlock());
+      auto *Accesses = MSSA->getBlockAccesses(Node->getBlock());
       if (Accesses) {
         auto Iter = find_if(reverse(*Accesses), [](const MemoryAccess &MA) {
           return !isa<MemoryUse>(MA);
@@ -426,10 +457,20 @@ class ClobberWalker {
       if (Current == StopAt)
         return {Current, false, false};
 
-      if (auto *MD = dyn_cast<MemoryDef>(Current))
-        if (MSSA.isLiveOnEntryDef(MD) ||
-            instructionClobbersQuery(MD, Desc.Loc, *Query, AA))
+      if (auto *MD = dyn_cast<MemoryDef>(Current)) {
+        if (MSSA->isLiveOnEntryDef(MD))
+          return {MD, true, false};
+        // Once the query has looked at too many accesses, give up and treat
+        // the current one as its clobber. This is conservative: callers only
+        // ever learn that the query may be clobbered earlier than it is.
+        if (CheckLimit && WalkBudget == 0) {
+          WalkLimitReached = true;
+          return {MD, true, false};
+        }
+        --WalkBudget;
+        if (instructionClobbersQuery(MD, Desc.Loc, *Query, AA))
           return {MD, true, false};
+      }
 
       // Cache checks must be done last, because if Current is a clobber, the
       // cache will contain the clobber for Current.
@@ -507,7 +548,7 @@ class ClobberWalker {
         assert(Res.Result != StopWhere || Res.FromCache);
         // If this wasn't a cache hit, we hit a clobber when walking. That's a
         // failure.
-        if (!Res.FromCache || !MSSA.dominates(Res.Result, StopWhere))
+        if (!Res.FromCache || !MSSA->dominates(Res.Result, StopWhere))
           return PathIndex;
 
         // Otherwise, it's a valid thing to potentially optimize to.
@@ -522,7 +563,7 @@ class ClobberWalker {
         continue;
       }
 
-      assert(!MSSA.isLiveOnEntryDef(Res.Result) && "liveOnEntry is a clobber");
+      assert(!MSSA->isLiveOnEntryDef(Res.Result) && "liveOnEntry is a clobber");
       addSearches(cast<MemoryPhi>(Res.Result), PausedSearches, PathIndex);
     }
 
@@ -620,7 +661,7 @@ class ClobberWalker {
       assert(!Paths.empty() && "Need a path to move");
       auto Dom = Paths.begin();
       for (auto I = std::next(Dom), E = Paths.end(); I != E; ++I)
-        if (!MSSA.dominates(I->Clobber, Dom->Clobber))
+        if (!MSSA->dominates(I->Clobber, Dom->Clobber))
           Dom = I;
       auto Last = Paths.end() - 1;
       if (Last != Dom)
@@ -629,14 +670,14 @@ class ClobberWalker {
 
     MemoryPhi *Current = Phi;
     while (1) {
-      assert(!MSSA.isLiveOnEntryDef(Current) &&
+      assert(!MSSA->isLiveOnEntryDef(Current) &&
              "liveOnEntry wasn't treated as a clobber?");
 
       MemoryAccess *Target = getWalkTarget(Current);
       // If a TerminatedPath doesn't dominate Target, then it wasn't a legal
       // optimization for the prior phi.
       assert(all_of(TerminatedPaths, [&](const TerminatedPath &P) {
-        return MSSA.dominates(P.Clobber, Target);
+        return MSSA->dominates(P.Clobber, Target);
       }));
 
       // FIXME: This is broken, because the Blocker may be reported to be
@@ -782,7 +823,7 @@ class ClobberWalker {
 
   void verifyOptResult(const OptznResult &R) const {
     assert(all_of(R.OtherClobbers, [&](const TerminatedPath &P) {
-      return MSSA.dominates(P.Clobber, R.PrimaryClobber.Clobber);
+      return MSSA->dominates(P.Clobber, R.PrimaryClobber.Clobber);
     }));
   }
 
@@ -793,17 +834,23 @@ class ClobberWalker {
 
 public:
   ClobberWalker(const MemorySSA &MSSA, AliasAnalysis &AA, DominatorTree &DT,
-                WalkerCache &WC)
-      : MSSA(MSSA), AA(AA), DT(DT), WC(WC), UseCache(true) {}
+                WalkerCache &WC, unsigned CheckLimit)
+      : MSSA(&MSSA), AA(AA), DT(DT), WC(WC), CheckLimit(CheckLimit),
+        UseCache(true) {}
 
   void reset() { WalkTargetCache.clear(); }
 
+  /// Used when the MemorySSA that this walker belongs to is moved.
+  void setMemorySSA(const MemorySSA &M) { MSSA = &M; }
+
   /// Finds the nearest clobber for the given query, optimizing phis if
   /// possible.
   MemoryAccess *findClobber(MemoryAccess *Start, UpwardsMemoryQuery &Q,
                             bool UseWalkerCache = true) {
     setUseCache(UseWalkerCache);
     Query = &Q;
+    WalkBudget = CheckLimit;
+    WalkLimitReached = false;
 
     MemoryAccess *Current = Start;
     // This walker pretends uses don't exist. If we're handed one, silently grab
@@ -828,8 +875,11 @@ public:
       Result = OptRes.PrimaryClobber.Clobber;
     }
 
+    if (WalkLimitReached)
+      ++NumClobberWalkLimits;
 #ifdef EXPENSIVE_CHECKS
-    checkClobberSanity(Current, Result, Q.StartingLoc, MSSA, Q, AA);
+    else
+      checkClobberSanity(Current, Result, Q.StartingLoc, *MSSA, Q, AA);
 #endif
     return Result;
   }
@@ -894,7 +944,8 @@ class MemorySSA::CachingWalker final : public MemorySSAWalker {
   void verifyRemoved(MemoryAccess *);
 
 public:
-  CachingWalker(MemorySSA *, AliasAnalysis *, DominatorTree *);
+  CachingWalker(MemorySSA *, AliasAnalysis *, DominatorTree *,
+                unsigned CacheLimit, unsigned CheckLimit);
   ~CachingWalker() override;
 
   using MemorySSAWalker::getClobberingMemoryAccess;
@@ -912,6 +963,12 @@ public:
   /// earliest-MemoryAccess-we-can-optimize-to". This is necessary if we're
   /// going to have DT updates, if we remove MemoryAccesses, etc.
   void resetClobberWalker() { Walker.reset(); }
+
+  /// Used when the MemorySSA that this walker belongs to is moved.
+  void setMemorySSA(MemorySSA *M) {
+    MSSA = M;
+    Walker.setMemorySSA(*M);
+  }
 };
 
 /// \brief Rename a single basic block into MemorySSA form.
@@ -1033,8 +1090,12 @@ void MemorySSA::markUnreachableAsLiveOnEntry(BasicBlock *BB) {
   }
 }
 
-MemorySSA::MemorySSA(Function &Func, AliasAnalysis *AA, DominatorTree *DT)
+MemorySSA::MemorySSA(Function &Func, AliasAnalysis *AA, DominatorTree *DT,
+                     unsigned WalkerCacheLimit, unsigned WalkerCheckLimit)
     : AA(AA), DT(DT), F(Func), LiveOnEntryDef(nullptr), Walker(nullptr),
+      WalkerCacheLimit(WalkerCacheLimit ? WalkerCacheLimit
+                                        : MaxWalkerCacheSize),
+      WalkerCheckLimit(WalkerCheckLimit ? WalkerCheckLimit : MaxCheckLimit),
       NextID(0) {
   buildMemorySSA();
 }
@@ -1044,10 +1105,11 @@ MemorySSA::MemorySSA(MemorySSA &&MSSA)
       ValueToMemoryAccess(std::move(MSSA.ValueToMemoryAccess)),
       PerBlockAccesses(std::move(MSSA.PerBlockAccesses)),
       LiveOnEntryDef(std::move(MSSA.LiveOnEntryDef)),
-      Walker(std::move(MSSA.Walker)), NextID(MSSA.NextID) {
-  // Update the Walker MSSA pointer so it doesn't point to the moved-from MSSA
+      Walker(std::move(MSSA.Walker)), WalkerCacheLimit(MSSA.WalkerCacheLimit),
+      WalkerCheckLimit(MSSA.WalkerCheckLimit), NextID(MSSA.NextID) {
+  // Update the Walker MSSA pointers so they don't point to the moved-from MSSA
   // object any more.
-  Walker->MSSA = this;
+  Walker->setMemorySSA(this);
 }
 
 MemorySSA::~MemorySSA() {
@@ -1196,7 +1258,8 @@ MemorySSA::CachingWalker *MemorySSA::getWalkerImpl() {
   if (Walker)
     return Walker.get();
 
-  Walker = make_unique<CachingWalker>(this, AA, DT);
+  Walker = make_unique<CachingWalker>(this, AA, DT, WalkerCacheLimit,
+                                      WalkerCheckLimit);
   return Walker.get();
 }
 
@@ -1412,6 +1475,242 @@ void MemorySSA::removeMemoryAccess(MemoryAccess *MA) {
   removeFromLookups(MA);
 }
 
+void MemorySSA::moveTo(MemoryUse *What, BasicBlock *BB, InsertionPlace Point) {
+  BasicBlock *From = What->getBlock();
+  auto FromIt = PerBlockAccesses.find(From);
+  FromIt->second->remove(What);
+  if (FromIt->second->empty())
+    PerBlockAccesses.erase(FromIt);
+  BlockNumberingValid.erase(From);
+
+  What->Block = BB;
+  AccessList *Accesses = getOrCreateAccessList(BB);
+  if (Point == Beginning)
+    Accesses->insert(find_if(*Accesses,
+                             [](const MemoryAccess &MA) {
+                               return !isa<MemoryPhi>(MA);
+                             }),
+                     What);
+  else
+    Accesses->push_back(What);
+  BlockNumberingValid.erase(BB);
+  getWalkerImpl()->invalidateInfo(What);
+}
+
+/// \brief Returns the MemoryDef or MemoryPhi that defines memory at the end of
+/// \p BB.
+MemoryAccess *MemorySSA::getReachingDefAtEnd(BasicBlock *BB) {
+  if (const AccessList *Accesses = getBlockAccesses(BB))
+    for (const MemoryAccess &MA : reverse(*Accesses))
+      if (!isa<MemoryUse>(MA))
+        return const_cast<MemoryAccess *>(&MA);
+  return getReachingDefAtStart(BB);
+}
+
+/// \brief Returns the MemoryDef or MemoryPhi that defines memory at the
+/// beginning of \p BB.
+///
+/// MemoryPhis are only placed in blocks that reach a memory access, so a
+/// block without a MemoryPhi may still be reached by different definitions.
+/// Like SSA construction on demand, this creates a MemoryPhi for the block
+/// and removes it again if all predecessors provide the same definition.
+MemoryAccess *MemorySSA::getReachingDefAtStart(BasicBlock *BB) {
+  // Follow single predecessors without recursing.
+  while (true) {
+    if (MemoryPhi *Phi = getMemoryAccess(BB))
+      return Phi;
+    if (BB == &F.getEntryBlock() || !DT->isReachableFromEntry(BB))
+      return LiveOnEntryDef.get();
+    BasicBlock *Pred = BB->getSinglePredecessor();
+    if (!Pred)
+      break;
+    if (const AccessList *Accesses = getBlockAccesses(Pred))
+      for (const MemoryAccess &MA : reverse(*Accesses))
+        if (!isa<MemoryUse>(MA))
+          return const_cast<MemoryAccess *>(&MA);
+    BB = Pred;
+  }
+
+  // Create the MemoryPhi before visiting the predecessors, so that cycles end
+  // at it. It gets its operands only once all of them are known, so that it is
+  // not considered for removal while it is incomplete.
+  MemoryPhi *Phi = createMemoryPhi(BB);
+  SmallVector<std::pair<WeakVH, BasicBlock *>, 8> Incoming;
+  for (BasicBlock *Pred : predecessors(BB))
+    Incoming.push_back({DT->isReachableFromEntry(Pred)
+                            ? getReachingDefAtEnd(Pred)
+                            : LiveOnEntryDef.get(),
+                        Pred});
+  for (auto &In : Incoming)
+    Phi->addIncoming(cast<MemoryAccess>(In.first), In.second);
+  return tryRemoveTrivialPhi(Phi);
+}
+
+/// \brief Returns the MemoryDef or MemoryPhi that defines memory right before
+/// \p MA.
+MemoryAccess *MemorySSA::getReachingDefBefore(MemoryUseOrDef *MA) {
+  AccessList *Accesses = PerBlockAccesses.find(MA->getBlock())->second.get();
+  for (auto I = AccessList::reverse_iterator(MA->getIterator()),
+            E = Accesses->rend();
+       I != E; ++I)
+    if (!isa<MemoryUse>(*I))
+      return &*I;
+  return getReachingDefAtStart(MA->getBlock());
+}
+
+/// \brief Removes \p Phi if all of its operands are the same definition or the
+/// phi itself, and then tries to remove the MemoryPhis that used it.
+///
+/// \returns the definition that replaces \p Phi, or \p Phi if it was kept.
+MemoryAccess *MemorySSA::tryRemoveTrivialPhi(MemoryPhi *Phi) {
+  MemoryAccess *Same = nullptr;
+  for (Use &Op : Phi->incoming_values()) {
+    auto *Incoming = cast<MemoryAccess>(Op);
+    if (Incoming == Same || Incoming == Phi)
+      continue;
+    if (Same)
+      return Phi;
+    Same = Incoming;
+  }
+  if (!Same)
+    Same = LiveOnEntryDef.get();
+
+  SmallVector<WeakVH, 4> PhiUsers;
+  for (User *U : Phi->users())
+    if (U != Phi && isa<MemoryPhi>(U))
+      PhiUsers.push_back(U);
+  WeakVH Result(Same);
+  Phi->replaceAllUsesWith(Same);
+  removeFromLookups(Phi);
+  for (WeakVH &U : PhiUsers)
+    if (auto *UserPhi = dyn_cast_or_null<MemoryPhi>(U))
+      tryRemoveTrivialPhi(UserPhi);
+  return cast<MemoryAccess>(Result);
+}
+
+void MemorySSA::insertUse(MemoryUse *Use) {
+  Use->setDefiningAccess(getReachingDefBefore(Use));
+}
+
+/// \brief Renames the accesses that \p Root reaches after \p Def was inserted.
+///
+/// \p Root is either \p Def or a MemoryPhi that merges it with other
+/// definitions. The accesses in the dominator subtree of \p Root are visited
+/// in order, except for the subtrees of the other blocks in \p Roots. The
+/// definition live at the end of each visited block is recorded in \p EndDefs,
+/// so that the MemoryPhis of the successors can be updated afterwards.
+void MemorySSA::renameAfterInsert(
+    MemoryDef *Def, MemoryAccess *Root,
+    const SmallPtrSetImpl<BasicBlock *> &Roots,
+    DenseMap<BasicBlock *, MemoryAccess *> &EndDefs) {
+  auto RenameBlock = [&](BasicBlock *BB, AccessList::iterator I,
+                         MemoryAccess *Incoming) {
+    for (AccessList::iterator E = PerBlockAccesses.find(BB)->second->end();
+         I != E; ++I) {
+      if (isa<MemoryPhi>(*I)) {
+        Incoming = &*I;
+      } else if (auto *MD = dyn_cast<MemoryDef>(&*I)) {
+        MD->setDefiningAccess(Incoming);
+        Incoming = MD;
+      } else {
+        // A MemoryUse keeps its definition if it was optimized past Root and
+        // Def does not clobber it.
+        auto *MU = cast<MemoryUse>(&*I);
+        MemoryAccess *Old = MU->getDefiningAccess();
+        if (Old == Incoming || Old == Root || !dominates(Old, Root))
+          continue;
+        UpwardsMemoryQuery Q(MU->getMemoryInst(), MU);
+        if (instructionClobbersQuery(Def, Q.StartingLoc, Q, *AA))
+          MU->setDefiningAccess(Incoming);
+      }
+    }
+    EndDefs[BB] = Incoming;
+    return Incoming;
+  };
+
+  BasicBlock *RootBB = Root->getBlock();
+  AccessList::iterator Start = Root->getIterator();
+  if (Root == Def)
+    ++Start;
+  SmallVector<std::pair<DomTreeNode *, MemoryAccess *>, 32> Worklist;
+  Worklist.push_back({DT->getNode(RootBB),
+                      RenameBlock(RootBB, Start, Root == Def ? Def : Root)});
+  while (!Worklist.empty()) {
+    DomTreeNode *Node;
+    MemoryAccess *Incoming;
+    std::tie(Node, Incoming) = Worklist.pop_back_val();
+    for (DomTreeNode *Child : *Node) {
+      BasicBlock *BB = Child->getBlock();
+      if (Roots.count(BB))
+        continue;
+      MemoryAccess *Out = Incoming;
+      auto It = PerBlockAccesses.find(BB);
+      if (It != PerBlockAccesses.end())
+        Out = RenameBlock(BB, It->second->begin(), Incoming);
+      else
+        EndDefs[BB] = Incoming;
+      Worklist.push_back({Child, Out});
+    }
+  }
+}
+
+void MemorySSA::insertDef(MemoryDef *Def) {
+  BasicBlock *BB = Def->getBlock();
+  Def->setDefiningAccess(getReachingDefBefore(Def));
+
+  // If Def is the last definition in its block, it reaches the end of the block
+  // and needs MemoryPhis in the iterated dominance frontier.
+  SmallPtrSet<BasicBlock *, 16> PhiBlocks;
+  SmallVector<MemoryPhi *, 8> NewPhis;
+  if (getReachingDefAtEnd(BB) == Def) {
+    SmallPtrSet<BasicBlock *, 1> DefiningBlocks;
+    DefiningBlocks.insert(BB);
+    ForwardIDFCalculator IDFs(*DT);
+    IDFs.setDefiningBlocks(DefiningBlocks);
+    SmallVector<BasicBlock *, 32> IDFBlocks;
+    IDFs.calculate(IDFBlocks);
+    for (BasicBlock *PhiBB : IDFBlocks) {
+      PhiBlocks.insert(PhiBB);
+      if (!getMemoryAccess(PhiBB))
+        NewPhis.push_back(createMemoryPhi(PhiBB));
+    }
+  }
+
+  // Rename everything that Def and the MemoryPhis reach.
+  DenseMap<BasicBlock *, MemoryAccess *> EndDefs;
+  if (!PhiBlocks.count(BB))
+    renameAfterInsert(Def, Def, PhiBlocks, EndDefs);
+  for (BasicBlock *PhiBB : PhiBlocks)
+    renameAfterInsert(Def, getMemoryAccess(PhiBB), PhiBlocks, EndDefs);
+
+  // Update the operands of the MemoryPhis that the renamed blocks reach, and
+  // fill in the new ones.
+  for (const auto &End : EndDefs)
+    for (BasicBlock *Succ : successors(End.first)) {
+      MemoryPhi *Phi = getMemoryAccess(Succ);
+      if (!Phi || Phi->getNumIncomingValues() == 0)
+        continue;
+      for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+        if (Phi->getIncomingBlock(I) == End.first)
+          Phi->setIncomingValue(I, End.second);
+    }
+  for (MemoryPhi *Phi : NewPhis) {
+    SmallVector<std::pair<WeakVH, BasicBlock *>, 8> Incoming;
+    for (BasicBlock *Pred : predecessors(Phi->getBlock())) {
+      MemoryAccess *In = EndDefs.lookup(Pred);
+      if (!In)
+        In = DT->isReachableFromEntry(Pred) ? getReachingDefAtEnd(Pred)
+                                            : LiveOnEntryDef.get();
+      Incoming.push_back({In, Pred});
+    }
+    for (auto &In : Incoming)
+      Phi->addIncoming(cast<MemoryAccess>(In.first), In.second);
+  }
+
+  // The walker may have cached clobbers that Def is now in the way of.
+  getWalkerImpl()->invalidateInfo(Def);
+}
+
 void MemorySSA::print(raw_ostream &OS) const {
   MemorySSAAnnotatedWriter Writer(this);
   F.print(OS, &Writer);
@@ -1760,8 +2059,10 @@ void MemorySSAWrapperPass::print(raw_ostream &OS, const Module *M) const {
 MemorySSAWalker::MemorySSAWalker(MemorySSA *M) : MSSA(M) {}
 
 MemorySSA::CachingWalker::CachingWalker(MemorySSA *M, AliasAnalysis *A,
-                                        DominatorTree *D)
-    : MemorySSAWalker(M), Walker(*M, *A, *D, Cache), AutoResetWalker(true) {}
+                                        DominatorTree *D, unsigned CacheLimit,
+                                        unsigned CheckLimit)
+    : MemorySSAWalker(M), Cache(CacheLimit),
+      Walker(*M, *A, *D, Cache, CheckLimit), AutoResetWalker(true) {}
 
 MemorySSA::CachingWalker::~CachingWalker() {}
 
@@ -25,6 +25,10 @@
 // 4. LoopVectorizationCostModel - A unit that checks for the profitability
 //    of vectorization. It decides on the optimal vector width, which
 //    can be one, if vectorization is not profitable.
+// 5. LoopVectorizationPlanner - A unit that builds a VPlan, a list of
+//    per-instruction recipes, for every candidate vectorization of a loop
+//    and picks the cheapest one. Besides innermost loops it models outer
+//    loops whose inner loop is short enough to be replicated.
 //
 //===----------------------------------------------------------------------===//
 //
@@ -58,6 +62,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/CodeMetrics.h"
 #include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -92,6 +97,7 @@
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Utils/LoopVersioning.h"
+#include "llvm/Transforms/Utils/UnrollLoop.h"
 #include "llvm/Transforms/Vectorize.h"
 #include <algorithm>
 #include <map>
@@ -105,11 +111,20 @@ using namespace llvm::PatternMatch;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(OuterLoopsReplicated,
+          "Number of inner loops replicated to vectorize their outer loop");
+STATISTIC(EarlyExitLoopsVectorized, "Number of loops with an early exit "
+                                    "vectorized");
 
 static cl::opt<bool>
     EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
                        cl::desc("Enable if-conversion during vectorization."));
 
+static cl::opt<bool> EnableEarlyExitVectorization(
+    "enable-early-exit-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Enable vectorization of loops that can leave before the exit "
+             "of their latch."));
+
 /// We don't vectorize loops with a known constant trip count below this number.
 static cl::opt<unsigned> TinyTripCountVectorThreshold(
     "vectorizer-min-trip-count", cl::init(16), cl::Hidden,
@@ -212,6 +227,25 @@ static cl::opt<unsigned> PragmaVectorizeSCEVCheckThreshold(
     cl::desc("The maximum number of SCEV checks allowed with a "
              "vectorize(enable) pragma"));
 
+static cl::opt<bool> EnableOuterLoopVectorization(
+    "enable-outer-loop-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Consider vectorizing outer loops whose inner loop has a small "
+             "constant trip count, by replicating the inner loop."));
+
+static cl::opt<unsigned> OuterLoopMaxInnerTripCount(
+    "outer-loop-vectorize-max-inner-trip-count", cl::init(8), cl::Hidden,
+    cl::desc("The largest constant trip count of an inner loop that is "
+             "replicated to vectorize its outer loop."));
+
+static cl::opt<unsigned> OuterLoopMaxReplicatedSize(
+    "outer-loop-vectorize-max-replicated-size", cl::init(128), cl::Hidden,
+    cl::desc("The maximum number of instructions that replicating an inner "
+             "loop to vectorize its outer loop may create."));
+
+static cl::opt<bool> PrintVPlans(
+    "vectorizer-print-plans", cl::init(false), cl::Hidden,
+    cl::desc("Print the plans the loop vectorizer builds for each loop."));
+
 namespace {
 
 // Forward declarations.
@@ -296,7 +330,8 @@ public:
         AC(AC), ORE(ORE), VF(VecWidth), UF(UnrollFactor),
         Builder(PSE.getSE()->getContext()), Induction(nullptr),
         OldInduction(nullptr), WidenMap(UnrollFactor), TripCount(nullptr),
-        VectorTripCount(nullptr), Legal(nullptr), AddedSafetyChecks(false) {}
+        VectorTripCount(nullptr), EarlyExitCond(nullptr), Legal(nullptr),
+        AddedSafetyChecks(false) {}
 
   // Perform the actual loop widening (vectorization).
   // MinimumBitWidths maps scalar integer values to the smallest bitwidth they
@@ -359,6 +394,14 @@ protected:
   /// See PR14725.
   void fixLCSSAPHIs();
 
+  /// Returns true, per vector iteration, if any of its iterations takes the
+  /// early exit of the loop.
+  Value *getEarlyExitCondition();
+
+  /// Leave the vector loop for the scalar loop after a vector iteration that
+  /// contains the early exit of the loop, if it has one.
+  void fixEarlyExit();
+
   /// Shrinks vector element sizes based on information in "MinBWs".
   void truncateToMinimalBitwidths();
 
@@ -597,6 +640,8 @@ protected:
   Value *TripCount;
   /// Trip count of the widened loop (TripCount - TripCount % (VF*UF))
   Value *VectorTripCount;
+  /// True in a vector iteration that contains the early exit of the loop.
+  Value *EarlyExitCond;
 
   /// Map of scalar integer values to the smallest bitwidth they can be legally
   /// represented as. The vector equivalents of these values should be truncated
@@ -1363,9 +1408,10 @@ public:
       OptimizationRemarkEmitter *ORE, LoopVectorizationRequirements *R,
       LoopVectorizeHints *H)
       : NumPredStores(0), TheLoop(L), PSE(PSE), TLI(TLI), TTI(TTI), DT(DT),
-        GetLAA(GetLAA), LAI(nullptr), ORE(ORE), InterleaveInfo(PSE, L, DT, LI),
-        Induction(nullptr), WidestIndTy(nullptr), HasFunNoNaNAttr(false),
-        Requirements(R), Hints(H) {}
+        AA(AA), GetLAA(GetLAA), LAI(nullptr), ORE(ORE),
+        InterleaveInfo(PSE, L, DT, LI), Induction(nullptr),
+        EarlyExitingBlock(nullptr), WidestIndTy(nullptr),
+        HasFunNoNaNAttr(false), Requirements(R), Hints(H) {}
 
   /// ReductionList contains the reduction descriptors for all
   /// of the reductions that were found in the loop.
@@ -1387,6 +1433,14 @@ public:
   /// Returns the Induction variable.
   PHINode *getInduction() { return Induction; }
 
+  /// Returns the block other than the latch that can leave the loop, or null
+  /// if the latch is the only exiting block.
+  BasicBlock *getEarlyExitingBlock() { return EarlyExitingBlock; }
+
+  /// Returns the number of times the backedge is taken before the loop leaves
+  /// through its latch. A loop with an early exit may leave sooner.
+  const SCEV *getBackedgeTakenCount();
+
   /// Returns the reduction variables found in the loop.
   ReductionList *getReductionVars() { return &Reductions; }
 
@@ -1504,6 +1558,18 @@ private:
   /// transformation.
   bool canVectorizeWithIfConvert();
 
+  /// Return true if the loop leaves through its latch and through one other
+  /// block that dominates the latch. Records that block as the early exit.
+  bool canVectorizeEarlyExit();
+
+  /// The vector loop runs whole vector iterations past the iteration that
+  /// takes the early exit, and the scalar loop re-executes the vector
+  /// iteration that contains it. Returns true if every instruction of the
+  /// loop can be executed that way: loads must be known dereferenceable for
+  /// all iterations of the latch exit, and stores must not alias any other
+  /// access so they can be masked off for the re-executed vector iteration.
+  bool canSpeculateEarlyExit();
+
   /// Collect the variables that need to stay uniform after vectorization.
   void collectLoopUniforms();
 
@@ -1552,6 +1618,8 @@ private:
   const TargetTransformInfo *TTI;
   /// Dominator Tree.
   DominatorTree *DT;
+  /// Alias Analysis.
+  AliasAnalysis *AA;
   // LoopAccess analysis.
   std::function<const LoopAccessInfo &(Loop &)> *GetLAA;
   // And the loop-accesses info corresponding to this loop.  This pointer is
@@ -1569,6 +1637,8 @@ private:
   /// Holds the integer induction variable. This is the counter of the
   /// loop.
   PHINode *Induction;
+  /// Holds the block other than the latch that exits the loop, if any.
+  BasicBlock *EarlyExitingBlock;
   /// Holds the reduction variables.
   ReductionList Reductions;
   /// Holds all of the induction variables that we found in the loop.
@@ -1601,6 +1671,130 @@ private:
   SmallPtrSet<const Instruction *, 8> MaskedOp;
 };
 
+/// VPRecipe - describes how a single instruction of the scalar loop is turned
+/// into vector code by a plan, together with the cost of doing so.
+struct VPRecipe {
+  enum RecipeKind {
+    /// No code of its own: folded into another recipe or removed.
+    Ignored,
+    /// A single scalar copy per vector iteration.
+    Uniform,
+    /// One instruction operating on vector operands.
+    Widen,
+    /// An induction, reduction or recurrence PHI.
+    WidenPHI,
+    /// A consecutive, possibly reversed or masked, wide load or store.
+    WidenMemory,
+    /// A wide load or store plus shuffles for a whole interleave group.
+    InterleaveGroup,
+    /// A masked gather or scatter intrinsic.
+    GatherScatter,
+    /// VF scalar copies plus the inserts and extracts to feed them.
+    Replicate
+  };
+
+  VPRecipe(Instruction *I, RecipeKind Kind, unsigned Cost, unsigned Count)
+      : Instr(I), Kind(Kind), Cost(Cost), Count(Count) {}
+
+  static const char *getKindName(RecipeKind Kind) {
+    switch (Kind) {
+    case Ignored:
+      return "IGNORED";
+    case Uniform:
+      return "UNIFORM";
+    case Widen:
+      return "WIDEN";
+    case WidenPHI:
+      return "WIDEN-PHI";
+    case WidenMemory:
+      return "WIDEN-MEMORY";
+    case InterleaveGroup:
+      return "INTERLEAVE-GROUP";
+    case GatherScatter:
+      return "GATHER-SCATTER";
+    case Replicate:
+      return "REPLICATE";
+    }
+    llvm_unreachable("Unknown recipe kind");
+  }
+
+  /// The scalar instruction this recipe vectorizes.
+  Instruction *Instr;
+  /// How the instruction is vectorized.
+  RecipeKind Kind;
+  /// The cost of one copy of the recipe.
+  unsigned Cost;
+  /// How many copies of the recipe one vector iteration executes. This is
+  /// larger than one for the body of an inner loop that an outer loop plan
+  /// replicates.
+  unsigned Count;
+};
+
+/// VPlan - a candidate vectorization of a loop for one vectorization factor.
+/// A plan records a recipe for every instruction that contributes to the
+/// vector loop, which keeps the decisions of the cost model in one place and
+/// lets the planner compare plans for different factors, and for different
+/// loops of a nest, by their total cost.
+class VPlan {
+public:
+  VPlan(Loop *L, unsigned VF, Loop *ReplicatedLoop = nullptr)
+      : TheLoop(L), VF(VF), ReplicatedLoop(ReplicatedLoop), Cost(0),
+        ProducesVectorCode(false) {}
+
+  /// Append a recipe for \p I. \p IsVector tells whether the recipe still
+  /// operates on vector values after type legalization in the backend.
+  void addRecipe(Instruction *I, VPRecipe::RecipeKind Kind, unsigned C,
+                 bool IsVector, unsigned Count = 1) {
+    Recipes.push_back(VPRecipe(I, Kind, C, Count));
+    ProducesVectorCode |= IsVector;
+  }
+
+  Loop *getLoop() const { return TheLoop; }
+  unsigned getVF() const { return VF; }
+  /// \return the inner loop that the plan replicates, if this is a plan for
+  /// an outer loop.
+  Loop *getReplicatedLoop() const { return ReplicatedLoop; }
+  ArrayRef<VPRecipe> getRecipes() const { return Recipes; }
+
+  /// \return the cost of one vector iteration of the plan. The cost is *not*
+  /// normalized by the vectorization factor.
+  unsigned getCost() const { return Cost; }
+  void addCost(unsigned C) { Cost += C; }
+
+  /// \return true if any recipe operates on vector values after type
+  /// legalization in the backend.
+  bool producesVectorCode() const { return ProducesVectorCode; }
+
+  void print(raw_ostream &OS) const {
+    OS << "VPlan for loop '" << TheLoop->getHeader()->getName() << "' VF "
+       << VF;
+    if (ReplicatedLoop)
+      OS << " replicating inner loop '"
+         << ReplicatedLoop->getHeader()->getName() << "'";
+    OS << ": cost " << Cost << "\n";
+    for (const VPRecipe &R : Recipes) {
+      OS << "  " << VPRecipe::getKindName(R.Kind) << " cost " << R.Cost;
+      if (R.Count != 1)
+        OS << " x" << R.Count;
+      OS << ":" << *R.Instr << "\n";
+    }
+  }
+
+private:
+  /// The loop whose iterations the plan combines.
+  Loop *TheLoop;
+  /// The vectorization factor of the plan.
+  unsigned VF;
+  /// The inner loop that is fully replicated into the vector body.
+  Loop *ReplicatedLoop;
+  /// The recipes in the order of the instructions of the scalar loop.
+  SmallVector<VPRecipe, 32> Recipes;
+  /// The cost of one iteration of the plan.
+  unsigned Cost;
+  /// True if the plan emits instructions that operate on vectors.
+  bool ProducesVectorCode;
+};
+
 /// LoopVectorizationCostModel - estimates the expected speedups due to
 /// vectorization.
 /// In many cases vectorization is not profitable. This can happen because of
@@ -1625,11 +1819,15 @@ public:
     unsigned Width; // Vector width with best cost
     unsigned Cost;  // Cost of the loop with that width
   };
-  /// \return The most profitable vectorization factor and the cost of that VF.
-  /// This method checks every power of two up to VF. If UserVF is not ZERO
-  /// then this vectorization factor will be selected if vectorization is
-  /// possible.
-  VectorizationFactor selectVectorizationFactor(bool OptForSize);
+  /// \return The largest vectorization factor that the target and the
+  /// dependences of the loop allow, or zero if the loop must not be
+  /// vectorized at all.
+  unsigned computeMaxVF(bool OptForSize);
+
+  /// \return The plan that vectorizes the loop with a factor of \p VF. The
+  /// cost of the plan is the expected execution cost of one iteration of the
+  /// vector loop, which is *not* normalized by the vectorization factor.
+  VPlan buildPlan(unsigned VF);
 
   /// \return The size (in bits) of the smallest and widest types in the code
   /// that needs to be vectorized. We ignore values that remain scalar such as
@@ -1678,16 +1876,17 @@ private:
   /// actually taken place).
   typedef std::pair<unsigned, bool> VectorizationCostTy;
 
-  /// Returns the expected execution cost. The unit of the cost does
-  /// not matter because we use the 'cost' units to compare different
-  /// vector widths. The cost that is returned is *not* normalized by
-  /// the factor width.
-  VectorizationCostTy expectedCost(unsigned VF);
-
   /// Returns the execution time cost of an instruction for a given vector
   /// width. Vector width of one means scalar.
   VectorizationCostTy getInstructionCost(Instruction *I, unsigned VF);
 
+  /// Returns the recipe that vectorizes \p I with a vector width of \p VF.
+  VPRecipe::RecipeKind getRecipeKind(Instruction *I, unsigned VF);
+
+  /// Returns how the load or store \p I is vectorized with a vector width of
+  /// \p VF, which must be larger than one.
+  VPRecipe::RecipeKind getMemoryRecipeKind(Instruction *I, unsigned VF);
+
   /// The cost-computation logic from getInstructionCost which provides
   /// the vector type as an output parameter.
   unsigned getInstructionCost(Instruction *I, unsigned VF, Type *&VectorTy);
@@ -1801,6 +2000,74 @@ private:
   OptimizationRemarkEmitter &ORE;
 };
 
+/// LoopVectorizationPlanner - builds the candidate plans for vectorizing a
+/// loop and picks the cheapest one.
+///
+/// For an innermost loop there is one plan per vectorization factor. The
+/// cost model builds them from the decision it makes for every instruction.
+///
+/// The planner also models vectorizing an outer loop whose only inner loop
+/// runs for a small constant number of iterations. Such an inner loop is too
+/// short to be vectorized by itself. If its body is replicated into the
+/// outer loop instead, consecutive iterations of the outer loop can share
+/// vector instructions. The recipes of those plans follow how the operands
+/// and addresses of every instruction in the nest evolve in the outer loop.
+class LoopVectorizationPlanner {
+public:
+  LoopVectorizationPlanner(Loop *L, ScalarEvolution &SE,
+                           const TargetTransformInfo &TTI,
+                           LoopVectorizationCostModel *CM = nullptr)
+      : TheLoop(L), SE(SE), TTI(TTI), CM(CM) {}
+
+  /// Plan the vectorization of an innermost loop with the cost model.
+  /// \return The most profitable vectorization factor and the cost of that
+  /// factor. If the user provided a vectorization factor, it is selected if
+  /// vectorization is possible. A non-zero \p ForcedVF, which was already
+  /// chosen for the loop nest, takes precedence over both.
+  LoopVectorizationCostModel::VectorizationFactor plan(bool OptForSize,
+                                                       unsigned ForcedVF = 0);
+
+  /// Plan the vectorization of the outer loop when its inner loop \p Inner
+  /// is replicated \p TripCount times into the body. \p Force ignores the
+  /// cost of the scalar loop nest. \return The most profitable vectorization
+  /// factor, or one if no plan beats the scalar loop nest.
+  unsigned planOuterLoop(Loop *Inner, unsigned TripCount, bool Force);
+
+  /// Print all plans that were built.
+  void printPlans(raw_ostream &OS) const {
+    for (const VPlan &Plan : Plans)
+      Plan.print(OS);
+  }
+
+private:
+  /// Build the outer loop plan with a vectorization factor of \p VF.
+  VPlan buildOuterLoopPlan(Loop *Inner, unsigned TripCount, unsigned VF);
+
+  /// Add the recipe for \p I, which executes \p Count times per iteration of
+  /// the outer loop, to \p Plan.
+  void addOuterLoopRecipe(VPlan &Plan, Loop *Inner, Instruction *I,
+                          unsigned Count);
+
+  /// \return The value of \p V in the copy of the body of \p Inner for its
+  /// first iteration. The other copies differ from it by an offset that does
+  /// not change in the outer loop.
+  const SCEV *getOuterLoopSCEV(Value *V, Loop *Inner);
+
+  /// The loop being planned for.
+  Loop *TheLoop;
+  /// Scalar evolution, to follow addresses across the loop nest.
+  ScalarEvolution &SE;
+  /// Vector target information.
+  const TargetTransformInfo &TTI;
+  /// The cost model of an innermost loop.
+  LoopVectorizationCostModel *CM;
+  /// The plans built so far, one per vectorization factor.
+  SmallVector<VPlan, 4> Plans;
+  /// The instructions that control the loops of an outer loop plan. They
+  /// are folded away or stay scalar.
+  SmallPtrSet<Instruction *, 8> InnerLoopControl, OuterLoopControl;
+};
+
 static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
   if (L.empty())
     return V.push_back(&L);
@@ -2594,6 +2861,17 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr) {
     assert(!Legal->isUniform(SI->getPointerOperand()) &&
            "We do not allow storing to uniform addresses");
     setDebugLocFromInst(Builder, SI);
+
+    // The scalar loop re-executes the stores of a vector iteration that
+    // contains the early exit.
+    if (Legal->getEarlyExitingBlock()) {
+      Value *Keep = Builder.CreateVectorSplat(
+          VF, Builder.CreateNot(getEarlyExitCondition()));
+      for (unsigned Part = 0; Part < UF; ++Part)
+        Mask[Part] = Legal->blockNeedsPredication(SI->getParent())
+                         ? Builder.CreateAnd(Mask[Part], Keep)
+                         : Keep;
+    }
     // We don't want to update the value in the map as it might be used in
     // another expression. So don't use a reference type for "StoredVal".
     VectorParts StoredVal = getVectorValue(SI->getValueOperand());
@@ -2817,7 +3095,7 @@ Value *InnerLoopVectorizer::getOrCreateTripCount(Loop *L) {
   IRBuilder<> Builder(L->getLoopPreheader()->getTerminator());
   // Find the loop boundaries.
   ScalarEvolution *SE = PSE.getSE();
-  const SCEV *BackedgeTakenCount = PSE.getBackedgeTakenCount();
+  const SCEV *BackedgeTakenCount = Legal->getBackedgeTakenCount();
   assert(BackedgeTakenCount != SE->getCouldNotCompute() &&
          "Invalid loop count");
 
@@ -3036,8 +3314,20 @@ void InnerLoopVectorizer::createEmptyLoop() {
   BasicBlock *OldBasicBlock = OrigLoop->getHeader();
   BasicBlock *VectorPH = OrigLoop->getLoopPreheader();
   BasicBlock *ExitBlock = OrigLoop->getExitBlock();
+  if (BasicBlock *EarlyExiting = Legal->getEarlyExitingBlock()) {
+    // Only the scalar loop takes the early exit; the vector loop and the
+    // middle block leave through the exit of the latch.
+    auto *LatchBr = cast<BranchInst>(OrigLoop->getLoopLatch()->getTerminator());
+    ExitBlock = LatchBr->getSuccessor(
+        OrigLoop->contains(LatchBr->getSuccessor(0)) ? 1 : 0);
+    // Give the early exit a block of its own if both exits share one, so that
+    // the exit block only sees the values of the latch exit.
+    if (is_contained(predecessors(ExitBlock), EarlyExiting))
+      SplitBlockPredecessors(ExitBlock, EarlyExiting, ".early", DT, LI, true);
+  }
   assert(VectorPH && "Invalid loop structure");
   assert(ExitBlock && "Must have an exit block");
+  LoopExitBlock = ExitBlock;
 
   // Some loops have a single integer induction variable, while other loops
   // don't. One example is c++ iterators that often have multiple pointer
@@ -3174,7 +3464,6 @@ void InnerLoopVectorizer::createEmptyLoop() {
   LoopVectorPreHeader = Lp->getLoopPreheader();
   LoopScalarPreHeader = ScalarPH;
   LoopMiddleBlock = MiddleBlock;
-  LoopExitBlock = ExitBlock;
   LoopVectorBody = VecBody;
   LoopScalarBody = OldBasicBlock;
 
@@ -3200,7 +3489,10 @@ void InnerLoopVectorizer::fixupIVUsers(PHINode *OrigPhi,
   // value (the value that feeds into the phi from the loop latch).
   // We allow both, but they, obviously, have different values.
 
-  assert(OrigLoop->getExitBlock() && "Expected a single exit block");
+  // Users behind an early exit are only reached from the scalar loop.
+  auto IsExitUser = [&](Instruction *UI) {
+    return !OrigLoop->contains(UI) && UI->getParent() == LoopExitBlock;
+  };
 
   DenseMap<Value *, Value *> MissingVals;
 
@@ -3209,7 +3501,7 @@ void InnerLoopVectorizer::fixupIVUsers(PHINode *OrigPhi,
   Value *PostInc = OrigPhi->getIncomingValueForBlock(OrigLoop->getLoopLatch());
   for (User *U : PostInc->users()) {
     Instruction *UI = cast<Instruction>(U);
-    if (!OrigLoop->contains(UI)) {
+    if (IsExitUser(UI)) {
       assert(isa<PHINode>(UI) && "Expected LCSSA form");
       MissingVals[UI] = EndValue;
     }
@@ -3220,7 +3512,7 @@ void InnerLoopVectorizer::fixupIVUsers(PHINode *OrigPhi,
   // that is Start + (Step * (CRD - 1)).
   for (User *U : OrigPhi->users()) {
     auto *UI = cast<Instruction>(U);
-    if (!OrigLoop->contains(UI)) {
+    if (IsExitUser(UI)) {
       const DataLayout &DL =
           OrigLoop->getHeader()->getModule()->getDataLayout();
       assert(isa<PHINode>(UI) && "Expected LCSSA form");
@@ -3776,6 +4068,9 @@ void InnerLoopVectorizer::vectorizeLoop() {
 
   fixLCSSAPHIs();
 
+  // Leave the vector loop when a vector iteration contains an early exit.
+  fixEarlyExit();
+
   // Make sure DomTree is updated.
   updateAnalysis();
 
@@ -3950,9 +4245,102 @@ void InnerLoopVectorizer::fixLCSSAPHIs() {
     auto *LCSSAPhi = dyn_cast<PHINode>(&LEI);
     if (!LCSSAPhi)
       break;
-    if (LCSSAPhi->getNumIncomingValues() == 1)
-      LCSSAPhi->addIncoming(UndefValue::get(LCSSAPhi->getType()),
-                            LoopMiddleBlock);
+    if (LCSSAPhi->getBasicBlockIndex(LoopMiddleBlock) != -1)
+      continue;
+    // A value that the loop does not compute, like the one an exit block
+    // shared with an early exit gets from the latch, passes through
+    // unchanged.
+    Value *Incoming =
+        LCSSAPhi->getIncomingValueForBlock(OrigLoop->getLoopLatch());
+    auto *IncomingInst = dyn_cast<Instruction>(Incoming);
+    if (IncomingInst && OrigLoop->contains(IncomingInst))
+      Incoming = UndefValue::get(LCSSAPhi->getType());
+    LCSSAPhi->addIncoming(Incoming, LoopMiddleBlock);
+  }
+}
+
+Value *InnerLoopVectorizer::getEarlyExitCondition() {
+  if (EarlyExitCond)
+    return EarlyExitCond;
+
+  BasicBlock *Exiting = Legal->getEarlyExitingBlock();
+  auto *BI = cast<BranchInst>(Exiting->getTerminator());
+  bool ExitOnTrue = !OrigLoop->contains(BI->getSuccessor(0));
+  const VectorParts &Cond = getVectorValue(BI->getCondition());
+
+  // Or together the lanes of all parts that take the exit.
+  Value *Any = nullptr;
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    Value *Exits = ExitOnTrue ? Cond[Part] : Builder.CreateNot(Cond[Part]);
+    Any = Any ? Builder.CreateOr(Any, Exits) : Exits;
+  }
+  // Reduce the lanes like the reductions do. Targets without mask registers
+  // do not lower a bitcast of the vector of i1 to an integer correctly.
+  if (VF > 1) {
+    SmallVector<Constant *, 32> ShuffleMask(VF, nullptr);
+    for (unsigned i = VF; i != 1; i >>= 1) {
+      for (unsigned j = 0; j != i / 2; ++j)
+        ShuffleMask[j] = Builder.getInt32(i / 2 + j);
+      std::fill(&ShuffleMask[i / 2], ShuffleMask.end(),
+                UndefValue::get(Builder.getInt32Ty()));
+      Value *Shuf = Builder.CreateShuffleVector(
+          Any, UndefValue::get(Any->getType()),
+          ConstantVector::get(ShuffleMask), "rdx.shuf");
+      Any = Builder.CreateOr(Any, Shuf, "bin.rdx");
+    }
+    Any = Builder.CreateExtractElement(Any, Builder.getInt32(0));
+  }
+  Any->setName("early.exit");
+  EarlyExitCond = Any;
+  return Any;
+}
+
+void InnerLoopVectorizer::fixEarlyExit() {
+  if (!Legal->getEarlyExitingBlock())
+    return;
+
+  // The vector loop leaves after a vector iteration in which some iteration
+  // of the scalar loop takes the early exit. That vector iteration had its
+  // stores masked off, and the scalar loop re-executes it from its first
+  // iteration and takes the exit itself:
+  //
+  //   vector.body:
+  //     ...
+  //     br (early.exit | index.next == n.vec), vector.early.exit, vector.body
+  //   vector.early.exit:
+  //     br early.exit, scalar.ph, middle.block
+  auto *LatchBr = cast<BranchInst>(LoopVectorBody->getTerminator());
+  Builder.SetInsertPoint(LatchBr);
+  Value *AnyExit = getEarlyExitCondition();
+  LatchBr->setCondition(
+      Builder.CreateOr(AnyExit, LatchBr->getCondition(), "vector.leave"));
+
+  BasicBlock *Check =
+      BasicBlock::Create(LoopVectorBody->getContext(), "vector.early.exit",
+                         LoopVectorBody->getParent(), LoopMiddleBlock);
+  LatchBr->setSuccessor(0, Check);
+  BranchInst::Create(LoopScalarPreHeader, LoopMiddleBlock, AnyExit, Check);
+  if (Loop *ParentLoop = OrigLoop->getParentLoop())
+    ParentLoop->addBasicBlockToLoop(Check, *LI);
+
+  // The scalar loop resumes at the first iteration of the vector iteration.
+  IRBuilder<> B(Check->getTerminator());
+  const DataLayout &DL = OrigLoop->getHeader()->getModule()->getDataLayout();
+  for (auto &InductionEntry : *Legal->getInductionVars()) {
+    PHINode *OrigPhi = InductionEntry.first;
+    InductionDescriptor II = InductionEntry.second;
+    auto *BCResumeVal =
+        cast<PHINode>(OrigPhi->getIncomingValueForBlock(LoopScalarPreHeader));
+    Value *Resume = Induction;
+    if (OrigPhi != OldInduction) {
+      Type *StepType = II.getStep()->getType();
+      Instruction::CastOps CastOp =
+          CastInst::getCastOpcode(Induction, true, StepType, true);
+      Value *Index = B.CreateCast(CastOp, Induction, StepType, "cast.index");
+      Resume = II.transform(B, Index, PSE.getSE(), DL);
+      Resume->setName("ind.resume");
+    }
+    BCResumeVal->addIncoming(Resume, Check);
   }
 }
 
@@ -4392,7 +4780,11 @@ void InnerLoopVectorizer::updateAnalysis() {
   // single loop.
   DT->addNewBlock(LoopVectorBody, LoopVectorPreHeader);
 
-  DT->addNewBlock(LoopMiddleBlock, LoopVectorBody);
+  // The middle block follows the latch, or the check for an early exit.
+  BasicBlock *MiddlePred = LoopMiddleBlock->getSinglePredecessor();
+  if (MiddlePred != LoopVectorBody)
+    DT->addNewBlock(MiddlePred, LoopVectorBody);
+  DT->addNewBlock(LoopMiddleBlock, MiddlePred);
   DT->addNewBlock(LoopScalarPreHeader, LoopBypassBlocks[0]);
   DT->changeImmediateDominator(LoopScalarBody, LoopScalarPreHeader);
   DT->changeImmediateDominator(LoopExitBlock, LoopBypassBlocks[0]);
@@ -4469,6 +4861,148 @@ bool LoopVectorizationLegality::canVectorizeWithIfConvert() {
   return true;
 }
 
+const SCEV *LoopVectorizationLegality::getBackedgeTakenCount() {
+  if (!EarlyExitingBlock)
+    return PSE.getBackedgeTakenCount();
+  return PSE.getSE()->getExitCount(TheLoop, TheLoop->getLoopLatch());
+}
+
+bool LoopVectorizationLegality::canVectorizeEarlyExit() {
+  if (!EnableEarlyExitVectorization)
+    return false;
+
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  TheLoop->getExitingBlocks(ExitingBlocks);
+  if (ExitingBlocks.size() != 2)
+    return false;
+
+  BasicBlock *Latch = TheLoop->getLoopLatch();
+  BasicBlock *Exiting =
+      ExitingBlocks[0] == Latch ? ExitingBlocks[1] : ExitingBlocks[0];
+  if (Exiting == Latch || !is_contained(ExitingBlocks, Latch))
+    return false;
+
+  // The early exit must be tested on every iteration so that we know which
+  // iteration takes it.
+  if (!DT->dominates(Exiting, Latch))
+    return false;
+
+  // Both exits must be plain conditional branches.
+  for (BasicBlock *BB : ExitingBlocks) {
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI || !BI->isConditional())
+      return false;
+  }
+
+  EarlyExitingBlock = Exiting;
+  DEBUG(dbgs() << "LV: Found an early exit in " << Exiting->getName()
+               << '\n');
+  return true;
+}
+
+bool LoopVectorizationLegality::canSpeculateEarlyExit() {
+  // Report the loop like any other loop with more than one exit.
+  auto CannotSpeculate = [&](const char *Why) {
+    emitAnalysis(VectorizationReport()
+                 << "loop control flow is not understood by vectorizer");
+    DEBUG(dbgs() << "LV: Cannot vectorize the early exit: " << Why << '\n');
+    return false;
+  };
+
+  if (!Reductions.empty() || !FirstOrderRecurrences.empty())
+    return CannotSpeculate("loop has a reduction or recurrence");
+
+  // The loads of a vector iteration can reach past the iteration that takes
+  // the early exit, but never past the last iteration of the latch exit.
+  ScalarEvolution *SE = PSE.getSE();
+  const SCEV *ExitCount = getBackedgeTakenCount();
+  APInt MaxExitCount = SE->getUnsignedRange(ExitCount).getUnsignedMax();
+  if (MaxExitCount.getActiveBits() > 32)
+    return CannotSpeculate("could not bound the iterations");
+  uint64_t MaxTripCount = MaxExitCount.getZExtValue() + 1;
+
+  const DataLayout &DL = TheLoop->getHeader()->getModule()->getDataLayout();
+  Instruction *CtxI = TheLoop->getLoopPreheader()->getTerminator();
+  SmallVector<Instruction *, 8> MemInsts;
+  SmallVector<StoreInst *, 4> Stores;
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    for (Instruction &I : *BB) {
+      if (auto *LI = dyn_cast<LoadInst>(&I)) {
+        MemInsts.push_back(LI);
+        if (!LI->isSimple())
+          return CannotSpeculate("volatile or atomic load");
+        Value *Ptr = LI->getPointerOperand();
+        if (isUniform(Ptr)) {
+          if (isDereferenceablePointer(Ptr, DL, CtxI, DT))
+            continue;
+        } else if (isConsecutivePtr(Ptr) == 1) {
+          // The consecutive access covers Start .. Start + MaxTripCount
+          // elements.
+          const auto *AR = dyn_cast<SCEVAddRecExpr>(PSE.getSCEV(Ptr));
+          const SCEV *Start = AR ? AR->getStart() : nullptr;
+          APInt Offset(DL.getPointerTypeSizeInBits(Ptr->getType()), 0);
+          if (auto *Add = dyn_cast_or_null<SCEVAddExpr>(Start)) {
+            auto *C = dyn_cast<SCEVConstant>(Add->getOperand(0));
+            if (Add->getNumOperands() == 2 && C &&
+                !C->getAPInt().isNegative()) {
+              Offset = C->getAPInt().zextOrTrunc(Offset.getBitWidth());
+              Start = Add->getOperand(1);
+            }
+          }
+          uint64_t EltSize = DL.getTypeStoreSize(LI->getType());
+          APInt Size =
+              Offset + APInt(Offset.getBitWidth(), MaxTripCount * EltSize);
+          if (auto *Base = dyn_cast_or_null<SCEVUnknown>(Start))
+            if (isDereferenceableAndAlignedPointer(Base->getValue(), 1, Size,
+                                                   DL, CtxI, DT))
+              continue;
+        }
+        return CannotSpeculate("load may not be dereferenceable");
+      }
+
+      if (auto *SI = dyn_cast<StoreInst>(&I)) {
+        MemInsts.push_back(SI);
+        Stores.push_back(SI);
+        continue;
+      }
+
+      if (I.mayReadOrWriteMemory())
+        return CannotSpeculate("instruction accesses memory");
+
+      // Everything else runs for the iterations after the early exit too.
+      if (!isa<PHINode>(I) && !isa<BranchInst>(I) &&
+          !isa<DbgInfoIntrinsic>(I) && !isSafeToSpeculativelyExecute(&I))
+        return CannotSpeculate("instruction may trap");
+    }
+  }
+
+  // Stores of the vector iteration that takes the early exit are masked off
+  // as a whole, so they must follow the exit and must not feed any other
+  // access of the loop.
+  for (StoreInst *SI : Stores) {
+    Value *Ptr = SI->getPointerOperand();
+    Type *Ty = SI->getValueOperand()->getType();
+    if (!SI->isSimple() || SI->getParent() == EarlyExitingBlock ||
+        !DT->dominates(EarlyExitingBlock, SI->getParent()) ||
+        !isLegalMaskedStore(Ty, Ptr))
+      return CannotSpeculate("store cannot be masked");
+    // The accesses cover a different location on every iteration.
+    MemoryLocation Loc = MemoryLocation::get(SI);
+    Loc.Size = MemoryLocation::UnknownSize;
+    for (Instruction *Other : MemInsts) {
+      if (Other == SI)
+        continue;
+      MemoryLocation OtherLoc = MemoryLocation::get(Other);
+      OtherLoc.Size = MemoryLocation::UnknownSize;
+      if (AA->alias(Loc, OtherLoc) != NoAlias)
+        return CannotSpeculate("store may alias another access");
+    }
+    MaskedOp.insert(SI);
+  }
+
+  return true;
+}
+
 bool LoopVectorizationLegality::canVectorize() {
   // We must have a loop in canonical form. Loops with indirectbr in them cannot
   // be canonicalized.
@@ -4491,8 +5025,9 @@ bool LoopVectorizationLegality::canVectorize() {
     return false;
   }
 
-  // We must have a single exiting block.
-  if (!TheLoop->getExitingBlock()) {
+  // We must have a single exiting block, unless the loop leaves through its
+  // latch and one early exit.
+  if (!TheLoop->getExitingBlock() && !canVectorizeEarlyExit()) {
     emitAnalysis(VectorizationReport()
                  << "loop control flow is not understood by vectorizer");
     return false;
@@ -4501,7 +5036,8 @@ bool LoopVectorizationLegality::canVectorize() {
   // We only handle bottom-tested loops, i.e. loop in which the condition is
   // checked at the end of each iteration. With that we can assume that all
   // instructions in the loop are executed the same number of times.
-  if (TheLoop->getExitingBlock() != TheLoop->getLoopLatch()) {
+  if (!EarlyExitingBlock &&
+      TheLoop->getExitingBlock() != TheLoop->getLoopLatch()) {
     emitAnalysis(VectorizationReport()
                  << "loop control flow is not understood by vectorizer");
     return false;
@@ -4519,7 +5055,7 @@ bool LoopVectorizationLegality::canVectorize() {
   }
 
   // ScalarEvolution needs to be able to find the exit count.
-  const SCEV *ExitCount = PSE.getBackedgeTakenCount();
+  const SCEV *ExitCount = getBackedgeTakenCount();
   if (ExitCount == PSE.getSE()->getCouldNotCompute()) {
     emitAnalysis(VectorizationReport()
                  << "could not determine number of loop iterations");
@@ -4554,8 +5090,9 @@ bool LoopVectorizationLegality::canVectorize() {
   if (EnableInterleavedMemAccesses.getNumOccurrences() > 0)
     UseInterleaved = EnableInterleavedMemAccesses;
 
-  // Analyze interleaved memory accesses.
-  if (UseInterleaved)
+  // Analyze interleaved memory accesses. Loops with an early exit only use
+  // consecutive accesses.
+  if (UseInterleaved && !EarlyExitingBlock)
     InterleaveInfo.analyzeInterleaving(*getSymbolicStrides());
 
   unsigned SCEVThreshold = VectorizeSCEVCheckThreshold;
@@ -4907,6 +5444,10 @@ void LoopVectorizationLegality::collectLoopUniforms() {
 bool LoopVectorizationLegality::canVectorizeMemory() {
   LAI = &(*GetLAA)(*TheLoop);
   InterleaveInfo.setLAI(LAI);
+
+  // LoopAccessAnalysis only handles loops with a single exiting block.
+  if (EarlyExitingBlock)
+    return canSpeculateEarlyExit();
   auto &OptionalReport = LAI->getReport();
   if (OptionalReport)
     emitAnalysis(VectorizationReport(*OptionalReport));
@@ -5256,10 +5797,7 @@ void InterleavedAccessInfo::analyzeInterleaving(
     }
 }
 
-LoopVectorizationCostModel::VectorizationFactor
-LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
-  // Width 1 means no vectorize
-  VectorizationFactor Factor = {1U, 0U};
+unsigned LoopVectorizationCostModel::computeMaxVF(bool OptForSize) {
   if (OptForSize && Legal->getRuntimePointerChecking()->Need) {
     emitAnalysis(
         VectorizationReport()
@@ -5268,7 +5806,7 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
            "compiling with -Os/-Oz");
     DEBUG(dbgs()
           << "LV: Aborting. Runtime ptr check is required with -Os/-Oz.\n");
-    return Factor;
+    return 0;
   }
 
   if (!EnableCondStoresVectorization && Legal->getNumPredStores()) {
@@ -5276,7 +5814,7 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
         VectorizationReport()
         << "store that is conditionally executed prevents vectorization");
     DEBUG(dbgs() << "LV: No vectorization. There are conditional stores.\n");
-    return Factor;
+    return 0;
   }
 
   // Find the trip count.
@@ -5346,7 +5884,7 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
           VectorizationReport()
           << "unable to calculate the loop count due to complex control flow");
       DEBUG(dbgs() << "LV: Aborting. A tail loop is required with -Os/-Oz.\n");
-      return Factor;
+      return 0;
     }
 
     // Find the maximum SIMD width that can fit within the trip count.
@@ -5363,60 +5901,11 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
                       "with '#pragma clang loop vectorize(enable)' "
                       "when compiling with -Os/-Oz");
       DEBUG(dbgs() << "LV: Aborting. A tail loop is required with -Os/-Oz.\n");
-      return Factor;
-    }
-  }
-
-  int UserVF = Hints->getWidth();
-  if (UserVF != 0) {
-    assert(isPowerOf2_32(UserVF) && "VF needs to be a power of two");
-    DEBUG(dbgs() << "LV: Using user VF " << UserVF << ".\n");
-
-    Factor.Width = UserVF;
-    return Factor;
-  }
-
-  float Cost = expectedCost(1).first;
-#ifndef NDEBUG
-  const float ScalarCost = Cost;
-#endif /* NDEBUG */
-  unsigned Width = 1;
-  DEBUG(dbgs() << "LV: Scalar loop costs: " << (int)ScalarCost << ".\n");
-
-  bool ForceVectorization = Hints->getForce() == LoopVectorizeHints::FK_Enabled;
-  // Ignore scalar width, because the user explicitly wants vectorization.
-  if (ForceVectorization && VF > 1) {
-    Width = 2;
-    Cost = expectedCost(Width).first / (float)Width;
-  }
-
-  for (unsigned i = 2; i <= VF; i *= 2) {
-    // Notice that the vector loop needs to be executed less times, so
-    // we need to divide the cost of the vector loops by the width of
-    // the vector elements.
-    VectorizationCostTy C = expectedCost(i);
-    float VectorCost = C.first / (float)i;
-    DEBUG(dbgs() << "LV: Vector loop of width " << i
-                 << " costs: " << (int)VectorCost << ".\n");
-    if (!C.second && !ForceVectorization) {
-      DEBUG(
-          dbgs() << "LV: Not considering vector loop of width " << i
-                 << " because it will not generate any vector instructions.\n");
-      continue;
-    }
-    if (VectorCost < Cost) {
-      Cost = VectorCost;
-      Width = i;
+      return 0;
     }
   }
 
-  DEBUG(if (ForceVectorization && Width > 1 && Cost >= ScalarCost) dbgs()
-        << "LV: Vectorization seems to be not beneficial, "
-        << "but was forced by a user.\n");
-  DEBUG(dbgs() << "LV: Selecting VF: " << Width << ".\n");
-  Factor.Width = Width;
-  Factor.Cost = Width * Cost;
-  return Factor;
+  return VF;
 }
 
 std::pair<unsigned, unsigned>
@@ -5548,7 +6037,7 @@ unsigned LoopVectorizationCostModel::selectInterleaveCount(bool OptForSize,
   // If we did not calculate the cost for VF (because the user selected the VF)
   // then we calculate the cost of VF here.
   if (LoopCost == 0)
-    LoopCost = expectedCost(VF).first;
+    LoopCost = buildPlan(VF).getCost();
 
   // Clamp the calculated IC to be between the 1 and the max interleave count
   // that the target allows.
@@ -5778,13 +6267,12 @@ LoopVectorizationCostModel::calculateRegisterUsage(ArrayRef<unsigned> VFs) {
   return RUs;
 }
 
-LoopVectorizationCostModel::VectorizationCostTy
-LoopVectorizationCostModel::expectedCost(unsigned VF) {
-  VectorizationCostTy Cost;
+VPlan LoopVectorizationCostModel::buildPlan(unsigned VF) {
+  VPlan Plan(TheLoop, VF);
 
   // For each block.
   for (BasicBlock *BB : TheLoop->blocks()) {
-    VectorizationCostTy BlockCost;
+    unsigned BlockCost = 0;
 
     // For each instruction in the old loop.
     for (Instruction &I : *BB) {
@@ -5802,8 +6290,8 @@ LoopVectorizationCostModel::expectedCost(unsigned VF) {
       if (ForceTargetInstructionCost.getNumOccurrences() > 0)
         C.first = ForceTargetInstructionCost;
 
-      BlockCost.first += C.first;
-      BlockCost.second |= C.second;
+      Plan.addRecipe(&I, getRecipeKind(&I, VF), C.first, C.second);
+      BlockCost += C.first;
       DEBUG(dbgs() << "LV: Found an estimated cost of " << C.first << " for VF "
                    << VF << " For instruction: " << I << '\n');
     }
@@ -5812,13 +6300,12 @@ LoopVectorizationCostModel::expectedCost(unsigned VF) {
     // When the code is scalar then some of the blocks are avoided due to CF.
     // When the code is vectorized we execute all code paths.
     if (VF == 1 && Legal->blockNeedsPredication(BB))
-      BlockCost.first /= 2;
+      BlockCost /= 2;
 
-    Cost.first += BlockCost.first;
-    Cost.second |= BlockCost.second;
+    Plan.addCost(BlockCost);
   }
 
-  return Cost;
+  return Plan;
 }
 
 /// \brief Check if the load/store instruction \p I may be translated into
@@ -5892,6 +6379,79 @@ static bool isStrideMul(Instruction *I, LoopVectorizationLegality *Legal) {
          Legal->hasStride(I->getOperand(1));
 }
 
+VPRecipe::RecipeKind
+LoopVectorizationCostModel::getMemoryRecipeKind(Instruction *I, unsigned VF) {
+  assert(VF > 1 && "Scalar memory accesses have no vector recipe");
+  StoreInst *SI = dyn_cast<StoreInst>(I);
+  LoadInst *LI = dyn_cast<LoadInst>(I);
+  Type *ValTy = (SI ? SI->getValueOperand()->getType() : LI->getType());
+  Value *Ptr = SI ? SI->getPointerOperand() : LI->getPointerOperand();
+
+  // Scalar load + broadcast.
+  if (LI && Legal->isUniform(Ptr))
+    return VPRecipe::Uniform;
+
+  if (Legal->isAccessInterleaved(I))
+    return VPRecipe::InterleaveGroup;
+
+  int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
+  bool UseGatherOrScatter =
+      (ConsecutiveStride == 0) && isGatherOrScatterLegal(I, Ptr, Legal);
+
+  // Accesses of types with padding can't be widened either.
+  const DataLayout &DL = I->getModule()->getDataLayout();
+  uint64_t ScalarAllocatedSize = DL.getTypeAllocSize(ValTy);
+  uint64_t VectorElementSize =
+      DL.getTypeStoreSize(ToVectorTy(ValTy, VF)) / VF;
+  if ((!ConsecutiveStride && !UseGatherOrScatter) ||
+      ScalarAllocatedSize != VectorElementSize)
+    return VPRecipe::Replicate;
+
+  if (UseGatherOrScatter)
+    return VPRecipe::GatherScatter;
+  return VPRecipe::WidenMemory;
+}
+
+VPRecipe::RecipeKind
+LoopVectorizationCostModel::getRecipeKind(Instruction *I, unsigned VF) {
+  if (VF == 1 || Legal->isUniformAfterVectorization(I))
+    return VPRecipe::Uniform;
+
+  switch (I->getOpcode()) {
+  case Instruction::GetElementPtr:
+    // GEPs are part of the recipe of the memory instruction that uses them.
+    return VPRecipe::Ignored;
+  case Instruction::Br:
+    return VPRecipe::Uniform;
+  case Instruction::PHI: {
+    auto *Phi = cast<PHINode>(I);
+    if (Legal->isInductionVariable(Phi) || Legal->isReductionVariable(Phi) ||
+        Legal->isFirstOrderRecurrence(Phi))
+      return VPRecipe::WidenPHI;
+    // Other PHIs are if-converted into selects.
+    return VPRecipe::Widen;
+  }
+  case Instruction::Load:
+  case Instruction::Store:
+    return getMemoryRecipeKind(I, VF);
+  case Instruction::Call: {
+    bool NeedToScalarize;
+    CallInst *CI = cast<CallInst>(I);
+    unsigned CallCost = getVectorCallCost(CI, VF, TTI, TLI, NeedToScalarize);
+    if (getVectorIntrinsicIDForCall(CI, TLI) &&
+        getVectorIntrinsicCost(CI, VF, TTI, TLI) <= CallCost)
+      return VPRecipe::Widen;
+    return NeedToScalarize ? VPRecipe::Replicate : VPRecipe::Widen;
+  }
+  default:
+    // Everything getInstructionCost knows how to widen.
+    if (I->isBinaryOp() || I->isCast() || isa<CmpInst>(I) ||
+        isa<SelectInst>(I))
+      return VPRecipe::Widen;
+    return VPRecipe::Replicate;
+  }
+}
+
 LoopVectorizationCostModel::VectorizationCostTy
 LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
   // If we know that this instruction will remain uniform, check the cost of
@@ -5925,6 +6485,15 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
     // instruction cost.
     return 0;
   case Instruction::Br: {
+    // The early exit also tests whether any lane takes it.
+    if (VF > 1 && I->getParent() == Legal->getEarlyExitingBlock())
+      return TTI.getCFInstrCost(I->getOpcode()) +
+             TTI.getCastInstrCost(Instruction::BitCast,
+                                  IntegerType::get(I->getContext(), VF),
+                                  ToVectorTy(Type::getInt1Ty(I->getContext()),
+                                             VF)) +
+             TTI.getCmpSelInstrCost(Instruction::ICmp,
+                                    IntegerType::get(I->getContext(), VF));
     return TTI.getCFInstrCost(I->getOpcode());
   }
   case Instruction::PHI: {
@@ -6029,7 +6598,8 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
       return TTI.getAddressComputationCost(VectorTy) +
              TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
-    if (LI && Legal->isUniform(Ptr)) {
+    VPRecipe::RecipeKind Kind = getMemoryRecipeKind(I, VF);
+    if (Kind == VPRecipe::Uniform) {
       // Scalar load + broadcast
       unsigned Cost = TTI.getAddressComputationCost(ValTy->getScalarType());
       Cost += TTI.getMemoryOpCost(I->getOpcode(), ValTy->getScalarType(),
@@ -6040,7 +6610,7 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
 
     // For an interleaved access, calculate the total cost of the whole
     // interleave group.
-    if (Legal->isAccessInterleaved(I)) {
+    if (Kind == VPRecipe::InterleaveGroup) {
       auto Group = Legal->getInterleavedAccessGroup(I);
       assert(Group && "Fail to get an interleaved access group.");
 
@@ -6079,16 +6649,7 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
     }
 
     // Scalarized loads/stores.
-    int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
-    bool UseGatherOrScatter =
-        (ConsecutiveStride == 0) && isGatherOrScatterLegal(I, Ptr, Legal);
-
-    bool Reverse = ConsecutiveStride < 0;
-    const DataLayout &DL = I->getModule()->getDataLayout();
-    uint64_t ScalarAllocatedSize = DL.getTypeAllocSize(ValTy);
-    uint64_t VectorElementSize = DL.getTypeStoreSize(VectorTy) / VF;
-    if ((!ConsecutiveStride && !UseGatherOrScatter) ||
-        ScalarAllocatedSize != VectorElementSize) {
+    if (Kind == VPRecipe::Replicate) {
       bool IsComplexComputation =
           isLikelyComplexAddressComputation(Ptr, Legal, SE, TheLoop);
       unsigned Cost = 0;
@@ -6114,8 +6675,8 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
     }
 
     unsigned Cost = TTI.getAddressComputationCost(VectorTy);
-    if (UseGatherOrScatter) {
-      assert(ConsecutiveStride == 0 &&
+    if (Kind == VPRecipe::GatherScatter) {
+      assert(Legal->isConsecutivePtr(Ptr) == 0 &&
              "Gather/Scatter are not used for consecutive stride");
       return Cost +
              TTI.getGatherScatterOpCost(I->getOpcode(), VectorTy, Ptr,
@@ -6128,7 +6689,7 @@ unsigned LoopVectorizationCostModel::getInstructionCost(Instruction *I,
     else
       Cost += TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
-    if (Reverse)
+    if (Legal->isConsecutivePtr(Ptr) < 0)
       Cost += TTI.getShuffleCost(TargetTransformInfo::SK_Reverse, VectorTy, 0);
     return Cost;
   }
@@ -6427,6 +6988,333 @@ Value *InnerLoopUnroller::getStepVector(Value *Val, int StartIdx, Value *Step,
   return Builder.CreateAdd(Val, Builder.CreateMul(C, Step), "induction");
 }
 
+LoopVectorizationCostModel::VectorizationFactor
+LoopVectorizationPlanner::plan(bool OptForSize, unsigned ForcedVF) {
+  assert(CM && "Innermost loops are planned with the cost model");
+  // Width 1 means no vectorize
+  LoopVectorizationCostModel::VectorizationFactor Factor = {1U, 0U};
+  unsigned MaxVF = CM->computeMaxVF(OptForSize);
+  if (MaxVF == 0)
+    return Factor;
+
+  int UserVF = ForcedVF ? ForcedVF : CM->Hints->getWidth();
+  if (UserVF != 0) {
+    assert(isPowerOf2_32(UserVF) && "VF needs to be a power of two");
+    DEBUG(dbgs() << "LV: Using user VF " << UserVF << ".\n");
+
+    Factor.Width = UserVF;
+    return Factor;
+  }
+
+  for (unsigned VF = 1; VF <= MaxVF; VF *= 2)
+    Plans.push_back(CM->buildPlan(VF));
+
+  float Cost = Plans[0].getCost();
+#ifndef NDEBUG
+  const float ScalarCost = Cost;
+#endif /* NDEBUG */
+  unsigned Width = 1;
+  DEBUG(dbgs() << "LV: Scalar loop costs: " << (int)ScalarCost << ".\n");
+
+  bool ForceVectorization =
+      CM->Hints->getForce() == LoopVectorizeHints::FK_Enabled;
+  // Ignore scalar width, because the user explicitly wants vectorization.
+  if (ForceVectorization && MaxVF > 1) {
+    Width = 2;
+    Cost = Plans[1].getCost() / (float)Width;
+  }
+
+  for (const VPlan &Plan : Plans) {
+    unsigned VF = Plan.getVF();
+    if (VF == 1)
+      continue;
+    // Notice that the vector loop needs to be executed less times, so
+    // we need to divide the cost of the vector loops by the width of
+    // the vector elements.
+    float VectorCost = Plan.getCost() / (float)VF;
+    DEBUG(dbgs() << "LV: Vector loop of width " << VF
+                 << " costs: " << (int)VectorCost << ".\n");
+    if (!Plan.producesVectorCode() && !ForceVectorization) {
+      DEBUG(
+          dbgs() << "LV: Not considering vector loop of width " << VF
+                 << " because it will not generate any vector instructions.\n");
+      continue;
+    }
+    if (VectorCost < Cost) {
+      Cost = VectorCost;
+      Width = VF;
+    }
+  }
+
+  DEBUG(if (ForceVectorization && Width > 1 && Cost >= ScalarCost) dbgs()
+        << "LV: Vectorization seems to be not beneficial, "
+        << "but was forced by a user.\n");
+  DEBUG(dbgs() << "LV: Selecting VF: " << Width << ".\n");
+  Factor.Width = Width;
+  Factor.Cost = Width * Cost;
+  return Factor;
+}
+
+unsigned LoopVectorizationPlanner::planOuterLoop(Loop *Inner,
+                                                 unsigned TripCount,
+                                                 bool Force) {
+  assert(!CM && "Outer loops are planned without the cost model");
+  // The induction variables of the inner loop become constants in every copy
+  // of its body, and its branches fold away.
+  BasicBlock *InnerLatch = Inner->getLoopLatch();
+  for (Instruction &I : *Inner->getHeader()) {
+    auto *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    InductionDescriptor ID;
+    if (!InductionDescriptor::isInductionPHI(Phi, Inner, &SE, ID))
+      continue;
+    InnerLoopControl.insert(Phi);
+    if (auto *Inc =
+            dyn_cast<Instruction>(Phi->getIncomingValueForBlock(InnerLatch)))
+      InnerLoopControl.insert(Inc);
+  }
+  for (BasicBlock *BB : Inner->blocks())
+    InnerLoopControl.insert(BB->getTerminator());
+  auto *InnerBr = cast<BranchInst>(InnerLatch->getTerminator());
+  if (InnerBr->isConditional())
+    if (auto *Cmp = dyn_cast<CmpInst>(InnerBr->getCondition()))
+      if (Cmp->hasOneUse())
+        InnerLoopControl.insert(Cmp);
+
+  // The outer loop keeps a single scalar exit test.
+  auto *OuterBr = cast<BranchInst>(TheLoop->getLoopLatch()->getTerminator());
+  OuterLoopControl.insert(OuterBr);
+  if (OuterBr->isConditional())
+    if (auto *Cmp = dyn_cast<CmpInst>(OuterBr->getCondition()))
+      if (Cmp->hasOneUse())
+        OuterLoopControl.insert(Cmp);
+
+  // Bound the vectorization factor by the widest type that is loaded or
+  // stored.
+  const DataLayout &DL = TheLoop->getHeader()->getModule()->getDataLayout();
+  unsigned WidestType = 8;
+  for (BasicBlock *BB : TheLoop->blocks())
+    for (Instruction &I : *BB) {
+      Type *T;
+      if (auto *SI = dyn_cast<StoreInst>(&I))
+        T = SI->getValueOperand()->getType();
+      else if (isa<LoadInst>(I))
+        T = I.getType();
+      else
+        continue;
+      if (!T->isPointerTy())
+        WidestType = std::max(WidestType,
+                              (unsigned)DL.getTypeSizeInBits(T));
+    }
+  unsigned MaxVF = std::max(TTI.getRegisterBitWidth(true) / WidestType, 1U);
+
+  for (unsigned VF = 1; VF <= MaxVF; VF *= 2)
+    Plans.push_back(buildOuterLoopPlan(Inner, TripCount, VF));
+
+  float Cost = Plans[0].getCost();
+  unsigned Width = 1;
+  DEBUG(dbgs() << "LV: Scalar loop nest costs: " << (int)Cost << ".\n");
+  for (const VPlan &Plan : Plans) {
+    unsigned VF = Plan.getVF();
+    if (VF == 1 || !Plan.producesVectorCode())
+      continue;
+    float VectorCost = Plan.getCost() / (float)VF;
+    DEBUG(dbgs() << "LV: Outer loop of width " << VF
+                 << " costs: " << (int)VectorCost << ".\n");
+    if (VectorCost < Cost || (Force && Width == 1)) {
+      Cost = VectorCost;
+      Width = VF;
+    }
+  }
+  return Width;
+}
+
+VPlan LoopVectorizationPlanner::buildOuterLoopPlan(Loop *Inner,
+                                                   unsigned TripCount,
+                                                   unsigned VF) {
+  VPlan Plan(TheLoop, VF, Inner);
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    unsigned Count = Inner->contains(BB) ? TripCount : 1;
+    for (Instruction &I : *BB) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (InnerLoopControl.count(&I))
+        Plan.addRecipe(&I, VPRecipe::Ignored, 0, false, Count);
+      else
+        addOuterLoopRecipe(Plan, Inner, &I, Count);
+    }
+  }
+  return Plan;
+}
+
+const SCEV *LoopVectorizationPlanner::getOuterLoopSCEV(Value *V,
+                                                       Loop *Inner) {
+  const SCEV *S = SE.getSCEV(V);
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (AR && AR->getLoop() == Inner && AR->isAffine() &&
+      SE.isLoopInvariant(AR->getStepRecurrence(SE), TheLoop))
+    return AR->getStart();
+  return S;
+}
+
+void LoopVectorizationPlanner::addOuterLoopRecipe(VPlan &Plan, Loop *Inner,
+                                                  Instruction *I,
+                                                  unsigned Count) {
+  unsigned VF = Plan.getVF();
+  unsigned Opcode = I->getOpcode();
+  VPRecipe::RecipeKind Kind = VPRecipe::Widen;
+  Type *ValTy = I->getType();
+  unsigned Cost = 0;
+
+  // Values that only depend on the inductions of the inner loop fold to
+  // constants in every copy of its body.
+  bool IsComputation = !isa<PHINode>(I) && !I->mayReadOrWriteMemory();
+  const SCEV *S = IsComputation && SE.isSCEVable(ValTy)
+                      ? getOuterLoopSCEV(I, Inner)
+                      : nullptr;
+  if (S && isa<SCEVConstant>(S)) {
+    Plan.addRecipe(I, VPRecipe::Ignored, 0, false, Count);
+    return;
+  }
+
+  // Control of the outer loop, and computations that do not change in it,
+  // keep a single scalar copy.
+  if (VF > 1 && IsComputation &&
+      (OuterLoopControl.count(I) || TheLoop->hasLoopInvariantOperands(I) ||
+       (S && SE.isLoopInvariant(S, TheLoop))))
+    VF = 1;
+
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    ValTy = SI->getValueOperand()->getType();
+  Type *VectorTy = ToVectorTy(ValTy, VF);
+
+  switch (Opcode) {
+  case Instruction::GetElementPtr:
+    // GEPs are part of the recipe of the memory instruction that uses them.
+    Kind = VPRecipe::Ignored;
+    break;
+  case Instruction::Br:
+    Cost = TTI.getCFInstrCost(Opcode);
+    break;
+  case Instruction::PHI: {
+    // Inductions and reductions of the outer loop are widened; PHIs of the
+    // inner loop become a chain of values in the replicated body.
+    auto *Phi = cast<PHINode>(I);
+    if (Phi->getParent() == TheLoop->getHeader())
+      Kind = VPRecipe::WidenPHI;
+    else if (Phi->getParent() == Inner->getHeader())
+      Kind = VPRecipe::Ignored;
+    break;
+  }
+  case Instruction::Load:
+  case Instruction::Store: {
+    auto *SI = dyn_cast<StoreInst>(I);
+    auto *LI = dyn_cast<LoadInst>(I);
+    unsigned Alignment = SI ? SI->getAlignment() : LI->getAlignment();
+    unsigned AS =
+        SI ? SI->getPointerAddressSpace() : LI->getPointerAddressSpace();
+    Type *ScalarTy = ValTy->getScalarType();
+    if (VF == 1) {
+      Cost = TTI.getAddressComputationCost(ValTy) +
+             TTI.getMemoryOpCost(Opcode, ValTy, Alignment, AS);
+      break;
+    }
+
+    const SCEV *Addr = getOuterLoopSCEV(getPointerOperand(I), Inner);
+    const DataLayout &DL = I->getModule()->getDataLayout();
+    int64_t Size = DL.getTypeAllocSize(ValTy);
+    auto *AR = dyn_cast<SCEVAddRecExpr>(Addr);
+    const SCEVConstant *Step =
+        AR && AR->getLoop() == TheLoop && AR->isAffine()
+            ? dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE))
+            : nullptr;
+    int64_t Stride = Step ? Step->getAPInt().getSExtValue() : 0;
+    bool Padded = DL.getTypeStoreSize(VectorTy) / VF != (uint64_t)Size;
+
+    if (LI && SE.isLoopInvariant(Addr, TheLoop)) {
+      // Scalar load + broadcast.
+      Kind = VPRecipe::Uniform;
+      Cost = TTI.getAddressComputationCost(ScalarTy) +
+             TTI.getMemoryOpCost(Opcode, ScalarTy, Alignment, AS) +
+             TTI.getShuffleCost(TargetTransformInfo::SK_Broadcast, VectorTy);
+    } else if (!Padded && (Stride == Size || Stride == -Size)) {
+      Kind = VPRecipe::WidenMemory;
+      Cost = TTI.getAddressComputationCost(VectorTy) +
+             TTI.getMemoryOpCost(Opcode, VectorTy, Alignment, AS);
+      if (Stride < 0)
+        Cost +=
+            TTI.getShuffleCost(TargetTransformInfo::SK_Reverse, VectorTy, 0);
+    } else if (!Padded && (LI ? TTI.isLegalMaskedGather(VectorTy)
+                              : TTI.isLegalMaskedScatter(VectorTy))) {
+      Kind = VPRecipe::GatherScatter;
+      Cost = TTI.getAddressComputationCost(VectorTy) +
+             TTI.getGatherScatterOpCost(Opcode, VectorTy,
+                                        getPointerOperand(I), false,
+                                        Alignment);
+    } else {
+      // The cost of extracting the pointers and values, and of the scalar
+      // accesses.
+      Kind = VPRecipe::Replicate;
+      Type *PtrTy = ToVectorTy(getPointerOperand(I)->getType(), VF);
+      for (unsigned i = 0; i < VF; ++i) {
+        Cost += TTI.getVectorInstrCost(Instruction::ExtractElement, PtrTy, i);
+        Cost += TTI.getVectorInstrCost(SI ? Instruction::ExtractElement
+                                          : Instruction::InsertElement,
+                                       VectorTy, i);
+      }
+      Cost += VF * (TTI.getAddressComputationCost(PtrTy, true) +
+                    TTI.getMemoryOpCost(Opcode, ScalarTy, Alignment, AS));
+    }
+    break;
+  }
+  case Instruction::Select: {
+    Type *CondTy = ToVectorTy(I->getOperand(0)->getType(), VF);
+    Cost = TTI.getCmpSelInstrCost(Opcode, VectorTy, CondTy);
+    break;
+  }
+  case Instruction::ICmp:
+  case Instruction::FCmp:
+    Cost = TTI.getCmpSelInstrCost(
+        Opcode, ToVectorTy(I->getOperand(0)->getType(), VF));
+    break;
+  default:
+    if (I->isBinaryOp()) {
+      TargetTransformInfo::OperandValueKind Op2VK =
+          isa<ConstantInt>(I->getOperand(1))
+              ? TargetTransformInfo::OK_UniformConstantValue
+              : TargetTransformInfo::OK_AnyValue;
+      Cost = TTI.getArithmeticInstrCost(Opcode, VectorTy,
+                                        TargetTransformInfo::OK_AnyValue,
+                                        Op2VK);
+    } else if (I->isCast()) {
+      Cost = TTI.getCastInstrCost(
+          Opcode, VectorTy, ToVectorTy(I->getOperand(0)->getType(), VF));
+    } else {
+      // Scalarize everything else: VF copies of the instruction, assumed to
+      // cost as much as a 'mul', plus the inserts and extracts.
+      Kind = VPRecipe::Replicate;
+      if (!ValTy->isVoidTy() && VF > 1)
+        Cost += VF * (TTI.getVectorInstrCost(Instruction::InsertElement,
+                                             VectorTy) +
+                      TTI.getVectorInstrCost(Instruction::ExtractElement,
+                                             VectorTy) *
+                          I->getNumOperands());
+      Cost += VF * TTI.getArithmeticInstrCost(Instruction::Mul, VectorTy);
+    }
+    break;
+  }
+
+  if (VF == 1 && Kind != VPRecipe::Ignored)
+    Kind = VPRecipe::Uniform;
+  bool IsVector = VF > 1 && Kind != VPRecipe::Ignored &&
+                  Kind != VPRecipe::Replicate && Kind != VPRecipe::Uniform &&
+                  !VectorTy->isVoidTy() &&
+                  TTI.getNumberOfParts(VectorTy) < VF;
+  Plan.addRecipe(I, Kind, Cost, IsVector, Count);
+  Plan.addCost(Cost * Count);
+}
+
 static void AddRuntimeUnrollDisableMetaData(Loop *L) {
   SmallVector<Metadata *, 4> MDs;
   // Reserve first location for self reference to the LoopID metadata node.
@@ -6580,9 +7468,13 @@ bool LoopVectorizePass::processLoop(Loop *L) {
     return false;
   }
 
-  // Select the optimal vectorization factor.
+  // Plan how to vectorize the loop and select the optimal vectorization
+  // factor.
+  LoopVectorizationPlanner LVP(L, *SE, *TTI, &CM);
   const LoopVectorizationCostModel::VectorizationFactor VF =
-      CM.selectVectorizationFactor(OptForSize);
+      LVP.plan(OptForSize, ReplicatedLoopVFs.lookup(L));
+  if (PrintVPlans)
+    LVP.printPlans(dbgs());
 
   // Select the interleave count.
   unsigned IC = CM.selectInterleaveCount(OptForSize, VF.Width, VF.Cost);
@@ -6628,6 +7520,14 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   // Override IC if user provided an interleave count.
   IC = UserIC > 0 ? UserIC : IC;
 
+  // Without vector masks the interleaved loop cannot hold back the stores of
+  // the iterations after an early exit.
+  if (!VectorizeLoop && LVL.getEarlyExitingBlock()) {
+    IntDiagMsg = "loop with an early exit is not interleaved without "
+                 "vectorizing it";
+    InterleaveLoop = false;
+  }
+
   // Emit diagnostic messages, if any.
   const char *VAPassName = Hints.vectorizeAnalysisPassName();
   if (!VectorizeLoop && !InterleaveLoop) {
@@ -6663,6 +7563,8 @@ bool LoopVectorizePass::processLoop(Loop *L) {
     InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF.Width, IC);
     LB.vectorize(&LVL, CM.MinBWs, CM.VecValuesToIgnore);
     ++LoopsVectorized;
+    if (LVL.getEarlyExitingBlock())
+      ++EarlyExitLoopsVectorized;
 
     // Add metadata to disable runtime unrolling a scalar loop when there are
     // no runtime checks about strides and memory. A scalar loop that is
@@ -6684,6 +7586,268 @@ bool LoopVectorizePass::processLoop(Loop *L) {
   return true;
 }
 
+namespace {
+/// How the address of a memory access of an outer loop nest evolves: it is
+/// Base + K * InnerStep + I * OuterStep bytes in the K-th iteration of the
+/// inner loop and the I-th iteration of the outer loop.
+struct OuterLoopAccess {
+  Instruction *I;
+  const SCEV *Base;
+  int64_t InnerStep;
+  int64_t OuterStep;
+  int64_t Size;
+  unsigned Copies;
+};
+}
+
+/// Return the step of \p S in \p L and set \p S to its start, or return
+/// None if \p S does not evolve by a constant step in \p L.
+static Optional<int64_t> getConstantStep(ScalarEvolution &SE, const SCEV *&S,
+                                         Loop *L) {
+  if (SE.isLoopInvariant(S, L))
+    return 0;
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return None;
+  auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+  if (!Step || Step->getAPInt().getMinSignedBits() > 32)
+    return None;
+  S = AR->getStart();
+  return Step->getAPInt().getSExtValue();
+}
+
+/// Return true if the bytes [A, A + SizeA) and [B + M * Stride, B + M * Stride
+/// + SizeB) overlap for some M with 0 < |M| < VF, where B = A + Dist.
+static bool overlapsWithinVF(int64_t Dist, int64_t Stride, int64_t SizeA,
+                             int64_t SizeB, unsigned VF) {
+  if (Stride == 0)
+    return Dist > -SizeB && Dist < SizeA;
+  if (Stride < 0)
+    Stride = -Stride;
+  // The iterations M with -SizeB < Dist + M * Stride < SizeA.
+  auto FloorDiv = [](int64_t N, int64_t D) {
+    return N / D - (N % D != 0 && N < 0);
+  };
+  int64_t Lo = std::max<int64_t>(FloorDiv(-SizeB - Dist, Stride) + 1,
+                                 1 - (int64_t)VF);
+  int64_t Hi = std::min<int64_t>(-FloorDiv(Dist - SizeA, Stride) - 1,
+                                 (int64_t)VF - 1);
+  return Lo <= Hi && (Lo != 0 || Hi != 0);
+}
+
+bool LoopVectorizePass::canVectorizeOuterLoop(Loop *L, Loop *Inner,
+                                              unsigned TripCount,
+                                              unsigned VF,
+                                              bool AllowReordering) {
+  if (isa<SCEVCouldNotCompute>(SE->getBackedgeTakenCount(L))) {
+    DEBUG(dbgs() << "LV: Outer loop trip count is not computable.\n");
+    return false;
+  }
+
+  // The PHIs of the outer loop must still be inductions or reductions once
+  // the inner loop is replicated.
+  for (Instruction &I : *L->getHeader()) {
+    auto *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    InductionDescriptor ID;
+    RecurrenceDescriptor RD;
+    if (!InductionDescriptor::isInductionPHI(Phi, L, SE, ID) &&
+        !RecurrenceDescriptor::isReductionPHI(Phi, L, RD)) {
+      DEBUG(dbgs() << "LV: Outer loop PHI " << *Phi
+                   << " is not an induction or reduction.\n");
+      return false;
+    }
+    if ((ID.hasUnsafeAlgebra() || RD.hasUnsafeAlgebra()) && !AllowReordering) {
+      DEBUG(dbgs() << "LV: Outer loop PHI " << *Phi
+                   << " needs floating-point reordering.\n");
+      return false;
+    }
+  }
+
+  // The loop access analysis only looks at innermost loops, so check the
+  // dependences between the iterations of the outer loop here, before the
+  // replication that cannot be undone. Every access is described by its
+  // constant steps in both loops, and must not touch the memory of another
+  // access less than VF iterations away.
+  const DataLayout &DL = L->getHeader()->getModule()->getDataLayout();
+  SmallVector<OuterLoopAccess, 16> Accesses;
+  bool HasStores = false;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (!I.mayReadOrWriteMemory())
+        continue;
+      auto *SI = dyn_cast<StoreInst>(&I);
+      auto *LI = dyn_cast<LoadInst>(&I);
+      if ((!SI && !LI) || (SI && !SI->isSimple()) || (LI && !LI->isSimple())) {
+        DEBUG(dbgs() << "LV: Outer loop contains an unsupported memory access "
+                     << I << ".\n");
+        return false;
+      }
+      HasStores |= SI != nullptr;
+      Type *Ty = SI ? SI->getValueOperand()->getType() : LI->getType();
+      const SCEV *Base = SE->getSCEV(getPointerOperand(&I));
+      bool InInner = Inner->contains(&I);
+      Optional<int64_t> InnerStep;
+      if (InInner)
+        InnerStep = getConstantStep(*SE, Base, Inner);
+      else if (SE->isLoopInvariant(Base, Inner))
+        InnerStep = 0;
+      Optional<int64_t> OuterStep =
+          InnerStep ? getConstantStep(*SE, Base, L) : None;
+      Accesses.push_back({&I, OuterStep ? Base : nullptr,
+                          InnerStep ? *InnerStep : 0,
+                          OuterStep ? *OuterStep : 0,
+                          (int64_t)DL.getTypeStoreSize(Ty),
+                          InInner ? TripCount : 1});
+    }
+  if (!HasStores)
+    return true;
+
+  for (unsigned A = 0, E = Accesses.size(); A != E; ++A)
+    for (unsigned B = A; B != E; ++B) {
+      const OuterLoopAccess &AccA = Accesses[A], &AccB = Accesses[B];
+      if (!isa<StoreInst>(AccA.I) && !isa<StoreInst>(AccB.I))
+        continue;
+      if (A != B) {
+        MemoryLocation LocA = MemoryLocation::get(AccA.I);
+        MemoryLocation LocB = MemoryLocation::get(AccB.I);
+        LocA.Size = MemoryLocation::UnknownSize;
+        LocB.Size = MemoryLocation::UnknownSize;
+        if (AA->alias(LocA, LocB) == NoAlias)
+          continue;
+      }
+
+      auto *Dist = AccA.Base && AccB.Base
+                       ? dyn_cast<SCEVConstant>(
+                             SE->getMinusSCEV(AccB.Base, AccA.Base))
+                       : nullptr;
+      if (!Dist || AccA.OuterStep != AccB.OuterStep ||
+          Dist->getAPInt().getMinSignedBits() > 32) {
+        DEBUG(dbgs() << "LV: Outer loop accesses " << *AccA.I << " and "
+                     << *AccB.I << " may depend on each other.\n");
+        return false;
+      }
+      for (unsigned KA = 0; KA != AccA.Copies; ++KA)
+        for (unsigned KB = 0; KB != AccB.Copies; ++KB)
+          if (overlapsWithinVF(Dist->getAPInt().getSExtValue() +
+                                   KB * AccB.InnerStep - KA * AccA.InnerStep,
+                               AccA.OuterStep, AccA.Size, AccB.Size, VF)) {
+            DEBUG(dbgs() << "LV: Outer loop carries a dependence between "
+                         << *AccA.I << " and " << *AccB.I << ".\n");
+            return false;
+          }
+    }
+  return true;
+}
+
+bool LoopVectorizePass::processOuterLoop(Loop *L) {
+  assert(L->getSubLoops().size() == 1 && "Only process loops with one child");
+  Loop *Inner = L->getSubLoops().front();
+  if (!Inner->empty())
+    return false;
+
+  LoopVectorizeHints Hints(L, true, *ORE);
+  bool Force = Hints.getForce() == LoopVectorizeHints::FK_Enabled;
+  if (Hints.getForce() == LoopVectorizeHints::FK_Disabled ||
+      Hints.getWidth() == 1 || (!EnableOuterLoopVectorization && !Force) ||
+      (!AlwaysVectorize && !Force))
+    return false;
+
+  DEBUG(dbgs() << "\nLV: Checking an outer loop in \""
+               << L->getHeader()->getParent()->getName() << "\" from "
+               << getDebugLocString(L) << "\n");
+
+  // Both loops need a single exit at their latch so that the inner loop can
+  // be replicated and the outer loop vectorized.
+  if (!L->getLoopPreheader() || !L->getExitBlock() ||
+      L->getExitingBlock() != L->getLoopLatch() ||
+      !Inner->getLoopPreheader() || !Inner->getExitBlock() ||
+      Inner->getExitingBlock() != Inner->getLoopLatch()) {
+    DEBUG(dbgs() << "LV: Outer loop nest is not in a supported form.\n");
+    return false;
+  }
+
+  // The replication cannot be undone, so give up on every loop nest that
+  // processLoop would refuse to vectorize once the outer loop is innermost.
+  Function *F = L->getHeader()->getParent();
+  unsigned OuterTC = SE->getSmallConstantTripCount(L);
+  if (!Force && ((OuterTC > 0 && OuterTC < TinyTripCountVectorThreshold) ||
+                 F->optForSize())) {
+    DEBUG(dbgs() << "LV: Outer loop is too short or optimized for size.\n");
+    return false;
+  }
+  if (F->hasFnAttribute(Attribute::NoImplicitFloat)) {
+    DEBUG(dbgs() << "LV: Can't vectorize when the NoImplicitFloat attribute "
+                    "is used.\n");
+    return false;
+  }
+  if (TTI->isFPVectorizationPotentiallyUnsafe())
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB)
+        if (I.getType()->isFloatingPointTy() &&
+            (isa<CallInst>(I) || I.isBinaryOp()) && !I.hasUnsafeAlgebra()) {
+          DEBUG(dbgs() << "LV: Potentially unsafe FP op prevents outer loop "
+                          "vectorization.\n");
+          return false;
+        }
+
+  // Only inner loops that are too short to be vectorized themselves are
+  // replicated.
+  unsigned TC = SE->getSmallConstantTripCount(Inner);
+  if (TC < 2 || TC > OuterLoopMaxInnerTripCount ||
+      TC >= TinyTripCountVectorThreshold) {
+    DEBUG(dbgs() << "LV: Inner loop trip count " << TC
+                 << " is not suitable for outer loop vectorization.\n");
+    return false;
+  }
+
+  // The replicated body must stay small, and must not contain anything that
+  // prevents vectorizing the outer loop later on.
+  unsigned InnerSize = 0;
+  for (BasicBlock *BB : Inner->blocks())
+    for (Instruction &I : *BB) {
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      ++InnerSize;
+      if (isa<CallInst>(I) && !isa<IntrinsicInst>(I)) {
+        DEBUG(dbgs() << "LV: Inner loop contains a call.\n");
+        return false;
+      }
+    }
+  if (InnerSize * TC > OuterLoopMaxReplicatedSize) {
+    DEBUG(dbgs() << "LV: Inner loop is too large to replicate.\n");
+    return false;
+  }
+
+  LoopVectorizationPlanner LVP(L, *SE, *TTI);
+  unsigned VF = LVP.planOuterLoop(Inner, TC, Force);
+  if (PrintVPlans)
+    LVP.printPlans(dbgs());
+  if (VF == 1) {
+    DEBUG(dbgs() << "LV: Outer loop vectorization is not beneficial.\n");
+    return false;
+  }
+  if (!canVectorizeOuterLoop(L, Inner, TC, VF, Hints.allowReordering()))
+    return false;
+
+  // Replicate the inner loop. The outer loop becomes an innermost loop that
+  // is vectorized like any other.
+  DEBUG(dbgs() << "LV: Replicating inner loop " << TC
+               << " times to vectorize the outer loop (" << VF << ").\n");
+  if (!UnrollLoop(Inner, TC, TC, /*Force=*/true, /*AllowRuntime=*/false,
+                  /*AllowExpensiveTripCount=*/false, TC, LI, SE, DT, AC,
+                  /*PreserveLCSSA=*/true))
+    return false;
+
+  // The dependences were only checked for this factor, and the cost was
+  // decided on the plans of the loop nest, so processLoop must not pick
+  // another one.
+  ReplicatedLoopVFs[L] = VF;
+  ++OuterLoopsReplicated;
+  return true;
+}
+
 bool LoopVectorizePass::runImpl(
     Function &F, ScalarEvolution &SE_, LoopInfo &LI_, TargetTransformInfo &TTI_,
     DominatorTree &DT_, BlockFrequencyInfo &BFI_, TargetLibraryInfo *TLI_,
@@ -6726,12 +7890,25 @@ bool LoopVectorizePass::runImpl(
   for (Loop *L : *LI)
     addInnerLoop(*L, Worklist);
 
+  // Outer loops whose only inner loop is too short to vectorize may be
+  // vectorized instead. Replicating the inner loop turns the outer loop into
+  // an inner loop, which then takes the place of its child in the worklist.
+  bool Changed = false;
+  for (Loop *&L : Worklist) {
+    Loop *Parent = L->getParentLoop();
+    if (Parent && Parent->getSubLoops().size() == 1 &&
+        processOuterLoop(Parent)) {
+      L = Parent;
+      Changed = true;
+    }
+  }
+
   LoopsAnalyzed += Worklist.size();
 
   // Now walk the identified inner loops.
-  bool Changed = false;
   while (!Worklist.empty())
     Changed |= processLoop(Worklist.pop_back_val());
+  ReplicatedLoopVFs.clear();
 
   // Process each loop nest in the function.
   return Changed;
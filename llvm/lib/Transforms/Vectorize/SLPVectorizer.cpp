@@ -40,6 +40,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Vectorize.h"
 #include <algorithm>
 #include <memory>
@@ -61,6 +62,11 @@ static cl::opt<bool>
 ShouldVectorizeHor("slp-vectorize-hor", cl::init(true), cl::Hidden,
                    cl::desc("Attempt to vectorize horizontal reductions"));
 
+static cl::opt<bool> ShouldVectorizeNonPow2(
+    "slp-vectorize-non-pow2", cl::init(true), cl::Hidden,
+    cl::desc("Attempt to vectorize bundles whose width is not a power of two, "
+             "such as the leftover elements of a store chain"));
+
 static cl::opt<bool> ShouldStartVectorizeHorAtStore(
     "slp-vectorize-hor-store", cl::init(false), cl::Hidden,
     cl::desc(
@@ -144,46 +150,62 @@ static bool isSplat(ArrayRef<Value *> VL) {
   return true;
 }
 
-///\returns Opcode that can be clubbed with \p Op to create an alternate
-/// sequence which can later be merged as a ShuffleVector instruction.
-static unsigned getAltOpcode(unsigned Op) {
-  switch (Op) {
-  case Instruction::FAdd:
-    return Instruction::FSub;
-  case Instruction::FSub:
-    return Instruction::FAdd;
-  case Instruction::Add:
-    return Instruction::Sub;
-  case Instruction::Sub:
-    return Instruction::Add;
-  default:
-    return 0;
-  }
-}
-
-///\returns bool representing if Opcode \p Op can be part
+///\returns bool representing if the opcodes \p Op and \p AltOp can be part
 /// of an alternate sequence which can later be merged as
 /// a ShuffleVector instruction.
-static bool canCombineAsAltInst(unsigned Op) {
-  return Op == Instruction::FAdd || Op == Instruction::FSub ||
-         Op == Instruction::Sub || Op == Instruction::Add;
+///
+/// Both operations are executed on all of the lanes of the vector, so integer
+/// division and remainder, which may trap on the lanes of the other opcode,
+/// are excluded.
+static bool canCombineAsAltInst(unsigned Op, unsigned AltOp) {
+  auto IsSafeBinOp = [](unsigned Opcode) {
+    return Instruction::isBinaryOp(Opcode) && Opcode != Instruction::UDiv &&
+           Opcode != Instruction::SDiv && Opcode != Instruction::URem &&
+           Opcode != Instruction::SRem;
+  };
+  return IsSafeBinOp(Op) && IsSafeBinOp(AltOp);
 }
 
-/// \returns ShuffleVector instruction if instructions in \p VL have
-///  alternate fadd,fsub / fsub,fadd/add,sub/sub,add sequence.
-/// (i.e. e.g. opcodes of fadd,fsub,fadd,fsub...)
+/// \returns ShuffleVector instruction if instructions in \p VL are binary
+/// operators with exactly two different opcodes, in any order across the
+/// lanes (e.g. fadd,fsub,fadd,fsub or add,add,sub or mul,shl,mul,mul).
 static unsigned isAltInst(ArrayRef<Value *> VL) {
   Instruction *I0 = dyn_cast<Instruction>(VL[0]);
   unsigned Opcode = I0->getOpcode();
-  unsigned AltOpcode = getAltOpcode(Opcode);
+  unsigned AltOpcode = 0;
   for (int i = 1, e = VL.size(); i < e; i++) {
     Instruction *I = dyn_cast<Instruction>(VL[i]);
-    if (!I || I->getOpcode() != ((i & 1) ? AltOpcode : Opcode))
+    if (!I)
       return 0;
+    if (I->getOpcode() == Opcode || I->getOpcode() == AltOpcode)
+      continue;
+    if (AltOpcode || !canCombineAsAltInst(Opcode, I->getOpcode()))
+      return 0;
+    AltOpcode = I->getOpcode();
   }
   return Instruction::ShuffleVector;
 }
 
+/// \returns true if the opcodes of the alternate sequence \p VL alternate
+/// between the even and the odd lanes, e.g. fadd,fsub,fadd,fsub.
+static bool isStrictAltInst(ArrayRef<Value *> VL) {
+  unsigned Opcode = cast<Instruction>(VL[0])->getOpcode();
+  for (unsigned i = 0, e = VL.size(); i < e; ++i)
+    if ((cast<Instruction>(VL[i])->getOpcode() == Opcode) != (i % 2 == 0))
+      return false;
+  return true;
+}
+
+/// \returns The opcode of the first instruction in the alternate sequence
+/// \p VL that differs from the opcode of VL[0].
+static unsigned getAltOpcode(ArrayRef<Value *> VL) {
+  unsigned Opcode = cast<Instruction>(VL[0])->getOpcode();
+  for (Value *V : VL)
+    if (cast<Instruction>(V)->getOpcode() != Opcode)
+      return cast<Instruction>(V)->getOpcode();
+  llvm_unreachable("Not an alternate sequence");
+}
+
 /// \returns The opcode if all of the Instructions in \p VL have the same
 /// opcode, or zero.
 static unsigned getSameOpcode(ArrayRef<Value *> VL) {
@@ -194,7 +216,7 @@ static unsigned getSameOpcode(ArrayRef<Value *> VL) {
   for (int i = 1, e = VL.size(); i < e; i++) {
     Instruction *I = dyn_cast<Instruction>(VL[i]);
     if (!I || Opcode != I->getOpcode()) {
-      if (canCombineAsAltInst(Opcode) && i == 1)
+      if (I && canCombineAsAltInst(Opcode, I->getOpcode()))
         return isAltInst(VL);
       return 0;
     }
@@ -394,6 +416,12 @@ private:
   /// \returns the cost of the vectorizable entry.
   int getEntryCost(TreeEntry *E);
 
+  /// \returns the cost of vectorizing the alternate sequence \p VL as two
+  /// vector operations of type \p VecTy and a blend, minus the cost of the
+  /// scalar operations.
+  int getAltShuffleCost(ArrayRef<Value *> VL, Type *ScalarTy,
+                        VectorType *VecTy);
+
   /// This is the recursive part of buildTree.
   void buildTree_rec(ArrayRef<Value *> Roots, unsigned Depth);
 
@@ -1456,6 +1484,28 @@ void BoUpSLP::buildTree_rec(ArrayRef<Value *> VL, unsigned Depth) {
         DEBUG(dbgs() << "SLP: ShuffleVector are not vectorized.\n");
         return;
       }
+      // The target prices the blend of strictly alternating lanes. Any other
+      // selection of lanes costs the same only if the target blends with an
+      // arbitrary mask in a single instruction per register.
+      VectorType *VecTy = VectorType::get(VL0->getType(), VL.size());
+      if (!isStrictAltInst(VL) &&
+          TTI->getShuffleCost(TargetTransformInfo::SK_Alternate, VecTy, 0) >
+              (int)TTI->getNumberOfParts(VecTy)) {
+        BS.cancelScheduling(VL);
+        newTreeEntry(VL, false);
+        DEBUG(dbgs() << "SLP: Gathering alternate sequence without a blend.\n");
+        return;
+      }
+      // Any two binary opcodes can be blended, but executing both on all of
+      // the lanes may cost more than inserting the scalar results into a
+      // vector, e.g. for a vector multiply blended with a shift.
+      int AltCost = getAltShuffleCost(VL, VL0->getType(), VecTy);
+      if (AltCost > getGatherCost(VecTy)) {
+        BS.cancelScheduling(VL);
+        newTreeEntry(VL, false);
+        DEBUG(dbgs() << "SLP: Gathering expensive alternate sequence.\n");
+        return;
+      }
       newTreeEntry(VL, true);
       DEBUG(dbgs() << "SLP: added a ShuffleVector op.\n");
 
@@ -1751,41 +1801,49 @@ int BoUpSLP::getEntryCost(TreeEntry *E) {
 
       return VecCallCost - ScalarCallCost;
     }
-    case Instruction::ShuffleVector: {
-      TargetTransformInfo::OperandValueKind Op1VK =
-          TargetTransformInfo::OK_AnyValue;
-      TargetTransformInfo::OperandValueKind Op2VK =
-          TargetTransformInfo::OK_AnyValue;
-      int ScalarCost = 0;
-      int VecCost = 0;
-      for (Value *i : VL) {
-        Instruction *I = cast<Instruction>(i);
-        if (!I)
-          break;
-        ScalarCost +=
-            TTI->getArithmeticInstrCost(I->getOpcode(), ScalarTy, Op1VK, Op2VK);
-      }
-      // VecCost is equal to sum of the cost of creating 2 vectors
-      // and the cost of creating shuffle.
-      Instruction *I0 = cast<Instruction>(VL[0]);
-      VecCost =
-          TTI->getArithmeticInstrCost(I0->getOpcode(), VecTy, Op1VK, Op2VK);
-      Instruction *I1 = cast<Instruction>(VL[1]);
-      VecCost +=
-          TTI->getArithmeticInstrCost(I1->getOpcode(), VecTy, Op1VK, Op2VK);
-      VecCost +=
-          TTI->getShuffleCost(TargetTransformInfo::SK_Alternate, VecTy, 0);
-      return VecCost - ScalarCost;
-    }
+    case Instruction::ShuffleVector:
+      return getAltShuffleCost(VL, ScalarTy, VecTy);
     default:
       llvm_unreachable("Unknown instruction");
   }
 }
 
+int BoUpSLP::getAltShuffleCost(ArrayRef<Value *> VL, Type *ScalarTy,
+                               VectorType *VecTy) {
+  TargetTransformInfo::OperandValueKind Op1VK =
+      TargetTransformInfo::OK_AnyValue;
+  TargetTransformInfo::OperandValueKind Op2VK =
+      TargetTransformInfo::OK_AnyValue;
+  int ScalarCost = 0;
+  int VecCost = 0;
+  for (Value *i : VL) {
+    Instruction *I = cast<Instruction>(i);
+    if (!I)
+      break;
+    ScalarCost +=
+        TTI->getArithmeticInstrCost(I->getOpcode(), ScalarTy, Op1VK, Op2VK);
+  }
+  // VecCost is equal to sum of the cost of creating 2 vectors
+  // and the cost of creating shuffle.
+  Instruction *I0 = cast<Instruction>(VL[0]);
+  VecCost =
+      TTI->getArithmeticInstrCost(I0->getOpcode(), VecTy, Op1VK, Op2VK);
+  VecCost +=
+      TTI->getArithmeticInstrCost(getAltOpcode(VL), VecTy, Op1VK, Op2VK);
+  VecCost +=
+      TTI->getShuffleCost(TargetTransformInfo::SK_Alternate, VecTy, 0);
+  return VecCost - ScalarCost;
+}
+
 bool BoUpSLP::isFullyVectorizableTinyTree() {
   DEBUG(dbgs() << "SLP: Check whether the tree with height " <<
         VectorizableTree.size() << " is fully vectorizable .\n");
 
+  // A single bundle of loads is enough when the whole vector is consumed by
+  // the reduction or the build vector the tree was built for.
+  if (VectorizableTree.size() == 1)
+    return !VectorizableTree[0].NeedToGather && !UserIgnoreList.empty();
+
   // We only handle trees of height 2.
   if (VectorizableTree.size() != 2)
     return false;
@@ -2579,29 +2637,29 @@ Value *BoUpSLP::vectorizeTree(TreeEntry *E) {
       Value *V0 = Builder.CreateBinOp(BinOp0->getOpcode(), LHS, RHS);
 
       // Create a vector of LHS op2 RHS
-      Instruction *VL1 = cast<Instruction>(E->Scalars[1]);
-      BinaryOperator *BinOp1 = cast<BinaryOperator>(VL1);
-      Value *V1 = Builder.CreateBinOp(BinOp1->getOpcode(), LHS, RHS);
-
-      // Create shuffle to take alternate operations from the vector.
-      // Also, gather up odd and even scalar ops to propagate IR flags to
-      // each vector operation.
-      ValueList OddScalars, EvenScalars;
+      Value *V1 = Builder.CreateBinOp(
+          (Instruction::BinaryOps)getAltOpcode(E->Scalars), LHS, RHS);
+
+      // Create shuffle to take the lanes of each opcode from its vector.
+      // Also, gather up the scalar ops of each opcode to propagate IR flags
+      // to each vector operation.
+      ValueList OpScalars, AltScalars;
       unsigned e = E->Scalars.size();
       SmallVector<Constant *, 8> Mask(e);
       for (unsigned i = 0; i < e; ++i) {
-        if (i & 1) {
+        Instruction *I = cast<Instruction>(E->Scalars[i]);
+        if (I->getOpcode() != BinOp0->getOpcode()) {
           Mask[i] = Builder.getInt32(e + i);
-          OddScalars.push_back(E->Scalars[i]);
+          AltScalars.push_back(E->Scalars[i]);
         } else {
           Mask[i] = Builder.getInt32(i);
-          EvenScalars.push_back(E->Scalars[i]);
+          OpScalars.push_back(E->Scalars[i]);
         }
       }
 
       Value *ShuffleMask = ConstantVector::get(Mask);
-      propagateIRFlags(V0, EvenScalars);
-      propagateIRFlags(V1, OddScalars);
+      propagateIRFlags(V0, OpScalars);
+      propagateIRFlags(V1, AltScalars);
 
       Value *V = Builder.CreateShuffleVector(V0, V1, ShuffleMask);
       E->VectorizedValue = V;
@@ -3624,6 +3682,8 @@ bool SLPVectorizerPass::vectorizeStoreChain(ArrayRef<Value *> Chain,
   SmallVector<WeakVH, 8> TrackValues(Chain.begin(), Chain.end());
 
   bool Changed = false;
+  // The first store after the last vectorized bundle.
+  unsigned Tail = 0;
   // Look for profitable vectorizable trees at all offsets, starting at zero.
   for (unsigned i = 0, e = ChainLen; i < e; ++i) {
     if (i + VF > e)
@@ -3649,10 +3709,38 @@ bool SLPVectorizerPass::vectorizeStoreChain(ArrayRef<Value *> Chain,
 
       // Move to the next bundle.
       i += VF - 1;
+      Tail = i + 1;
       Changed = true;
     }
   }
 
+  // Try the stores left over at the end of the chain as a single bundle whose
+  // width is not a power of two, e.g. the three components of a 3-D point.
+  // The vector type is widened by the backend, and the cost model decides
+  // whether that is profitable. If a power-of-two part of the tail fills a
+  // smaller register, leave the tail to the smaller register sizes, which
+  // are tried next.
+  unsigned TailLen = ChainLen - Tail;
+  if (!ShouldVectorizeNonPow2 || TailLen < 3 || TailLen >= VF ||
+      isPowerOf2_32(TailLen) ||
+      PowerOf2Floor(TailLen) * Sz >= R.getMinVecRegSize() ||
+      hasValueBeenRAUWed(Chain, TrackValues, Tail, TailLen))
+    return Changed;
+
+  DEBUG(dbgs() << "SLP: Analyzing " << TailLen << " stores at offset " << Tail
+        << "\n");
+  R.buildTree(Chain.slice(Tail, TailLen));
+  R.computeMinimumValueSizes();
+
+  int Cost = R.getTreeCost();
+
+  DEBUG(dbgs() << "SLP: Found cost=" << Cost << " for VF=" << TailLen << "\n");
+  if (Cost < CostThreshold) {
+    DEBUG(dbgs() << "SLP: Decided to vectorize cost=" << Cost << "\n");
+    R.vectorizeTree();
+    Changed = true;
+  }
+
   return Changed;
 }
 
@@ -3811,7 +3899,7 @@ bool SLPVectorizerPass::tryToVectorizeList(ArrayRef<Value *> VL, BoUpSLP &R,
     else
       OpsWidth = VF;
 
-    if (!isPowerOf2_32(OpsWidth) || OpsWidth < 2)
+    if (OpsWidth < 2 || (!isPowerOf2_32(OpsWidth) && !ShouldVectorizeNonPow2))
       break;
 
     // Check that a previous iteration of this loop did not delete the Value.
@@ -3943,10 +4031,35 @@ static Value *createRdxShuffleMask(unsigned VecLen, unsigned NumEltsToRdx,
 }
 
 
+/// \returns The kind of min/max operation if \p V is the select of a
+/// select(cmp(a, b), a, b) pattern that can be reassociated, or MRK_Invalid.
+static RecurrenceDescriptor::MinMaxRecurrenceKind getMinMaxKind(Value *V) {
+  SelectInst *Select = dyn_cast<SelectInst>(V);
+  if (!Select)
+    return RecurrenceDescriptor::MRK_Invalid;
+  RecurrenceDescriptor::InstDesc Prev(false, nullptr);
+  RecurrenceDescriptor::MinMaxRecurrenceKind Kind =
+      RecurrenceDescriptor::isMinMaxSelectCmpPattern(Select, Prev)
+          .getMinMaxKind();
+  if (Kind == RecurrenceDescriptor::MRK_Invalid)
+    return Kind;
+
+  // The compare has to be in the same block as the select, and floating-point
+  // min/max can only be reassociated if we can ignore NaNs and signed zeros.
+  Instruction *Cmp = cast<Instruction>(Select->getCondition());
+  if (Cmp->getParent() != Select->getParent())
+    return RecurrenceDescriptor::MRK_Invalid;
+  if (isa<FCmpInst>(Cmp) && !Cmp->hasUnsafeAlgebra())
+    return RecurrenceDescriptor::MRK_Invalid;
+  return Kind;
+}
+
 /// Model horizontal reductions.
 ///
-/// A horizontal reduction is a tree of reduction operations (currently add and
-/// fadd) that has operations that can be put into a vector as its leaf.
+/// A horizontal reduction is a tree of reduction operations (currently add,
+/// fadd and integer or fast floating-point min/max implemented as
+/// select(cmp(a, b), a, b)) that has operations that can be put into a vector
+/// as its leaf.
 /// For example, this tree:
 ///
 /// mul mul mul mul
@@ -3974,11 +4087,14 @@ class HorizontalReduction {
   SmallVector<Value *, 16> ReductionOps;
   SmallVector<Value *, 32> ReducedVals;
 
-  BinaryOperator *ReductionRoot;
+  Instruction *ReductionRoot;
   PHINode *ReductionPHI;
 
   /// The opcode of the reduction.
   unsigned ReductionOpcode;
+  /// The kind of a min/max reduction, or MRK_Invalid if this is an arithmetic
+  /// reduction.
+  RecurrenceDescriptor::MinMaxRecurrenceKind MinMaxKind;
   /// The opcode of the values we perform a reduction on.
   unsigned ReducedValueOpcode;
   /// Should we model this reduction as a pairwise reduction tree or a tree that
@@ -3995,11 +4111,12 @@ public:
 
   HorizontalReduction(unsigned MinVecRegSize)
       : ReductionRoot(nullptr), ReductionPHI(nullptr), ReductionOpcode(0),
-        ReducedValueOpcode(0), IsPairwiseReduction(false), ReduxWidth(0),
+        MinMaxKind(RecurrenceDescriptor::MRK_Invalid), ReducedValueOpcode(0),
+        IsPairwiseReduction(false), ReduxWidth(0),
         MinVecRegSize(MinVecRegSize) {}
 
   /// \brief Try to find a reduction tree.
-  bool matchAssociativeReduction(PHINode *Phi, BinaryOperator *B) {
+  bool matchAssociativeReduction(PHINode *Phi, Instruction *B) {
     assert((!Phi ||
             std::find(Phi->op_begin(), Phi->op_end(), B) != Phi->op_end()) &&
            "Thi phi needs to use the binary operator");
@@ -4008,12 +4125,12 @@ public:
     //  r *= v1 + v2 + v3 + v4
     // In such a case start looking for a tree rooted in the first '+'.
     if (Phi) {
-      if (B->getOperand(0) == Phi) {
+      if (getRdxOperand(B, 0) == Phi) {
         Phi = nullptr;
-        B = dyn_cast<BinaryOperator>(B->getOperand(1));
-      } else if (B->getOperand(1) == Phi) {
+        B = getRdxNode(getRdxOperand(B, 1));
+      } else if (getRdxOperand(B, 1) == Phi) {
         Phi = nullptr;
-        B = dyn_cast<BinaryOperator>(B->getOperand(0));
+        B = getRdxNode(getRdxOperand(B, 0));
       }
     }
 
@@ -4026,6 +4143,7 @@ public:
 
     const DataLayout &DL = B->getModule()->getDataLayout();
     ReductionOpcode = B->getOpcode();
+    MinMaxKind = getMinMaxKind(B);
     ReducedValueOpcode = 0;
     // FIXME: Register size should be a parameter to this function, so we can
     // try different vectorization factors.
@@ -4036,11 +4154,22 @@ public:
     if (ReduxWidth < 4)
       return false;
 
-    // We currently only support adds.
+    // We currently only support adds and min/max.
     if (ReductionOpcode != Instruction::Add &&
-        ReductionOpcode != Instruction::FAdd)
+        ReductionOpcode != Instruction::FAdd &&
+        MinMaxKind == RecurrenceDescriptor::MRK_Invalid)
       return false;
 
+    // A min/max reduction is rewritten as a whole, so the phi has to be an
+    // operand of the root.
+    if (Phi && MinMaxKind != RecurrenceDescriptor::MRK_Invalid)
+      return false;
+
+    // Each value in a min/max tree is used by both the compare and the select
+    // of its parent.
+    unsigned NumParentUses =
+        MinMaxKind == RecurrenceDescriptor::MRK_Invalid ? 1 : 2;
+
     // Post order traverse the reduction tree starting at B. We only handle true
     // trees containing only binary operators or selects.
     SmallVector<std::pair<Instruction *, unsigned>, 32> Stack;
@@ -4048,7 +4177,7 @@ public:
     while (!Stack.empty()) {
       Instruction *TreeN = Stack.back().first;
       unsigned EdgeToVist = Stack.back().second++;
-      bool IsReducedValue = TreeN->getOpcode() != ReductionOpcode;
+      bool IsReducedValue = !isReductionOp(TreeN);
 
       // Only handle trees in the current basic block.
       if (TreeN->getParent() != B->getParent())
@@ -4056,7 +4185,7 @@ public:
 
       // Each tree node needs to have one user except for the ultimate
       // reduction.
-      if (!TreeN->hasOneUse() && TreeN != B)
+      if (!TreeN->hasNUses(NumParentUses) && TreeN != B)
         return false;
 
       // Postorder vist.
@@ -4069,6 +4198,10 @@ public:
           else if (ReducedValueOpcode != TreeN->getOpcode())
             return false;
           ReducedVals.push_back(TreeN);
+        } else if (MinMaxKind != RecurrenceDescriptor::MRK_Invalid) {
+          // The values are used by both the compare and the select.
+          ReductionOps.push_back(cast<SelectInst>(TreeN)->getCondition());
+          ReductionOps.push_back(TreeN);
         } else {
           // We need to be able to reassociate the adds.
           if (!TreeN->isAssociative())
@@ -4081,10 +4214,11 @@ public:
       }
 
       // Visit left or right.
-      Value *NextV = TreeN->getOperand(EdgeToVist);
-      // We currently only allow BinaryOperator's and SelectInst's as reduction
-      // values in our tree.
-      if (isa<BinaryOperator>(NextV) || isa<SelectInst>(NextV))
+      Value *NextV = getRdxOperand(TreeN, EdgeToVist);
+      // We currently only allow BinaryOperator's, SelectInst's and loads as
+      // reduction values in our tree.
+      if (isa<BinaryOperator>(NextV) || isa<SelectInst>(NextV) ||
+          isa<LoadInst>(NextV))
         Stack.push_back(std::make_pair(cast<Instruction>(NextV), 0));
       else if (NextV != Phi)
         return false;
@@ -4118,8 +4252,12 @@ public:
       }      
       V.computeMinimumValueSizes();
 
-      // Estimate cost.
-      int Cost = V.getTreeCost() + getReductionCost(TTI, ReducedVals[i]);
+      // Estimate cost. A tree that cannot be vectorized has the maximal cost,
+      // which must not wrap around when the reduction cost is added.
+      int TreeCost = V.getTreeCost();
+      if (TreeCost == INT_MAX)
+        break;
+      int Cost = TreeCost + getReductionCost(TTI, ReducedVals[i]);
       if (Cost >= -SLPCostThreshold)
         break;
 
@@ -4134,8 +4272,8 @@ public:
       Value *ReducedSubTree = emitReduction(VectorizedRoot, Builder);
       if (VectorizedTree) {
         Builder.SetCurrentDebugLocation(Loc);
-        VectorizedTree = createBinOp(Builder, ReductionOpcode, VectorizedTree,
-                                     ReducedSubTree, "bin.rdx");
+        VectorizedTree =
+            createOp(Builder, VectorizedTree, ReducedSubTree, "bin.rdx");
       } else
         VectorizedTree = ReducedSubTree;
     }
@@ -4145,8 +4283,7 @@ public:
       for (; i < NumReducedVals; ++i) {
         Builder.SetCurrentDebugLocation(
           cast<Instruction>(ReducedVals[i])->getDebugLoc());
-        VectorizedTree = createBinOp(Builder, ReductionOpcode, VectorizedTree,
-                                     ReducedVals[i]);
+        VectorizedTree = createOp(Builder, VectorizedTree, ReducedVals[i]);
       }
       // Update users.
       if (ReductionPHI) {
@@ -4164,11 +4301,66 @@ public:
   }
 
 private:
+  /// \returns The operand \p Idx of the reduction operation \p I. The
+  /// operands of a min/max are the values of its select.
+  static Value *getRdxOperand(Instruction *I, unsigned Idx) {
+    if (isa<SelectInst>(I))
+      return I->getOperand(Idx + 1);
+    return I->getOperand(Idx);
+  }
+
+  /// \returns \p V if it can be the root of a reduction tree, or null.
+  static Instruction *getRdxNode(Value *V) {
+    if (isa<BinaryOperator>(V) ||
+        getMinMaxKind(V) != RecurrenceDescriptor::MRK_Invalid)
+      return cast<Instruction>(V);
+    return nullptr;
+  }
+
+  /// \returns True if \p I is an operation of this reduction.
+  bool isReductionOp(Instruction *I) const {
+    if (MinMaxKind != RecurrenceDescriptor::MRK_Invalid)
+      return getMinMaxKind(I) == MinMaxKind;
+    return I->getOpcode() == ReductionOpcode;
+  }
+
+  /// \brief Calculate the cost of a min/max reduction, which is emitted as a
+  /// tree of vector compares and selects that splits the vector in halves.
+  int getMinMaxReductionCost(TargetTransformInfo *TTI, Type *ScalarTy,
+                             Type *VecTy) {
+    IsPairwiseReduction = false;
+    unsigned CmpOpcode =
+        ScalarTy->isFloatingPointTy() ? Instruction::FCmp : Instruction::ICmp;
+    Type *CondTy = CmpInst::makeCmpResultType(ScalarTy);
+    Type *VecCondTy = CmpInst::makeCmpResultType(VecTy);
+
+    int VecOpCost =
+        TTI->getCmpSelInstrCost(CmpOpcode, VecTy, VecCondTy) +
+        TTI->getCmpSelInstrCost(Instruction::Select, VecTy, VecCondTy) +
+        TTI->getShuffleCost(TargetTransformInfo::SK_ExtractSubvector, VecTy,
+                            ReduxWidth / 2, VecTy);
+    int VecReduxCost =
+        Log2_32(ReduxWidth) * VecOpCost +
+        TTI->getVectorInstrCost(Instruction::ExtractElement, VecTy, 0);
+    int ScalarReduxCost =
+        ReduxWidth *
+        (TTI->getCmpSelInstrCost(CmpOpcode, ScalarTy, CondTy) +
+         TTI->getCmpSelInstrCost(Instruction::Select, ScalarTy, CondTy));
+
+    DEBUG(dbgs() << "SLP: Adding cost " << VecReduxCost - ScalarReduxCost
+                 << " for min/max reduction\n");
+
+    return VecReduxCost - ScalarReduxCost;
+  }
+
   /// \brief Calculate the cost of a reduction.
   int getReductionCost(TargetTransformInfo *TTI, Value *FirstReducedVal) {
     Type *ScalarTy = FirstReducedVal->getType();
     Type *VecTy = VectorType::get(ScalarTy, ReduxWidth);
 
+    if (MinMaxKind != RecurrenceDescriptor::MRK_Invalid)
+      return getMinMaxReductionCost(TTI, ScalarTy, VecTy);
+
     int PairwiseRdxCost = TTI->getReductionCost(ReductionOpcode, VecTy, true);
     int SplittingRdxCost = TTI->getReductionCost(ReductionOpcode, VecTy, false);
 
@@ -4194,6 +4386,14 @@ private:
     return Builder.CreateBinOp((Instruction::BinaryOps)Opcode, L, R, Name);
   }
 
+  /// \brief Create a reduction operation of \p L and \p R.
+  Value *createOp(IRBuilder<> &Builder, Value *L, Value *R,
+                  const Twine &Name = "") {
+    if (MinMaxKind != RecurrenceDescriptor::MRK_Invalid)
+      return RecurrenceDescriptor::createMinMaxOp(Builder, MinMaxKind, L, R);
+    return createBinOp(Builder, ReductionOpcode, L, R, Name);
+  }
+
   /// \brief Emit a horizontal reduction of the vectorized value.
   Value *emitReduction(Value *VectorizedValue, IRBuilder<> &Builder) {
     assert(VectorizedValue && "Need to have a vectorized tree node");
@@ -4213,14 +4413,13 @@ private:
         Value *RightShuf = Builder.CreateShuffleVector(
           TmpVec, UndefValue::get(TmpVec->getType()), (RightMask),
           "rdx.shuf.r");
-        TmpVec = createBinOp(Builder, ReductionOpcode, LeftShuf, RightShuf,
-                             "bin.rdx");
+        TmpVec = createOp(Builder, LeftShuf, RightShuf, "bin.rdx");
       } else {
         Value *UpperHalf =
           createRdxShuffleMask(ReduxWidth, i, false, false, Builder);
         Value *Shuf = Builder.CreateShuffleVector(
           TmpVec, UndefValue::get(TmpVec->getType()), UpperHalf, "rdx.shuf");
-        TmpVec = createBinOp(Builder, ReductionOpcode, TmpVec, Shuf, "bin.rdx");
+        TmpVec = createOp(Builder, TmpVec, Shuf, "bin.rdx");
       }
     }
 
@@ -4347,7 +4546,7 @@ static Value *getReductionValue(const DominatorTree *DT, PHINode *P,
 /// can be done.
 /// \returns true if a horizontal reduction was matched and reduced.
 /// \returns false if a horizontal reduction was not matched.
-static bool canMatchHorizontalReduction(PHINode *P, BinaryOperator *BI,
+static bool canMatchHorizontalReduction(PHINode *P, Instruction *BI,
                                         BoUpSLP &R, TargetTransformInfo *TTI,
                                         unsigned MinRegSize) {
   if (!ShouldVectorizeHor)
@@ -4435,6 +4634,16 @@ bool SLPVectorizerPass::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
 
       Value *Rdx = getReductionValue(DT, P, BB, LI);
 
+      // Try to match and vectorize a horizontal min/max reduction.
+      if (SelectInst *SI = dyn_cast_or_null<SelectInst>(Rdx)) {
+        if (canMatchHorizontalReduction(P, SI, R, TTI, R.getMinVecRegSize())) {
+          Changed = true;
+          it = BB->begin();
+          e = BB->end();
+        }
+        continue;
+      }
+
       // Check if this is a Binary Operator.
       BinaryOperator *BI = dyn_cast_or_null<BinaryOperator>(Rdx);
       if (!BI)
@@ -4480,7 +4689,15 @@ bool SLPVectorizerPass::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
 
     // Try to vectorize horizontal reductions feeding into a return.
     if (ReturnInst *RI = dyn_cast<ReturnInst>(it))
-      if (RI->getNumOperands() != 0)
+      if (RI->getNumOperands() != 0) {
+        if (SelectInst *SI = dyn_cast<SelectInst>(RI->getOperand(0)))
+          if (canMatchHorizontalReduction(nullptr, SI, R, TTI,
+                                          R.getMinVecRegSize())) {
+            Changed = true;
+            it = BB->begin();
+            e = BB->end();
+            continue;
+          }
         if (BinaryOperator *BinOp =
                 dyn_cast<BinaryOperator>(RI->getOperand(0))) {
           DEBUG(dbgs() << "SLP: Found a return to vectorize.\n");
@@ -4492,6 +4709,7 @@ bool SLPVectorizerPass::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
             continue;
           }
         }
+      }
 
     // Try to vectorize trees that start at compare instructions.
     if (CmpInst *CI = dyn_cast<CmpInst>(it)) {
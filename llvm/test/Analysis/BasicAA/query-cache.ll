@@ -0,0 +1,38 @@
+; RUN: opt < %s -basicaa -loop-accesses -analyze -aa-query-cache-stats 2>&1 | FileCheck %s --check-prefix=LAA
+; RUN: opt < %s -disable-output -basicaa -licm -aa-query-cache-stats 2>&1 | FileCheck %s --check-prefix=LICM
+; RUN: opt < %s -S -basicaa -licm | FileCheck %s
+
+; Alias queries repeated while the loop access analysis and LICM build their
+; alias sets are answered from the query cache.
+
+; LAA: AA query cache for 'loop-accesses': alias {{[1-9][0-9]*}} hits, {{[0-9]+}} misses; decomposed GEPs {{[0-9]+}} hits, {{[0-9]+}} misses
+; LICM: AA query cache for 'licm': alias {{[0-9]+}} hits, {{[0-9]+}} misses; decomposed GEPs {{[1-9][0-9]*}} hits, {{[0-9]+}} misses
+
+define void @f(i32* noalias %a, i32* %b, i64 %n) {
+; CHECK-LABEL: @f(
+; CHECK: entry:
+; CHECK: load i32, i32* %a
+; CHECK: loop:
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %a0 = load i32, i32* %a
+  %b0 = getelementptr i32, i32* %b, i64 1
+  store i32 %a0, i32* %b0
+  %a1 = getelementptr i32, i32* %a, i64 1
+  %v1 = load i32, i32* %a1
+  %b1 = getelementptr i32, i32* %b, i64 2
+  store i32 %v1, i32* %b1
+  %a2 = getelementptr i32, i32* %a, i64 2
+  %v2 = load i32, i32* %a2
+  %b2 = getelementptr i32, i32* %b, i64 3
+  store i32 %v2, i32* %b2
+  %i.next = add i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,64 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-creation-depth=3 | FileCheck %s --check-prefix=CREATION
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-arith-depth=0 | FileCheck %s --check-prefix=ARITH
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-expr-operands=2 | FileCheck %s --check-prefix=SIZE
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-cost-report 2>&1 >/dev/null | FileCheck %s --check-prefix=REPORT
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-cost-report -scalar-evolution-max-creation-depth=3 2>&1 >/dev/null | FileCheck %s --check-prefix=REPORT-CREATION
+
+; The compile time limits of ScalarEvolution make it give up on expressions
+; that take too long to analyze, and leave them unknown or unsimplified.
+
+; Analyzing the phi recurses through the whole chain of adds in the loop.
+define void @chain(i32 %n) {
+; CHECK-LABEL: Classifying expressions for: @chain
+; CHECK: %iv = phi
+; CHECK-NEXT: -->  {0,+,4}<%loop>
+; CREATION-LABEL: Classifying expressions for: @chain
+; CREATION: %iv = phi
+; CREATION-NEXT: -->  %iv
+; The add that the analysis of the phi gave up on is analyzed again when it
+; is queried itself, while the adds built on top of it keep their results.
+; CREATION: %x2 = add
+; CREATION-NEXT: -->  (2 + %iv)
+; CREATION: %x4 = add
+; CREATION-NEXT: -->  (2 + %x2)
+entry:
+  br label %loop
+
+loop:
+  %iv = phi i32 [ 0, %entry ], [ %x4, %loop ]
+  %x1 = add i32 1, %iv
+  %x2 = add i32 1, %x1
+  %x3 = add i32 1, %x2
+  %x4 = add i32 1, %x3
+  %cmp = icmp slt i32 %x4, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; Adding two sums flattens them and then merges equal operands.
+define i32 @sums(i32 %a, i32 %b, i32 %c) {
+; CHECK-LABEL: Classifying expressions for: @sums
+; CHECK: %u = add
+; CHECK-NEXT: -->  (%a + %b + %c)
+; CHECK: %v = add
+; CHECK-NEXT: -->  ((2 * %a) + (2 * %b) + %c)
+; ARITH-LABEL: Classifying expressions for: @sums
+; ARITH: %v = add
+; ARITH-NEXT: -->  (%a + %a + %b + %b + %c)
+; SIZE-LABEL: Classifying expressions for: @sums
+; SIZE: %u = add
+; SIZE-NEXT: -->  %u
+; SIZE: %v = add
+; SIZE-NEXT: -->  %v
+  %t = add i32 %a, %b
+  %u = add i32 %t, %c
+  %v = add i32 %u, %t
+  ret i32 %v
+}
+
+; REPORT: SCEV cost for 'chain': {{[0-9]+}} expressions; unique expression hits {{[0-9]+}}, misses {{[0-9]+}}; value cache hits {{[0-9]+}}, misses {{[0-9]+}}; max value depth 6; limits hit: arith depth 0, value depth 0, expression size 0
+; REPORT: SCEV cost for 'sums':
+; REPORT-CREATION: SCEV cost for 'chain': {{.*}}; limits hit: arith depth 0, value depth 1, expression size 0
@@ -0,0 +1,51 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -function-sections | FileCheck %s --check-prefix=SECTIONS
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -profile-guided-section-prefix=false | FileCheck %s --check-prefix=DISABLED
+
+; Functions that the profile finds hot or cold are placed in .text.hot and
+; .text.unlikely.
+
+; CHECK: .section .text.hot,"ax",@progbits
+; CHECK-NEXT: .globl hot
+; SECTIONS: .section .text.hot.hot,"ax",@progbits
+; DISABLED-NOT: .section
+; DISABLED: .globl hot
+define void @hot() !prof !20 {
+  ret void
+}
+
+; CHECK: .section .text.unlikely,"ax",@progbits
+; CHECK-NEXT: .globl cold
+; SECTIONS: .section .text.unlikely.cold,"ax",@progbits
+; DISABLED-NOT: .section
+; DISABLED: .globl cold
+define void @cold() !prof !21 {
+  ret void
+}
+
+; CHECK: .text
+; CHECK-NEXT: .globl neither
+; SECTIONS: .section .text.neither,"ax",@progbits
+define void @neither() !prof !22 {
+  ret void
+}
+
+!llvm.module.flags = !{!1}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!20 = !{!"function_entry_count", i64 1000}
+!21 = !{!"function_entry_count", i64 1}
+!22 = !{!"function_entry_count", i64 100}
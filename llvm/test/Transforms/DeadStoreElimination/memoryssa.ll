@@ -0,0 +1,109 @@
+; RUN: opt < %s -basicaa -dse -S | FileCheck %s
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -S | FileCheck %s
+; RUN: opt < %s -aa-pipeline=basic-aa -passes=dse -enable-dse-memoryssa -S | FileCheck %s
+; RUN: opt < %s -disable-output -basicaa -dse -enable-dse-memoryssa -print-memoryssa -verify-memoryssa
+
+; DSE finds the same dead stores with MemorySSA as with
+; MemoryDependenceAnalysis, and keeps MemorySSA up to date.
+
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+declare noalias i8* @calloc(i64, i64)
+declare void @free(i8*)
+declare void @clobber()
+
+; A store that is overwritten past a store that may alias.
+define void @overwritten(i32* %p, i32* %q) {
+; CHECK-LABEL: @overwritten(
+; CHECK-NEXT: store i32 20, i32* %q
+; CHECK-NEXT: store i32 30, i32* %p
+; CHECK-NEXT: ret void
+  store i32 10, i32* %p
+  store i32 20, i32* %q
+  store i32 30, i32* %p
+  ret void
+}
+
+; A load in between may read the first store.
+define i32 @read_in_between(i32* %p, i32* %q) {
+; CHECK-LABEL: @read_in_between(
+; CHECK-NEXT: store i32 10, i32* %p
+; CHECK-NEXT: %v = load i32, i32* %q
+; CHECK-NEXT: store i32 30, i32* %p
+  store i32 10, i32* %p
+  %v = load i32, i32* %q
+  store i32 30, i32* %p
+  ret i32 %v
+}
+
+; A memset is killed by a store that covers it.
+define void @memset(i32* %p) {
+; CHECK-LABEL: @memset(
+; CHECK-NEXT: store i32 0, i32* %p
+; CHECK-NEXT: ret void
+  %p8 = bitcast i32* %p to i8*
+  call void @llvm.memset.p0i8.i64(i8* %p8, i8 1, i64 4, i32 4, i1 false)
+  store i32 0, i32* %p
+  ret void
+}
+
+; Storing back a value that was just loaded does nothing, even across a
+; store to other memory and another block.
+define void @noop_store(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @noop_store(
+; CHECK: store i32 1, i32* %q
+; CHECK-NOT: store
+; CHECK: ret void
+entry:
+  %v = load i32, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 1, i32* %q
+  br label %exit
+
+exit:
+  store i32 %v, i32* %p
+  ret void
+}
+
+; Storing back a value after a call that may change it is not a noop.
+define void @not_noop_store(i32* %p) {
+; CHECK-LABEL: @not_noop_store(
+; CHECK: store i32 %v, i32* %p
+  %v = load i32, i32* %p
+  call void @clobber()
+  store i32 %v, i32* %p
+  ret void
+}
+
+; Stores to memory that is freed afterwards are dead.
+define void @freed(i32* %p) {
+; CHECK-LABEL: @freed(
+; CHECK-NEXT: %p8 = bitcast
+; CHECK-NEXT: call void @free(i8* %p8)
+  store i32 1, i32* %p
+  %p8 = bitcast i32* %p to i8*
+  call void @free(i8* %p8)
+  ret void
+}
+
+; A null store to memory from calloc is dead.
+define i32* @calloc_null_store() {
+; CHECK-LABEL: @calloc_null_store(
+; CHECK-NOT: store
+  %m = call i8* @calloc(i64 1, i64 4)
+  %p = bitcast i8* %m to i32*
+  store i32 0, i32* %p
+  ret i32* %p
+}
+
+; Stores to a local variable are dead at the end of the function.
+define void @end_of_function() {
+; CHECK-LABEL: @end_of_function(
+; CHECK-NOT: store
+  %a = alloca i32
+  store i32 1, i32* %a
+  call void @clobber()
+  store i32 2, i32* %a
+  ret void
+}
@@ -0,0 +1,173 @@
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+
+; Load elimination finds the same redundancies with MemorySSA as with
+; MemoryDependenceAnalysis.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1)
+declare i32 @readonly(i32*) readonly
+declare void @clobber()
+
+; A store forwards its value to a load in another block, past a store that
+; does not alias.
+define i32 @store_forward(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @store_forward(
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %q
+  %v = load i32, i32* %p
+; CHECK-NOT: load
+; CHECK: ret i32 1
+  ret i32 %v
+
+exit:
+  ret i32 0
+}
+
+; A load is redundant with a dominating load that reads the same memory.
+define i32 @load_load(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @load_load(
+entry:
+  %a = load i32, i32* %p
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 0, i32* %q
+  br label %join
+
+join:
+  %b = load i32, i32* %p
+  %sum = add i32 %a, %b
+; CHECK: %a = load i32, i32* %p
+; CHECK-NOT: load
+; CHECK: %sum = add i32 %a, %a
+  ret i32 %sum
+}
+
+; A store in between that may alias keeps the load.
+define i32 @clobbered(i32* %p, i32* %q) {
+; CHECK-LABEL: @clobbered(
+  %a = load i32, i32* %p
+  store i32 0, i32* %q
+  %b = load i32, i32* %p
+  %sum = add i32 %a, %b
+; CHECK: %b = load i32, i32* %p
+; CHECK: %sum = add i32 %a, %b
+  ret i32 %sum
+}
+
+; The values stored on both sides of a diamond are merged with a phi.
+define i32 @diamond(i32* %p, i1 %c) {
+; CHECK-LABEL: @diamond(
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  store i32 1, i32* %p
+  br label %join
+
+right:
+  store i32 2, i32* %p
+  br label %join
+
+join:
+  %v = load i32, i32* %p
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32 [ 2, %right ], [ 1, %left ]
+; CHECK-NEXT: ret i32 %v
+  ret i32 %v
+}
+
+; A load that is available on one side of a diamond is made available on the
+; other side too.
+define i32 @partial(i32* %p, i1 %c) {
+; CHECK-LABEL: @partial(
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  store i32 1, i32* %p
+  br label %join
+
+right:
+  call void @clobber()
+  br label %join
+
+join:
+  %v = load i32, i32* %p
+; CHECK: right:
+; CHECK: %v.pre = load i32, i32* %p
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32 [ %v.pre, %right ], [ 1, %left ]
+  ret i32 %v
+}
+
+; The address is PHI translated into the predecessors.
+define i32 @phi_translate(i32* %p, i32* %q, i1 %c) {
+; CHECK-LABEL: @phi_translate(
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  store i32 1, i32* %p
+  br label %join
+
+right:
+  store i32 2, i32* %q
+  br label %join
+
+join:
+  %addr = phi i32* [ %p, %left ], [ %q, %right ]
+  %v = load i32, i32* %addr
+; CHECK: join:
+; CHECK-NOT: load
+; CHECK: ret i32
+  ret i32 %v
+}
+
+; Nothing has been stored to a local variable.
+define i32 @uninitialized() {
+; CHECK-LABEL: @uninitialized(
+  %a = alloca i32
+  %v = load i32, i32* %a
+; CHECK: ret i32 undef
+  ret i32 %v
+}
+
+; A memset forwards its value.
+define i32 @memset(i32* %p) {
+; CHECK-LABEL: @memset(
+  %p8 = bitcast i32* %p to i8*
+  call void @llvm.memset.p0i8.i64(i8* %p8, i8 0, i64 4, i32 4, i1 false)
+  %v = load i32, i32* %p
+; CHECK: ret i32 0
+  ret i32 %v
+}
+
+; Calls that only read memory are redundant if they read the same memory.
+define i32 @readonly_calls(i32* noalias %p, i32* noalias %q, i1 %c) {
+; CHECK-LABEL: @readonly_calls(
+entry:
+  %a = call i32 @readonly(i32* %p)
+  br i1 %c, label %then, label %join
+
+then:
+  br label %join
+
+join:
+  %b = call i32 @readonly(i32* %p)
+  call void @clobber()
+  %d = call i32 @readonly(i32* %p)
+  %sum = add i32 %a, %b
+  %sum2 = add i32 %sum, %d
+; CHECK: join:
+; CHECK-NEXT: call void @clobber()
+; CHECK-NEXT: %d = call i32 @readonly(i32* %p)
+; CHECK-NEXT: %sum = add i32 %a, %a
+  ret i32 %sum2
+}
@@ -0,0 +1,168 @@
+; RUN: opt < %s -hotcoldsplit -S | FileCheck %s
+; RUN: opt < %s -passes=hotcoldsplit -S | FileCheck %s
+; RUN: opt < %s -O2 -hot-cold-split -debug-pass=Structure -disable-output 2>&1 | FileCheck %s --check-prefix=PIPELINE
+
+; PIPELINE: Hot Cold Splitting
+
+; The cold regions of profiled functions are outlined into cold functions in
+; .text.unlikely. A region that ends in a noreturn call is outlined into a
+; noreturn function.
+
+declare void @sink(i32)
+declare void @abort() noreturn
+
+; CHECK-LABEL: define i32 @hot_error(
+; CHECK: entry:
+; CHECK-NEXT: %cmp = icmp
+; CHECK-NEXT: br i1 %cmp, label %codeRepl, label %ok
+; CHECK: codeRepl:
+; CHECK-NEXT: call void @hot_error_fail(i32 %x) [[NORETURN:#[0-9]+]]
+; CHECK-NEXT: unreachable
+; CHECK: ok:
+define i32 @hot_error(i32 %x) !prof !20 {
+entry:
+  %cmp = icmp slt i32 %x, 0
+  br i1 %cmp, label %fail, label %ok, !prof !21
+
+fail:
+  %a = mul i32 %x, 3
+  call void @sink(i32 %a)
+  %b = add i32 %a, 7
+  call void @sink(i32 %b)
+  call void @abort()
+  unreachable
+
+ok:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+; A cold diamond is outlined as one region, and the value it computes is
+; returned through a pointer.
+; CHECK-LABEL: define i32 @hot_diamond(
+; CHECK: codeRepl:
+; CHECK-NEXT: call void @hot_diamond_cold(i32 %x, i1 %c, i32* %m.loc)
+; CHECK-NEXT: %m.reload = load i32, i32* %m.loc
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32 [ %x, %entry ], [ %m.reload, %codeRepl ]
+define i32 @hot_diamond(i32 %x, i1 %c) !prof !20 {
+entry:
+  %cmp = icmp eq i32 %x, 42
+  br i1 %cmp, label %cold, label %join, !prof !21
+
+cold:
+  call void @sink(i32 %x)
+  br i1 %c, label %left, label %right
+
+left:
+  %l = shl i32 %x, 2
+  call void @sink(i32 %l)
+  br label %merge
+
+right:
+  %rr = lshr i32 %x, 2
+  call void @sink(i32 %rr)
+  br label %merge
+
+merge:
+  %m = phi i32 [ %l, %left ], [ %rr, %right ]
+  br label %join
+
+join:
+  %v = phi i32 [ %x, %entry ], [ %m, %merge ]
+  ret i32 %v
+}
+
+; The PHI of a cold block with several hot predecessors stays behind.
+; CHECK-LABEL: define void @hot_merged_error(
+; CHECK: fail:
+; CHECK-NEXT: %code = phi i32 [ 1, %entry ], [ 2, %second ]
+; CHECK-NEXT: br label %codeRepl
+; CHECK: codeRepl:
+; CHECK-NEXT: call void @hot_merged_error_fail.ce(i32 %code, i32 %x)
+define void @hot_merged_error(i32 %x, i32 %y) !prof !20 {
+entry:
+  %c1 = icmp slt i32 %x, 0
+  br i1 %c1, label %fail, label %second, !prof !21
+
+second:
+  %c2 = icmp slt i32 %y, 0
+  br i1 %c2, label %fail, label %ok, !prof !21
+
+fail:
+  %code = phi i32 [ 1, %entry ], [ 2, %second ]
+  %a = mul i32 %code, 3
+  call void @sink(i32 %a)
+  call void @sink(i32 %x)
+  call void @abort()
+  unreachable
+
+ok:
+  ret void
+}
+
+; A cold region that is too small to pay for the call stays in place.
+; CHECK-LABEL: define void @hot_small(
+; CHECK-NOT: codeRepl
+; CHECK: ret void
+define void @hot_small(i32 %x) !prof !20 {
+entry:
+  %cmp = icmp slt i32 %x, 0
+  br i1 %cmp, label %fail, label %ok, !prof !21
+
+fail:
+  call void @abort()
+  unreachable
+
+ok:
+  ret void
+}
+
+; Functions without a profile are not split.
+; CHECK-LABEL: define i32 @no_profile(
+; CHECK-NOT: codeRepl
+; CHECK: ret i32
+define i32 @no_profile(i32 %x) {
+entry:
+  %cmp = icmp slt i32 %x, 0
+  br i1 %cmp, label %fail, label %ok, !prof !21
+
+fail:
+  %a = mul i32 %x, 3
+  call void @sink(i32 %a)
+  %b = add i32 %a, 7
+  call void @sink(i32 %b)
+  call void @abort()
+  unreachable
+
+ok:
+  ret i32 %x
+}
+
+; CHECK: define internal void @hot_error_fail(i32 %x) [[COLDNORETURN:#[0-9]+]] !prof [[COUNT:![0-9]+]] !section_prefix [[UNLIKELY:![0-9]+]]
+; CHECK: define internal void @hot_diamond_cold(i32 %x, i1 %c, i32* %m.out) [[COLD:#[0-9]+]] !prof [[COUNT]] !section_prefix [[UNLIKELY]]
+
+; CHECK-DAG: attributes [[NORETURN]] = { noreturn }
+; CHECK-DAG: attributes [[COLDNORETURN]] = { cold minsize noinline noreturn }
+; CHECK-DAG: attributes [[COLD]] = { cold minsize noinline }
+; CHECK: [[COUNT]] = !{!"function_entry_count", i64 0}
+; CHECK: [[UNLIKELY]] = !{!"function_section_prefix", !".unlikely"}
+
+!llvm.module.flags = !{!1}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
+!20 = !{!"function_entry_count", i64 1000}
+!21 = !{!"branch_weights", i32 0, i32 1000}
@@ -0,0 +1,123 @@
+; RUN: opt < %s -passes='cgscc(inline)' -pass-remarks=inline -S 2>&1 | FileCheck %s
+; RUN: opt < %s -inline -S | FileCheck %s --check-prefix=LEGACY
+
+; The new pass manager inliner works bottom-up and visits the call sites of
+; a function with the largest estimated benefit first.
+
+; CHECK: leaf inlined into small
+; CHECK-NEXT: small inlined into caller
+; CHECK-NEXT: large inlined into caller
+
+declare void @ext(i32)
+
+define void @large(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %x
+  %c = xor i32 %b, %a
+  call void @ext(i32 %a)
+  call void @ext(i32 %b)
+  call void @ext(i32 %c)
+  ret void
+}
+
+define void @leaf(i32 %x) {
+  call void @ext(i32 %x)
+  ret void
+}
+
+define void @small(i32 %x) {
+  call void @leaf(i32 %x)
+  ret void
+}
+
+define void @caller(i32 %x) {
+; CHECK-LABEL: define void @caller(
+; CHECK-NOT: call void @large
+; CHECK-NOT: call void @small
+; CHECK: ret void
+  call void @large(i32 %x)
+  call void @small(i32 %x)
+  ret void
+}
+
+; Calls between the functions of one RefSCC are left alone.
+define void @even(i32 %n) {
+; CHECK-LABEL: define void @even(
+; CHECK: call void @odd(
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %m = sub i32 %n, 1
+  call void @odd(i32 %m)
+  br label %done
+
+done:
+  ret void
+}
+
+define void @odd(i32 %n) {
+; CHECK-LABEL: define void @odd(
+; CHECK: call void @even(
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %m = sub i32 %n, 1
+  call void @even(i32 %m)
+  br label %done
+
+done:
+  ret void
+}
+
+; The order changes what is inlined. @five is the more profitable call site,
+; and once it is inlined, inlining @eight as well would make @helper too big
+; to be inlined into @user, so @eight is deferred and inlined into @user
+; instead. Visiting the call sites in program order inlines @eight into
+; @helper first, which then is too big to be inlined.
+define void @five(i32 %x) {
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  ret void
+}
+
+define void @eight(i32 %x) {
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  call void @ext(i32 %x)
+  ret void
+}
+
+define linkonce_odr void @helper(i32 %x) {
+; CHECK-LABEL: define linkonce_odr void @helper(
+; CHECK-NEXT: call void @eight(
+; CHECK-NOT: call void @five
+; CHECK: ret void
+; LEGACY-LABEL: define linkonce_odr void @helper(
+; LEGACY-NOT: call void @eight
+; LEGACY-NOT: call void @five
+; LEGACY: ret void
+  call void @eight(i32 %x)
+  call void @five(i32 %x)
+  ret void
+}
+
+define void @user(i32 %x) {
+; CHECK-LABEL: define void @user(
+; CHECK-NOT: call void @helper
+; CHECK-NOT: call void @eight
+; CHECK: ret void
+; LEGACY-LABEL: define void @user(
+; LEGACY-NEXT: call void @helper(
+  call void @helper(i32 %x)
+  ret void
+}
@@ -0,0 +1,43 @@
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -inline-cost-cache=false -S | FileCheck %s
+; RUN: opt < %s -inline -stats -disable-output 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The inline cost analysis of the call sites which tell it nothing about the
+; arguments of @sum is computed once and replayed. The call sites with
+; a constant argument or with aliasing pointer arguments are analyzed in full.
+
+; STATS: 4 inline - Number of functions inlined
+; STATS: 1 inline-cost - Number of callee summaries computed
+; STATS: 4 inline-cost - Number of call sites analyzed{{$}}
+; STATS: 2 inline-cost - Number of call sites analyzed by replaying a callee summary
+
+define i32 @sum(i32* %p, i32* %q, i32 %n) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %q1 = getelementptr inbounds i32, i32* %q, i64 1
+  %a = load i32, i32* %p
+  %b = load i32, i32* %p1
+  %c = load i32, i32* %q
+  %d = load i32, i32* %q1
+  %ab = add i32 %a, %b
+  %cd = add i32 %c, %d
+  %r = add i32 %ab, %cd
+  %cmp = icmp eq i32* %p, %q
+  %sel = select i1 %cmp, i32 %n, i32 %r
+  ret i32 %sel
+}
+
+define i32 @caller(i32* %x, i32* %y, i32* %z, i32 %n) {
+; CHECK-LABEL: @caller(
+; CHECK-NOT: call
+; CHECK: ret i32
+entry:
+  %s1 = call i32 @sum(i32* %x, i32* %y, i32 %n)
+  %s2 = call i32 @sum(i32* %y, i32* %z, i32 %s1)
+  %s3 = call i32 @sum(i32* %x, i32* %z, i32 7)
+  %s4 = call i32 @sum(i32* %x, i32* %x, i32 %s2)
+  %t1 = add i32 %s2, %s3
+  %t2 = add i32 %t1, %s4
+  ret i32 %t2
+}
@@ -0,0 +1,133 @@
+; RUN: opt < %s -S -basicaa -licm | FileCheck %s
+; RUN: opt < %s -S -basicaa -licm -enable-mssa-loop-dependency | FileCheck %s
+; RUN: opt < %s -disable-output -basicaa -licm -enable-mssa-loop-dependency -print-memoryssa -verify-memoryssa
+
+; LICM makes the same decisions when it asks MemorySSA whether loads and calls
+; are invariant, and keeps MemorySSA up to date when it hoists, sinks and
+; promotes.
+
+@G1 = global i32 0
+@G2 = global i32 0
+
+declare i32 @readonly(i32*) readonly argmemonly nounwind
+declare void @clobber()
+declare void @write(i32*) argmemonly nounwind
+
+; The load is only clobbered outside of the loop.
+define i32 @hoist_load(i32 %n) {
+; CHECK-LABEL: @hoist_load(
+; CHECK: entry:
+; CHECK: %v = load i32, i32* @G1
+; CHECK: loop:
+entry:
+  store i32 1, i32* @G1
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %v = load i32, i32* @G1
+  %sum.next = add i32 %sum, %v
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %sum.next, %loop ]
+  ret i32 %r
+}
+
+; The call in the loop may write to @G1.
+define i32 @no_hoist_load(i32 %n) {
+; CHECK-LABEL: @no_hoist_load(
+; CHECK: loop:
+; CHECK: %v = load i32, i32* @G1
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %v = load i32, i32* @G1
+  call void @clobber()
+  %sum.next = add i32 %sum, %v
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %sum.next, %loop ]
+  ret i32 %r
+}
+
+; A readonly call is hoisted past a store to other memory.
+define i32 @hoist_call(i32 %n, i32* noalias %p, i32* noalias %q) {
+; CHECK-LABEL: @hoist_call(
+; CHECK: entry:
+; CHECK: %v = call i32 @readonly(i32* %p)
+; CHECK: loop:
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = call i32 @readonly(i32* %p)
+  store i32 %v, i32* %q
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %v
+}
+
+; A load that is only used outside of the loop is sunk.
+define i32 @sink_load(i32 %n, i32* noalias %q) {
+; CHECK-LABEL: @sink_load(
+; CHECK: exit:
+; CHECK-NEXT: %v.le = load i32, i32* @G1
+; CHECK-NEXT: ret i32 %v.le
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* @G1
+  call void @write(i32* %q)
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %v, %loop ]
+  ret i32 %r
+}
+
+; The loads and stores of @G1 are promoted.
+define void @promote(i32 %n) {
+; CHECK-LABEL: @promote(
+; CHECK: entry:
+; CHECK: %G1.promoted = load i32, i32* @G1
+; CHECK: loop:
+; CHECK-NOT: load
+; CHECK-NOT: store
+; CHECK: exit:
+; CHECK: store i32 %{{.*}}, i32* @G1
+; CHECK-NEXT: %v = load i32, i32* @G2
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %old = load i32, i32* @G1
+  %new = add i32 %old, %i
+  store i32 %new, i32* @G1
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %v = load i32, i32* @G2
+  store i32 %v, i32* @G2
+  ret void
+}
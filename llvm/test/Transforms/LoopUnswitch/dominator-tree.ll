@@ -0,0 +1,135 @@
+; RUN: opt < %s -loop-unswitch -verify-dom-info -verify-loop-info -disable-output
+; RUN: opt < %s -loop-unswitch -S | FileCheck %s
+
+; Loop unswitching keeps the dominator tree up to date as it unswitches
+; instead of recomputing it after every loop.
+
+declare void @f()
+declare void @g()
+
+; Trivial unswitching branches from the preheader to the exit.
+define void @trivial(i32 %n, i1 %c) {
+; CHECK-LABEL: @trivial(
+; CHECK: entry:
+; CHECK-NEXT: br i1 %c, label %{{.*}}, label %{{.*}}
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %latch, label %exit
+
+latch:
+  call void @f()
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; Nontrivial unswitching clones the loop, whose exits reach the same blocks.
+define i32 @nontrivial(i32 %n, i1 %c) {
+; CHECK-LABEL: @nontrivial(
+; CHECK: entry:
+; CHECK-NEXT: br i1 %c, label %{{.*}}, label %{{.*}}
+; CHECK: loop.us:
+; CHECK: loop:
+; CHECK: join:
+; CHECK-NEXT: %r = phi i32
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %then, label %else
+
+then:
+  call void @f()
+  br label %latch
+
+else:
+  call void @g()
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  br label %join
+
+join:
+  %r = phi i32 [ %i.next, %exit ]
+  ret i32 %r
+}
+
+; The inner loop is unswitched inside of the outer loop, and the cloned exit
+; blocks branch back into the outer loop.
+define void @nested(i32 %n, i32 %m, i1 %c) {
+; CHECK-LABEL: @nested(
+; CHECK: inner.us:
+; CHECK: inner:
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner.latch ]
+  br i1 %c, label %then, label %inner.latch
+
+then:
+  call void @f()
+  br label %inner.latch
+
+inner.latch:
+  call void @g()
+  %j.next = add i32 %j, 1
+  %cmp.inner = icmp slt i32 %j.next, %m
+  br i1 %cmp.inner, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %cmp.outer = icmp slt i32 %i.next, %n
+  br i1 %cmp.outer, label %outer, label %exit
+
+exit:
+  ret void
+}
+
+; Unswitching a switch puts the dead case of the original loop on a dead
+; path.
+define void @switch(i32 %n, i32 %x) {
+; CHECK-LABEL: @switch(
+; CHECK: br i1 true, label %us-unreachable
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  switch i32 %x, label %latch [
+    i32 0, label %case0
+    i32 1, label %case1
+  ]
+
+case0:
+  call void @f()
+  br label %latch
+
+case1:
+  call void @g()
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -5,18 +5,12 @@
 ; after unswitching the first one.
 
 
-; CHECK:  br i1 %cond1, label %..split_crit_edge, label %.loop_exit.split_crit_edge
+; CHECK:  br i1 %cond1, label %.split, label %.loop_exit.split_crit_edge
 
-; CHECK:  ..split_crit_edge:                                ; preds = %0
-; CHECK:    br label %.split
+; CHECK:  .split:                                           ; preds = %0
+; CHECK:    br i1 %cond2, label %.split.split, label %.split.loop_exit.split1_crit_edge
 
-; CHECK:  .split:                                           ; preds = %..split_crit_edge
-; CHECK:    br i1 %cond2, label %.split..split.split_crit_edge, label %.split.loop_exit.split1_crit_edge
-
-; CHECK:  .split..split.split_crit_edge:                    ; preds = %.split
-; CHECK:    br label %.split.split
-
-; CHECK:  .split.split:                                     ; preds = %.split..split.split_crit_edge
+; CHECK:  .split.split:                                     ; preds = %.split
 ; CHECK:    br label %loop_begin
 
 ; CHECK:  loop_begin:                                       ; preds = %do_something, %.split.split
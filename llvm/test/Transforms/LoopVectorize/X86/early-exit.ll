@@ -0,0 +1,287 @@
+; RUN: opt < %s -loop-vectorize -enable-early-exit-vectorization -force-vector-interleave=1 -mattr=+avx2 -verify-dom-info -verify-loop-info -S | FileCheck %s --check-prefix=CHECK --check-prefix=AVX2
+; RUN: opt < %s -loop-vectorize -enable-early-exit-vectorization -force-vector-interleave=1 -mattr=+avx512f -S | FileCheck %s --check-prefix=CHECK --check-prefix=AVX512
+; RUN: opt < %s -loop-vectorize -enable-early-exit-vectorization -force-vector-interleave=1 -mattr=+sse4.2 -S | FileCheck %s --check-prefix=SSE
+; RUN: opt < %s -loop-vectorize -force-vector-interleave=1 -mattr=+avx2 -S | FileCheck %s --check-prefix=DISABLED
+; RUN: opt < %s -loop-vectorize -enable-early-exit-vectorization -force-vector-interleave=1 -mattr=+avx2 -S | llc -mattr=+avx2 | FileCheck %s --check-prefix=AVX2-ASM
+; RUN: opt < %s -loop-vectorize -enable-early-exit-vectorization -force-vector-interleave=1 -mattr=+avx512f -S | llc -mattr=+avx512f | FileCheck %s --check-prefix=AVX512-ASM
+
+; With -enable-early-exit-vectorization, loops that leave through their latch
+; and through an early exit are vectorized when their loads stay within
+; dereferenceable memory for all iterations of the latch exit. A vector
+; iteration that contains the early exit has its stores masked off, and the
+; scalar loop re-executes it.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@a = global [1024 x i32] zeroinitializer, align 16
+
+; Find the first element equal to %x.
+define i64 @find(i32 %x) {
+; CHECK-LABEL: @find(
+; CHECK: vector.body:
+; CHECK: %index = phi i64 [ 0, %vector.ph ], [ %index.next, %vector.body ]
+; AVX2: %[[LOAD:.*]] = load <8 x i32>
+; AVX2: %[[CMP:.*]] = icmp eq <8 x i32> %[[LOAD]]
+; AVX2: %[[SHUF:.*]] = shufflevector <8 x i1> %[[CMP]], <8 x i1> undef, <8 x i32> <i32 4, i32 5, i32 6, i32 7, i32 undef, i32 undef, i32 undef, i32 undef>
+; AVX2: %[[OR:.*]] = or <8 x i1> %[[CMP]], %[[SHUF]]
+; AVX2: %early.exit = extractelement <8 x i1> %{{.*}}, i32 0
+; AVX512: %[[LOAD:.*]] = load <16 x i32>
+; AVX512: %[[CMP:.*]] = icmp eq <16 x i32> %[[LOAD]]
+; AVX512: %[[SHUF:.*]] = shufflevector <16 x i1> %[[CMP]], <16 x i1> undef
+; AVX512: %[[OR:.*]] = or <16 x i1> %[[CMP]], %[[SHUF]]
+; AVX512: %early.exit = extractelement <16 x i1> %{{.*}}, i32 0
+; CHECK: %vector.leave = or i1 %early.exit,
+; CHECK: br i1 %vector.leave, label %vector.early.exit, label %vector.body
+; CHECK: vector.early.exit:
+; CHECK-NEXT: br i1 %early.exit, label %scalar.ph, label %middle.block
+; CHECK: scalar.ph:
+; CHECK: %bc.resume.val = phi i64 {{.*}}[ %index, %vector.early.exit ]
+; CHECK: loop:
+; CHECK: br i1 %found, label %exit.early, label %latch
+; CHECK: exit.early:
+; CHECK-NEXT: %r.ph = phi i64 [ %i, %loop ]
+; CHECK: exit:
+; CHECK-NEXT: %r = phi i64 [ -1, %latch ], [ %r.ph, %exit.early ], [ -1, %middle.block ]
+
+; DISABLED-LABEL: @find(
+; DISABLED-NOT: vector.body
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds [1024 x i32], [1024 x i32]* @a, i64 0, i64 %i
+  %v = load i32, i32* %p, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ -1, %latch ]
+  ret i64 %r
+}
+
+; A strnlen-like loop with a pointer induction that exits on a false
+; condition. The scalar loop resumes both inductions at the start of the
+; vector iteration.
+define i8* @find_nul(i8* dereferenceable(256) %s) {
+; CHECK-LABEL: @find_nul(
+; AVX2: %[[CMP:.*]] = icmp ne <32 x i8>
+; AVX2: %[[NOT:.*]] = xor <32 x i1> %[[CMP]]
+; AVX2: %[[SHUF:.*]] = shufflevector <32 x i1> %[[NOT]], <32 x i1> undef
+; AVX2: %[[OR:.*]] = or <32 x i1> %[[NOT]], %[[SHUF]]
+; AVX2: %early.exit = extractelement <32 x i1> %{{.*}}, i32 0
+; CHECK: vector.early.exit:
+; CHECK: %ind.resume = getelementptr i8, i8* %s, i64 %index
+; CHECK: scalar.ph:
+; CHECK: phi i8* {{.*}}[ %ind.resume, %vector.early.exit ]
+entry:
+  br label %loop
+
+loop:
+  %p = phi i8* [ %s, %entry ], [ %p.next, %latch ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %c = load i8, i8* %p, align 1
+  %nz = icmp ne i8 %c, 0
+  br i1 %nz, label %latch, label %exit
+
+latch:
+  %p.next = getelementptr inbounds i8, i8* %p, i64 1
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, 256
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i8* [ %p, %loop ], [ null, %latch ]
+  ret i8* %r
+}
+
+; Copy up to the first zero. The stores become masked stores that are
+; disabled in the vector iteration that contains the zero. Without masked
+; stores the loop is not vectorized.
+define void @copy_until(i32* noalias %dst, i32* noalias dereferenceable(4096) %src) {
+; CHECK-LABEL: @copy_until(
+; CHECK: %early.exit = extractelement
+; CHECK: %[[KEEP:.*]] = xor i1 %early.exit, true
+; AVX2: %[[INS:.*]] = insertelement <8 x i1> undef, i1 %[[KEEP]], i32 0
+; AVX2: %[[SPLAT:.*]] = shufflevector <8 x i1> %[[INS]], <8 x i1> undef, <8 x i32> zeroinitializer
+; AVX2: call void @llvm.masked.store.v8i32.p0v8i32(<8 x i32> {{.*}}, <8 x i32>* {{.*}}, i32 4, <8 x i1> %[[SPLAT]])
+; AVX512: %[[INS:.*]] = insertelement <16 x i1> undef, i1 %[[KEEP]], i32 0
+; AVX512: %[[SPLAT:.*]] = shufflevector <16 x i1> %[[INS]], <16 x i1> undef, <16 x i32> zeroinitializer
+; AVX512: call void @llvm.masked.store.v16i32.p0v16i32(<16 x i32> {{.*}}, <16 x i32>* {{.*}}, i32 4, <16 x i1> %[[SPLAT]])
+; CHECK: br i1 %vector.leave, label %vector.early.exit, label %vector.body
+
+; The stores are masked with the compare of the loaded values, and the loop
+; branches on whether any lane takes the exit.
+; AVX2-ASM-LABEL: copy_until:
+; AVX2-ASM: vpcmpeqd
+; AVX2-ASM: vpor
+; AVX2-ASM: vpmaskmovd %ymm{{[0-9]+}}, %ymm{{[0-9]+}}, (%rdi,%rcx)
+; AVX2-ASM-NEXT: testb $1, %dl
+; AVX2-ASM-NEXT: jne
+; AVX512-ASM-LABEL: copy_until:
+; AVX512-ASM: vpcmpeqd %zmm{{[0-9]+}}, %zmm{{[0-9]+}}, %k1
+; AVX512-ASM: korw
+; AVX512-ASM: vmovdqu32 %zmm{{[0-9]+}}, (%rdi,%rcx) {%k{{[0-9]}}}
+; AVX512-ASM: testb
+; AVX512-ASM-NEXT: jne
+
+; SSE-LABEL: @copy_until(
+; SSE-NOT: vector.body
+; SSE: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds i32, i32* %src, i64 %i
+  %v = load i32, i32* %p, align 4
+  %z = icmp eq i32 %v, 0
+  br i1 %z, label %end, label %latch
+
+latch:
+  %q = getelementptr inbounds i32, i32* %dst, i64 %i
+  store i32 %v, i32* %q, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %end, label %loop
+
+end:
+  ret void
+}
+
+; Nothing is known about the memory after %src.
+define i64 @not_dereferenceable(i32* %src, i32 %x) {
+; CHECK-LABEL: @not_dereferenceable(
+; CHECK-NOT: vector.body
+; CHECK: ret i64
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds i32, i32* %src, i64 %i
+  %v = load i32, i32* %p, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ -1, %latch ]
+  ret i64 %r
+}
+
+; The store may write to memory the loads of later iterations read.
+define void @store_may_alias(i32* %dst) {
+; CHECK-LABEL: @store_may_alias(
+; CHECK-NOT: vector.body
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds [1024 x i32], [1024 x i32]* @a, i64 0, i64 %i
+  %v = load i32, i32* %p, align 4
+  %z = icmp eq i32 %v, 0
+  br i1 %z, label %end, label %latch
+
+latch:
+  %q = getelementptr inbounds i32, i32* %dst, i64 %i
+  store i32 %v, i32* %q, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %end, label %loop
+
+end:
+  ret void
+}
+
+; The store happens before the exit is tested.
+define void @store_before_exit(i32* noalias %dst) {
+; CHECK-LABEL: @store_before_exit(
+; CHECK-NOT: vector.body
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds [1024 x i32], [1024 x i32]* @a, i64 0, i64 %i
+  %v = load i32, i32* %p, align 4
+  %q = getelementptr inbounds i32, i32* %dst, i64 %i
+  store i32 %v, i32* %q, align 4
+  %z = icmp eq i32 %v, 0
+  br i1 %z, label %end, label %latch
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %end, label %loop
+
+end:
+  ret void
+}
+
+; Reductions are not supported with an early exit.
+define i32 @reduction(i32 %x) {
+; CHECK-LABEL: @reduction(
+; CHECK-NOT: vector.body
+; CHECK: ret i32
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %latch ]
+  %p = getelementptr inbounds [1024 x i32], [1024 x i32]* @a, i64 0, i64 %i
+  %v = load i32, i32* %p, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %sum.next = add i32 %sum, %v
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ %sum, %loop ], [ %sum.next, %latch ]
+  ret i32 %r
+}
+
+; A division could trap in the iterations after the early exit.
+define void @division(i32* noalias %dst, i32 %d) {
+; CHECK-LABEL: @division(
+; CHECK-NOT: vector.body
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %p = getelementptr inbounds [1024 x i32], [1024 x i32]* @a, i64 0, i64 %i
+  %v = load i32, i32* %p, align 4
+  %z = icmp eq i32 %v, 0
+  br i1 %z, label %end, label %latch
+
+latch:
+  %div = sdiv i32 %d, %v
+  %q = getelementptr inbounds i32, i32* %dst, i64 %i
+  store i32 %div, i32* %q, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %end, label %loop
+
+end:
+  ret void
+}
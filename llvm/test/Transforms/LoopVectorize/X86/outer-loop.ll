@@ -0,0 +1,343 @@
+; RUN: opt < %s -loop-vectorize -enable-outer-loop-vectorization -mattr=+avx512f -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -mattr=+avx512f -S | FileCheck %s --check-prefix=DISABLED
+; RUN: opt < %s -loop-vectorize -enable-outer-loop-vectorization -mattr=+avx512f -vectorizer-print-plans -disable-output 2>&1 | FileCheck %s --check-prefix=PLAN
+
+; The inner loops below run four times, too few to vectorize them. The
+; vectorizer replicates them and vectorizes the outer loop instead when the
+; plans for the outer loop are cheaper than the scalar loop nest.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; for (i = 0; i < n; i++) {
+;   float s = 0;
+;   for (j = 0; j < 4; j++)
+;     s += a[j * 1024 + i] * b[j];
+;   c[i] = s;
+; }
+define void @column_sums(float* noalias %a, float* noalias %b, float* noalias %c, i64 %n) {
+; CHECK-LABEL: @column_sums(
+; CHECK: vector.body:
+; CHECK: load <16 x float>
+; CHECK: load <16 x float>
+; CHECK: load <16 x float>
+; CHECK: load <16 x float>
+; CHECK: store <16 x float>
+; CHECK: middle.block:
+; DISABLED-LABEL: @column_sums(
+; DISABLED-NOT: <{{[0-9]+}} x float>
+; DISABLED: ret void
+; PLAN-LABEL: VPlan for loop 'outer.header' VF 1 replicating inner loop 'inner': cost
+; PLAN: VPlan for loop 'outer.header' VF 16 replicating inner loop 'inner': cost
+; PLAN-NEXT: WIDEN-PHI cost 0: %i = phi i64
+; PLAN: IGNORED cost 0 x4: %j = phi i64
+; PLAN: IGNORED cost 0 x4: %row = mul nuw nsw i64 %j, 1024
+; PLAN: WIDEN-MEMORY cost {{[0-9]+}} x4: %va = load float, float* %pa
+; PLAN: UNIFORM cost {{[0-9]+}} x4: %vb = load float, float* %pb
+; PLAN: WIDEN cost {{[0-9]+}} x4: %mul = fmul float %va, %vb
+; PLAN: IGNORED cost 0 x4: %cmp.inner = icmp eq i64 %j.next, 4
+; PLAN: WIDEN-MEMORY cost {{[0-9]+}}: store float %sum.lcssa, float* %pc
+; PLAN: UNIFORM cost {{[0-9]+}}: %cmp.outer = icmp eq i64 %i.next, %n
+; The replicated loop is vectorized with the factor planned for the nest.
+; PLAN-NOT: VPlan for loop 'outer.header' VF {{[0-9]+}}: cost
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi float [ 0.0, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %pb = getelementptr inbounds float, float* %b, i64 %j
+  %vb = load float, float* %pb, align 4
+  %mul = fmul float %va, %vb
+  %sum.next = fadd float %sum, %mul
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %pc = getelementptr inbounds float, float* %c, i64 %i
+  store float %sum.lcssa, float* %pc, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+; The same nest, enabled by a hint on the outer loop instead of the option.
+define void @hint(float* noalias %a, float* noalias %b, float* noalias %c, i64 %n) {
+; DISABLED-LABEL: @hint(
+; DISABLED: vector.body:
+; DISABLED: load <16 x float>
+; DISABLED: store <16 x float>
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi float [ 0.0, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %pb = getelementptr inbounds float, float* %b, i64 %j
+  %vb = load float, float* %pb, align 4
+  %mul = fmul float %va, %vb
+  %sum.next = fadd float %sum, %mul
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %pc = getelementptr inbounds float, float* %c, i64 %i
+  store float %sum.lcssa, float* %pc, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+; A call in the inner loop keeps the outer loop from being vectorized.
+declare float @f(float)
+
+define void @call(float* noalias %a, float* noalias %c, i64 %n) {
+; CHECK-LABEL: @call(
+; CHECK-NOT: vector.body:
+; CHECK: inner:
+; CHECK: ret void
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi float [ 0.0, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %fa = call float @f(float %va)
+  %sum.next = fadd float %sum, %fa
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %pc = getelementptr inbounds float, float* %c, i64 %i
+  store float %sum.lcssa, float* %pc, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+; The outer loop carries a dependence through c, so it cannot be vectorized
+; and the inner loop is left alone.
+; for (i = 0; i < n; i++) {
+;   float s = c[i];
+;   for (j = 0; j < 4; j++)
+;     s += a[j * 1024 + i];
+;   c[i + 1] = s;
+; }
+define void @carried(float* noalias %a, float* %c, i64 %n) {
+; CHECK-LABEL: @carried(
+; CHECK-NOT: vector.body:
+; CHECK: inner:
+; CHECK: ret void
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %pc = getelementptr inbounds float, float* %c, i64 %i
+  %vc = load float, float* %pc, align 4
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi float [ %vc, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %sum.next = fadd float %sum, %va
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %i.next = add nuw nsw i64 %i, 1
+  %pc.next = getelementptr inbounds float, float* %c, i64 %i.next
+  store float %sum.lcssa, float* %pc.next, align 4
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+; An element of c is accessed again only 1024 iterations of the outer loop
+; later, which is further apart than the vector width.
+; for (i = 0; i < n; i++)
+;   for (j = 0; j < 4; j++)
+;     c[j * 1024 + i] += a[j * 1024 + i];
+define void @in_place(float* noalias %a, float* %c, i64 %n) {
+; CHECK-LABEL: @in_place(
+; CHECK: vector.body:
+; CHECK: store <16 x float>
+; CHECK: middle.block:
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %pc = getelementptr inbounds float, float* %c, i64 %idx
+  %vc = load float, float* %pc, align 4
+  %add = fadd float %vc, %va
+  store float %add, float* %pc, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+; Vector divisions by a variable are expanded lane by lane, so no plan beats
+; the scalar loop nest, and the nest is left as it was.
+; for (i = 0; i < n; i++) {
+;   unsigned short s = 0;
+;   for (j = 0; j < 4; j++)
+;     s += a[j * 1024 + i] / d;
+;   c[i] = s;
+; }
+define void @divide(i16* noalias %a, i16* noalias %c, i16 %d, i64 %n) {
+; CHECK-LABEL: @divide(
+; CHECK-NOT: vector.body:
+; CHECK: inner:
+; CHECK-NEXT: %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+; CHECK: br i1 %cmp.inner, label %outer.latch, label %inner
+; CHECK: br i1 %cmp.outer, label %exit{{.*}}, label %outer.header
+; PLAN: WIDEN cost {{[0-9]+}} x4: %q = udiv i16 %va, %d
+; PLAN-NOT: VPlan for loop 'outer.header' VF {{[0-9]+}}: cost
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi i16 [ 0, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds i16, i16* %a, i64 %idx
+  %va = load i16, i16* %pa, align 2
+  %q = udiv i16 %va, %d
+  %sum.next = add i16 %sum, %q
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi i16 [ %sum.next, %inner ]
+  %pc = getelementptr inbounds i16, i16* %c, i64 %i
+  store i16 %sum.lcssa, i16* %pc, align 2
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+; The vectorizer does not vectorize loops of functions optimized for size, so
+; the inner loop is not replicated either.
+define void @optsize(float* noalias %a, float* noalias %b, float* noalias %c, i64 %n) optsize {
+; CHECK-LABEL: @optsize(
+; CHECK-NOT: vector.body:
+; CHECK: inner:
+; CHECK-NEXT: %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+; CHECK: br i1 %cmp.inner, label %outer.latch, label %inner
+; CHECK: br i1 %cmp.outer, label %exit{{.*}}, label %outer.header
+entry:
+  %cmp.entry = icmp sgt i64 %n, 0
+  br i1 %cmp.entry, label %outer.header, label %exit
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner ]
+  %sum = phi float [ 0.0, %outer.header ], [ %sum.next, %inner ]
+  %row = mul nuw nsw i64 %j, 1024
+  %idx = add nuw nsw i64 %row, %i
+  %pa = getelementptr inbounds float, float* %a, i64 %idx
+  %va = load float, float* %pa, align 4
+  %pb = getelementptr inbounds float, float* %b, i64 %j
+  %vb = load float, float* %pb, align 4
+  %mul = fmul float %va, %vb
+  %sum.next = fadd float %sum, %mul
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp.inner = icmp eq i64 %j.next, 4
+  br i1 %cmp.inner, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %pc = getelementptr inbounds float, float* %c, i64 %i
+  store float %sum.lcssa, float* %pc, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp.outer = icmp eq i64 %i.next, %n
+  br i1 %cmp.outer, label %exit, label %outer.header
+
+exit:
+  ret void
+}
+
+!0 = distinct !{!0, !1}
+!1 = !{!"llvm.loop.vectorize.enable", i1 true}
@@ -0,0 +1,154 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -S -mattr=+avx2 | FileCheck %s
+
+; Bundles of two different binary operators are vectorized as both vector
+; operations and a shuffle that picks the lanes of each, whatever the order of
+; the opcodes across the lanes.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The opcodes do not alternate lane by lane.
+; CHECK-LABEL: @add_add_sub_sub(
+; CHECK: %[[ADD:.*]] = add <4 x i32> %[[X:.*]], %[[Y:.*]]
+; CHECK: %[[SUB:.*]] = sub <4 x i32> %[[X]], %[[Y]]
+; CHECK: shufflevector <4 x i32> %[[ADD]], <4 x i32> %[[SUB]], <4 x i32> <i32 0, i32 1, i32 6, i32 7>
+define void @add_add_sub_sub(i32* noalias %d, i32* noalias %a, i32* noalias %b) {
+entry:
+  %pa0 = getelementptr inbounds i32, i32* %a, i64 0
+  %pb0 = getelementptr inbounds i32, i32* %b, i64 0
+  %x0 = load i32, i32* %pa0, align 4
+  %y0 = load i32, i32* %pb0, align 4
+  %r0 = add i32 %x0, %y0
+  %pd0 = getelementptr inbounds i32, i32* %d, i64 0
+  store i32 %r0, i32* %pd0, align 4
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %pb1 = getelementptr inbounds i32, i32* %b, i64 1
+  %x1 = load i32, i32* %pa1, align 4
+  %y1 = load i32, i32* %pb1, align 4
+  %r1 = add i32 %x1, %y1
+  %pd1 = getelementptr inbounds i32, i32* %d, i64 1
+  store i32 %r1, i32* %pd1, align 4
+  %pa2 = getelementptr inbounds i32, i32* %a, i64 2
+  %pb2 = getelementptr inbounds i32, i32* %b, i64 2
+  %x2 = load i32, i32* %pa2, align 4
+  %y2 = load i32, i32* %pb2, align 4
+  %r2 = sub i32 %x2, %y2
+  %pd2 = getelementptr inbounds i32, i32* %d, i64 2
+  store i32 %r2, i32* %pd2, align 4
+  %pa3 = getelementptr inbounds i32, i32* %a, i64 3
+  %pb3 = getelementptr inbounds i32, i32* %b, i64 3
+  %x3 = load i32, i32* %pa3, align 4
+  %y3 = load i32, i32* %pb3, align 4
+  %r3 = sub i32 %x3, %y3
+  %pd3 = getelementptr inbounds i32, i32* %d, i64 3
+  store i32 %r3, i32* %pd3, align 4
+  ret void
+}
+
+; Any pair of operators can be combined, not just additions and subtractions.
+; CHECK-LABEL: @fmul_fadd(
+; CHECK: %[[MUL:.*]] = fmul <4 x float> %[[X:.*]], %[[Y:.*]]
+; CHECK: %[[ADD:.*]] = fadd <4 x float> %[[X]], %[[Y]]
+; CHECK: shufflevector <4 x float> %[[MUL]], <4 x float> %[[ADD]], <4 x i32> <i32 0, i32 5, i32 6, i32 7>
+define void @fmul_fadd(float* noalias %d, float* noalias %a, float* noalias %b) {
+entry:
+  %pa0 = getelementptr inbounds float, float* %a, i64 0
+  %pb0 = getelementptr inbounds float, float* %b, i64 0
+  %x0 = load float, float* %pa0, align 4
+  %y0 = load float, float* %pb0, align 4
+  %r0 = fmul float %x0, %y0
+  %pd0 = getelementptr inbounds float, float* %d, i64 0
+  store float %r0, float* %pd0, align 4
+  %pa1 = getelementptr inbounds float, float* %a, i64 1
+  %pb1 = getelementptr inbounds float, float* %b, i64 1
+  %x1 = load float, float* %pa1, align 4
+  %y1 = load float, float* %pb1, align 4
+  %r1 = fadd float %x1, %y1
+  %pd1 = getelementptr inbounds float, float* %d, i64 1
+  store float %r1, float* %pd1, align 4
+  %pa2 = getelementptr inbounds float, float* %a, i64 2
+  %pb2 = getelementptr inbounds float, float* %b, i64 2
+  %x2 = load float, float* %pa2, align 4
+  %y2 = load float, float* %pb2, align 4
+  %r2 = fadd float %x2, %y2
+  %pd2 = getelementptr inbounds float, float* %d, i64 2
+  store float %r2, float* %pd2, align 4
+  %pa3 = getelementptr inbounds float, float* %a, i64 3
+  %pb3 = getelementptr inbounds float, float* %b, i64 3
+  %x3 = load float, float* %pa3, align 4
+  %y3 = load float, float* %pb3, align 4
+  %r3 = fadd float %x3, %y3
+  %pd3 = getelementptr inbounds float, float* %d, i64 3
+  store float %r3, float* %pd3, align 4
+  ret void
+}
+
+; Alternate opcodes in a 3-D point.
+; CHECK-LABEL: @add_sub_add(
+; CHECK: %[[ADD:.*]] = fadd <3 x float> %[[X:.*]], %[[Y:.*]]
+; CHECK: %[[SUB:.*]] = fsub <3 x float> %[[X]], %[[Y]]
+; CHECK: shufflevector <3 x float> %[[ADD]], <3 x float> %[[SUB]], <3 x i32> <i32 0, i32 4, i32 2>
+define void @add_sub_add(float* noalias %d, float* noalias %a, float* noalias %b) {
+entry:
+  %pa0 = getelementptr inbounds float, float* %a, i64 0
+  %pb0 = getelementptr inbounds float, float* %b, i64 0
+  %x0 = load float, float* %pa0, align 4
+  %y0 = load float, float* %pb0, align 4
+  %r0 = fadd float %x0, %y0
+  %pd0 = getelementptr inbounds float, float* %d, i64 0
+  store float %r0, float* %pd0, align 4
+  %pa1 = getelementptr inbounds float, float* %a, i64 1
+  %pb1 = getelementptr inbounds float, float* %b, i64 1
+  %x1 = load float, float* %pa1, align 4
+  %y1 = load float, float* %pb1, align 4
+  %r1 = fsub float %x1, %y1
+  %pd1 = getelementptr inbounds float, float* %d, i64 1
+  store float %r1, float* %pd1, align 4
+  %pa2 = getelementptr inbounds float, float* %a, i64 2
+  %pb2 = getelementptr inbounds float, float* %b, i64 2
+  %x2 = load float, float* %pa2, align 4
+  %y2 = load float, float* %pb2, align 4
+  %r2 = fadd float %x2, %y2
+  %pd2 = getelementptr inbounds float, float* %d, i64 2
+  store float %r2, float* %pd2, align 4
+  ret void
+}
+
+; The division could trap in the lanes of the addition.
+; CHECK-LABEL: @add_sdiv(
+; CHECK-NOT: <4 x i32>
+; CHECK: sdiv i32
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+define void @add_sdiv(i32* noalias %d, i32* noalias %a, i32* noalias %b) {
+entry:
+  %pa0 = getelementptr inbounds i32, i32* %a, i64 0
+  %pb0 = getelementptr inbounds i32, i32* %b, i64 0
+  %x0 = load i32, i32* %pa0, align 4
+  %y0 = load i32, i32* %pb0, align 4
+  %r0 = add i32 %x0, %y0
+  %pd0 = getelementptr inbounds i32, i32* %d, i64 0
+  store i32 %r0, i32* %pd0, align 4
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %pb1 = getelementptr inbounds i32, i32* %b, i64 1
+  %x1 = load i32, i32* %pa1, align 4
+  %y1 = load i32, i32* %pb1, align 4
+  %r1 = sdiv i32 %x1, %y1
+  %pd1 = getelementptr inbounds i32, i32* %d, i64 1
+  store i32 %r1, i32* %pd1, align 4
+  %pa2 = getelementptr inbounds i32, i32* %a, i64 2
+  %pb2 = getelementptr inbounds i32, i32* %b, i64 2
+  %x2 = load i32, i32* %pa2, align 4
+  %y2 = load i32, i32* %pb2, align 4
+  %r2 = add i32 %x2, %y2
+  %pd2 = getelementptr inbounds i32, i32* %d, i64 2
+  store i32 %r2, i32* %pd2, align 4
+  %pa3 = getelementptr inbounds i32, i32* %a, i64 3
+  %pb3 = getelementptr inbounds i32, i32* %b, i64 3
+  %x3 = load i32, i32* %pa3, align 4
+  %y3 = load i32, i32* %pb3, align 4
+  %r3 = add i32 %x3, %y3
+  %pd3 = getelementptr inbounds i32, i32* %d, i64 3
+  store i32 %r3, i32* %pd3, align 4
+  ret void
+}
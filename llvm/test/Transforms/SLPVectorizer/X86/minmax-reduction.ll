@@ -0,0 +1,170 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -S -mattr=+avx2 | FileCheck %s
+
+; Trees of integer or fast floating-point min/max operations, written as
+; select(cmp(a, b), a, b), are vectorized as horizontal reductions.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The maximum of eight consecutive integers.
+; CHECK-LABEL: @smax8(
+; CHECK: %[[V:.*]] = load <8 x i32>
+; CHECK: %[[SHUF:.*]] = shufflevector <8 x i32> %[[V]], <8 x i32> undef, <8 x i32> <i32 4, i32 5, i32 6, i32 7, i32 undef, i32 undef, i32 undef, i32 undef>
+; CHECK: %[[CMP:.*]] = icmp sgt <8 x i32> %[[V]], %[[SHUF]]
+; CHECK: select <8 x i1> %[[CMP]], <8 x i32> %[[V]], <8 x i32> %[[SHUF]]
+; CHECK: icmp sgt <8 x i32>
+; CHECK: icmp sgt <8 x i32>
+; CHECK: %[[RES:.*]] = extractelement <8 x i32> %{{.*}}, i32 0
+; CHECK: ret i32 %[[RES]]
+define i32 @smax8(i32* %p) {
+entry:
+  %p0 = getelementptr inbounds i32, i32* %p, i64 0
+  %v0 = load i32, i32* %p0, align 4
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %v1 = load i32, i32* %p1, align 4
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %v2 = load i32, i32* %p2, align 4
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %v3 = load i32, i32* %p3, align 4
+  %p4 = getelementptr inbounds i32, i32* %p, i64 4
+  %v4 = load i32, i32* %p4, align 4
+  %p5 = getelementptr inbounds i32, i32* %p, i64 5
+  %v5 = load i32, i32* %p5, align 4
+  %p6 = getelementptr inbounds i32, i32* %p, i64 6
+  %v6 = load i32, i32* %p6, align 4
+  %p7 = getelementptr inbounds i32, i32* %p, i64 7
+  %v7 = load i32, i32* %p7, align 4
+  %c1 = icmp sgt i32 %v0, %v1
+  %m1 = select i1 %c1, i32 %v0, i32 %v1
+  %c2 = icmp sgt i32 %m1, %v2
+  %m2 = select i1 %c2, i32 %m1, i32 %v2
+  %c3 = icmp sgt i32 %m2, %v3
+  %m3 = select i1 %c3, i32 %m2, i32 %v3
+  %c4 = icmp sgt i32 %m3, %v4
+  %m4 = select i1 %c4, i32 %m3, i32 %v4
+  %c5 = icmp sgt i32 %m4, %v5
+  %m5 = select i1 %c5, i32 %m4, i32 %v5
+  %c6 = icmp sgt i32 %m5, %v6
+  %m6 = select i1 %c6, i32 %m5, i32 %v6
+  %c7 = icmp sgt i32 %m6, %v7
+  %m7 = select i1 %c7, i32 %m6, i32 %v7
+  ret i32 %m7
+}
+
+; The unsigned minimum of four consecutive integers.
+; CHECK-LABEL: @umin4(
+; CHECK: load <4 x i32>
+; CHECK: icmp ult <4 x i32>
+; CHECK: icmp ult <4 x i32>
+; CHECK: %[[RES:.*]] = extractelement <4 x i32> %{{.*}}, i32 0
+; CHECK: ret i32 %[[RES]]
+define i32 @umin4(i32* %p) {
+entry:
+  %p0 = getelementptr inbounds i32, i32* %p, i64 0
+  %v0 = load i32, i32* %p0, align 4
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %v1 = load i32, i32* %p1, align 4
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %v2 = load i32, i32* %p2, align 4
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %v3 = load i32, i32* %p3, align 4
+  %c1 = icmp ult i32 %v0, %v1
+  %m1 = select i1 %c1, i32 %v0, i32 %v1
+  %c2 = icmp ult i32 %m1, %v2
+  %m2 = select i1 %c2, i32 %m1, i32 %v2
+  %c3 = icmp ult i32 %m2, %v3
+  %m3 = select i1 %c3, i32 %m2, i32 %v3
+  ret i32 %m3
+}
+
+; Floating-point maximum with fast-math.
+; CHECK-LABEL: @fmax4(
+; CHECK: load <4 x float>
+; CHECK: fcmp fast ogt <4 x float>
+; CHECK: fcmp fast ogt <4 x float>
+; CHECK: %[[RES:.*]] = extractelement <4 x float> %{{.*}}, i32 0
+; CHECK: ret float %[[RES]]
+define float @fmax4(float* %p) {
+entry:
+  %p0 = getelementptr inbounds float, float* %p, i64 0
+  %v0 = load float, float* %p0, align 4
+  %p1 = getelementptr inbounds float, float* %p, i64 1
+  %v1 = load float, float* %p1, align 4
+  %p2 = getelementptr inbounds float, float* %p, i64 2
+  %v2 = load float, float* %p2, align 4
+  %p3 = getelementptr inbounds float, float* %p, i64 3
+  %v3 = load float, float* %p3, align 4
+  %c1 = fcmp fast ogt float %v0, %v1
+  %m1 = select i1 %c1, float %v0, float %v1
+  %c2 = fcmp fast ogt float %m1, %v2
+  %m2 = select i1 %c2, float %m1, float %v2
+  %c3 = fcmp fast ogt float %m2, %v3
+  %m3 = select i1 %c3, float %m2, float %v3
+  ret float %m3
+}
+
+; Without fast-math, NaNs make the order of the comparisons observable.
+; CHECK-LABEL: @fmax4_strict(
+; CHECK-NOT: <4 x float>
+; CHECK: ret float %m3
+define float @fmax4_strict(float* %p) {
+entry:
+  %p0 = getelementptr inbounds float, float* %p, i64 0
+  %v0 = load float, float* %p0, align 4
+  %p1 = getelementptr inbounds float, float* %p, i64 1
+  %v1 = load float, float* %p1, align 4
+  %p2 = getelementptr inbounds float, float* %p, i64 2
+  %v2 = load float, float* %p2, align 4
+  %p3 = getelementptr inbounds float, float* %p, i64 3
+  %v3 = load float, float* %p3, align 4
+  %c1 = fcmp ogt float %v0, %v1
+  %m1 = select i1 %c1, float %v0, float %v1
+  %c2 = fcmp ogt float %m1, %v2
+  %m2 = select i1 %c2, float %m1, float %v2
+  %c3 = fcmp ogt float %m2, %v3
+  %m3 = select i1 %c3, float %m2, float %v3
+  ret float %m3
+}
+
+; A running minimum in a loop.
+; CHECK-LABEL: @smin_loop(
+; CHECK: loop:
+; CHECK: load <4 x i32>
+; CHECK: icmp slt <4 x i32>
+; CHECK: icmp slt <4 x i32>
+; CHECK: %[[RDX:.*]] = extractelement <4 x i32> %{{.*}}, i32 0
+; CHECK: %[[CMP:.*]] = icmp slt i32 %min, %[[RDX]]
+; CHECK: %min.next = select i1 %[[CMP]], i32 %min, i32 %[[RDX]]
+define i32 @smin_loop(i32* %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %min = phi i32 [ 2147483647, %entry ], [ %min.next, %loop ]
+  %p0 = getelementptr inbounds i32, i32* %p, i64 %i
+  %i1 = add i64 %i, 1
+  %p1 = getelementptr inbounds i32, i32* %p, i64 %i1
+  %i2 = add i64 %i, 2
+  %p2 = getelementptr inbounds i32, i32* %p, i64 %i2
+  %i3 = add i64 %i, 3
+  %p3 = getelementptr inbounds i32, i32* %p, i64 %i3
+  %v0 = load i32, i32* %p0, align 4
+  %v1 = load i32, i32* %p1, align 4
+  %v2 = load i32, i32* %p2, align 4
+  %v3 = load i32, i32* %p3, align 4
+  %c1 = icmp slt i32 %v0, %v1
+  %m1 = select i1 %c1, i32 %v0, i32 %v1
+  %c2 = icmp slt i32 %m1, %v2
+  %m2 = select i1 %c2, i32 %m1, i32 %v2
+  %c3 = icmp slt i32 %m2, %v3
+  %m3 = select i1 %c3, i32 %m2, i32 %v3
+  %c = icmp slt i32 %min, %m3
+  %min.next = select i1 %c, i32 %min, i32 %m3
+  %i.next = add i64 %i, 4
+  %done = icmp uge i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %min.next
+}
@@ -0,0 +1,90 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -S -mattr=+avx2 | FileCheck %s
+; RUN: opt < %s -basicaa -slp-vectorizer -S -mattr=+avx2 -slp-vectorize-non-pow2=false | FileCheck %s --check-prefix=DISABLED
+
+; Bundles whose width is not a power of two, such as the components of a 3-D
+; point or the stores left over after a full vector, are vectorized with a
+; vector type of that width when the cost model says it is profitable.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-LABEL: @add3(
+; CHECK: load <3 x float>
+; CHECK: load <3 x float>
+; CHECK: fadd <3 x float>
+; CHECK: store <3 x float>
+; DISABLED-LABEL: @add3(
+; DISABLED-NOT: <3 x float>
+; DISABLED: ret void
+define void @add3(float* noalias %d, float* noalias %a, float* noalias %b) {
+entry:
+  %a1 = getelementptr inbounds float, float* %a, i64 1
+  %a2 = getelementptr inbounds float, float* %a, i64 2
+  %b1 = getelementptr inbounds float, float* %b, i64 1
+  %b2 = getelementptr inbounds float, float* %b, i64 2
+  %d1 = getelementptr inbounds float, float* %d, i64 1
+  %d2 = getelementptr inbounds float, float* %d, i64 2
+  %x0 = load float, float* %a, align 4
+  %x1 = load float, float* %a1, align 4
+  %x2 = load float, float* %a2, align 4
+  %y0 = load float, float* %b, align 4
+  %y1 = load float, float* %b1, align 4
+  %y2 = load float, float* %b2, align 4
+  %s0 = fadd float %x0, %y0
+  %s1 = fadd float %x1, %y1
+  %s2 = fadd float %x2, %y2
+  store float %s0, float* %d, align 4
+  store float %s1, float* %d1, align 4
+  store float %s2, float* %d2, align 4
+  ret void
+}
+
+; The first four stores fill a vector and the last three form a second bundle.
+; CHECK-LABEL: @mul7(
+; CHECK: mul <4 x i32>
+; CHECK: store <4 x i32>
+; CHECK: mul <3 x i32>
+; CHECK: store <3 x i32>
+; DISABLED-LABEL: @mul7(
+; DISABLED: store <4 x i32>
+; DISABLED-NOT: <3 x i32>
+; DISABLED: ret void
+define void @mul7(i32* noalias %d, i32* noalias %a) {
+entry:
+  %pa0 = getelementptr inbounds i32, i32* %a, i64 0
+  %x0 = load i32, i32* %pa0, align 4
+  %m0 = mul i32 %x0, 3
+  %pd0 = getelementptr inbounds i32, i32* %d, i64 0
+  store i32 %m0, i32* %pd0, align 4
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %x1 = load i32, i32* %pa1, align 4
+  %m1 = mul i32 %x1, 4
+  %pd1 = getelementptr inbounds i32, i32* %d, i64 1
+  store i32 %m1, i32* %pd1, align 4
+  %pa2 = getelementptr inbounds i32, i32* %a, i64 2
+  %x2 = load i32, i32* %pa2, align 4
+  %m2 = mul i32 %x2, 5
+  %pd2 = getelementptr inbounds i32, i32* %d, i64 2
+  store i32 %m2, i32* %pd2, align 4
+  %pa3 = getelementptr inbounds i32, i32* %a, i64 3
+  %x3 = load i32, i32* %pa3, align 4
+  %m3 = mul i32 %x3, 6
+  %pd3 = getelementptr inbounds i32, i32* %d, i64 3
+  store i32 %m3, i32* %pd3, align 4
+  %pa4 = getelementptr inbounds i32, i32* %a, i64 4
+  %x4 = load i32, i32* %pa4, align 4
+  %m4 = mul i32 %x4, 7
+  %pd4 = getelementptr inbounds i32, i32* %d, i64 4
+  store i32 %m4, i32* %pd4, align 4
+  %pa5 = getelementptr inbounds i32, i32* %a, i64 5
+  %x5 = load i32, i32* %pa5, align 4
+  %m5 = mul i32 %x5, 8
+  %pd5 = getelementptr inbounds i32, i32* %d, i64 5
+  store i32 %m5, i32* %pd5, align 4
+  %pa6 = getelementptr inbounds i32, i32* %a, i64 6
+  %x6 = load i32, i32* %pa6, align 4
+  %m6 = mul i32 %x6, 9
+  %pd6 = getelementptr inbounds i32, i32* %d, i64 6
+  store i32 %m6, i32* %pd6, align 4
+  ret void
+}
@@ -233,6 +233,50 @@ for.end:
   ret void
 }
 
+; The same chain of three stores is vectorized as one <3 x float> bundle.
+
+; CHECK-LABEL: good_load_order_non_pow2
+
+; CHECK: %[[V1:[0-9]+]] = load <3 x float>, <3 x float>*
+; CHECK: %[[V2:[0-9]+]] = insertelement <3 x float> undef, float %1, i32 0
+; CHECK: %[[V3:[0-9]+]] = shufflevector <3 x float> %[[V2]], <3 x float> %[[V1]], <3 x i32> <i32 0, i32 3, i32 4>
+; CHECK:                = fmul <3 x float> %[[V1]], %[[V3]]
+
+define void @good_load_order_non_pow2() {
+entry:
+  br label %for.cond1.preheader
+
+for.cond1.preheader:
+  %0 = load float, float* getelementptr inbounds ([32000 x float], [32000 x float]* @a, i64 0, i64 0), align 16
+  br label %for.body3
+
+for.body3:
+  %1 = phi float [ %0, %for.cond1.preheader ], [ %6, %for.body3 ]
+  %indvars.iv = phi i64 [ 0, %for.cond1.preheader ], [ %indvars.iv.next, %for.body3 ]
+  %2 = add nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds [32000 x float], [32000 x float]* @a, i64 0, i64 %2
+  %3 = load float, float* %arrayidx, align 4
+  %arrayidx5 = getelementptr inbounds [32000 x float], [32000 x float]* @a, i64 0, i64 %indvars.iv
+  %mul6 = fmul float %3, %1
+  store float %mul6, float* %arrayidx5, align 4
+  %4 = add nsw i64 %indvars.iv, 2
+  %arrayidx11 = getelementptr inbounds [32000 x float], [32000 x float]* @a, i64 0, i64 %4
+  %5 = load float, float* %arrayidx11, align 4
+  %mul15 = fmul float %5, %3
+  store float %mul15, float* %arrayidx, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 3
+  %arrayidx21 = getelementptr inbounds [32000 x float], [32000 x float]* @a, i64 0, i64 %indvars.iv.next
+  %6 = load float, float* %arrayidx21, align 4
+  %mul25 = fmul float %6, %5
+  store float %mul25, float* %arrayidx11, align 4
+  %7 = trunc i64 %indvars.iv.next to i32
+  %cmp2 = icmp slt i32 %7, 31995
+  br i1 %cmp2, label %for.body3, label %for.end
+
+for.end:
+  ret void
+}
+
 ; Check vectorization of following code for double data type-
 ;  c[0] = a[0]+b[0];
 ;  c[1] = b[1]+a[1]; // swapped b[1] and a[1]
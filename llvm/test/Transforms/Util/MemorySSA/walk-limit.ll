@@ -0,0 +1,27 @@
+; RUN: opt -basicaa -print-memoryssa -verify-memoryssa -analyze < %s 2>&1 | FileCheck %s
+; RUN: opt -basicaa -print-memoryssa -verify-memoryssa -analyze -memssa-check-limit=2 < %s 2>&1 | FileCheck %s --check-prefix=LIMIT
+;
+; Once a clobber query has looked at too many stores, the walker stops and
+; conservatively reports the access it stopped at as the clobber.
+
+define i32 @foo(i32* noalias %p, i32* noalias %q) {
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %p
+  store i32 0, i32* %p
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 1, i32* %q
+  store i32 1, i32* %q
+; CHECK: 3 = MemoryDef(2)
+; CHECK-NEXT: store i32 2, i32* %q
+  store i32 2, i32* %q
+; CHECK: 4 = MemoryDef(3)
+; CHECK-NEXT: store i32 3, i32* %q
+  store i32 3, i32* %q
+
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %v = load i32, i32* %p
+; LIMIT: MemoryUse(2)
+; LIMIT-NEXT: %v = load i32, i32* %p
+  %v = load i32, i32* %p
+  ret i32 %v
+}
@@ -204,6 +204,58 @@ TEST_F(AliasAnalysisTest, getModRefInfo) {
   EXPECT_EQ(AA.getModRefInfo(AtomicRMW), MRI_ModRef);
 }
 
+TEST_F(AliasAnalysisTest, QueryCacheScope) {
+  // Setup function.
+  auto *PtrType = Type::getInt32PtrTy(C);
+  auto *I64Type = Type::getInt64Ty(C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), {PtrType}, false);
+  auto *F = cast<Function>(M.getOrInsertFunction("f", FTy));
+  auto *BB = BasicBlock::Create(C, "entry", F);
+  Argument *P = &*F->arg_begin();
+  auto *A = GetElementPtrInst::Create(Type::getInt32Ty(C), P,
+                                      ConstantInt::get(I64Type, 1), "a", BB);
+  auto *B = GetElementPtrInst::Create(Type::getInt32Ty(C), P,
+                                      ConstantInt::get(I64Type, 2), "b", BB);
+  ReturnInst::Create(C, nullptr, BB);
+
+  auto &AA = getAAResults(*F);
+  MemoryLocation LocA(A, 4), LocB(B, 4);
+  EXPECT_FALSE(AA.isCachingQueries());
+  {
+    AAResults::QueryCacheScope Scope(AA, "outer");
+    EXPECT_TRUE(AA.isCachingQueries());
+    EXPECT_EQ(NoAlias, AA.alias(LocA, LocB));
+    EXPECT_EQ(NoAlias, AA.alias(LocB, LocA));
+    AAResults::QueryCacheStats &Stats = AA.getQueryCacheStats();
+    EXPECT_EQ(1u, Stats.AliasMisses);
+    EXPECT_EQ(1u, Stats.AliasHits);
+    EXPECT_EQ(2u, Stats.DecomposedGEPMisses);
+    EXPECT_EQ(0u, Stats.DecomposedGEPHits);
+
+    // A nested scope shares the decomposed GEPs but counts separately.
+    {
+      AAResults::QueryCacheScope Inner(AA, "inner");
+      EXPECT_NE(NoAlias, AA.alias(MemoryLocation(A, 8), LocB));
+      EXPECT_EQ(1u, AA.getQueryCacheStats().AliasMisses);
+      EXPECT_EQ(2u, AA.getQueryCacheStats().DecomposedGEPHits);
+      EXPECT_EQ(0u, AA.getQueryCacheStats().DecomposedGEPMisses);
+    }
+    EXPECT_EQ(&Stats, &AA.getQueryCacheStats());
+  }
+  EXPECT_FALSE(AA.isCachingQueries());
+
+  // Nothing is remembered once the outermost scope ends, so changing the IR is
+  // fine.
+  B->setOperand(1, ConstantInt::get(I64Type, 1));
+  EXPECT_EQ(MustAlias, AA.alias(LocA, LocB));
+  {
+    AAResults::QueryCacheScope Scope(AA, "outer");
+    EXPECT_EQ(MustAlias, AA.alias(LocA, LocB));
+    EXPECT_EQ(0u, AA.getQueryCacheStats().AliasHits);
+    EXPECT_EQ(0u, AA.getQueryCacheStats().DecomposedGEPHits);
+  }
+}
+
 class AAPassInfraTest : public testing::Test {
 protected:
   LLVMContext C;
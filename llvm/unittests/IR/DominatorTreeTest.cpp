@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Dominators.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Constants.h"
@@ -258,3 +259,240 @@ INITIALIZE_PASS_BEGIN(DPass, "dpass", "dpass", false, false)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
 INITIALIZE_PASS_END(DPass, "dpass", "dpass", false, false)
+
+namespace {
+std::unique_ptr<Module> parseIR(LLVMContext &Context, const char *IR) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Context);
+  if (!M)
+    Err.print("DominatorTreeTest", errs());
+  return M;
+}
+
+BasicBlock *getBlock(Function &F, StringRef Name) {
+  for (BasicBlock &BB : F)
+    if (BB.getName() == Name)
+      return &BB;
+  llvm_unreachable("No block with that name");
+}
+
+// Edits the CFG of a function whose blocks all end in a switch, and queues
+// the same edits on a dominator tree.
+struct SwitchCFGEditor {
+  DominatorTree &DT;
+  uint64_t NextCaseValue = 100;
+
+  explicit SwitchCFGEditor(DominatorTree &DT) : DT(DT) {}
+
+  void insertEdge(BasicBlock *From, BasicBlock *To) {
+    auto *SI = cast<SwitchInst>(From->getTerminator());
+    SI->addCase(ConstantInt::get(Type::getInt32Ty(From->getContext()),
+                                 NextCaseValue++),
+                To);
+    DT.insertEdge(From, To);
+  }
+
+  bool deleteEdge(BasicBlock *From, BasicBlock *To) {
+    auto *SI = cast<SwitchInst>(From->getTerminator());
+    for (auto I = SI->case_begin(), E = SI->case_end(); I != E; ++I)
+      if (I.getCaseSuccessor() == To) {
+        SI->removeCase(I);
+        DT.deleteEdge(From, To);
+        return true;
+      }
+    return false;
+  }
+};
+
+const char *SwitchCFG =
+    "define void @f(i32 %x) {\n"
+    "entry:\n"
+    "  switch i32 %x, label %exit [ i32 0, label %a\n"
+    "                               i32 1, label %b ]\n"
+    "a:\n"
+    "  switch i32 %x, label %exit [ i32 0, label %c ]\n"
+    "b:\n"
+    "  switch i32 %x, label %exit [ i32 0, label %d ]\n"
+    "c:\n"
+    "  switch i32 %x, label %exit [ i32 0, label %d\n"
+    "                               i32 1, label %e ]\n"
+    "d:\n"
+    "  switch i32 %x, label %exit [ ]\n"
+    "e:\n"
+    "  switch i32 %x, label %exit [ i32 0, label %c ]\n"
+    "exit:\n"
+    "  ret void\n"
+    "}\n";
+
+TEST(DominatorTree, InsertEdge) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseIR(Context, SwitchCFG);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  SwitchCFGEditor Editor(DT);
+  BasicBlock *Entry = getBlock(F, "entry"), *A = getBlock(F, "a"),
+             *B = getBlock(F, "b"), *C = getBlock(F, "c"),
+             *D = getBlock(F, "d"), *E = getBlock(F, "e");
+
+  // An edge to a block whose immediate dominator also dominates the source
+  // changes nothing.
+  Editor.insertEdge(E, D);
+  EXPECT_TRUE(DT.hasPendingUpdates());
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.hasPendingUpdates());
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(D)->getIDom()->getBlock(), Entry);
+
+  // b -> c moves c up to entry; e is still only reachable through c.
+  EXPECT_EQ(DT.getNode(C)->getIDom()->getBlock(), A);
+  Editor.insertEdge(B, C);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(C)->getIDom()->getBlock(), Entry);
+  EXPECT_EQ(DT.getNode(E)->getIDom()->getBlock(), C);
+  EXPECT_FALSE(DT.dominates(A, C));
+
+  // a -> e moves e up to entry as well.
+  Editor.insertEdge(A, E);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(E)->getIDom()->getBlock(), Entry);
+}
+
+TEST(DominatorTree, DeleteEdge) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseIR(Context, SwitchCFG);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  SwitchCFGEditor Editor(DT);
+  BasicBlock *A = getBlock(F, "a"), *B = getBlock(F, "b"),
+             *C = getBlock(F, "c"), *D = getBlock(F, "d"),
+             *E = getBlock(F, "e");
+
+  // Without b -> d, c dominates d.
+  Editor.deleteEdge(B, D);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(D)->getIDom()->getBlock(), C);
+
+  // Deleting a back edge does not change anything.
+  Editor.deleteEdge(E, C);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+
+  // Without a -> c, c, d and e become unreachable.
+  Editor.deleteEdge(A, C);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(C), nullptr);
+  EXPECT_EQ(DT.getNode(D), nullptr);
+  EXPECT_EQ(DT.getNode(E), nullptr);
+  EXPECT_FALSE(DT.isReachableFromEntry(D));
+
+  // Making them reachable again adds them back.
+  Editor.insertEdge(B, D);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(D)->getIDom()->getBlock(), B);
+}
+
+TEST(DominatorTree, DeleteEdgeUnreachablePredecessor) {
+  // x is outside of the subtree of r, but loses its path through a.
+  const char *IR = "define void @f(i32 %v) {\n"
+                   "entry:\n"
+                   "  switch i32 %v, label %r [ i32 0, label %y ]\n"
+                   "r:\n"
+                   "  switch i32 %v, label %exit [ i32 0, label %a ]\n"
+                   "a:\n"
+                   "  switch i32 %v, label %x [ ]\n"
+                   "y:\n"
+                   "  switch i32 %v, label %x [ ]\n"
+                   "x:\n"
+                   "  br label %exit\n"
+                   "exit:\n"
+                   "  ret void\n"
+                   "}\n";
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseIR(Context, IR);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  SwitchCFGEditor Editor(DT);
+  BasicBlock *Entry = getBlock(F, "entry"), *R = getBlock(F, "r"),
+             *A = getBlock(F, "a"), *X = getBlock(F, "x"),
+             *Y = getBlock(F, "y");
+
+  EXPECT_EQ(DT.getNode(X)->getIDom()->getBlock(), Entry);
+  Editor.deleteEdge(R, A);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(A), nullptr);
+  EXPECT_EQ(DT.getNode(X)->getIDom()->getBlock(), Y);
+}
+
+TEST(DominatorTree, BatchedUpdates) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseIR(Context, SwitchCFG);
+  Function &F = *M->getFunction("f");
+  DominatorTree DT(F);
+  SwitchCFGEditor Editor(DT);
+  BasicBlock *A = getBlock(F, "a"), *B = getBlock(F, "b"),
+             *C = getBlock(F, "c"), *D = getBlock(F, "d"),
+             *E = getBlock(F, "e");
+
+  // Reroute c through b and d, and drop e.
+  Editor.deleteEdge(A, C);
+  Editor.insertEdge(B, C);
+  Editor.deleteEdge(C, E);
+  Editor.deleteEdge(C, D);
+  Editor.insertEdge(D, C);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+  EXPECT_EQ(DT.getNode(C)->getIDom()->getBlock(), B);
+  EXPECT_EQ(DT.getNode(D)->getIDom()->getBlock(), B);
+  EXPECT_EQ(DT.getNode(E), nullptr);
+
+  // An edge that is inserted and deleted again is ignored.
+  Editor.insertEdge(A, E);
+  Editor.deleteEdge(A, E);
+  DT.applyUpdates(F);
+  EXPECT_FALSE(DT.compare(DominatorTree(F)));
+}
+
+TEST(DominatorTree, RandomUpdates) {
+  // A chain of blocks that all branch to the exit.
+  std::string IR = "define void @f(i32 %x) {\n";
+  const unsigned NumBlocks = 16;
+  for (unsigned I = 0; I != NumBlocks; ++I)
+    IR += "bb" + utostr(I) + ":\n  switch i32 %x, label %exit [ i32 0, " +
+          "label %" + (I + 1 == NumBlocks ? "exit" : "bb" + utostr(I + 1)) +
+          " ]\n";
+  IR += "exit:\n  ret void\n}\n";
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseIR(Context, IR.c_str());
+  Function &F = *M->getFunction("f");
+  SmallVector<BasicBlock *, 16> Blocks;
+  for (unsigned I = 0; I != NumBlocks; ++I)
+    Blocks.push_back(getBlock(F, "bb" + utostr(I)));
+
+  DominatorTree DT(F);
+  SwitchCFGEditor Editor(DT);
+  uint32_t Seed = 42;
+  auto Random = [&Seed](unsigned N) {
+    Seed = Seed * 1103515245 + 12345;
+    return (Seed >> 16) % N;
+  };
+  for (unsigned Round = 0; Round != 300; ++Round) {
+    unsigned NumUpdates = 1 + Random(3);
+    for (unsigned I = 0; I != NumUpdates; ++I) {
+      BasicBlock *From = Blocks[Random(NumBlocks)];
+      // The entry block must not have predecessors.
+      BasicBlock *To = Blocks[1 + Random(NumBlocks - 1)];
+      if (Random(2) || !Editor.deleteEdge(From, To))
+        Editor.insertEdge(From, To);
+    }
+    DT.applyUpdates(F);
+    ASSERT_FALSE(DT.compare(DominatorTree(F))) << "round " << Round;
+  }
+}
+} // end anonymous namespace
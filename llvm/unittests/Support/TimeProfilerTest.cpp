@@ -0,0 +1,68 @@
+//===- unittests/TimeProfilerTest.cpp - Time profiler tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(TimeProfiler, DisabledByDefault) {
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+  // Scopes are no-ops while the profiler is disabled.
+  TimeTraceScope Scope("Unused", "detail");
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+}
+
+TEST(TimeProfiler, WritesChromeTrace) {
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0);
+  ASSERT_TRUE(timeTraceProfilerEnabled());
+  {
+    TimeTraceScope Outer("InstantiateFunction", "foo<int>");
+    {
+      // Recursive sections only count once towards the totals.
+      TimeTraceScope Inner("InstantiateFunction", "bar<\"q\">");
+    }
+    TimeTraceScope Parse("ParseClass", [] { return std::string("S"); });
+  }
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS);
+  OS.flush();
+
+  EXPECT_EQ(0u, Trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"InstantiateFunction\","
+                       "\"args\":{\"detail\":\"foo<int>\"}"));
+  EXPECT_NE(std::string::npos, Trace.find("\"detail\":\"bar<\\\"q\\\">\""));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"Total InstantiateFunction\","
+                       "\"args\":{\"detail\":\"1 calls\"}"));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"name\":\"Total ParseClass\","
+                       "\"args\":{\"detail\":\"1 calls\"}"));
+
+  std::string Summary;
+  raw_string_ostream SummaryOS(Summary);
+  timeTraceProfilerPrintSummary(SummaryOS, 1);
+  SummaryOS.flush();
+  EXPECT_NE(std::string::npos, Summary.find("InstantiateFunction:\n"));
+  EXPECT_NE(std::string::npos, Summary.find("ParseClass:\n"));
+  // Only the top entry of each section name is listed.
+  EXPECT_EQ(1, (int)(Summary.find("foo<int>") != std::string::npos) +
+                   (int)(Summary.find("bar<\"q\">") != std::string::npos));
+
+  timeTraceProfilerCleanup();
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+}
+
+} // end anonymous namespace
@@ -308,3 +308,184 @@ TEST_F(MemorySSATest, TestStoreDoubleQuery) {
   EXPECT_EQ(Clobber, StoreAccess);
   EXPECT_TRUE(MSSA.isLiveOnEntryDef(LiveOnEntry));
 }
+
+TEST_F(MemorySSATest, InsertUseCreatesPhi) {
+  // We create a diamond with a store on one side and nothing after the merge
+  // point, so that there is no phi in the merge block. Inserting a load there
+  // has to create one.
+  F = Function::Create(
+      FunctionType::get(B.getVoidTy(), {B.getInt8PtrTy()}, false),
+      GlobalValue::ExternalLinkage, "F", &M);
+  BasicBlock *Entry(BasicBlock::Create(C, "", F));
+  BasicBlock *Left(BasicBlock::Create(C, "", F));
+  BasicBlock *Right(BasicBlock::Create(C, "", F));
+  BasicBlock *Merge(BasicBlock::Create(C, "", F));
+  B.SetInsertPoint(Entry);
+  B.CreateCondBr(B.getTrue(), Left, Right);
+  B.SetInsertPoint(Left);
+  Argument *PointerArg = &*F->arg_begin();
+  StoreInst *SI = B.CreateStore(B.getInt8(16), PointerArg);
+  BranchInst::Create(Merge, Left);
+  BranchInst::Create(Merge, Right);
+
+  setupAnalyses();
+  MemorySSA &MSSA = Analyses->MSSA;
+  EXPECT_EQ(MSSA.getMemoryAccess(Merge), nullptr);
+
+  B.SetInsertPoint(Merge);
+  LoadInst *LI = B.CreateLoad(PointerArg);
+  auto *LoadAccess = cast<MemoryUse>(MSSA.createMemoryAccessInBB(
+      LI, nullptr, Merge, MemorySSA::Beginning));
+  MSSA.insertUse(LoadAccess);
+
+  MemoryPhi *MP = MSSA.getMemoryAccess(Merge);
+  ASSERT_NE(MP, nullptr);
+  EXPECT_EQ(LoadAccess->getDefiningAccess(), MP);
+  EXPECT_EQ(MP->getIncomingValueForBlock(Left), MSSA.getMemoryAccess(SI));
+  EXPECT_EQ(MP->getIncomingValueForBlock(Right), MSSA.getLiveOnEntryDef());
+  MSSA.verifyMemorySSA();
+
+  // A second load in the same block uses the same phi.
+  B.SetInsertPoint(Merge);
+  LoadInst *LI2 = B.CreateLoad(PointerArg);
+  auto *LoadAccess2 = cast<MemoryUse>(
+      MSSA.createMemoryAccessInBB(LI2, nullptr, Merge, MemorySSA::End));
+  MSSA.insertUse(LoadAccess2);
+  EXPECT_EQ(LoadAccess2->getDefiningAccess(), MP);
+  MSSA.verifyMemorySSA();
+}
+
+TEST_F(MemorySSATest, InsertUseWithoutPhi) {
+  // If both sides of a diamond have the same definition, inserting a load at
+  // the merge point must not leave a phi behind.
+  F = Function::Create(
+      FunctionType::get(B.getVoidTy(), {B.getInt8PtrTy()}, false),
+      GlobalValue::ExternalLinkage, "F", &M);
+  BasicBlock *Entry(BasicBlock::Create(C, "", F));
+  BasicBlock *Left(BasicBlock::Create(C, "", F));
+  BasicBlock *Right(BasicBlock::Create(C, "", F));
+  BasicBlock *Merge(BasicBlock::Create(C, "", F));
+  B.SetInsertPoint(Entry);
+  Argument *PointerArg = &*F->arg_begin();
+  StoreInst *SI = B.CreateStore(B.getInt8(16), PointerArg);
+  B.CreateCondBr(B.getTrue(), Left, Right);
+  BranchInst::Create(Merge, Left);
+  BranchInst::Create(Merge, Right);
+
+  setupAnalyses();
+  MemorySSA &MSSA = Analyses->MSSA;
+
+  B.SetInsertPoint(Merge);
+  LoadInst *LI = B.CreateLoad(PointerArg);
+  auto *LoadAccess = cast<MemoryUse>(MSSA.createMemoryAccessInBB(
+      LI, nullptr, Merge, MemorySSA::Beginning));
+  MSSA.insertUse(LoadAccess);
+
+  EXPECT_EQ(MSSA.getMemoryAccess(Merge), nullptr);
+  EXPECT_EQ(LoadAccess->getDefiningAccess(), MSSA.getMemoryAccess(SI));
+  MSSA.verifyMemorySSA();
+}
+
+TEST_F(MemorySSATest, InsertDefInDiamond) {
+  // We create a diamond with a load after the merge point, and then insert a
+  // store on one side. The load must now use a phi that merges the store with
+  // liveOnEntry.
+  F = Function::Create(
+      FunctionType::get(B.getVoidTy(), {B.getInt8PtrTy()}, false),
+      GlobalValue::ExternalLinkage, "F", &M);
+  BasicBlock *Entry(BasicBlock::Create(C, "", F));
+  BasicBlock *Left(BasicBlock::Create(C, "", F));
+  BasicBlock *Right(BasicBlock::Create(C, "", F));
+  BasicBlock *Merge(BasicBlock::Create(C, "", F));
+  B.SetInsertPoint(Entry);
+  B.CreateCondBr(B.getTrue(), Left, Right);
+  BranchInst::Create(Merge, Left);
+  BranchInst::Create(Merge, Right);
+  B.SetInsertPoint(Merge);
+  Argument *PointerArg = &*F->arg_begin();
+  LoadInst *LI = B.CreateLoad(PointerArg);
+
+  setupAnalyses();
+  MemorySSA &MSSA = Analyses->MSSA;
+  auto *LoadAccess = cast<MemoryUse>(MSSA.getMemoryAccess(LI));
+  EXPECT_TRUE(MSSA.isLiveOnEntryDef(LoadAccess->getDefiningAccess()));
+
+  B.SetInsertPoint(Left->getTerminator());
+  StoreInst *SI = B.CreateStore(B.getInt8(16), PointerArg);
+  auto *StoreAccess = cast<MemoryDef>(
+      MSSA.createMemoryAccessInBB(SI, nullptr, Left, MemorySSA::End));
+  MSSA.insertDef(StoreAccess);
+
+  EXPECT_TRUE(MSSA.isLiveOnEntryDef(StoreAccess->getDefiningAccess()));
+  MemoryPhi *MP = MSSA.getMemoryAccess(Merge);
+  ASSERT_NE(MP, nullptr);
+  EXPECT_EQ(MP->getIncomingValueForBlock(Left), StoreAccess);
+  EXPECT_EQ(MP->getIncomingValueForBlock(Right), MSSA.getLiveOnEntryDef());
+  EXPECT_EQ(LoadAccess->getDefiningAccess(), MP);
+  EXPECT_EQ(Analyses->Walker->getClobberingMemoryAccess(LI), MP);
+  MSSA.verifyMemorySSA();
+}
+
+TEST_F(MemorySSATest, InsertDefBeforeDef) {
+  // Inserting a store in front of another one makes it the defining access of
+  // that store and the clobber of loads from the location it writes. Loads
+  // that it does not clobber keep their defining access.
+  F = Function::Create(FunctionType::get(B.getVoidTy(), {}, false),
+                       GlobalValue::ExternalLinkage, "F", &M);
+  B.SetInsertPoint(BasicBlock::Create(C, "", F));
+  Type *Int8 = Type::getInt8Ty(C);
+  Value *A = B.CreateAlloca(Int8, ConstantInt::get(Int8, 1), "A");
+  Value *Other = B.CreateAlloca(Int8, ConstantInt::get(Int8, 1), "B");
+  StoreInst *SI = B.CreateStore(ConstantInt::get(Int8, 0), Other);
+  LoadInst *LoadA = B.CreateLoad(A);
+  LoadInst *LoadOther = B.CreateLoad(Other);
+
+  setupAnalyses();
+  MemorySSA &MSSA = Analyses->MSSA;
+  auto *StoreAccess = cast<MemoryDef>(MSSA.getMemoryAccess(SI));
+  auto *LoadOtherAccess = cast<MemoryUse>(MSSA.getMemoryAccess(LoadOther));
+
+  B.SetInsertPoint(SI);
+  StoreInst *NewSI = B.CreateStore(ConstantInt::get(Int8, 1), A);
+  auto *NewAccess = cast<MemoryDef>(
+      MSSA.createMemoryAccessBefore(NewSI, nullptr, StoreAccess));
+  MSSA.insertDef(NewAccess);
+
+  EXPECT_TRUE(MSSA.isLiveOnEntryDef(NewAccess->getDefiningAccess()));
+  EXPECT_EQ(StoreAccess->getDefiningAccess(), NewAccess);
+  EXPECT_EQ(LoadOtherAccess->getDefiningAccess(), StoreAccess);
+  EXPECT_EQ(Analyses->Walker->getClobberingMemoryAccess(LoadA), NewAccess);
+  MSSA.verifyMemorySSA();
+}
+
+TEST_F(MemorySSATest, MoveAUse) {
+  // Hoist a load from one side of a diamond to the entry block.
+  F = Function::Create(
+      FunctionType::get(B.getVoidTy(), {B.getInt8PtrTy()}, false),
+      GlobalValue::ExternalLinkage, "F", &M);
+  BasicBlock *Entry(BasicBlock::Create(C, "", F));
+  BasicBlock *Left(BasicBlock::Create(C, "", F));
+  BasicBlock *Right(BasicBlock::Create(C, "", F));
+  BasicBlock *Merge(BasicBlock::Create(C, "", F));
+  B.SetInsertPoint(Entry);
+  Argument *PointerArg = &*F->arg_begin();
+  StoreInst *SI = B.CreateStore(B.getInt8(16), PointerArg);
+  B.CreateCondBr(B.getTrue(), Left, Right);
+  B.SetInsertPoint(Left);
+  LoadInst *LI = B.CreateLoad(PointerArg);
+  BranchInst::Create(Merge, Left);
+  BranchInst::Create(Merge, Right);
+
+  setupAnalyses();
+  MemorySSA &MSSA = Analyses->MSSA;
+  auto *LoadAccess = cast<MemoryUse>(MSSA.getMemoryAccess(LI));
+
+  LI->moveBefore(Entry->getTerminator());
+  MSSA.moveTo(LoadAccess, Entry, MemorySSA::End);
+
+  EXPECT_EQ(LoadAccess->getBlock(), Entry);
+  EXPECT_EQ(MSSA.getBlockAccesses(Left), nullptr);
+  EXPECT_EQ(LoadAccess->getDefiningAccess(), MSSA.getMemoryAccess(SI));
+  EXPECT_TRUE(MSSA.locallyDominates(MSSA.getMemoryAccess(SI), LoadAccess));
+  MSSA.verifyMemorySSA();
+}